@@ -0,0 +1,192 @@
+/*
+  Benchmark.ino
+
+  This sketch measures throughput and latency on real hardware: how fast the
+  board moves TCP data through the W5500, how long it takes to answer a UDP
+  datagram or an HTTP request, and what an idle server poll costs.
+
+  Drive it from a computer on the same network:
+  - TCP receive:  nc 192.168.1.177 5001 < bigfile
+  - TCP send:     nc 192.168.1.177 5002 > /dev/null   (stop with Ctrl-C)
+  - UDP echo:     nc -u 192.168.1.177 5003            (type lines)
+  - HTTP:         curl http://192.168.1.177/  or  ab -n 1000 http://192.168.1.177/
+
+  Each finished transfer prints its size, duration and MB/s; UDP and HTTP
+  print the time spent serving each datagram or request. Build with
+  -DETHERNET3_PERF=1 to also print the SPI transactions each test made (see
+  EthernetPerf.h). SimBenchmark counts the same operations without hardware.
+
+  Circuit:
+  - W5500 Ethernet module with CS on pin 10
+
+  Created for Ethernet3 library
+  This code is in the public domain.
+*/
+
+#include <Ethernet3.h>
+#include <EthernetUdp2.h>
+#include <HTTP.h>
+#include <SPI.h>
+
+byte mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
+IPAddress ip(192, 168, 1, 177);
+
+W5500 chip(10);  // 10 is the CS pin for the W5500 chip
+
+EthernetClass Ethernet(&chip);
+EthernetServer recvServer(&Ethernet, &chip, 5001);
+EthernetServer sendServer(&Ethernet, &chip, 5002);
+EthernetUDP Udp(&Ethernet, &chip);
+HTTPServer http(&Ethernet, &chip, 80);
+
+const uint16_t UDP_PORT = 5003;
+const unsigned long SEND_SECONDS = 10;  // length of a TCP send test
+
+uint8_t buffer[2048];
+uint32_t httpServed = 0;
+
+EthernetPerfStats perfBefore;
+
+HTTPResponse handleRoot(const HTTPRequest& request) {
+    httpServed++;
+    return HTTPServer::sendPlain("hello");
+}
+
+// Remember the counters at the start of a test
+void perfStart() { Ethernet.perfSnapshot(perfBefore); }
+
+// Print the SPI transactions since perfStart(), if the counters are compiled in
+void perfPrint() {
+    EthernetPerfStats now;
+    if (!Ethernet.perfSnapshot(now)) return;
+    Serial.print("  SPI reads ");
+    Serial.print(now.spiReads - perfBefore.spiReads);
+    Serial.print(", writes ");
+    Serial.print(now.spiWrites - perfBefore.spiWrites);
+    Serial.print(", bytes ");
+    Serial.println((now.spiBytesRead - perfBefore.spiBytesRead) +
+                   (now.spiBytesWritten - perfBefore.spiBytesWritten));
+}
+
+void printRate(const char* name, uint32_t bytes, unsigned long us) {
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.print(bytes);
+    Serial.print(" bytes in ");
+    Serial.print(us / 1000);
+    Serial.print(" ms, ");
+    Serial.print(us ? (float)bytes / us : 0, 3);  // bytes per us == MB/s
+    Serial.println(" MB/s");
+}
+
+// Time EthernetServer::available() with nobody connecting
+void benchIdlePoll() {
+    const int polls = 1000;
+    perfStart();
+    unsigned long start = micros();
+    for (int i = 0; i < polls; i++) recvServer.available();
+    unsigned long us = micros() - start;
+    Serial.print("Idle server poll: ");
+    Serial.print((float)us / polls, 1);
+    Serial.println(" us");
+    perfPrint();
+}
+
+// Read everything the peer sends until it closes
+void benchReceive(EthernetClient& client) {
+    uint32_t total = 0;
+    perfStart();
+    unsigned long start = micros();
+    while (client.connected() || client.available()) {
+        int n = client.read(buffer, sizeof(buffer));
+        if (n > 0) total += n;
+    }
+    unsigned long us = micros() - start;
+    client.stop();
+    printRate("TCP receive", total, us);
+    perfPrint();
+}
+
+// Send for SEND_SECONDS or until the peer goes away
+void benchSend(EthernetClient& client) {
+    uint32_t total = 0;
+    perfStart();
+    unsigned long start = micros();
+    while (client.connected() && micros() - start < SEND_SECONDS * 1000000UL) {
+        total += client.write(buffer, sizeof(buffer));
+    }
+    unsigned long us = micros() - start;
+    client.stop();
+    printRate("TCP send", total, us);
+    perfPrint();
+}
+
+// A connection to the send port carries no data, so available() will not
+// hand it out: look for an established socket on that port instead
+int findSendSocket() {
+    for (int s = 0; s < MAX_SOCK_NUM; s++) {
+        if (chip.readSnSR(s) == SnSR::ESTABLISHED && chip.readSnPORT(s) == 5002) return s;
+    }
+    return -1;
+}
+
+void serviceUDP() {
+    unsigned long start = micros();
+    int size = Udp.parsePacket();
+    if (size <= 0) return;
+    int n = Udp.read(buffer, sizeof(buffer));
+    Udp.beginPacket(Udp.remoteIP(), Udp.remotePort());
+    Udp.write(buffer, n);
+    Udp.endPacket();
+    unsigned long us = micros() - start;
+    Serial.print("UDP echo ");
+    Serial.print(size);
+    Serial.print(" bytes: ");
+    Serial.print(us);
+    Serial.println(" us");
+}
+
+void serviceHTTP() {
+    uint32_t served = httpServed;
+    unsigned long start = micros();
+    http.handleClient();
+    unsigned long us = micros() - start;
+    if (httpServed == served) return;
+    Serial.print("HTTP request: ");
+    Serial.print(us);
+    Serial.println(" us");
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+        ; // wait for serial port to connect. Needed for native USB port only
+    }
+
+    Ethernet.begin(mac, ip);
+    recvServer.begin();
+    sendServer.begin();
+    Udp.begin(UDP_PORT);
+    http.onGET("/", handleRoot);
+    http.begin();
+    memset(buffer, 'x', sizeof(buffer));
+
+    Serial.print("Benchmark ready at ");
+    Serial.println(Ethernet.localIP());
+    benchIdlePoll();
+}
+
+void loop() {
+    EthernetClient incoming = recvServer.available();
+    if (incoming) benchReceive(incoming);
+
+    sendServer.available();  // keeps the send port listening
+    int s = findSendSocket();
+    if (s >= 0) {
+        EthernetClient outgoing(&Ethernet, &chip, s);
+        benchSend(outgoing);
+    }
+
+    serviceUDP();
+    serviceHTTP();
+}
@@ -0,0 +1,55 @@
+/*
+ * HTTP Assets Example
+ *
+ * Serves a small web UI compiled into flash. The files in data/ were turned
+ * into assets.h with
+ *
+ *   python3 extras/embed_assets.py examples/HTTPAssets/data -o examples/HTTPAssets/assets.h
+ *
+ * Each file is stored gzip-compressed with its response headers and ETag, so
+ * a page load costs no RAM for the content, browsers that already have a
+ * file get a 304 without a body, and the bytes on the wire are the
+ * compressed ones. Regenerate assets.h after editing anything in data/.
+ *
+ * Circuit:
+ * * Ethernet shield attached to pins 10, 11, 12, 13
+ */
+
+#include <Ethernet3.h>
+#include <SPI.h>
+#include <HTTP.h>
+
+#include "assets.h"
+
+byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
+IPAddress ip(192, 168, 1, 177);
+
+W5500 chip(10);
+EthernetClass Ethernet(&chip);
+HTTPServer server(&Ethernet, &chip, 80);
+
+HTTPResponse handleUptime(const HTTPRequest& request) {
+  return HTTPServer::sendPlain(String(millis() / 1000));
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  Ethernet.begin(mac, ip);
+
+  // Files from flash first, then the dynamic routes
+  server.serveAssets(HTTP_ASSETS, HTTP_ASSET_COUNT);
+  server.onGET("/api/uptime", handleUptime);
+  server.begin();
+
+  Serial.print("Open http://");
+  Serial.print(Ethernet.localIP());
+  Serial.println("/");
+}
+
+void loop() {
+  server.handleClient();
+}
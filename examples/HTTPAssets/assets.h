@@ -0,0 +1,78 @@
+// Generated by extras/embed_assets.py from data; do not edit.
+// 3 entries, 446 bytes of bodies.
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <HTTPAsset.h>
+
+static const uint8_t asset_index_html_gz[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x91, 0xb1, 0x4e, 0x03, 0x31,
+    0x0c, 0x86, 0xf7, 0x3e, 0x85, 0xb9, 0xe5, 0xae, 0x43, 0x2f, 0x42, 0x2c, 0x08, 0x72, 0x41, 0xa2,
+    0xed, 0xc0, 0x04, 0x43, 0x19, 0x18, 0xc3, 0xc5, 0xd7, 0x44, 0xe4, 0x72, 0x51, 0xe2, 0x56, 0x54,
+    0x88, 0x77, 0x27, 0xc9, 0xb5, 0xea, 0xc2, 0x64, 0xeb, 0xfb, 0xfd, 0xdb, 0x8e, 0xc3, 0x6f, 0x36,
+    0xaf, 0xeb, 0xdd, 0xc7, 0xdb, 0x16, 0x34, 0x8d, 0x56, 0x2c, 0xf8, 0x25, 0xa0, 0x54, 0x62, 0x01,
+    0xc0, 0x47, 0x24, 0x09, 0xbd, 0x96, 0x21, 0x22, 0x75, 0xd5, 0x81, 0x86, 0xd5, 0x7d, 0x55, 0x04,
+    0x32, 0x64, 0x51, 0x6c, 0x49, 0x63, 0x70, 0x48, 0x77, 0xb0, 0xc1, 0xa3, 0xe9, 0x91, 0xb3, 0x99,
+    0xe7, 0x0a, 0x6b, 0xdc, 0x17, 0x04, 0xb4, 0x5d, 0x15, 0xe9, 0x64, 0x31, 0x6a, 0x44, 0xaa, 0x40,
+    0x07, 0x1c, 0xba, 0x8a, 0x15, 0xd4, 0xf6, 0x31, 0xa6, 0x6e, 0x9c, 0xcd, 0xe3, 0xf8, 0xe7, 0xa4,
+    0x4e, 0xc5, 0xaa, 0x6f, 0xff, 0xe9, 0x9c, 0x60, 0xd6, 0xbc, 0xd8, 0x69, 0x13, 0xc1, 0xcb, 0x3d,
+    0x82, 0x74, 0x0a, 0x0c, 0x45, 0xb8, 0x0e, 0x00, 0x19, 0x10, 0x22, 0x86, 0x23, 0x2a, 0x18, 0xc2,
+    0x34, 0xc2, 0x60, 0x65, 0xd4, 0x2d, 0x67, 0xfe, 0x6c, 0x7e, 0xf7, 0x64, 0x46, 0x7c, 0x00, 0x1e,
+    0xbd, 0x74, 0x60, 0x54, 0x7a, 0x54, 0x21, 0x95, 0x78, 0xe2, 0x2c, 0x33, 0x01, 0xf1, 0x52, 0x1d,
+    0xfb, 0x60, 0x3c, 0xe5, 0x14, 0x60, 0x40, 0xea, 0x75, 0x53, 0x33, 0xe9, 0x0d, 0x9b, 0x1d, 0xf5,
+    0xb2, 0x4d, 0x3b, 0xba, 0x26, 0x40, 0x27, 0x20, 0xb4, 0x84, 0xdf, 0xd4, 0x2c, 0xcf, 0x8c, 0x32,
+    0xfb, 0x29, 0x46, 0x00, 0x35, 0xf5, 0x87, 0x11, 0x1d, 0xb5, 0x7b, 0xa4, 0xad, 0xc5, 0x9c, 0x3e,
+    0x9f, 0x5e, 0x54, 0x53, 0x5f, 0xfb, 0x24, 0xef, 0x7a, 0x72, 0x94, 0x14, 0xe8, 0x80, 0x1e, 0x8b,
+    0xf1, 0x77, 0x99, 0x63, 0x5a, 0xea, 0xbc, 0x05, 0x67, 0xf3, 0x7d, 0xd2, 0x25, 0xca, 0x27, 0xfd,
+    0x01, 0xea, 0xe2, 0xe9, 0x60, 0xbc, 0x01, 0x00, 0x00,
+};
+
+static const char asset_index_html_gz_headers[] PROGMEM =
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "ETag: \"31051aef2b8c0439-gz\"\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Content-Encoding: gzip\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "";
+
+static const char asset_index_html_gz_etag[] PROGMEM = "\"31051aef2b8c0439-gz\"";
+
+static const char asset_index_html_gz_path0[] PROGMEM = "/";
+
+static const char asset_index_html_gz_path1[] PROGMEM = "/index.html";
+
+static const uint8_t asset_style_css_gz[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x35, 0x8d, 0xcd, 0x0a, 0xc3, 0x20,
+    0x10, 0x84, 0xef, 0x3e, 0xc5, 0x42, 0xce, 0x82, 0x91, 0x92, 0x83, 0x79, 0x9a, 0xf5, 0x2f, 0x91,
+    0xaa, 0x5b, 0xd4, 0xd0, 0x84, 0xd0, 0x77, 0x6f, 0x4c, 0x29, 0x73, 0x9a, 0x6f, 0x66, 0x18, 0x4d,
+    0xf6, 0x80, 0x93, 0x01, 0x78, 0xca, 0x8d, 0x7b, 0x4c, 0x21, 0x1e, 0x0a, 0x2a, 0xe6, 0xca, 0xab,
+    0x2b, 0xc1, 0xcf, 0x57, 0x94, 0xb0, 0x2c, 0x21, 0x2b, 0x90, 0x2e, 0x01, 0x6e, 0x8d, 0x7e, 0x6c,
+    0xe7, 0xef, 0x60, 0xdb, 0xaa, 0xe0, 0x21, 0x5c, 0xea, 0xc8, 0x50, 0xa4, 0xa2, 0x60, 0x90, 0x52,
+    0x76, 0xab, 0xd1, 0x3c, 0x97, 0x42, 0x5b, 0xb6, 0x17, 0xf3, 0xd8, 0x35, 0xb3, 0x0f, 0x63, 0xeb,
+    0x78, 0xff, 0xfd, 0xdb, 0x42, 0x4c, 0x13, 0xe2, 0x3d, 0xa0, 0x62, 0x5d, 0xe1, 0x9a, 0x5a, 0xa3,
+    0xa4, 0x60, 0x7c, 0xed, 0x50, 0x29, 0x06, 0x0b, 0x83, 0x31, 0xa6, 0x4f, 0xbf, 0x75, 0xba, 0xa6,
+    0x40, 0xac, 0x00, 0x00, 0x00,
+};
+
+static const char asset_style_css_gz_headers[] PROGMEM =
+    "Content-Type: text/css; charset=utf-8\r\n"
+    "ETag: \"0b0571262f2a59c8-gz\"\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Content-Encoding: gzip\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "";
+
+static const char asset_style_css_gz_etag[] PROGMEM = "\"0b0571262f2a59c8-gz\"";
+
+static const char asset_style_css_gz_path0[] PROGMEM = "/style.css";
+
+static const HTTPAsset HTTP_ASSETS[] PROGMEM = {
+    {asset_index_html_gz_path0, asset_index_html_gz_headers, asset_index_html_gz_etag, asset_index_html_gz, 297, HTTP_ASSET_GZIP},
+    {asset_index_html_gz_path1, asset_index_html_gz_headers, asset_index_html_gz_etag, asset_index_html_gz, 297, HTTP_ASSET_GZIP},
+    {asset_style_css_gz_path0, asset_style_css_gz_headers, asset_style_css_gz_etag, asset_style_css_gz, 149, HTTP_ASSET_GZIP},
+};
+
+#define HTTP_ASSET_COUNT (sizeof(HTTP_ASSETS) / sizeof(HTTP_ASSETS[0]))
+
+#endif
@@ -69,9 +69,7 @@ void loop() {
 
 // this method makes an HTTP GET request:
 void httpGet() {
-  // close any connection before send a new request.
-  httpClient.disconnect();
-
+  // The connection from the previous request is reused if the server kept it open
   Serial.println("\nStarting HTTP GET request...");
   
   // Make a complete GET request with URL
@@ -85,11 +83,10 @@ void httpGet() {
   
   Serial.println("Headers:");
   for (int i = 0; i < response.getHeaderCount(); i++) {
-    // This is a simple way to print headers - in real implementation
-    // you might want to add a method to iterate through headers
-    Serial.print("  Header ");
-    Serial.print(i);
-    Serial.println(" present");
+    Serial.print("  ");
+    Serial.print(response.getHeaderName(i));
+    Serial.print(": ");
+    Serial.println(response.getHeaderValue(i));
   }
   
   Serial.println("Body:");
@@ -123,4 +120,38 @@ void httpGetManual() {
   }
   
   lastConnectionTime = millis();
+}
+
+// Streaming: read a body of any size without holding it in memory
+void httpGetStreaming() {
+  Serial.println("\nStarting streaming HTTP GET request...");
+
+  if (!httpClient.connect("httpbin.org", 80)) {
+    Serial.println("Connection failed");
+    return;
+  }
+
+  HTTPRequest request = HTTPRequest::GET("/stream-bytes/4096");
+  request.addHeader("Host", "httpbin.org");
+  int status = httpClient.startRequest(request);
+  Serial.print("Status Code: ");
+  Serial.println(status);
+
+  // Ends as soon as the last byte arrives, chunked or not
+  HTTPResponseBody& body = httpClient.responseBody();
+  uint8_t buf[64];
+  unsigned long total = 0;
+  unsigned long last = millis();
+  while (!body.complete() && millis() - last < 5000) {
+    int n = body.read(buf, sizeof(buf));
+    if (n > 0) {
+      total += n;
+      last = millis();
+    }
+  }
+  httpClient.endResponse();
+
+  Serial.print("Received ");
+  Serial.print(total);
+  Serial.println(" bytes");
 }
\ No newline at end of file
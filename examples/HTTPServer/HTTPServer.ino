@@ -43,6 +43,7 @@ void setup() {
   server.onGET("/sensors", handleSensors);
   server.onGET("/api/status", handleAPIStatus);
   server.onPOST("/api/data", handleAPIData);
+  server.onGET("/log.csv", handleLog);
   server.onNotFound(handleNotFound);
   
   server.begin();
@@ -54,6 +55,7 @@ void setup() {
   Serial.println("  GET  /sensors");
   Serial.println("  GET  /api/status");
   Serial.println("  POST /api/data");
+  Serial.println("  GET  /log.csv");
 }
 
 void loop() {
@@ -117,6 +119,22 @@ HTTPResponse handleAPIData(const HTTPRequest& request) {
   return HTTPServer::sendJSON(json);
 }
 
+// Streaming handler: rows go straight to the socket in chunks, so the
+// response can be far larger than free RAM
+void handleLog(const HTTPRequest& request, HTTPResponseWriter& response) {
+  response.begin(200);
+  response.contentType("text/csv");
+  response.println("sample,A0,A1");
+  for (int i = 0; i < 500; i++) {
+    response.print(i);
+    response.print(',');
+    response.print(analogRead(0));
+    response.print(',');
+    response.println(analogRead(1));
+  }
+  response.end();
+}
+
 HTTPResponse handleNotFound(const HTTPRequest& request) {
   String html = "<!DOCTYPE html><html><head><title>404 Not Found</title></head>";
   html += "<body><h1>404 - Page Not Found</h1>";
@@ -0,0 +1,79 @@
+/*
+  MultiChipServer.ino
+
+  This sketch runs one echo server across two W5500 chips with EthernetGroup.
+
+  A single W5500 has 8 sockets. With two chips in a group the server listens
+  on port 23 of both, so twice as many clients can be connected at once, and
+  each chip's traffic uses its own SPI transactions (and its own bus, if the
+  chips are wired to different SPI ports).
+
+  This example:
+  - Puts two W5500s (CS on pins 10 and 9) in one group, each with its own
+    MAC and IP address
+  - Echoes back whatever clients of either chip send
+  - Prints the sockets in use across both chips every ten seconds
+
+  Created for Ethernet3 library
+  This code is in the public domain.
+*/
+
+#include <Ethernet3.h>
+#include <EthernetGroup.h>
+#include <SPI.h>
+
+byte mac0[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xE0};
+byte mac1[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xE1};
+IPAddress ip0(192, 168, 1, 180);
+IPAddress ip1(192, 168, 1, 181);
+
+W5500 chip0(10);  // 10 is the CS pin of the first W5500
+W5500 chip1(9);   // 9 is the CS pin of the second; pass &SPI1 to use another bus
+
+EthernetClass ethernet0(&chip0);
+EthernetClass ethernet1(&chip1);
+EthernetGroup group;
+EthernetGroupServer server(&group, 23);
+
+uint8_t buffer[256];
+unsigned long lastReport = 0;
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  group.add(&ethernet0, &chip0);
+  group.add(&ethernet1, &chip1);
+  ethernet0.begin(mac0, ip0);
+  ethernet1.begin(mac1, ip1);
+
+  // Listens on port 23 of every chip in the group
+  server.begin();
+
+  Serial.print("Echo server on ");
+  Serial.print(ethernet0.localIP());
+  Serial.print(" and ");
+  Serial.println(ethernet1.localIP());
+}
+
+void loop() {
+  group.maintain();
+
+  // Clients of both chips are served in turn
+  EthernetClient client = server.available();
+  if (client) {
+    int n = client.read(buffer, sizeof(buffer));
+    if (n > 0) client.write(buffer, n);
+  }
+
+  if (millis() - lastReport > 10000) {
+    lastReport = millis();
+    EthernetSocketStats stats = group.socketStats();
+    Serial.print("Sockets in use: ");
+    Serial.print(stats.inUse);
+    Serial.print(" of ");
+    Serial.println(stats.total);
+  }
+}
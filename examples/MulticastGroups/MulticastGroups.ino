@@ -0,0 +1,95 @@
+/*
+  MulticastGroups.ino
+
+  This sketch listens to several multicast groups at once with EthernetMulticast.
+
+  Each group gets its own socket. The chip filters multicast in hardware on the
+  group programmed into each socket and sends the IGMP joins itself, so traffic
+  for groups the device has not joined never crosses the SPI bus.
+
+  This example:
+  - Joins 239.255.0.1 (status) and 239.255.0.2 (alarms) on port 12345
+  - Sends each group's datagrams to its own handler
+  - Leaves the alarm group after ten minutes
+
+  Compatible with MulticastSender.ino example.
+
+  Created for Ethernet3 library
+  This code is in the public domain.
+*/
+
+#include <Ethernet3.h>
+#include <EthernetMulticast.h>
+#include <SPI.h>
+
+byte mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xEE};
+IPAddress ip(192, 168, 1, 179);
+
+W5500 chip(10);  // 10 is the CS pin for the W5500 chip
+
+EthernetClass Ethernet(&chip);
+EthernetMulticast multicast(&Ethernet, &chip);
+
+IPAddress statusGroup(239, 255, 0, 1);
+IPAddress alarmGroup(239, 255, 0, 2);
+const uint16_t groupPort = 12345;
+
+uint8_t packetBuffer[256];  // Datagrams are read into this buffer
+bool alarmsJoined = false;
+
+void printPacket(const char* label, IPAddress from, const uint8_t* data, uint16_t len) {
+  Serial.print(label);
+  Serial.print(" from ");
+  Serial.print(from);
+  Serial.print(": ");
+  Serial.write(data, len);
+  Serial.println();
+}
+
+void onStatus(void* ctx, IPAddress group, IPAddress from, uint16_t fromPort,
+              const uint8_t* data, uint16_t len) {
+  printPacket("Status", from, data, len);
+}
+
+void onAlarm(void* ctx, IPAddress group, IPAddress from, uint16_t fromPort,
+             const uint8_t* data, uint16_t len) {
+  printPacket("ALARM", from, data, len);
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  Ethernet.begin(mac, ip);
+  Serial.print("Local IP address: ");
+  Serial.println(Ethernet.localIP());
+
+  if (!multicast.join(statusGroup, groupPort, onStatus)) {
+    Serial.println("Failed to join the status group");
+  }
+
+  // IGMPv2 is the default; MulticastOpt also selects IGMPv1 and lets the chip
+  // drop broadcast and unicast datagrams on the socket
+  alarmsJoined = multicast.join(alarmGroup, groupPort, onAlarm, nullptr,
+                                MulticastOpt::BLOCK_BROADCAST);
+  if (!alarmsJoined) {
+    Serial.println("Failed to join the alarm group");
+  }
+
+  Serial.print("Member of ");
+  Serial.print(multicast.groupCount());
+  Serial.println(" groups");
+}
+
+void loop() {
+  multicast.poll(packetBuffer, sizeof(packetBuffer));
+
+  if (alarmsJoined && millis() > 600000UL) {
+    // Sends the IGMP leave and frees the socket
+    multicast.leave(alarmGroup, groupPort);
+    alarmsJoined = false;
+    Serial.println("Left the alarm group");
+  }
+}
@@ -60,7 +60,8 @@ void setup() {
   Serial.print("Local IP address: ");
   Serial.println(Ethernet.localIP());
   
-  // Begin multicast listening
+  // Begin multicast listening. The chip sends the IGMP join for the group and
+  // filters out other groups' traffic in hardware.
   if (Udp.beginMulticast(multicastIP, multicastPort)) {
     Serial.print("Successfully joined multicast group: ");
     Serial.print(multicastIP);
@@ -72,11 +73,6 @@ void setup() {
     return;
   }
   
-  // Additional multicast group join (optional)
-  if (Udp.joinMulticastGroup(multicastIP)) {
-    Serial.println("Multicast group join confirmed");
-  }
-  
   Serial.println("Listening for multicast messages...");
   Serial.println("Send messages using the MulticastSender example or any multicast sender.");
   Serial.println();
@@ -123,11 +119,13 @@ void loop() {
   Network Requirements:
   - All devices must be on the same network/subnet
   - Network switches/routers must support multicast forwarding
-  - Some networks may require IGMP configuration
+  - Switches with IGMP snooping forward the group once they see the
+    chip's IGMP join
   
   Troubleshooting:
   - If no packets are received, check your network configuration
   - Ensure the multicast IP (239.255.0.1) is valid and not filtered
   - Verify that sender and receiver use the same multicast group and port
   - Some networks may block multicast traffic by default
+  - To listen to several groups at once, see the MulticastGroups example
 */
\ No newline at end of file
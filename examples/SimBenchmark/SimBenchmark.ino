@@ -0,0 +1,184 @@
+/*
+  SimBenchmark.ino
+
+  This sketch measures how many SPI transactions and bytes each network
+  operation costs, without a W5500 or a network. It runs the library on
+  W5500Sim, a simulated chip that keeps the W5500 registers and socket memory
+  in RAM and counts every SPI frame the driver would have sent.
+
+  The counts depend only on the library code, not on the board, the wiring or
+  the network, so two firmware builds can be compared exactly: a change that
+  adds a register read to the receive path shows up here as one more read.
+
+  This example:
+  - Runs TCP receive/send, UDP receive/send, server polling, connection
+    accept and an HTTP request against the simulator
+  - Prints SPI reads, writes and bytes per operation, averaged over
+    several runs, and the CPU time each operation took
+
+  The simulator needs about 33 KB of RAM (ESP32, RP2040, STM32, Teensy).
+  Build with W5500SIM_MEM_KB=8 to halve that.
+
+  Created for Ethernet3 library
+  This code is in the public domain.
+*/
+
+#include <Ethernet3.h>
+#include <EthernetUdp2.h>
+#include <HTTP.h>
+#include <SPI.h>
+#include <chips/sim/w5500sim.h>
+
+byte mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
+IPAddress ip(192, 168, 1, 177);
+uint8_t peerIP[] = {192, 168, 1, 2};
+
+W5500Sim chip;  // no CS pin: nothing is wired
+
+EthernetClass Ethernet(&chip);
+EthernetServer server(&Ethernet, &chip, 23);
+EthernetUDP Udp(&Ethernet, &chip);
+HTTPServer http(&Ethernet, &chip, 80);
+
+const int RUNS = 8;         // each operation is averaged over this many runs
+const uint16_t CHUNK = 1024;  // bytes per TCP send / receive
+uint8_t buffer[CHUNK];
+uint32_t transmitted = 0;  // bytes the simulated chip put on the wire
+
+W5500SimStats before;
+unsigned long startedAt;
+
+void countTransmit(void* ctx, SOCKET s, const uint8_t* data, uint16_t len) {
+  transmitted += len;
+}
+
+HTTPResponse handleRoot(const HTTPRequest& request) {
+  return HTTPServer::sendPlain("hello");
+}
+
+// Find the socket in a given state (and, if port is not 0, on that port)
+int findSocket(uint8_t status, uint16_t port = 0) {
+  for (int s = 0; s < MAX_SOCK_NUM; s++) {
+    if (chip.readSnSR(s) == status && (port == 0 || chip.readSnPORT(s) == port)) return s;
+  }
+  return -1;
+}
+
+void startOp() {
+  before = chip.stats();
+  startedAt = micros();
+}
+
+// Print the SPI traffic and time since startOp(), per run
+void endOp(const char* name, int runs = RUNS) {
+  unsigned long elapsed = micros() - startedAt;
+  const W5500SimStats& now = chip.stats();
+  char line[96];
+  snprintf(line, sizeof(line), "%-18s %6lu %6lu %8lu %8lu %6lu", name,
+           (unsigned long)(now.reads - before.reads) / runs,
+           (unsigned long)(now.writes - before.writes) / runs,
+           (unsigned long)(now.bytesRead - before.bytesRead) / runs,
+           (unsigned long)(now.bytesWritten - before.bytesWritten) / runs,
+           elapsed / runs);
+  Serial.println(line);
+}
+
+void benchTCP() {
+  // Both sides of one connection: the simulated peer connects and sends,
+  // the sketch reads and answers
+  server.begin();
+  int s = findSocket(SnSR::LISTEN, 23);
+
+  startOp();
+  for (int i = 0; i < RUNS; i++) server.available();
+  endOp("server idle poll");
+
+  // A new connection is handed out once its first data has arrived
+  chip.peerConnect(s, peerIP, 40000);
+  chip.peerSend(s, buffer, 1);
+  startOp();
+  EthernetClient client = server.available();
+  endOp("server accept", 1);
+  client.read();
+
+  startOp();
+  for (int i = 0; i < RUNS; i++) {
+    chip.peerSend(s, buffer, CHUNK);
+    client.read(buffer, CHUNK);
+  }
+  endOp("tcp recv 1 KB");
+
+  startOp();
+  for (int i = 0; i < RUNS; i++) {
+    client.write(buffer, CHUNK);
+    client.flush();
+  }
+  endOp("tcp send 1 KB");
+
+  chip.peerClose(s);
+  client.stop();
+}
+
+void benchUDP() {
+  Udp.begin(5000);
+  int s = findSocket(SnSR::UDP, 5000);
+
+  startOp();
+  for (int i = 0; i < RUNS; i++) {
+    chip.peerSendUDP(s, peerIP, 6000, buffer, 64);
+    Udp.parsePacket();
+    Udp.read(buffer, 64);
+  }
+  endOp("udp recv 64 B");
+
+  startOp();
+  for (int i = 0; i < RUNS; i++) {
+    Udp.beginPacket(IPAddress(peerIP), 6000);
+    Udp.write(buffer, 64);
+    Udp.endPacket();
+  }
+  endOp("udp send 64 B");
+
+  Udp.stop();
+}
+
+void benchHTTP() {
+  static const char request[] = "GET / HTTP/1.1\r\nHost: bench\r\n\r\n";
+  http.onGET("/", handleRoot);
+  http.begin();
+  http.handleClient();
+  int s = findSocket(SnSR::LISTEN, 80);
+
+  // One keep-alive connection carrying every request
+  chip.peerConnect(s, peerIP, 40001);
+  startOp();
+  for (int i = 0; i < RUNS; i++) {
+    chip.peerSend(s, (const uint8_t*)request, sizeof(request) - 1);
+    http.handleClient();
+  }
+  endOp("http GET /");
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  Serial.println("Ethernet3 SPI cost per operation (W5500Sim)");
+  Serial.println("===========================================");
+
+  chip.onTransmit(countTransmit);
+  Ethernet.begin(mac, ip);
+  memset(buffer, 'x', sizeof(buffer));
+
+  Serial.println("operation           reads writes  rdbytes  wrbytes     us");
+  benchTCP();
+  benchUDP();
+  benchHTTP();
+
+  Serial.print("Bytes transmitted: ");
+  Serial.println(transmitted);
+}
+
+void loop() {}
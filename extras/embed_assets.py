@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Embed a directory of web files in flash for HTTPServer::serveAssets().
+
+Writes a header declaring every file as a PROGMEM byte array together with a
+PROGMEM HTTPAsset table (see src/HTTPAsset.h) holding the precomputed response
+headers and an ETag derived from the file's contents. Compressible files are
+stored gzip-encoded when that makes them smaller.
+
+    python3 extras/embed_assets.py data/ -o assets.h
+
+then, in the sketch:
+
+    #include "assets.h"
+    server.serveAssets(HTTP_ASSETS, HTTP_ASSET_COUNT);
+
+index.html in any directory is also served at the directory's path ("/" for
+the top level). Re-run the script whenever the files change.
+"""
+
+import argparse
+import gzip
+import hashlib
+import mimetypes
+import os
+import re
+import sys
+
+COMPRESSIBLE = (
+    "text/",
+    "application/javascript",
+    "application/json",
+    "application/xml",
+    "image/svg+xml",
+)
+
+EXTRA_TYPES = {
+    ".js": "application/javascript",
+    ".mjs": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".woff2": "font/woff2",
+    ".wasm": "application/wasm",
+}
+
+
+def content_type(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext in EXTRA_TYPES:
+        ctype = EXTRA_TYPES[ext]
+    else:
+        ctype = mimetypes.guess_type(path)[0] or "application/octet-stream"
+    if ctype.startswith("text/") or ctype in ("application/javascript", "application/json"):
+        ctype += "; charset=utf-8"
+    return ctype
+
+
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"').replace("\r\n", '\\r\\n"\n    "') + '"'
+
+
+def c_bytes(data, indent="    ", per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append(indent + ", ".join("0x%02x" % b for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def identifier(url, gz):
+    name = re.sub(r"[^0-9A-Za-z]", "_", url.strip("/")) or "index"
+    return "asset_" + name + ("_gz" if gz else "")
+
+
+def collect(root):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for filename in sorted(filenames):
+            if filename.startswith("."):
+                continue
+            full = os.path.join(dirpath, filename)
+            rel = os.path.relpath(full, root).replace(os.sep, "/")
+            files.append((full, "/" + rel))
+    return files
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("root", help="directory of files to embed")
+    parser.add_argument("-o", "--output", default="assets.h", help="header to write")
+    parser.add_argument("--cache-control", default="no-cache",
+                        help="Cache-Control value (default: no-cache, i.e. always revalidate)")
+    parser.add_argument("--no-gzip", action="store_true", help="store every file uncompressed")
+    parser.add_argument("--keep-identity", action="store_true",
+                        help="also store the uncompressed copy of compressed files, for "
+                             "clients that do not accept gzip")
+    args = parser.parse_args()
+
+    entries = []
+    arrays = []
+    total = 0
+    for full, url in collect(args.root):
+        with open(full, "rb") as f:
+            data = f.read()
+        ctype = content_type(url)
+        etag = '"%s"' % hashlib.sha1(data).hexdigest()[:16]
+
+        variants = [(data, False)]
+        if not args.no_gzip and ctype.startswith(COMPRESSIBLE):
+            packed = gzip.compress(data, compresslevel=9, mtime=0)
+            if len(packed) < len(data):
+                variants = [(packed, True)] + (variants if args.keep_identity else [])
+
+        urls = [url]
+        if os.path.basename(url) == "index.html":
+            urls.insert(0, url[: -len("index.html")])
+
+        for body, gz in variants:
+            name = identifier(url, gz)
+            tag = etag[:-1] + ('-gz"' if gz else '"')
+            headers = "Content-Type: %s\r\nETag: %s\r\nCache-Control: %s\r\n" % (
+                ctype, tag, args.cache_control)
+            if gz:
+                headers += "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n"
+            arrays.append("static const uint8_t %s[] PROGMEM = {\n%s\n};" % (name, c_bytes(body)))
+            arrays.append("static const char %s_headers[] PROGMEM =\n    %s;" % (name, c_string(headers)))
+            arrays.append("static const char %s_etag[] PROGMEM = %s;" % (name, c_string(tag)))
+            for i, u in enumerate(urls):
+                path_name = "%s_path%d" % (name, i)
+                arrays.append("static const char %s[] PROGMEM = %s;" % (path_name, c_string(u)))
+                entries.append("    {%s, %s_headers, %s_etag, %s, %d, %s}," % (
+                    path_name, name, name, name, len(body), "HTTP_ASSET_GZIP" if gz else "0"))
+            total += len(body)
+
+    if not entries:
+        sys.exit("no files found in " + args.root)
+
+    guard = re.sub(r"[^0-9A-Za-z]", "_", os.path.basename(args.output)).upper()
+    with open(args.output, "w", newline="\n") as out:
+        out.write("// Generated by extras/embed_assets.py from %s; do not edit.\n" % args.root)
+        out.write("// %d entries, %d bytes of bodies.\n\n" % (len(entries), total))
+        out.write("#ifndef %s\n#define %s\n\n#include <HTTPAsset.h>\n\n" % (guard, guard))
+        out.write("\n\n".join(arrays))
+        out.write("\n\nstatic const HTTPAsset HTTP_ASSETS[] PROGMEM = {\n")
+        out.write("\n".join(entries))
+        out.write("\n};\n\n#define HTTP_ASSET_COUNT (sizeof(HTTP_ASSETS) / sizeof(HTTP_ASSETS[0]))\n")
+        out.write("\n#endif\n")
+
+    print("%s: %d entries, %d bytes" % (args.output, len(entries), total))
+
+
+if __name__ == "__main__":
+    main()
@@ -4,6 +4,7 @@
 
 #include "Dhcp.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -11,132 +12,363 @@ DhcpClass::DhcpClass(EthernetClass* eth, EthernetChip* chip, unsigned long timeo
                      unsigned long responseTimeout)
     : _ethernet(eth),
       _chip(chip),
+      _dhcpTransactionId(0),
+      _leaseSec(0),
+      _leaseTick(0),
+      _startTime(0),
+      _unboundSince(0),
+      _lastSend(0),
+      _retransmit(responseTimeout),
+      _fallbackAfter(0),
       _timeout(timeout),
       _responseTimeout(responseTimeout),
+      _dhcp_state(DhcpState::STOPPED),
+      _fellBack(false),
+      _open(false),
+      _reboot(false),
+      _handler(nullptr),
+      _handlerCtx(nullptr),
       _dhcpUdpSocket(eth, chip) {
+    _dhcpUdpSocket.setSocketOwner(SockOwner::DHCP);
     memset(_dhcpMacAddr, 0, sizeof(_dhcpMacAddr));
-    memset(_dhcpLocalIp, 0, sizeof(_dhcpLocalIp));
-    memset(_dhcpSubnetMask, 0, sizeof(_dhcpSubnetMask));
-    memset(_dhcpGatewayIp, 0, sizeof(_dhcpGatewayIp));
-    memset(_dhcpDhcpServerIp, 0, sizeof(_dhcpDhcpServerIp));
-    memset(_dhcpDnsServerIp, 0, sizeof(_dhcpDnsServerIp));
     _dhcpDnsdomainName = NULL;
     _dhcpHostName = NULL;
     reset_DHCP_lease();
 }
 
 int DhcpClass::beginWithDHCP(uint8_t* mac, unsigned long timeout, unsigned long responseTimeout) {
-    _dhcpLeaseTime = 0;
-    _dhcpT1 = 0;
-    _dhcpT2 = 0;
-    _lastCheck = 0;
     _timeout = timeout;
     _responseTimeout = responseTimeout;
 
-    // zero out _dhcpMacAddr
-    memset(_dhcpMacAddr, 0, 6);
-    reset_DHCP_lease();
+    start(mac);
+
+    unsigned long startTime = millis();
+    while (_dhcp_state != DhcpState::BOUND) {
+        if ((millis() - startTime) > _timeout) {
+            stop();
+            return 0;
+        }
+        checkLease();
+        delay(10);
+    }
+    return 1;
+}
 
+void DhcpClass::start(uint8_t* mac, unsigned long fallbackAfter) {
+    _fallbackAfter = fallbackAfter;
+    _fellBack = false;
+
+    // An imported lease for this interface: ask to keep it before discovering
+    if (_reboot && memcmp(_dhcpMacAddr, mac, 6) == 0) {
+        _reboot = false;
+        _unboundSince = millis();
+        setState(DhcpState::INIT_REBOOT);
+        return;
+    }
+    _reboot = false;
     memcpy((void*)_dhcpMacAddr, (void*)mac, 6);
-    _dhcp_state = STATE_DHCP_START;
-    return request_DHCP_lease();
+    restart();
 }
 
-void DhcpClass::reset_DHCP_lease() {
-    // zero out _dhcpSubnetMask, _dhcpGatewayIp, _dhcpLocalIp, _dhcpDhcpServerIp, _dhcpDnsServerIp
-    memset(_dhcpLocalIp, 0, 20);
+// Fletcher-16 over everything before the check field
+static uint16_t leaseCheck(const DhcpLease& lease) {
+    const uint8_t* p = (const uint8_t*)&lease;
+    uint16_t a = 0, b = 0;
+    for (size_t i = 0; i < offsetof(DhcpLease, check); i++) {
+        a = (a + p[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
+
+bool DhcpClass::exportLease(DhcpLease& lease) const {
+    memset(&lease, 0, sizeof(lease));
+    uint32_t remaining = leaseRemaining();
+    if (remaining == 0) return false;
+
+    lease.version = DHCP_LEASE_VERSION;
+    memcpy(lease.mac, _dhcpMacAddr, 6);
+    memcpy(lease.ip, _dhcpLocalIp, 4);
+    memcpy(lease.subnet, _dhcpSubnetMask, 4);
+    memcpy(lease.gateway, _dhcpGatewayIp, 4);
+    memcpy(lease.server, _dhcpDhcpServerIp, 4);
+    memcpy(lease.dns, _dhcpDnsServerIp, 4);
+    memcpy(lease.dns2, _dhcpDnsServerIp2, 4);
+    lease.leaseTime = _dhcpLeaseTime;
+    lease.t1 = _dhcpT1;
+    lease.t2 = _dhcpT2;
+    lease.remaining = remaining;
+    lease.check = leaseCheck(lease);
+    return true;
 }
 
-// return:0 on error, 1 if request is sent and response is received
-int DhcpClass::request_DHCP_lease() {
-    uint8_t messageType = 0;
+bool DhcpClass::importLease(const DhcpLease& lease, uint32_t elapsed) {
+    _reboot = false;
+    if (lease.version != DHCP_LEASE_VERSION || lease.check != leaseCheck(lease)) return false;
+    if (lease.ip[0] == 0 && lease.ip[1] == 0 && lease.ip[2] == 0 && lease.ip[3] == 0) {
+        return false;
+    }
+    // Expired while we were down: the address may be someone else's, so discover
+    if (lease.remaining <= elapsed) return false;
+
+    memcpy(_dhcpMacAddr, lease.mac, 6);
+    memcpy(_dhcpLocalIp, lease.ip, 4);
+    memcpy(_dhcpSubnetMask, lease.subnet, 4);
+    memcpy(_dhcpGatewayIp, lease.gateway, 4);
+    memcpy(_dhcpDhcpServerIp, lease.server, 4);
+    memcpy(_dhcpDnsServerIp, lease.dns, 4);
+    memcpy(_dhcpDnsServerIp2, lease.dns2, 4);
+    _dhcpLeaseTime = lease.leaseTime;
+    _dhcpT1 = lease.t1;
+    _dhcpT2 = lease.t2;
+    _reboot = true;
+    return true;
+}
 
-    // Pick an initial transaction ID
-    _dhcpTransactionId = random(1UL, 2000UL);
-    _dhcpInitialTransactionId = _dhcpTransactionId;
+void DhcpClass::stop() {
+    closeSocket();
+    setState(DhcpState::STOPPED);
+}
 
+void DhcpClass::reset_DHCP_lease() {
+    memset(_dhcpLocalIp, 0, sizeof(_dhcpLocalIp));
+    memset(_dhcpSubnetMask, 0, sizeof(_dhcpSubnetMask));
+    memset(_dhcpGatewayIp, 0, sizeof(_dhcpGatewayIp));
+    memset(_dhcpDhcpServerIp, 0, sizeof(_dhcpDhcpServerIp));
+    memset(_dhcpDnsServerIp, 0, sizeof(_dhcpDnsServerIp));
+    memset(_dhcpDnsServerIp2, 0, sizeof(_dhcpDnsServerIp2));
+    _dhcpLeaseTime = 0;
+    _dhcpT1 = 0;
+    _dhcpT2 = 0;
+}
+
+void DhcpClass::setState(uint8_t state) {
+    if (state == _dhcp_state) return;
+    uint8_t from = _dhcp_state;
+    _dhcp_state = state;
+    // A renewal keeps the lease; only time leases obtained by discovery or reboot
+    if (state == DhcpState::BOUND &&
+        (from == DhcpState::REQUESTING || from == DhcpState::REBOOTING)) {
+        ETHERNET_PERF_EVENT(dhcp, DHCP_BOUND, MAX_SOCK_NUM, millis() - _unboundSince);
+    }
+    if (_handler) _handler(_handlerCtx, from, state);
+}
+
+void DhcpClass::closeSocket() {
+    if (!_open) return;
     _dhcpUdpSocket.stop();
-    if (_dhcpUdpSocket.begin(DHCP_CLIENT_PORT) == 0) {
-        // Couldn't get a socket
-        return 0;
+    _open = false;
+}
+
+// Forget the lease and start discovering again
+void DhcpClass::restart() {
+    reset_DHCP_lease();
+    _unboundSince = millis();
+    setState(DhcpState::INIT);
+}
+
+// Start an exchange with a fresh transaction ID and send its first message
+void DhcpClass::newTransaction(uint8_t state) {
+    _dhcpTransactionId = random(1L, 0x7FFFFFFFL);
+    _startTime = millis();
+    _retransmit = _responseTimeout;
+    setState(state);
+    transmit();
+}
+
+// Send the message of the current state: DISCOVER while looking for a server, else REQUEST
+void DhcpClass::transmit() {
+    unsigned long now = millis();
+    _lastSend = now;
+
+    // A missing socket is treated like a lost message: try again when the wait runs out
+    if (!_open) {
+        if (_dhcpUdpSocket.begin(DHCP_CLIENT_PORT) == 0) return;
+        _open = true;
     }
 
-    presend_DHCP();
+    bool discover = _dhcp_state == DhcpState::SELECTING || _dhcp_state == DhcpState::FALLBACK;
+    send_DHCP_MESSAGE(discover ? DHCP_DISCOVER : DHCP_REQUEST, (now - _startTime) / 1000);
+}
+
+int DhcpClass::handleReply(uint8_t messageType) {
+    uint8_t from = _dhcp_state;
 
-    int result = 0;
+    if (messageType == DHCP_OFFER &&
+        (from == DhcpState::SELECTING || from == DhcpState::FALLBACK)) {
+        // Request the offered address, keeping the transaction ID
+        _retransmit = _responseTimeout;
+        setState(DhcpState::REQUESTING);
+        transmit();
+        return DHCP_CHECK_NONE;
+    }
 
-    unsigned long startTime = millis();
+    // FALLBACK may have been entered while a REQUEST was out, so take its ACK too
+    if (from != DhcpState::REQUESTING && from != DhcpState::RENEWING &&
+        from != DhcpState::REBINDING && from != DhcpState::FALLBACK &&
+        from != DhcpState::REBOOTING) {
+        return DHCP_CHECK_NONE;
+    }
 
-    while (_dhcp_state != STATE_DHCP_LEASED) {
-        if (_dhcp_state == STATE_DHCP_START) {
-            // Serial.println("DHCP_START");
-            _dhcpTransactionId++;
-
-            send_DHCP_MESSAGE(DHCP_DISCOVER, ((millis() - startTime) / 1000));
-            _dhcp_state = STATE_DHCP_DISCOVER;
-        } else if (_dhcp_state == STATE_DHCP_REREQUEST) {
-            _dhcpTransactionId++;
-            send_DHCP_MESSAGE(DHCP_REQUEST, ((millis() - startTime) / 1000));
-            _dhcp_state = STATE_DHCP_REQUEST;
-        } else if (_dhcp_state == STATE_DHCP_DISCOVER) {
-            uint32_t respId;
-
-            messageType = parseDHCPResponse(_responseTimeout, respId);
-            if (messageType == DHCP_OFFER) {
-                // We'll use the transaction ID that the offer came with,
-                // rather than the one we were up to
-                _dhcpTransactionId = respId;
-                send_DHCP_MESSAGE(DHCP_REQUEST, ((millis() - startTime) / 1000));
-                _dhcp_state = STATE_DHCP_REQUEST;
-            }
-        } else if (_dhcp_state == STATE_DHCP_REQUEST) {
-            uint32_t respId;
-            messageType = parseDHCPResponse(_responseTimeout, respId);
-            if (messageType == DHCP_ACK) {
-                _dhcp_state = STATE_DHCP_LEASED;
-                result = 1;
-                // use default lease time if we didn't get it
-                if (_dhcpLeaseTime == 0) {
-                    _dhcpLeaseTime = DEFAULT_LEASE;
-                }
-                // calculate T1 & T2 if we didn't get it
-                if (_dhcpT1 == 0) {
-                    // T1 should be 50% of _dhcpLeaseTime
-                    _dhcpT1 = _dhcpLeaseTime >> 1;
-                }
-                if (_dhcpT2 == 0) {
-                    // T2 should be 87.5% (7/8ths) of _dhcpLeaseTime
-                    _dhcpT2 = _dhcpT1 << 1;
-                }
-                _renewInSec = _dhcpT1;
-                _rebindInSec = _dhcpT2;
-            } else if (messageType == DHCP_NAK)
-                _dhcp_state = STATE_DHCP_START;
+    if (messageType == DHCP_ACK) {
+        // use default lease time if we didn't get it
+        if (_dhcpLeaseTime == 0) {
+            _dhcpLeaseTime = DEFAULT_LEASE;
+        }
+        // calculate T1 & T2 if we didn't get it
+        if (_dhcpT1 == 0) {
+            // T1 should be 50% of _dhcpLeaseTime
+            _dhcpT1 = _dhcpLeaseTime >> 1;
+        }
+        if (_dhcpT2 == 0) {
+            // T2 should be 87.5% (7/8ths) of _dhcpLeaseTime
+            _dhcpT2 = _dhcpLeaseTime - (_dhcpLeaseTime >> 3);
         }
+        _leaseSec = 0;
+        _leaseTick = millis();
+
+        // No traffic until T1, so give the socket back
+        closeSocket();
+        setState(DhcpState::BOUND);
+        if (from == DhcpState::RENEWING) return DHCP_CHECK_RENEW_OK;
+        if (from == DhcpState::REBINDING) return DHCP_CHECK_REBIND_OK;
+        return DHCP_CHECK_BOUND;
+    }
 
-        if (messageType == 255) {
-            messageType = 0;
-            _dhcp_state = STATE_DHCP_START;
+    if (messageType == DHCP_NAK) {
+        if (from == DhcpState::REBOOTING) {
+            // The saved lease is no good here (e.g. another network): discover
+            restart();
+            return DHCP_CHECK_NONE;
+        }
+        if (from == DhcpState::REQUESTING || from == DhcpState::FALLBACK) {
+            // Offer withdrawn: look for another one
+            setState(DhcpState::INIT);
+            return DHCP_CHECK_NONE;
         }
+        // The server took the lease back
+        restart();
+        return DHCP_CHECK_REBIND_FAIL;
+    }
+    return DHCP_CHECK_NONE;
+}
+
+int DhcpClass::checkTimers() {
+    unsigned long now = millis();
+
+    switch (_dhcp_state) {
+        case DhcpState::BOUND:
+            if (_leaseSec >= _dhcpT1) newTransaction(DhcpState::RENEWING);
+            return DHCP_CHECK_NONE;
 
-        if (result != 1 && ((millis() - startTime) > _timeout)) break;
+        case DhcpState::RENEWING:
+            if (_leaseSec >= _dhcpT2) {
+                // The leasing server didn't answer; ask any server
+                newTransaction(DhcpState::REBINDING);
+                return DHCP_CHECK_RENEW_FAIL;
+            }
+            break;
+
+        case DhcpState::REBINDING:
+            if (_leaseSec >= _dhcpLeaseTime) {
+                // Lease expired
+                restart();
+                return DHCP_CHECK_REBIND_FAIL;
+            }
+            break;
+
+        case DhcpState::SELECTING:
+        case DhcpState::REQUESTING:
+        case DhcpState::REBOOTING:
+            if (_fallbackAfter != 0 && !_fellBack && now - _unboundSince >= _fallbackAfter) {
+                _fellBack = true;
+                setState(DhcpState::FALLBACK);
+                return DHCP_CHECK_FALLBACK;
+            }
+            break;
     }
 
-    // We're done with the socket now
-    _dhcpUdpSocket.stop();
-    _dhcpTransactionId++;
+    if (now - _lastSend < _retransmit) return DHCP_CHECK_NONE;
+
+    if (_dhcp_state == DhcpState::REBOOTING && _retransmit >= 2 * _responseTimeout) {
+        // Nobody vouches for the saved lease; RFC 2131 3.2 says not to use it
+        restart();
+        return DHCP_CHECK_NONE;
+    }
+    if (_dhcp_state == DhcpState::REQUESTING && _retransmit >= 4 * _responseTimeout) {
+        // Three REQUESTs went unanswered: start over
+        setState(DhcpState::INIT);
+        return DHCP_CHECK_NONE;
+    }
+
+    // Exponential backoff (RFC 2131 4.1)
+    _retransmit = _retransmit >= DHCP_MAX_RETRANSMIT / 2 ? DHCP_MAX_RETRANSMIT : _retransmit * 2;
+    transmit();
+    return DHCP_CHECK_NONE;
+}
+
+/*
+    returns:
+    0/DHCP_CHECK_NONE: nothing happened
+    1/DHCP_CHECK_RENEW_FAIL: renew failed (T2 reached), rebinding
+    2/DHCP_CHECK_RENEW_OK: renew success
+    3/DHCP_CHECK_REBIND_FAIL: lease lost (expired or refused), discovering again
+    4/DHCP_CHECK_REBIND_OK: rebind success
+    5/DHCP_CHECK_BOUND: a new lease was obtained
+    6/DHCP_CHECK_FALLBACK: the fallback time passed without a lease
+*/
+int DhcpClass::checkLease() {
+    if (_dhcp_state == DhcpState::STOPPED) return DHCP_CHECK_NONE;
+
+    // Advance the lease clock in whole seconds; keeps counting across millis() overflow
+    uint32_t secs = (millis() - _leaseTick) / 1000;
+    _leaseTick += secs * 1000;
+    _leaseSec += secs;
+
+    if (_dhcp_state == DhcpState::INIT) {
+        // Drop what the last server offered, so any server's OFFER is taken
+        reset_DHCP_lease();
+        newTransaction(_fellBack ? DhcpState::FALLBACK : DhcpState::SELECTING);
+        return DHCP_CHECK_NONE;
+    }
+    if (_dhcp_state == DhcpState::INIT_REBOOT) {
+        // Any server on the network may answer; take the identifier from its ACK
+        memset(_dhcpDhcpServerIp, 0, sizeof(_dhcpDhcpServerIp));
+        // and the lease times too, so the saved ones can't outlive the new lease
+        _dhcpLeaseTime = 0;
+        _dhcpT1 = 0;
+        _dhcpT2 = 0;
+        newTransaction(DhcpState::REBOOTING);
+        return DHCP_CHECK_NONE;
+    }
+
+    if (_open) {
+        uint32_t respId;
+        int messageType = parseDHCPResponse(respId);
+        if (messageType > 0) return handleReply(messageType);
+    }
 
-    return result;
+    return checkTimers();
 }
 
-void DhcpClass::presend_DHCP() {}
+uint32_t DhcpClass::leaseRemaining() const {
+    if (_dhcp_state != DhcpState::BOUND && _dhcp_state != DhcpState::RENEWING &&
+        _dhcp_state != DhcpState::REBINDING) {
+        return 0;
+    }
+    return _leaseSec < _dhcpLeaseTime ? _dhcpLeaseTime - _leaseSec : 0;
+}
 
 void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed) {
     uint8_t buffer[32];
     memset(buffer, 0, 32);
-    IPAddress dest_addr(255, 255, 255, 255);  // Broadcast address
+    // Renewing and rebinding clients already own their address (RFC 2131 4.3.2)
+    bool haveAddress = _dhcp_state == DhcpState::RENEWING || _dhcp_state == DhcpState::REBINDING;
+    // Renewals go straight to the leasing server, everything else is broadcast
+    IPAddress dest_addr(255, 255, 255, 255);
+    if (_dhcp_state == DhcpState::RENEWING) dest_addr = _dhcpDhcpServerIp;
 
-    if (-1 == _dhcpUdpSocket.beginPacket(dest_addr, DHCP_SERVER_PORT)) {
+    if (!_dhcpUdpSocket.beginPacket(dest_addr, DHCP_SERVER_PORT)) {
         // FIXME Need to return errors
         return;
     }
@@ -154,11 +386,12 @@ void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed)
     buffer[8] = ((secondsElapsed & 0xff00) >> 8);
     buffer[9] = (secondsElapsed & 0x00ff);
 
-    // flags
-    unsigned short flags = htons(DHCP_FLAGSBROADCAST);
+    // flags: ask for a broadcast reply until we can receive unicast
+    unsigned short flags = htons(haveAddress ? 0 : DHCP_FLAGSBROADCAST);
     memcpy(buffer + 10, &(flags), 2);
 
-    // ciaddr: already zeroed
+    // ciaddr: our address while renewing or rebinding, else zero
+    if (haveAddress) memcpy(buffer + 12, _dhcpLocalIp, 4);
     // yiaddr: already zeroed
     // siaddr: already zeroed
     // giaddr: already zeroed
@@ -211,7 +444,7 @@ void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed)
     // put data in w5500 transmit buffer
     _dhcpUdpSocket.write(buffer, 30);
 
-    if (messageType == DHCP_REQUEST) {
+    if (messageType == DHCP_REQUEST && !haveAddress) {
         buffer[0] = dhcpRequestedIPaddr;
         buffer[1] = 0x04;
         buffer[2] = _dhcpLocalIp[0];
@@ -219,15 +452,20 @@ void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed)
         buffer[4] = _dhcpLocalIp[2];
         buffer[5] = _dhcpLocalIp[3];
 
-        buffer[6] = dhcpServerIdentifier;
-        buffer[7] = 0x04;
-        buffer[8] = _dhcpDhcpServerIp[0];
-        buffer[9] = _dhcpDhcpServerIp[1];
-        buffer[10] = _dhcpDhcpServerIp[2];
-        buffer[11] = _dhcpDhcpServerIp[3];
+        // INIT-REBOOT asks whichever server hears it, so no server identifier
+        uint8_t len = 6;
+        if (_dhcp_state != DhcpState::REBOOTING) {
+            buffer[6] = dhcpServerIdentifier;
+            buffer[7] = 0x04;
+            buffer[8] = _dhcpDhcpServerIp[0];
+            buffer[9] = _dhcpDhcpServerIp[1];
+            buffer[10] = _dhcpDhcpServerIp[2];
+            buffer[11] = _dhcpDhcpServerIp[3];
+            len = 12;
+        }
 
         // put data in w5500 transmit buffer
-        _dhcpUdpSocket.write(buffer, 12);
+        _dhcpUdpSocket.write(buffer, len);
     }
 
     buffer[0] = dhcpParamRequest;
@@ -246,18 +484,12 @@ void DhcpClass::send_DHCP_MESSAGE(uint8_t messageType, uint16_t secondsElapsed)
     _dhcpUdpSocket.endPacket();
 }
 
-uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& transactionId) {
+// returns -1 if nothing was received, 0 if the packet isn't for us, else the message type
+int DhcpClass::parseDHCPResponse(uint32_t& transactionId) {
     uint8_t type = 0;
     uint8_t opt_len = 0;
 
-    unsigned long startTime = millis();
-
-    while (_dhcpUdpSocket.parsePacket() <= 0) {
-        if ((millis() - startTime) > responseTimeout) {
-            return 255;
-        }
-        delay(50);
-    }
+    if (_dhcpUdpSocket.parsePacket() <= 0) return -1;
 
     // start reading in the packet
     RIP_MSG_FIXED fixedMsg;
@@ -265,8 +497,7 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
 
     if (fixedMsg.op == DHCP_BOOTREPLY && _dhcpUdpSocket.remotePort() == DHCP_SERVER_PORT) {
         transactionId = ntohl(fixedMsg.xid);
-        if (memcmp(fixedMsg.chaddr, _dhcpMacAddr, 6) != 0 ||
-            (transactionId < _dhcpInitialTransactionId) || (transactionId > _dhcpTransactionId)) {
+        if (memcmp(fixedMsg.chaddr, _dhcpMacAddr, 6) != 0 || transactionId != _dhcpTransactionId) {
             // Need to read the rest of the packet here regardless
             _dhcpUdpSocket.flush();
             return 0;
@@ -275,10 +506,11 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
         memcpy(_dhcpLocalIp, fixedMsg.yiaddr, 4);
 
         // Skip to the option part
-        // Doing this a byte at a time so we don't have to put a big buffer
+        // Doing this a few bytes at a time so we don't have to put a big buffer
         // on the stack (as we don't have lots of memory lying around)
-        for (int i = 0; i < (240 - (int)sizeof(RIP_MSG_FIXED)); i++) {
-            _dhcpUdpSocket.read();  // we don't care about the returned byte
+        uint8_t skip[32];
+        for (int left = 240 - (int)sizeof(RIP_MSG_FIXED); left > 0; left -= sizeof(skip)) {
+            _dhcpUdpSocket.read(skip, left < (int)sizeof(skip) ? left : sizeof(skip));
         }
 
         while (_dhcpUdpSocket.available() > 0) {
@@ -315,6 +547,12 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
                 case dns:
                     opt_len = _dhcpUdpSocket.read();
                     _dhcpUdpSocket.read(_dhcpDnsServerIp, 4);
+                    // keep the second server for failover
+                    memset(_dhcpDnsServerIp2, 0, 4);
+                    if (opt_len >= 8) {
+                        _dhcpUdpSocket.read(_dhcpDnsServerIp2, 4);
+                        opt_len -= 4;
+                    }
                     for (int i = 0; i < opt_len - 4; i++) {
                         _dhcpUdpSocket.read();
                     }
@@ -322,12 +560,14 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
 
                 case domainName:
                     opt_len = _dhcpUdpSocket.read();
+                    free(_dhcpDnsdomainName);
                     _dhcpDnsdomainName = (char*)malloc(sizeof(char) * opt_len + 1);
                     _dhcpUdpSocket.read(_dhcpDnsdomainName, opt_len);
                     _dhcpDnsdomainName[opt_len] = '\0';
                     break;
                 case hostName:
                     opt_len = _dhcpUdpSocket.read();
+                    free(_dhcpHostName);
                     _dhcpHostName = (char*)malloc(sizeof(char) * opt_len + 1);
                     _dhcpUdpSocket.read(_dhcpHostName, opt_len);
                     _dhcpHostName[opt_len] = '\0';
@@ -366,7 +606,6 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
                     opt_len = _dhcpUdpSocket.read();
                     _dhcpUdpSocket.read((uint8_t*)&_dhcpLeaseTime, sizeof(_dhcpLeaseTime));
                     _dhcpLeaseTime = ntohl(_dhcpLeaseTime);
-                    _renewInSec = _dhcpLeaseTime;
                     break;
 
                 default:
@@ -387,67 +626,6 @@ uint8_t DhcpClass::parseDHCPResponse(unsigned long responseTimeout, uint32_t& tr
     return type;
 }
 
-/*
-    returns:
-    0/DHCP_CHECK_NONE: nothing happened
-    1/DHCP_CHECK_RENEW_FAIL: renew failed
-    2/DHCP_CHECK_RENEW_OK: renew success
-    3/DHCP_CHECK_REBIND_FAIL: rebind fail
-    4/DHCP_CHECK_REBIND_OK: rebind success
-*/
-int DhcpClass::checkLease() {
-    // this uses a signed / unsigned trick to deal with millis overflow
-    unsigned long now = millis();
-    signed long snow = (long)now;
-    int rc = DHCP_CHECK_NONE;
-    if (_lastCheck != 0) {
-        signed long factor;
-        // calc how many ms past the timeout we are
-        factor = snow - (long)_secTimeout;
-        // if on or passed the timeout, reduce the counters
-        if (factor >= 0) {
-            // next timeout should be now plus 1000 ms minus parts of second in factor
-            _secTimeout = snow + 1000 - factor % 1000;
-            // how many seconds late are we, minimum 1
-            factor = factor / 1000 + 1;
-
-            // reduce the counters by that mouch
-            // if we can assume that the cycle time (factor) is fairly constant
-            // and if the remainder is less than cycle time * 2
-            // do it early instead of late
-            if (_renewInSec < factor * 2)
-                _renewInSec = 0;
-            else
-                _renewInSec -= factor;
-
-            if (_rebindInSec < factor * 2)
-                _rebindInSec = 0;
-            else
-                _rebindInSec -= factor;
-        }
-
-        // if we have a lease but should renew, do it
-        if (_dhcp_state == STATE_DHCP_LEASED && _renewInSec <= 0) {
-            _dhcp_state = STATE_DHCP_REREQUEST;
-            rc = 1 + request_DHCP_lease();
-        }
-
-        // if we have a lease or is renewing but should bind, do it
-        if ((_dhcp_state == STATE_DHCP_LEASED || _dhcp_state == STATE_DHCP_START) &&
-            _rebindInSec <= 0) {
-            // this should basically restart completely
-            _dhcp_state = STATE_DHCP_START;
-            reset_DHCP_lease();
-            rc = 3 + request_DHCP_lease();
-        }
-    } else {
-        _secTimeout = snow + 1000;
-    }
-
-    _lastCheck = now;
-    return rc;
-}
-
 IPAddress DhcpClass::getLocalIp() { return IPAddress(_dhcpLocalIp); }
 
 IPAddress DhcpClass::getSubnetMask() { return IPAddress(_dhcpSubnetMask); }
@@ -458,6 +636,8 @@ IPAddress DhcpClass::getDhcpServerIp() { return IPAddress(_dhcpDhcpServerIp); }
 
 IPAddress DhcpClass::getDnsServerIp() { return IPAddress(_dhcpDnsServerIp); }
 
+IPAddress DhcpClass::getSecondaryDnsServerIp() { return IPAddress(_dhcpDnsServerIp2); }
+
 char* DhcpClass::getDnsDomainName() { return _dhcpDnsdomainName; }
 
 char* DhcpClass::getHostName() { return _dhcpHostName; }
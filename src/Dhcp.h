@@ -4,6 +4,7 @@
 #ifndef Dhcp_h
 #define Dhcp_h
 
+#include "DhcpState.h"
 #include "Ethernet3.h"
 #include "EthernetUdp2.h"
 #include "chips/EthernetChip.h"
@@ -12,14 +13,6 @@
 class EthernetClass;  // Forward declaration to avoid circular dependency
 class EthernetChip;   // Forward declaration to avoid circular dependency
 
-/* DHCP state machine. */
-#define STATE_DHCP_START 0
-#define STATE_DHCP_DISCOVER 1
-#define STATE_DHCP_REQUEST 2
-#define STATE_DHCP_LEASED 3
-#define STATE_DHCP_REREQUEST 4
-#define STATE_DHCP_RELEASE 5
-
 #define DHCP_FLAGSBROADCAST 0x8000
 
 /* UDP port numbers for DHCP */
@@ -58,6 +51,13 @@ class EthernetChip;   // Forward declaration to avoid circular dependency
 #define DHCP_CHECK_RENEW_OK (2)
 #define DHCP_CHECK_REBIND_FAIL (3)
 #define DHCP_CHECK_REBIND_OK (4)
+#define DHCP_CHECK_BOUND (5)     // a new lease was obtained (first one, or after losing one)
+#define DHCP_CHECK_FALLBACK (6)  // the fallback time passed without a lease
+
+/* Longest wait between retransmissions, in ms (RFC 2131 4.1) */
+#ifndef DHCP_MAX_RETRANSMIT
+#define DHCP_MAX_RETRANSMIT 64000UL
+#endif
 
 enum {
     padOption = 0,
@@ -144,7 +144,6 @@ class DhcpClass {
    private:
     EthernetClass* _ethernet;  // Pointer to the Ethernet class instance
     EthernetChip* _chip;       // Pointer to the Ethernet chip interface
-    uint32_t _dhcpInitialTransactionId;
     uint32_t _dhcpTransactionId;
     uint8_t _dhcpMacAddr[6];
     uint8_t _dhcpLocalIp[4];
@@ -154,23 +153,38 @@ class DhcpClass {
     uint8_t _dhcpGatewayIp[4];
     uint8_t _dhcpDhcpServerIp[4];
     uint8_t _dhcpDnsServerIp[4];
+    uint8_t _dhcpDnsServerIp2[4];  // second address of option 6, 0.0.0.0 if none
     uint32_t _dhcpLeaseTime;
     uint32_t _dhcpT1, _dhcpT2;
-    signed long _renewInSec;
-    signed long _rebindInSec;
-    signed long _lastCheck;
+    uint32_t _leaseSec;             // seconds since the lease was granted
+    unsigned long _leaseTick;       // millis() the lease clock last advanced at
+    unsigned long _startTime;       // millis() the current transaction started
+    unsigned long _unboundSince;    // millis() the client last started without a lease
+    unsigned long _lastSend;        // millis() of the last transmission
+    unsigned long _retransmit;      // wait before the next retransmission, in ms
+    unsigned long _fallbackAfter;   // ms without a lease before FALLBACK, 0 = never
     unsigned long _timeout;
     unsigned long _responseTimeout;
-    unsigned long _secTimeout;
     uint8_t _dhcp_state;
+    bool _fellBack;                 // FALLBACK has been entered since start()
+    bool _open;                     // _dhcpUdpSocket holds a socket
+    bool _reboot;                   // start() tries INIT-REBOOT with an imported lease
+    DhcpStateHandler _handler;
+    void* _handlerCtx;
     EthernetUDP _dhcpUdpSocket;
-    int request_DHCP_lease();
     void reset_DHCP_lease();
-    void presend_DHCP();
     void send_DHCP_MESSAGE(uint8_t, uint16_t);
     void printByte(char*, uint8_t);
 
-    uint8_t parseDHCPResponse(unsigned long responseTimeout, uint32_t& transactionId);
+    void setState(uint8_t state);
+    void closeSocket();
+    void newTransaction(uint8_t state);
+    void transmit();
+    void restart();
+    int handleReply(uint8_t messageType);
+    int checkTimers();
+
+    int parseDHCPResponse(uint32_t& transactionId);
 
    public:
     DhcpClass(EthernetClass* eth, EthernetChip* chip, unsigned long timeout = 60000,
@@ -180,12 +194,50 @@ class DhcpClass {
     IPAddress getGatewayIp();
     IPAddress getDhcpServerIp();
     IPAddress getDnsServerIp();
+    IPAddress getSecondaryDnsServerIp();
     char* getDnsDomainName();
     char* getHostName();
 
+    /* Get a lease, blocking until one is bound or timeout ms have passed.
+       returns 1 on success, 0 on timeout (the client is then stopped) */
     int beginWithDHCP(uint8_t*, unsigned long timeout = 60000,
                       unsigned long responseTimeout = 5000);
+
+    /* Start getting a lease without waiting; checkLease() does the work.
+       fallbackAfter: ms without a lease before entering DhcpState::FALLBACK, 0 for never */
+    void start(uint8_t* mac, unsigned long fallbackAfter = 0);
+
+    /* Stop the client and give its socket back. The lease is kept but no longer renewed */
+    void stop();
+
+    /* Advance the client: send, receive at most one reply, and renew or rebind the lease
+       when due. Never waits. returns a DHCP_CHECK_* code */
     int checkLease();
+
+    /* returns the current DhcpState */
+    uint8_t state() const { return _dhcp_state; }
+
+    /* Register a handler called on every state change, or nullptr */
+    void onStateChange(DhcpStateHandler handler, void* ctx = nullptr) {
+        _handler = handler;
+        _handlerCtx = ctx;
+    }
+
+    /* returns the lease length and the seconds left on it (0 if there is none) */
+    uint32_t leaseTime() const { return _dhcpLeaseTime; }
+    uint32_t leaseRemaining() const;
+
+    /* Copy the lease out for saving across restarts.
+       returns false (and an empty lease) if no lease is held */
+    bool exportLease(DhcpLease& lease) const;
+
+    /* Hand back a saved lease before start()/beginWithDHCP(). If it is intact and belongs
+       to the MAC address being started, the client first asks to keep it with a single
+       INIT-REBOOT request, and only falls back to discovery if the server refuses or
+       doesn't answer. elapsed is the time in seconds since the lease was saved, if known
+       (e.g. from an RTC); a lease that ran out in that time is not asked for.
+       returns false if the lease is empty, corrupt or expired */
+    bool importLease(const DhcpLease& lease, uint32_t elapsed = 0);
 };
 
 #endif
@@ -0,0 +1,70 @@
+/**
+ * @file DhcpState.h
+ * @brief States of the incremental DHCP client and its state-change handler
+ *
+ * DhcpClass runs as a state machine stepped from EthernetClass::maintain(); it
+ * never waits for the network. These are the states it reports, named after
+ * RFC 2131, plus FALLBACK for "no lease yet, the static fallback configuration
+ * is in use and discovery goes on in the background".
+ *
+ * DhcpLease is the client's lease in a flat, byte-copyable form, so it can be
+ * saved to EEPROM or flash and handed back after a restart; the client then
+ * confirms it with a single INIT-REBOOT request instead of a full discovery.
+ */
+
+#ifndef dhcpstate_h
+#define dhcpstate_h
+
+#include <Arduino.h>
+
+/**
+ * @brief DHCP client state (DhcpClass::state())
+ */
+class DhcpState {
+   public:
+    static const uint8_t STOPPED = 0;     ///< Not running
+    static const uint8_t INIT = 1;        ///< About to send DHCPDISCOVER
+    static const uint8_t SELECTING = 2;   ///< DHCPDISCOVER sent, waiting for an offer
+    static const uint8_t REQUESTING = 3;  ///< DHCPREQUEST sent for an offer, waiting for the ACK
+    static const uint8_t BOUND = 4;       ///< Lease held
+    static const uint8_t RENEWING = 5;    ///< Past T1, asking the leasing server to extend
+    static const uint8_t REBINDING = 6;   ///< Past T2, asking any server to extend
+    static const uint8_t FALLBACK = 7;    ///< Static fallback in use, still discovering
+    static const uint8_t INIT_REBOOT = 8; ///< About to ask to keep a saved lease
+    static const uint8_t REBOOTING = 9;   ///< INIT-REBOOT DHCPREQUEST sent, waiting for the ACK
+};
+
+/** @brief DhcpLease::version of a lease written by this library */
+#define DHCP_LEASE_VERSION 1
+
+/**
+ * @brief A DHCP lease in a form that can be stored byte for byte
+ *
+ * Addresses are kept as raw bytes, not IPAddress, so the struct can be
+ * written to and read back from EEPROM as is.
+ */
+struct DhcpLease {
+    uint8_t version;     ///< DHCP_LEASE_VERSION, 0 if empty
+    uint8_t mac[6];      ///< Interface the lease was granted to
+    uint8_t ip[4];       ///< Leased address
+    uint8_t subnet[4];   ///< Subnet mask
+    uint8_t gateway[4];  ///< Router
+    uint8_t server[4];   ///< DHCP server identifier
+    uint8_t dns[4];      ///< DNS server
+    uint8_t dns2[4];     ///< Secondary DNS server
+    uint32_t leaseTime;  ///< Lease length in seconds
+    uint32_t t1;         ///< Renewal time in seconds
+    uint32_t t2;         ///< Rebinding time in seconds
+    uint32_t remaining;  ///< Seconds left on the lease when it was saved
+    uint16_t check;      ///< Fletcher-16 of the fields above, to reject blank or worn storage
+};
+
+/**
+ * @brief Called on every DHCP state change
+ * @param ctx Context given with the handler
+ * @param from Previous DhcpState
+ * @param to New DhcpState
+ */
+typedef void (*DhcpStateHandler)(void* ctx, uint8_t from, uint8_t to);
+
+#endif
@@ -38,28 +38,113 @@
 #define TIMED_OUT -1
 #define INVALID_SERVER -2
 #define TRUNCATED -3
+#define NAME_NOT_FOUND -11
+#define RESOLVER_BUSY -12
 #define INVALID_RESPONSE -4
 
-// DNSClient constructor
-DNSClient::DNSClient(EthernetClass* eth, EthernetChip* chip)
-    : _ethernet(eth), _chip(chip), iDNSServer(INADDR_NONE), iRequestId(0), iUdp(eth, chip) {
-    // Initialize the DNS client with the given Ethernet chip
+// DNSCache
+
+DNSCache::DNSCache() {
+    for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) _entries[i].flags = 0;
+    memset(&_stats, 0, sizeof(_stats));
 }
-DNSClient::DNSClient(EthernetClass* eth, EthernetChip* chip, unsigned long timeout)
-    : _ethernet(eth), _chip(chip), iDNSServer(INADDR_NONE), iRequestId(0), iUdp(eth, chip) {
-    // Initialize the DNS client with the given Ethernet chip and timeouts
-    iUdp.setTimeout(timeout);
+
+bool DNSCache::expired(const Entry& e) const {
+    if (e.flags & PINNED) return false;
+    return millis() - e.stored >= e.ttl;
 }
 
-void DNSClient::begin(const IPAddress& aDNSServer) {
-    iDNSServer = aDNSServer;
-    iRequestId = 0;
+DNSCache::Entry* DNSCache::find(const char* name) {
+    for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+        Entry& e = _entries[i];
+        if ((e.flags & USED) && strcasecmp(e.name, name) == 0) return &e;
+    }
+    return nullptr;
 }
 
-int DNSClient::inet_aton(const char* aIPAddrString, IPAddress& aResult) {
+// Slot to store name in: its own entry, a free or expired one, or the least recently used
+DNSCache::Entry* DNSCache::slotFor(const char* name) {
+    Entry* e = find(name);
+    if (e) return e;
+
+    Entry* victim = nullptr;
+    for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+        Entry& c = _entries[i];
+        if (!(c.flags & USED) || expired(c)) return &c;
+        if (c.flags & PINNED) continue;
+        if (!victim || millis() - c.used > millis() - victim->used) victim = &c;
+    }
+    if (victim) _stats.evictions++;
+    return victim;
+}
+
+bool DNSCache::put(const char* name, const IPAddress& addr, uint32_t ttl, uint8_t flags) {
+    if (strlen(name) >= DNS_CACHE_NAME_LEN) return false;
+
+    Entry* e = slotFor(name);
+    if (!e) return false;
+    // don't let a lookup overwrite a pinned address
+    if ((e->flags & PINNED) && !(flags & PINNED)) return true;
+
+    strcpy(e->name, name);
+    e->addr = addr;
+    e->stored = e->used = millis();
+    e->ttl = ttl;
+    e->flags = USED | flags;
+    _stats.stores++;
+    return true;
+}
+
+int8_t DNSCache::lookup(const char* name, IPAddress& result) {
+    Entry* e = find(name);
+    if (e && expired(*e)) {
+        e->flags = 0;
+        e = nullptr;
+    }
+    if (!e) {
+        _stats.misses++;
+        return 0;
+    }
+
+    e->used = millis();
+    if (e->flags & NEGATIVE) {
+        _stats.negativeHits++;
+        return -1;
+    }
+    result = e->addr;
+    _stats.hits++;
+    return 1;
+}
+
+bool DNSCache::store(const char* name, const IPAddress& addr, uint32_t ttl) {
+    // a zero TTL means "don't cache"
+    if (ttl == 0) return false;
+    if (ttl > DNS_CACHE_MAX_TTL) ttl = DNS_CACHE_MAX_TTL;
+    return put(name, addr, ttl * 1000UL, 0);
+}
+
+bool DNSCache::storeNegative(const char* name) {
+    return put(name, INADDR_NONE, DNS_CACHE_NEGATIVE_TTL * 1000UL, NEGATIVE);
+}
+
+bool DNSCache::pin(const char* name, const IPAddress& addr) { return put(name, addr, 0, PINNED); }
+
+void DNSCache::remove(const char* name) {
+    Entry* e = find(name);
+    if (e) e->flags = 0;
+}
+
+void DNSCache::flush() {
+    for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (!(_entries[i].flags & PINNED)) _entries[i].flags = 0;
+    }
+}
+
+// Parse a dotted-quad address
+static int parseDottedQuad(const char* aIPAddrString, IPAddress& aResult) {
     // See if we've been given a valid IP address
     const char* p = aIPAddrString;
-    while (*p && ((*p == '.') || (*p >= '0') || (*p <= '9'))) {
+    while (*p && ((*p == '.') || ((*p >= '0') && (*p <= '9')))) {
         p++;
     }
 
@@ -100,56 +185,8 @@ int DNSClient::inet_aton(const char* aIPAddrString, IPAddress& aResult) {
     }
 }
 
-int DNSClient::getHostByName(const char* aHostname, IPAddress& aResult) {
-    int ret = 0;
-
-    // See if it's a numeric IP address
-    if (inet_aton(aHostname, aResult)) {
-        // It is, our work here is done
-        return 1;
-    }
-
-    // Check we've got a valid DNS server to use
-    if (iDNSServer == INADDR_NONE) {
-        return INVALID_SERVER;
-    }
-
-    // Find a socket to use
-    if (iUdp.begin(1024 + (millis() & 0xF)) == 1) {
-        // Try up to three times
-        int retries = 0;
-        //        while ((retries < 3) && (ret <= 0))
-        {
-            // Send DNS request
-            ret = iUdp.beginPacket(iDNSServer, DNS_PORT);
-            if (ret != 0) {
-                // Now output the request data
-                ret = BuildRequest(aHostname);
-                if (ret != 0) {
-                    // And finally send the request
-                    ret = iUdp.endPacket();
-                    if (ret != 0) {
-                        // Now wait for a response
-                        int wait_retries = 0;
-                        ret = TIMED_OUT;
-                        while ((wait_retries < 3) && (ret == TIMED_OUT)) {
-                            ret = ProcessResponse(5000, aResult);
-                            wait_retries++;
-                        }
-                    }
-                }
-            }
-            retries++;
-        }
-
-        // We're done with the socket now
-        iUdp.stop();
-    }
-
-    return ret;
-}
-
-uint16_t DNSClient::BuildRequest(const char* aName) {
+// Write a standard A query for aName into the packet being built
+static void writeQuery(EthernetUDP& udp, uint16_t id, const char* aName) {
     // Build header
     //                                    1  1  1  1  1  1
     //      0  1  2  3  4  5  6  7  8  9  0  1  2  3  4  5
@@ -166,27 +203,24 @@ uint16_t DNSClient::BuildRequest(const char* aName) {
     //    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
     //    |                    ARCOUNT                    |
     //    +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    // As we only support one request at a time at present, we can simplify
-    // some of this header
-    iRequestId = millis();  // generate a random ID
     uint16_t twoByteBuffer;
 
     // FIXME We should also check that there's enough space available to write to, rather
     // FIXME than assume there's enough space (as the code does at present)
-    iUdp.write((uint8_t*)&iRequestId, sizeof(iRequestId));
+    udp.write((uint8_t*)&id, sizeof(id));
 
     twoByteBuffer = htons(QUERY_FLAG | OPCODE_STANDARD_QUERY | RECURSION_DESIRED_FLAG);
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
 
     twoByteBuffer = htons(1);  // One question record
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
 
     twoByteBuffer = 0;  // Zero answer records
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
 
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
     // and zero additional records
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
 
     // Build question
     const char* start = aName;
@@ -203,9 +237,9 @@ uint16_t DNSClient::BuildRequest(const char* aName) {
         if (end - start > 0) {
             // Write out the size of this section
             len = end - start;
-            iUdp.write(&len, sizeof(len));
+            udp.write(&len, sizeof(len));
             // And then write out the section
-            iUdp.write((uint8_t*)start, end - start);
+            udp.write((uint8_t*)start, end - start);
         }
         start = end + 1;
     }
@@ -213,54 +247,29 @@ uint16_t DNSClient::BuildRequest(const char* aName) {
     // We've got to the end of the question name, so
     // terminate it with a zero-length section
     len = 0;
-    iUdp.write(&len, sizeof(len));
+    udp.write(&len, sizeof(len));
     // Finally the type and class of question
     twoByteBuffer = htons(TYPE_A);
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
 
     twoByteBuffer = htons(CLASS_IN);  // Internet class of question
-    iUdp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
-    // Success!  Everything buffered okay
-    return 1;
+    udp.write((uint8_t*)&twoByteBuffer, sizeof(twoByteBuffer));
 }
 
-uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
-    uint32_t startTime = millis();
-
-    // Wait for a response packet
-    while (iUdp.parsePacket() <= 0) {
-        if ((millis() - startTime) > aTimeout) return TIMED_OUT;
-        delay(50);
-    }
-
-    // We've had a reply!
-    // Read the UDP header
-    uint8_t header[DNS_HEADER_SIZE];  // Enough space to reuse for the DNS header
-    // Check that it's a response from the right server and the right port
-    if ((iDNSServer != iUdp.remoteIP()) || (iUdp.remotePort() != DNS_PORT)) {
-        // It's not from who we expected
-        return INVALID_SERVER;
-    }
-
-    // Read through the rest of the response
-    if (iUdp.available() < DNS_HEADER_SIZE) {
-        return TRUNCATED;
-    }
-    iUdp.read(header, DNS_HEADER_SIZE);
-
+// Read the rest of a response whose 12-byte header has been read
+static int16_t readAnswer(EthernetUDP& udp, const uint8_t* header, IPAddress& aAddress,
+                          uint32_t& aTTL) {
     uint16_t header_flags = htons(*((uint16_t*)&header[2]));
-    // Check that it's a response to this request
-    if ((iRequestId != (*((uint16_t*)&header[0]))) ||
-        ((header_flags & QUERY_RESPONSE_MASK) != (uint16_t)RESPONSE_FLAG)) {
-        // Mark the entire packet as read
-        iUdp.flush();
-        return INVALID_RESPONSE;
-    }
     // Check for any errors in the response (or in our request)
     // although we don't do anything to get round these
+    if ((header_flags & RESP_MASK) == RESP_NAME_ERROR) {
+        // NXDOMAIN: worth remembering
+        udp.flush();
+        return NAME_NOT_FOUND;
+    }
     if ((header_flags & TRUNCATION_FLAG) || (header_flags & RESP_MASK)) {
         // Mark the entire packet as read
-        iUdp.flush();
+        udp.flush();
         return -5;  // INVALID_RESPONSE;
     }
 
@@ -268,8 +277,8 @@ uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
     uint16_t answerCount = htons(*((uint16_t*)&header[6]));
     if (answerCount == 0) {
         // Mark the entire packet as read
-        iUdp.flush();
-        return -6;  // INVALID_RESPONSE;
+        udp.flush();
+        return NAME_NOT_FOUND;  // name exists but has no address
     }
 
     // Skip over any questions
@@ -277,19 +286,19 @@ uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
         // Skip over the name
         uint8_t len;
         do {
-            iUdp.read(&len, sizeof(len));
+            udp.read(&len, sizeof(len));
             if (len > 0) {
                 // Don't need to actually read the data out for the string, just
                 // advance ptr to beyond it
                 while (len--) {
-                    iUdp.read();  // we don't care about the returned byte
+                    udp.read();  // we don't care about the returned byte
                 }
             }
         } while (len != 0);
 
         // Now jump over the type and class
         for (int i = 0; i < 4; i++) {
-            iUdp.read();  // we don't care about the returned byte
+            udp.read();  // we don't care about the returned byte
         }
     }
 
@@ -302,7 +311,7 @@ uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
         // Skip the name
         uint8_t len;
         do {
-            iUdp.read(&len, sizeof(len));
+            udp.read(&len, sizeof(len));
             if ((len & LABEL_COMPRESSION_MASK) == 0) {
                 // It's just a normal label
                 if (len > 0) {
@@ -310,7 +319,7 @@ uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
                     // Don't need to actually read the data out for the string,
                     // just advance ptr to beyond it
                     while (len--) {
-                        iUdp.read();  // we don't care about the returned byte
+                        udp.read();  // we don't care about the returned byte
                     }
                 }
             } else {
@@ -321,7 +330,7 @@ uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
                 // a pointer.  Either way, when we get here we're at the end of
                 // the name
                 // Skip over the pointer
-                iUdp.read();  // we don't care about the returned byte
+                udp.read();  // we don't care about the returned byte
                 // And set len so that we drop out of the name loop
                 len = 0;
             }
@@ -330,38 +339,357 @@ uint16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
         // Check the type and class
         uint16_t answerType;
         uint16_t answerClass;
-        iUdp.read((uint8_t*)&answerType, sizeof(answerType));
-        iUdp.read((uint8_t*)&answerClass, sizeof(answerClass));
+        udp.read((uint8_t*)&answerType, sizeof(answerType));
+        udp.read((uint8_t*)&answerClass, sizeof(answerClass));
 
-        // Ignore the Time-To-Live as we don't do any caching
-        for (int i = 0; i < TTL_SIZE; i++) {
-            iUdp.read();  // we don't care about the returned byte
-        }
+        // Keep the Time-To-Live for the cache
+        uint8_t ttl[TTL_SIZE];
+        udp.read(ttl, TTL_SIZE);
+        aTTL = ((uint32_t)ttl[0] << 24) | ((uint32_t)ttl[1] << 16) | ((uint32_t)ttl[2] << 8) |
+               ttl[3];
 
         // And read out the length of this answer
         // Don't need header_flags anymore, so we can reuse it here
-        iUdp.read((uint8_t*)&header_flags, sizeof(header_flags));
+        udp.read((uint8_t*)&header_flags, sizeof(header_flags));
 
         if ((htons(answerType) == TYPE_A) && (htons(answerClass) == CLASS_IN)) {
             if (htons(header_flags) != 4) {
                 // It's a weird size
                 // Mark the entire packet as read
-                iUdp.flush();
+                udp.flush();
                 return -9;  // INVALID_RESPONSE;
             }
-            iUdp.read(aAddress.raw_address(), 4);
+            udp.read(aAddress.raw_address(), 4);
+            udp.flush();
             return SUCCESS;
         } else {
             // This isn't an answer type we're after, move onto the next one
             for (uint16_t i = 0; i < htons(header_flags); i++) {
-                iUdp.read();  // we don't care about the returned byte
+                udp.read();  // we don't care about the returned byte
             }
         }
     }
 
     // Mark the entire packet as read
-    iUdp.flush();
+    udp.flush();
 
     // If we get here then we haven't found an answer
     return -10;  // INVALID_RESPONSE;
 }
+
+// DNSClient constructor
+DNSClient::DNSClient(EthernetClass* eth, EthernetChip* chip)
+    : _ethernet(eth),
+      _chip(chip),
+      iDNSServer(INADDR_NONE),
+      iRequestId(0),
+      iTTL(0),
+      iUdp(eth, chip) {
+    // Initialize the DNS client with the given Ethernet chip
+    iUdp.setSocketOwner(SockOwner::DNS);
+}
+DNSClient::DNSClient(EthernetClass* eth, EthernetChip* chip, unsigned long timeout)
+    : _ethernet(eth),
+      _chip(chip),
+      iDNSServer(INADDR_NONE),
+      iRequestId(0),
+      iTTL(0),
+      iUdp(eth, chip) {
+    // Initialize the DNS client with the given Ethernet chip and timeouts
+    iUdp.setSocketOwner(SockOwner::DNS);
+    iUdp.setTimeout(timeout);
+}
+
+void DNSClient::begin(const IPAddress& aDNSServer) {
+    iDNSServer = aDNSServer;
+    iRequestId = 0;
+}
+
+int DNSClient::inet_aton(const char* aIPAddrString, IPAddress& aResult) {
+    return parseDottedQuad(aIPAddrString, aResult);
+}
+
+int DNSClient::getHostByName(const char* aHostname, IPAddress& aResult) {
+    int ret = 0;
+
+    // See if it's a numeric IP address
+    if (inet_aton(aHostname, aResult)) {
+        // It is, our work here is done
+        return 1;
+    }
+
+    // Answer from the cache while the record is fresh
+    DNSCache* cache = _ethernet->dnsCache();
+    int8_t cached = cache->lookup(aHostname, aResult);
+    if (cached > 0) return SUCCESS;
+    if (cached < 0) return NAME_NOT_FOUND;
+
+    // Check we've got a valid DNS server to use
+    if (iDNSServer == INADDR_NONE) {
+        return INVALID_SERVER;
+    }
+
+    ETHERNET_PERF_START_MS(start);
+
+    // Find a socket to use
+    if (iUdp.begin(1024 + (millis() & 0xF)) == 1) {
+        // Try up to three times, asking again whenever an answer doesn't come
+        int retries = 0;
+        ret = TIMED_OUT;
+        while ((retries < 3) && (ret == TIMED_OUT)) {
+            // Send DNS request
+            ret = iUdp.beginPacket(iDNSServer, DNS_PORT);
+            if (ret != 0) {
+                // Now output the request data
+                ret = BuildRequest(aHostname);
+                if (ret != 0) {
+                    // And finally send the request
+                    ret = iUdp.endPacket();
+                    if (ret != 0) {
+                        // Now wait for a response
+                        ret = ProcessResponse(5000, aResult);
+                    }
+                }
+            }
+            retries++;
+        }
+
+        // We're done with the socket now
+        iUdp.stop();
+    }
+    ETHERNET_PERF_EVENT(dns, DNS, MAX_SOCK_NUM, ETHERNET_PERF_ELAPSED_MS(start));
+
+    if (ret == SUCCESS) {
+        cache->store(aHostname, aResult, iTTL);
+    } else if (ret == NAME_NOT_FOUND) {
+        cache->storeNegative(aHostname);
+    }
+    return ret;
+}
+
+uint16_t DNSClient::BuildRequest(const char* aName) {
+    iRequestId = millis();  // generate a random ID
+    writeQuery(iUdp, iRequestId, aName);
+    // Success!  Everything buffered okay
+    return 1;
+}
+
+int16_t DNSClient::ProcessResponse(uint16_t aTimeout, IPAddress& aAddress) {
+    uint32_t startTime = millis();
+
+    // Wait for a response packet from the right server and port, to this request; anything
+    // else (e.g. a late answer to an earlier attempt) is dropped
+    uint8_t header[DNS_HEADER_SIZE];
+    for (;;) {
+        while (iUdp.parsePacket() <= 0) {
+            if ((millis() - startTime) > aTimeout) return TIMED_OUT;
+            delay(50);
+        }
+
+        if ((iDNSServer == iUdp.remoteIP()) && (iUdp.remotePort() == DNS_PORT) &&
+            (iUdp.available() >= DNS_HEADER_SIZE)) {
+            iUdp.read(header, DNS_HEADER_SIZE);
+            uint16_t header_flags = htons(*((uint16_t*)&header[2]));
+            if ((iRequestId == (*((uint16_t*)&header[0]))) &&
+                ((header_flags & QUERY_RESPONSE_MASK) == (uint16_t)RESPONSE_FLAG)) {
+                break;
+            }
+        }
+        // Mark the entire packet as read
+        iUdp.flush();
+    }
+
+    return readAnswer(iUdp, header, aAddress, iTTL);
+}
+
+// DNSResolver
+
+DNSResolver::DNSResolver(EthernetClass* eth, EthernetChip* chip)
+    : _ethernet(eth), _chip(chip), _udp(eth, chip), _open(false), _seq(0) {
+    _udp.setSocketOwner(SockOwner::DNS);
+    for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES; i++) _queries[i].attempts = 0;
+}
+
+uint8_t DNSResolver::pending() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES; i++) {
+        if (_queries[i].attempts) n++;
+    }
+    return n;
+}
+
+int DNSResolver::resolveAsync(const char* aHostname, DNSResolveHandler aHandler, void* aCtx) {
+    IPAddress addr;
+
+    // Numeric addresses and cached names need no query
+    if (parseDottedQuad(aHostname, addr)) {
+        if (aHandler) aHandler(aCtx, aHostname, SUCCESS, addr);
+        return 1;
+    }
+    int8_t cached = _ethernet->dnsCache()->lookup(aHostname, addr);
+    if (cached != 0) {
+        if (aHandler) aHandler(aCtx, aHostname, cached > 0 ? SUCCESS : NAME_NOT_FOUND, addr);
+        return 1;
+    }
+
+    if (_ethernet->dnsServerIP() == INADDR_NONE &&
+        _ethernet->secondaryDnsServerIP() == INADDR_NONE) {
+        return INVALID_SERVER;
+    }
+    if (strlen(aHostname) >= DNS_CACHE_NAME_LEN) return RESOLVER_BUSY;
+
+    Query* q = nullptr;
+    for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES; i++) {
+        if (!_queries[i].attempts) {
+            q = &_queries[i];
+            break;
+        }
+    }
+    if (!q) return RESOLVER_BUSY;
+
+    // One socket for every query in flight, on a random high port
+    if (!_open) {
+        if (_udp.begin(49152 + (micros() & 0x3FFF)) != 1) return RESOLVER_BUSY;
+        _open = true;
+    }
+
+    // An ID no other query in flight is using
+    uint16_t id;
+    bool unique;
+    do {
+        id = (uint16_t)(micros() ^ (++_seq * 0x9E37U));
+        unique = id != 0;
+        for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES && unique; i++) {
+            if (_queries[i].attempts && _queries[i].id == id) unique = false;
+        }
+    } while (!unique);
+
+    strcpy(q->name, aHostname);
+    q->id = id;
+    q->handler = aHandler;
+    q->ctx = aCtx;
+#if ETHERNET3_PERF
+    q->startedAt = millis();
+#endif
+    send(*q);
+    return 0;
+}
+
+// Send (or resend) a query, alternating servers and doubling the wait each time
+bool DNSResolver::send(Query& q) {
+    IPAddress primary = _ethernet->dnsServerIP();
+    IPAddress secondary = _ethernet->secondaryDnsServerIP();
+    IPAddress server = primary;
+    if (secondary != INADDR_NONE && ((q.attempts & 1) || primary == INADDR_NONE)) {
+        server = secondary;
+    }
+
+    if (q.attempts == 0) {
+        q.timeout = DNS_RESOLVER_TIMEOUT;
+    } else {
+        q.timeout = q.timeout >= DNS_RESOLVER_MAX_TIMEOUT / 2 ? DNS_RESOLVER_MAX_TIMEOUT
+                                                              : q.timeout * 2;
+    }
+    q.attempts++;
+    q.sentAt = millis();
+
+    // A failed send is treated like a lost one: the wait runs out and it goes again
+    if (!_udp.beginPacket(server, DNS_PORT)) return false;
+    writeQuery(_udp, q.id, q.name);
+    return _udp.endPacket() == 1;
+}
+
+void DNSResolver::finish(Query& q, int result, const IPAddress& addr) {
+    // Free the slot first so the handler can start another lookup
+    char name[DNS_CACHE_NAME_LEN];
+    strcpy(name, q.name);
+    DNSResolveHandler handler = q.handler;
+    void* ctx = q.ctx;
+    q.attempts = 0;
+    ETHERNET_PERF_EVENT(dns, DNS, MAX_SOCK_NUM, millis() - q.startedAt);
+
+    if (handler) handler(ctx, name, result, addr);
+}
+
+void DNSResolver::receive() {
+    uint8_t header[DNS_HEADER_SIZE];
+    IPAddress primary = _ethernet->dnsServerIP();
+    IPAddress secondary = _ethernet->secondaryDnsServerIP();
+
+    while (_open && _udp.parsePacket() > 0) {
+        IPAddress from = _udp.remoteIP();
+        if (_udp.remotePort() != DNS_PORT || (from != primary && from != secondary) ||
+            _udp.available() < DNS_HEADER_SIZE) {
+            _udp.flush();
+            continue;
+        }
+        _udp.read(header, DNS_HEADER_SIZE);
+
+        uint16_t id = *((uint16_t*)&header[0]);
+        uint16_t header_flags = htons(*((uint16_t*)&header[2]));
+        Query* q = nullptr;
+        for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES; i++) {
+            if (_queries[i].attempts && _queries[i].id == id) {
+                q = &_queries[i];
+                break;
+            }
+        }
+        if (!q || (header_flags & QUERY_RESPONSE_MASK) != (uint16_t)RESPONSE_FLAG) {
+            // Not ours, or an answer to a query already settled
+            _udp.flush();
+            continue;
+        }
+
+        IPAddress addr;
+        uint32_t ttl = 0;
+        int16_t ret = readAnswer(_udp, header, addr, ttl);
+        if (ret == SUCCESS) {
+            _ethernet->dnsCache()->store(q->name, addr, ttl);
+            finish(*q, ret, addr);
+        } else if (ret == NAME_NOT_FOUND) {
+            _ethernet->dnsCache()->storeNegative(q->name);
+            finish(*q, ret, addr);
+        } else if (q->attempts < DNS_RESOLVER_ATTEMPTS) {
+            // The server could not answer; ask the other one now
+            send(*q);
+        } else {
+            finish(*q, ret, addr);
+        }
+    }
+}
+
+void DNSResolver::release() {
+    if (_open && pending() == 0) {
+        _udp.stop();
+        _open = false;
+    }
+}
+
+uint8_t DNSResolver::poll() {
+    if (!_open) return 0;
+
+    receive();
+
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES; i++) {
+        Query& q = _queries[i];
+        if (!q.attempts || now - q.sentAt < q.timeout) continue;
+        if (q.attempts >= DNS_RESOLVER_ATTEMPTS) {
+            finish(q, TIMED_OUT, INADDR_NONE);
+        } else {
+            send(q);
+        }
+    }
+
+    release();
+    return pending();
+}
+
+void DNSResolver::cancel(const char* aHostname) {
+    for (uint8_t i = 0; i < DNS_RESOLVER_QUERIES; i++) {
+        if (_queries[i].attempts && strcasecmp(_queries[i].name, aHostname) == 0) {
+            _queries[i].attempts = 0;
+        }
+    }
+    release();
+}
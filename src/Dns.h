@@ -8,7 +8,9 @@
 #include <Arduino.h>
 #include <string.h>
 
+#include "DnsCache.h"
 #include "Ethernet3.h"
+#include "EthernetPerf.h"
 #include "EthernetUdp2.h"
 #include "chips/utility/socket.h"
 #include "chips/utility/wiznet_registers.h"
@@ -33,6 +35,8 @@ class DNSClient {
     int inet_aton(const char* aIPAddrString, IPAddress& aResult);
 
     /** Resolve the given hostname to an IP address.
+        Answers from the EthernetClass resolver cache when it can, and caches
+        the answer (or the fact that the name does not exist) otherwise.
         @param aHostname Name to be resolved
         @param aResult IPAddress structure to store the returned IP address
         @result 1 if aIPAddrString was successfully converted to an IP address,
@@ -44,11 +48,108 @@ class DNSClient {
     EthernetClass* _ethernet;  // Pointer to the Ethernet class instance
     EthernetChip* _chip;       // Pointer to the Ethernet chip interface
     uint16_t BuildRequest(const char* aName);
-    uint16_t ProcessResponse(uint16_t aTimeout, IPAddress& aAddress);
+    int16_t ProcessResponse(uint16_t aTimeout, IPAddress& aAddress);
 
     IPAddress iDNSServer;
     uint16_t iRequestId;
+    uint32_t iTTL;  // TTL of the last answer, in seconds
     EthernetUDP iUdp;
 };
 
+// Most lookups a DNSResolver keeps in flight at once
+#ifndef DNS_RESOLVER_QUERIES
+#define DNS_RESOLVER_QUERIES 4
+#endif
+
+// Times a query is sent before it fails, alternating servers when there are two
+#ifndef DNS_RESOLVER_ATTEMPTS
+#define DNS_RESOLVER_ATTEMPTS 4
+#endif
+
+// Wait for the first answer in ms; doubles on every retransmission
+#ifndef DNS_RESOLVER_TIMEOUT
+#define DNS_RESOLVER_TIMEOUT 1000
+#endif
+
+// Longest wait between retransmissions in ms
+#ifndef DNS_RESOLVER_MAX_TIMEOUT
+#define DNS_RESOLVER_MAX_TIMEOUT 8000
+#endif
+
+/** Completion handler of DNSResolver::resolveAsync().
+    @param ctx Context given with the request
+    @param host Name that was looked up
+    @param result 1 on success, -1 timed out, -2 no DNS server, -11 no such name,
+           other negative values for a bad answer
+    @param addr The address, valid when result is 1
+*/
+typedef void (*DNSResolveHandler)(void* ctx, const char* host, int result, const IPAddress& addr);
+
+/** Non-blocking resolver.
+    Keeps up to DNS_RESOLVER_QUERIES lookups in flight on one UDP socket and
+    matches answers to them by request ID. An unanswered query is sent again
+    with a doubled timeout, alternating between the primary and secondary DNS
+    servers of the EthernetClass, and a server that answers with an error is
+    skipped at once. Answers go through the EthernetClass resolver cache.
+
+    The socket is taken when the first query starts and given back when the
+    last one finishes. Call poll() from loop(), or attach the resolver with
+    EthernetClass::setResolver() and call maintain().
+*/
+class DNSResolver {
+   public:
+    DNSResolver(EthernetClass* eth, EthernetChip* chip);
+
+    /** Start resolving a hostname.
+        Dotted addresses and cached names are answered at once: the handler is
+        called before resolveAsync() returns.
+        @param aHostname Name to be resolved; copied
+        @param aHandler Called with the result
+        @param aCtx Passed to the handler
+        @result 1 answered already, 0 query in flight, -2 no DNS server,
+                -12 no free query slot, socket, or the name is too long
+    */
+    int resolveAsync(const char* aHostname, DNSResolveHandler aHandler, void* aCtx = nullptr);
+
+    /** Receive answers and retransmit or fail overdue queries.
+        Makes no SPI traffic while no query is in flight.
+        @result Number of queries still in flight
+    */
+    uint8_t poll();
+
+    /** Abandon the lookups of a name without calling their handlers.
+        @param aHostname Name given to resolveAsync()
+    */
+    void cancel(const char* aHostname);
+
+    /** @result Number of queries in flight */
+    uint8_t pending() const;
+
+   protected:
+    struct Query {
+        char name[DNS_CACHE_NAME_LEN];
+        uint16_t id;              // request ID, as sent
+        uint8_t attempts;         // times sent so far, 0 = slot free
+        unsigned long sentAt;     // millis() of the last send
+        uint16_t timeout;         // wait for this send, in ms
+        DNSResolveHandler handler;
+        void* ctx;
+#if ETHERNET3_PERF
+        unsigned long startedAt;  // millis() of the first send
+#endif
+    };
+
+    EthernetClass* _ethernet;
+    EthernetChip* _chip;
+    EthernetUDP _udp;
+    bool _open;  // _udp holds a socket
+    uint16_t _seq;
+    Query _queries[DNS_RESOLVER_QUERIES];
+
+    bool send(Query& q);
+    void finish(Query& q, int result, const IPAddress& addr);
+    void receive();
+    void release();
+};
+
 #endif
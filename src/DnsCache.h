@@ -0,0 +1,131 @@
+/**
+ * @file DnsCache.h
+ * @brief Fixed-size resolver cache for the Ethernet3 DNS client
+ *
+ * Hostname lookups made through EthernetClass (EthernetClient::connect(host),
+ * EthernetUDP::beginPacket(host), EthernetClass::hostByName()) are answered
+ * from this cache while the record's TTL lasts, so reconnecting to a known
+ * host costs neither a DNS round trip nor a socket. Names that do not exist
+ * are remembered for a short time too, and entries can be pinned to a fixed
+ * address that never expires.
+ */
+
+#ifndef dnscache_h
+#define dnscache_h
+
+#include <Arduino.h>
+
+#include "IPAddress.h"
+
+/** @brief Number of names the cache holds */
+#ifndef DNS_CACHE_SIZE
+#define DNS_CACHE_SIZE 4
+#endif
+
+/** @brief Longest name that can be cached, including the terminator */
+#ifndef DNS_CACHE_NAME_LEN
+#define DNS_CACHE_NAME_LEN 40
+#endif
+
+/** @brief Seconds a name that does not exist is remembered */
+#ifndef DNS_CACHE_NEGATIVE_TTL
+#define DNS_CACHE_NEGATIVE_TTL 30
+#endif
+
+/** @brief Upper limit on a record's TTL, in seconds */
+#ifndef DNS_CACHE_MAX_TTL
+#define DNS_CACHE_MAX_TTL 86400UL
+#endif
+
+/**
+ * @brief Resolver cache counters
+ */
+struct DNSCacheStats {
+    uint16_t hits;          ///< Lookups answered with an address
+    uint16_t negativeHits;  ///< Lookups answered with "no such name"
+    uint16_t misses;        ///< Lookups that needed a query
+    uint16_t stores;        ///< Answers added
+    uint16_t evictions;     ///< Live entries replaced to make room
+};
+
+/**
+ * @brief Fixed-size DNS answer cache
+ *
+ * Names are compared case-insensitively. When the cache is full the least
+ * recently used unpinned entry is replaced.
+ */
+class DNSCache {
+   private:
+    static const uint8_t USED = 0x01;      ///< Slot holds an entry
+    static const uint8_t NEGATIVE = 0x02;  ///< Entry records that the name does not exist
+    static const uint8_t PINNED = 0x04;    ///< Entry never expires and is never evicted
+
+    struct Entry {
+        char name[DNS_CACHE_NAME_LEN];
+        IPAddress addr;
+        unsigned long stored;  ///< millis() when stored
+        unsigned long used;    ///< millis() when last returned
+        uint32_t ttl;          ///< Lifetime in ms
+        uint8_t flags;
+    };
+
+    Entry _entries[DNS_CACHE_SIZE];
+    DNSCacheStats _stats;
+
+    Entry* find(const char* name);
+    Entry* slotFor(const char* name);
+    bool expired(const Entry& e) const;
+    bool put(const char* name, const IPAddress& addr, uint32_t ttl, uint8_t flags);
+
+   public:
+    DNSCache();
+
+    /**
+     * @brief Look a name up
+     * @param name Hostname
+     * @param result Receives the cached address on a hit
+     * @return 1 cached address, -1 cached "no such name", 0 not cached
+     */
+    int8_t lookup(const char* name, IPAddress& result);
+
+    /**
+     * @brief Cache an answer
+     * @param name Hostname
+     * @param addr Address from the answer record
+     * @param ttl TTL from the answer record, in seconds
+     * @return false if the name is too long or every slot is pinned
+     */
+    bool store(const char* name, const IPAddress& addr, uint32_t ttl);
+
+    /**
+     * @brief Remember that a name does not exist (NXDOMAIN or no A record)
+     * @param name Hostname
+     * @return false if the name could not be cached
+     */
+    bool storeNegative(const char* name);
+
+    /**
+     * @brief Pin a name to a fixed address
+     * @param name Hostname
+     * @param addr Address to answer with until unpinned
+     * @return false if the name is too long or every slot is pinned
+     */
+    bool pin(const char* name, const IPAddress& addr);
+
+    /**
+     * @brief Drop a name from the cache, pinned or not
+     * @param name Hostname
+     */
+    void remove(const char* name);
+
+    /** @brief Drop every unpinned entry */
+    void flush();
+
+    /** @return Cache counters */
+    const DNSCacheStats& stats() const { return _stats; }
+
+    /** @brief Zero the counters */
+    void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+};
+
+#endif
@@ -16,6 +16,8 @@
 
 #include "Ethernet3.h"
 
+#include "Dns.h"
+
 #if defined(WIZ550io_WITH_MACADDRESS)
 /**
  * @brief Initialize Ethernet using WIZ550io's built-in MAC address with DHCP
@@ -39,11 +41,12 @@ int EthernetClass::begin(void) {
     };
     if (_dhcp != NULL) {
         delete _dhcp;
+        _dhcp = NULL;
     }
-    _dhcp = new DhcpClass();
 
     // Initialise the basic info
-    _chip->init();
+    if (!initChip()) return 0;
+    _dhcp = new DhcpClass(this, _chip);
     _chip->setIPAddress(IPAddress(0, 0, 0, 0).raw_address());
     _chip->getMACAddress(mac_address);
 
@@ -56,6 +59,7 @@ int EthernetClass::begin(void) {
         _chip->setGatewayIp(_dhcp->getGatewayIp().raw_address());
         _chip->setSubnetMask(_dhcp->getSubnetMask().raw_address());
         _dnsServerAddress = _dhcp->getDnsServerIp();
+        _dnsServerAddress2 = _dhcp->getSecondaryDnsServerIp();
         _dnsDomainName = _dhcp->getDnsDomainName();
         _hostName = _dhcp->getHostName();
     }
@@ -119,11 +123,12 @@ void EthernetClass::begin(IPAddress local_ip, IPAddress dns_server, IPAddress ga
  */
 void EthernetClass::begin(IPAddress local_ip, IPAddress dns_server, IPAddress gateway,
                           IPAddress subnet) {
-    _chip->init();
+    if (!initChip()) return;
     _chip->setIPAddress(local_ip.raw_address());
     _chip->setGatewayIp(gateway.raw_address());
     _chip->setSubnetMask(subnet.raw_address());
     _dnsServerAddress = dns_server;
+    _dnsServerAddress2 = INADDR_NONE;
 }
 #else
 /**
@@ -141,31 +146,55 @@ void EthernetClass::begin(IPAddress local_ip, IPAddress dns_server, IPAddress ga
  * @note The mac_address array must remain valid during initialization
  */
 int EthernetClass::begin(uint8_t *mac_address) {
-    if (_dhcp != NULL) {
-        delete _dhcp;
-    }
-    _dhcp = new DhcpClass(this, _chip);
-    // Initialise the basic info
-    _chip->init();
-    _chip->setMACAddress(mac_address);
-    _chip->setIPAddress(IPAddress(0, 0, 0, 0).raw_address());
+    if (!startDhcp(mac_address)) return 0;
 
     // Now try to get our config info from a DHCP server
     int ret = _dhcp->beginWithDHCP(mac_address);
     if (ret == 1) {
         // We've successfully found a DHCP server and got our configuration info, so set things
         // accordingly
-        _chip->setIPAddress(_dhcp->getLocalIp().raw_address());
-        _chip->setGatewayIp(_dhcp->getGatewayIp().raw_address());
-        _chip->setSubnetMask(_dhcp->getSubnetMask().raw_address());
-        _dnsServerAddress = _dhcp->getDnsServerIp();
-        _dnsDomainName = _dhcp->getDnsDomainName();
-        _hostName = _dhcp->getHostName();
+        applyDhcpConfig();
     }
 
     return ret;
 }
 
+/**
+ * @brief Initialize Ethernet with MAC address and start DHCP in the background
+ * @param mac_address 6-byte MAC address array
+ *
+ * Sets up the chip and returns at once; maintain() obtains the lease and
+ * loads it (or the static fallback) into the chip.
+ */
+void EthernetClass::beginAsync(uint8_t *mac_address) {
+    if (!startDhcp(mac_address)) return;
+    _dhcp->start(mac_address, _fallbackAfter);
+}
+
+/**
+ * @brief Reset the chip and create a DHCP client for it
+ * @param mac_address 6-byte MAC address array
+ * @return false if the chip failed its self-test
+ */
+bool EthernetClass::startDhcp(uint8_t *mac_address) {
+    if (_dhcp != NULL) {
+        delete _dhcp;
+        _dhcp = NULL;
+    }
+    // Initialise the basic info
+    if (!initChip()) return false;
+
+    _dhcp = new DhcpClass(this, _chip);
+    _dhcp->onStateChange(_dhcpHandler, _dhcpHandlerCtx);
+    if (_bootLease != nullptr) {
+        _dhcp->importLease(*_bootLease, _bootLeaseAge);
+        _bootLease = nullptr;
+    }
+    _chip->setMACAddress(mac_address);
+    _chip->setIPAddress(IPAddress(0, 0, 0, 0).raw_address());
+    return true;
+}
+
 /**
  * @brief Initialize Ethernet with MAC and static IP, auto-configured DNS and gateway
  * @param mac_address 6-byte MAC address array
@@ -228,12 +257,13 @@ void EthernetClass::begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dn
  */
 void EthernetClass::begin(uint8_t *mac, IPAddress local_ip, IPAddress dns_server, IPAddress gateway,
                           IPAddress subnet) {
-    _chip->init();
+    if (!initChip()) return;
     _chip->setMACAddress(mac);
     _chip->setIPAddress(local_ip.raw_address());
     _chip->setGatewayIp(gateway.raw_address());
     _chip->setSubnetMask(subnet.raw_address());
     _dnsServerAddress = dns_server;
+    _dnsServerAddress2 = INADDR_NONE;
 }
 
 #endif
@@ -249,16 +279,24 @@ void EthernetClass::begin(uint8_t *mac, IPAddress local_ip, IPAddress dns_server
  * - DHCP_CHECK_NONE: No action taken (no DHCP in use or lease still valid)
  * - DHCP_CHECK_RENEW_OK: Lease successfully renewed
  * - DHCP_CHECK_REBIND_OK: Lease successfully rebound
- * - DHCP_CHECK_RENEW_FAIL: Lease renewal failed
- * - DHCP_CHECK_REBIND_FAIL: Lease rebinding failed
+ * - DHCP_CHECK_RENEW_FAIL: Lease renewal failed, rebinding with any server
+ * - DHCP_CHECK_REBIND_FAIL: Lease lost (expired or refused), discovering again
+ * - DHCP_CHECK_BOUND: A new lease was obtained and loaded (beginAsync(), or after a loss)
+ * - DHCP_CHECK_FALLBACK: No lease within the fallback time; the fallback was loaded
  * 
  * When renewal or rebinding succeeds, network configuration is automatically
  * updated with any new settings from the DHCP server.
  * 
+ * The DHCP client never waits here: each call sends or reads at most one
+ * message, so a slow DHCP server no longer stalls the caller.
+ * 
  * @note Only call this if you initialized with DHCP (not static IP)
  */
 int EthernetClass::maintain() {
     int rc = DHCP_CHECK_NONE;
+    if (_events != nullptr) _events->poll();
+    serviceSockets();
+    if (_resolver != nullptr) _resolver->poll();
     if (_dhcp != NULL) {
         // we have a pointer to dhcp, use it
         rc = _dhcp->checkLease();
@@ -268,13 +306,16 @@ int EthernetClass::maintain() {
                 break;
             case DHCP_CHECK_RENEW_OK:
             case DHCP_CHECK_REBIND_OK:
+            case DHCP_CHECK_BOUND:
                 // we might have got a new IP.
-                _chip->setIPAddress(_dhcp->getLocalIp().raw_address());
-                _chip->setGatewayIp(_dhcp->getGatewayIp().raw_address());
-                _chip->setSubnetMask(_dhcp->getSubnetMask().raw_address());
-                _dnsServerAddress = _dhcp->getDnsServerIp();
-                _dnsDomainName = _dhcp->getDnsDomainName();
-                _hostName = _dhcp->getHostName();
+                applyDhcpConfig();
+                break;
+            case DHCP_CHECK_FALLBACK:
+                applyFallbackConfig();
+                break;
+            case DHCP_CHECK_REBIND_FAIL:
+                // the lease is gone; use the fallback while looking for a new one
+                if (_fallbackAfter != 0) applyFallbackConfig();
                 break;
             default:
                 // this is actually a error, it will retry though
@@ -284,6 +325,358 @@ int EthernetClass::maintain() {
     return rc;
 }
 
+/**
+ * @brief Load the lease held by the DHCP client into the chip
+ */
+void EthernetClass::applyDhcpConfig() {
+    _chip->setIPAddress(_dhcp->getLocalIp().raw_address());
+    _chip->setGatewayIp(_dhcp->getGatewayIp().raw_address());
+    _chip->setSubnetMask(_dhcp->getSubnetMask().raw_address());
+    _dnsServerAddress = _dhcp->getDnsServerIp();
+    _dnsServerAddress2 = _dhcp->getSecondaryDnsServerIp();
+    _dnsDomainName = _dhcp->getDnsDomainName();
+    _hostName = _dhcp->getHostName();
+}
+
+/**
+ * @brief Load the static fallback configuration into the chip
+ */
+void EthernetClass::applyFallbackConfig() {
+    _chip->setIPAddress(_fallbackIp.raw_address());
+    _chip->setGatewayIp(_fallbackGateway.raw_address());
+    _chip->setSubnetMask(_fallbackSubnet.raw_address());
+    _dnsServerAddress = _fallbackDns;
+    _dnsServerAddress2 = INADDR_NONE;
+}
+
+/**
+ * @brief Configure the static fallback used when DHCP is slow or the lease is lost
+ * @param afterMs Milliseconds without a lease before the fallback is used, 0 to disable
+ * @param local_ip Fallback IP address
+ * @param dns_server Fallback DNS server
+ * @param gateway Fallback gateway
+ * @param subnet Fallback subnet mask
+ */
+void EthernetClass::setDhcpFallback(unsigned long afterMs, IPAddress local_ip,
+                                    IPAddress dns_server, IPAddress gateway, IPAddress subnet) {
+    _fallbackAfter = afterMs;
+    _fallbackIp = local_ip;
+    _fallbackDns = dns_server;
+    _fallbackGateway = gateway;
+    _fallbackSubnet = subnet;
+}
+
+/**
+ * @brief Register a handler for DHCP state changes
+ * @param handler Called with the old and new DhcpState, or nullptr
+ * @param ctx Passed to the handler
+ *
+ * Kept across begin() calls, which create a new DHCP client.
+ */
+void EthernetClass::onDhcpState(DhcpStateHandler handler, void *ctx) {
+    _dhcpHandler = handler;
+    _dhcpHandlerCtx = ctx;
+    if (_dhcp != NULL) _dhcp->onStateChange(handler, ctx);
+}
+
+/**
+ * @brief Get the state of the DHCP client
+ * @return DhcpState, DhcpState::STOPPED when DHCP is not in use
+ */
+uint8_t EthernetClass::dhcpState() const {
+    return _dhcp != NULL ? _dhcp->state() : DhcpState::STOPPED;
+}
+
+/**
+ * @brief Copy out the current DHCP lease
+ * @param lease Receives the lease, emptied if none is held
+ * @return false if DHCP is not in use or holds no lease
+ */
+bool EthernetClass::dhcpLease(DhcpLease &lease) const {
+    if (_dhcp == NULL) {
+        memset(&lease, 0, sizeof(lease));
+        return false;
+    }
+    return _dhcp->exportLease(lease);
+}
+
+/**
+ * @brief Initialise the chip and the socket allocator
+ * @return false if init() failed; the allocator is then left with no sockets
+ */
+bool EthernetClass::initChip() {
+    if (!_chip->init()) {
+        resetSockets(0);
+        return false;
+    }
+    resetSockets(_chip->maxSockets());
+    return true;
+}
+
+/**
+ * @brief Reset the socket allocator
+ * @param count Sockets the chip provides
+ */
+void EthernetClass::resetSockets(uint8_t count) {
+    if (count > MAX_SOCK_NUM) count = MAX_SOCK_NUM;
+    _freeMask = count >= 8 ? 0xFF : (1 << count) - 1;
+    for (uint8_t i = 0; i < MAX_SOCK_NUM; i++) {
+        // handles from before the reset no longer own their sockets
+        if (_owner[i] != SockOwner::NONE) _generation[i]++;
+        _owner[i] = SockOwner::NONE;
+        _server_port[i] = 0;
+        _state[i] = SockAsync::IDLE;
+        _drainLen[i] = 0;
+    }
+    _asyncMask = 0;
+    _writerMask = 0;
+    for (uint8_t i = 0; i < SockOwner::COUNT; i++) _held[i] = 0;
+    memset(&_sockStats, 0, sizeof(_sockStats));
+    _sockStats.total = count;
+}
+
+/**
+ * @brief Pick a free socket for an owner without touching the chip
+ * @param owner Owner kind
+ * @return Socket number, or MAX_SOCK_NUM if none may be given to this owner
+ */
+uint8_t EthernetClass::pickSocket(uint8_t owner) {
+    if (_freeMask == 0) return MAX_SOCK_NUM;
+
+    // Free sockets the other owner kinds are still owed
+    uint8_t owed = 0;
+    for (uint8_t i = 0; i < SockOwner::COUNT; i++) {
+        if (i != owner && _reserve[i] > _held[i]) owed += _reserve[i] - _held[i];
+    }
+    if (freeSockets() <= owed) return MAX_SOCK_NUM;
+
+    return __builtin_ctz(_freeMask);
+}
+
+/**
+ * @brief Take back allocated sockets whose owner left them closed
+ * @return Number of sockets reclaimed
+ *
+ * One Sn_SR read per allocated socket; only run when the free mask is empty.
+ */
+uint8_t EthernetClass::reclaimSockets() {
+    uint8_t reclaimed = 0;
+    for (uint8_t sock = 0; sock < _sockStats.total; sock++) {
+        if (_owner[sock] == SockOwner::NONE) continue;
+        if (_chip->readSnSR(sock) == SnSR::CLOSED) {
+            freeSocket(sock);
+            reclaimed++;
+        }
+    }
+    _sockStats.reclaims += reclaimed;
+    return reclaimed;
+}
+
+uint8_t EthernetClass::allocSocket(uint8_t owner) {
+    if (owner >= SockOwner::COUNT || owner == SockOwner::NONE) owner = SockOwner::USER;
+
+    uint8_t sock = pickSocket(owner);
+    if (sock == MAX_SOCK_NUM && reclaimSockets() > 0) sock = pickSocket(owner);
+    if (sock == MAX_SOCK_NUM) {
+        _sockStats.failures++;
+        return MAX_SOCK_NUM;
+    }
+
+    _freeMask &= ~(1 << sock);
+    _owner[sock] = owner;
+    _generation[sock]++;
+    _state[sock] = SockAsync::IDLE;
+    _held[owner]++;
+    _sockStats.allocs++;
+    _sockStats.inUse++;
+    if (_sockStats.inUse > _sockStats.peak) _sockStats.peak = _sockStats.inUse;
+    return sock;
+}
+
+void EthernetClass::freeSocket(uint8_t sock) {
+    if (sock >= MAX_SOCK_NUM || _owner[sock] == SockOwner::NONE) return;
+
+    _held[_owner[sock]]--;
+    _owner[sock] = SockOwner::NONE;
+    _generation[sock]++;
+    _server_port[sock] = 0;
+    // an operation still running on it is abandoned (its handler is not called)
+    _state[sock] = SockAsync::IDLE;
+    _asyncMask &= ~(1 << sock);
+    _writerMask &= ~(1 << sock);
+    _freeMask |= (1 << sock);
+    _sockStats.inUse--;
+}
+
+bool EthernetClass::freeSocket(uint8_t sock, uint8_t generation) {
+    if (!ownsSocket(sock, generation)) return false;
+    freeSocket(sock);
+    return true;
+}
+
+bool EthernetClass::reserveSockets(uint8_t owner, uint8_t count) {
+    if (owner >= SockOwner::COUNT) return false;
+    _reserve[owner] = count;
+
+    uint8_t wanted = 0;
+    for (uint8_t i = 0; i < SockOwner::COUNT; i++) wanted += _reserve[i];
+    return wanted <= _sockStats.total;
+}
+
+uint8_t EthernetClass::freeSockets() const { return __builtin_popcount(_freeMask); }
+
+EthernetSocketStats EthernetClass::socketStats() const {
+    EthernetSocketStats stats = _sockStats;
+    stats.reserved = 0;
+    for (uint8_t i = 0; i < SockOwner::COUNT; i++) {
+        if (_reserve[i] > _held[i]) stats.reserved += _reserve[i] - _held[i];
+    }
+    return stats;
+}
+
+void EthernetClass::startAsync(uint8_t sock, uint8_t state, uint16_t timeout,
+                               EthernetAsyncHandler handler, void* ctx) {
+    _state[sock] = state;
+    _asyncStart[sock] = millis();
+    _asyncTimeout[sock] = timeout;
+    _asyncHandler[sock] = handler;
+    _asyncCtx[sock] = ctx;
+    _asyncMask |= (1 << sock);
+}
+
+bool EthernetClass::finishAsync(uint8_t sock, uint8_t state, int8_t result) {
+    EthernetAsyncHandler handler = _asyncHandler[sock];
+
+    _state[sock] = state;
+    _asyncMask &= ~(1 << sock);
+    _asyncHandler[sock] = nullptr;
+
+    if (handler) handler(_asyncCtx[sock], sock, result);
+    return true;
+}
+
+bool EthernetClass::stepSocket(uint8_t sock) {
+    if (!(_asyncMask & (1 << sock))) return false;
+
+    bool expired = _asyncTimeout[sock] != 0 && millis() - _asyncStart[sock] >= _asyncTimeout[sock];
+    uint8_t sr;
+    int8_t pending;
+
+    switch (_state[sock]) {
+        case SockAsync::CONNECTING:
+            sr = _chip->readSnSR(sock);
+            if (sr == SnSR::ESTABLISHED || sr == SnSR::CLOSE_WAIT) {
+                return finishAsync(sock, SockAsync::CONNECTED, 1);
+            }
+            if (sr == SnSR::CLOSED || expired) {
+                // the socket goes back to the allocator before the handler runs
+                close(_chip, sock);
+                freeSocket(sock);
+                return finishAsync(sock, SockAsync::IDLE, -1);
+            }
+            return false;
+
+        case SockAsync::DRAINING:
+            // stopAsync() data that did not fit in TX memory, queued as room appears
+            if (_drainLen[sock] > 0 && !expired) {
+                uint16_t n = sendAsync(_chip, sock, _drainBuf[sock], _drainLen[sock]);
+                _drainBuf[sock] += n;
+                _drainLen[sock] -= n;
+                bool failed = false;
+                if (n == 0) {
+                    sr = _chip->readSnSR(sock);
+                    failed = sr != SnSR::ESTABLISHED && sr != SnSR::CLOSE_WAIT;
+                }
+                if (_drainLen[sock] > 0 && !failed) return false;
+            }
+            pending = _drainLen[sock] > 0 || expired ? 1 : sendPoll(_chip, sock);
+            if (_drainLen[sock] > 0 || pending < 0) {
+                // timed out or failed before everything was sent: do not pass it off as graceful
+                _drainLen[sock] = 0;
+                close(_chip, sock);
+                freeSocket(sock);
+                return finishAsync(sock, SockAsync::IDLE, 0);
+            }
+            // let queued non-blocking data go out ahead of the FIN
+            if (pending == 0) return false;
+            disconnect(_chip, sock);
+            _state[sock] = SockAsync::CLOSING;
+            return false;
+
+        case SockAsync::CLOSING:
+            if (_chip->readSnSR(sock) == SnSR::CLOSED) {
+                freeSocket(sock);
+                return finishAsync(sock, SockAsync::IDLE, 1);
+            }
+            if (expired) {
+                close(_chip, sock);
+                freeSocket(sock);
+                return finishAsync(sock, SockAsync::IDLE, 0);
+            }
+            return false;
+
+        default:
+            _asyncMask &= ~(1 << sock);
+            return true;
+    }
+}
+
+/**
+ * @brief Advance asynchronous connects and closes
+ *
+ * With an event engine enabling CON, DISCON and TIMEOUT, only sockets that
+ * raised an event are read; draining and timed out sockets are stepped
+ * regardless, since neither raises an event of its own.
+ */
+void EthernetClass::serviceSockets() {
+    if (_writerMask != 0) serviceWrites();
+    if (_asyncMask == 0) return;
+
+    uint8_t due = _asyncMask;
+    const uint8_t needed = SnIR::CON | SnIR::DISCON | SnIR::TIMEOUT;
+    if (_events != nullptr && (_events->eventMask() & needed) == needed) {
+        uint8_t covered = _asyncMask & _events->socketMask();
+        due = _events->takeChanged(covered) | (_asyncMask & ~covered);
+        for (uint8_t sock = 0; sock < MAX_SOCK_NUM; sock++) {
+            if (!(covered & (1 << sock))) continue;
+            if (_state[sock] == SockAsync::DRAINING ||
+                (_asyncTimeout[sock] != 0 && millis() - _asyncStart[sock] >= _asyncTimeout[sock])) {
+                due |= (1 << sock);
+            }
+        }
+    }
+
+    for (uint8_t sock = 0; sock < MAX_SOCK_NUM; sock++) {
+        if (due & (1 << sock)) stepSocket(sock);
+    }
+}
+
+/**
+ * @brief Send the write buffers of watched clients once they pass their idle timeout
+ *
+ * Costs nothing until a buffer has aged; the data is queued with sendAsync(),
+ * so this never waits for the chip.
+ */
+void EthernetClass::serviceWrites() {
+    for (uint8_t sock = 0; sock < MAX_SOCK_NUM; sock++) {
+        if (!(_writerMask & (1 << sock))) continue;
+        if (!_writers[sock]->serviceWrites(sock)) _writerMask &= ~(1 << sock);
+    }
+}
+
+void EthernetClass::unwatchWrites(EthernetClient* client) {
+    for (uint8_t sock = 0; sock < MAX_SOCK_NUM; sock++) {
+        if ((_writerMask & (1 << sock)) && _writers[sock] == client) _writerMask &= ~(1 << sock);
+    }
+}
+
+int EthernetClass::hostByName(const char* host, IPAddress& result) {
+    DNSClient dns(this, _chip);
+
+    dns.begin(_dnsServerAddress);
+    return dns.getHostByName(host, result);
+}
+
 /**
  * @brief Get the current local IP address
  * @return Current IP address assigned to this device
@@ -347,3 +740,47 @@ char* EthernetClass::dnsDomainName() { return _dnsDomainName; }
  * Only available when using DHCP initialization and if the DHCP server provides this option.
  */
 char* EthernetClass::hostName() { return _hostName; }
+
+/**
+ * @brief Copy the performance counters
+ * @param out Filled with the counters, or zeroed if they are not compiled in
+ * @return true if the library was built with ETHERNET3_PERF
+ */
+bool EthernetClass::perfSnapshot(EthernetPerfStats& out) {
+#if ETHERNET3_PERF
+    out = ethernetPerf;
+    return true;
+#else
+    memset(&out, 0, sizeof(out));
+    return false;
+#endif
+}
+
+/**
+ * @brief Clear the performance counters
+ *
+ * Call between runs of a benchmark, or after reading a snapshot to report
+ * per-interval figures.
+ */
+void EthernetClass::perfReset() {
+#if ETHERNET3_PERF
+    memset(&ethernetPerf, 0, sizeof(ethernetPerf));
+#endif
+}
+
+/**
+ * @brief Set the trace hook
+ * @param hook Trace hook, or nullptr to remove it
+ * @param ctx Passed to the hook
+ */
+void EthernetClass::setTraceHook(EthernetTraceHook hook, void* ctx) {
+#if ETHERNET3_PERF
+    // Never let a trace pair the new hook with the old context
+    ethernetTraceHook = nullptr;
+    ethernetTraceCtx = ctx;
+    ethernetTraceHook = hook;
+#else
+    (void)hook;
+    (void)ctx;
+#endif
+}
@@ -21,14 +21,20 @@
  */
 
 #include "Dhcp.h"
+#include "DhcpState.h"
+#include "DnsCache.h"
 #include "EthernetClient.h"
+#include "EthernetEvents.h"
+#include "EthernetPerf.h"
 #include "EthernetServer.h"
+#include "EthernetSockets.h"
 #include "IPAddress.h"
 #include "chips/utility/socket.h"
 #include "chips/utility/wiznet_registers.h"
 #include "chips/w5500.h"
 
 class DhcpClass;  // Forward declaration to avoid circular dependency
+class DNSResolver;
 class EthernetChip;
 
 /**
@@ -49,13 +55,87 @@ class EthernetClass {
    private:
     EthernetChip* _chip;         ///< Pointer to the Ethernet chip interface
     IPAddress _dnsServerAddress; ///< DNS server IP address
+    IPAddress _dnsServerAddress2; ///< Secondary DNS server IP address, INADDR_NONE if none
     char* _dnsDomainName;        ///< DNS domain name from DHCP
     char* _hostName;             ///< Host name from DHCP
     DhcpClass* _dhcp;            ///< DHCP client instance
+    DhcpStateHandler _dhcpHandler;  ///< Handed to the DHCP client when it is created
+    void* _dhcpHandlerCtx;          ///< Context for _dhcpHandler
+    const DhcpLease* _bootLease;    ///< Saved lease for the next DHCP start, if any
+    uint32_t _bootLeaseAge;         ///< Seconds since _bootLease was saved, 0 if unknown
+    unsigned long _fallbackAfter;   ///< ms without a lease before the fallback, 0 = none
+    IPAddress _fallbackIp;          ///< Static fallback configuration
+    IPAddress _fallbackDns;
+    IPAddress _fallbackGateway;
+    IPAddress _fallbackSubnet;
+    EthernetEvents* _events;     ///< Socket interrupt engine, if attached
+    DNSResolver* _resolver;      ///< Asynchronous resolver, if attached
+    DNSCache _dnsCache;          ///< Resolver cache shared by every DNS lookup
+
+    uint8_t _freeMask;                    ///< Sockets not allocated (bit n = socket n)
+    uint8_t _reserve[SockOwner::COUNT];   ///< Sockets held back for each owner kind
+    uint8_t _held[SockOwner::COUNT];      ///< Sockets each owner kind holds now
+    uint8_t _generation[MAX_SOCK_NUM];    ///< Bumped each time a socket is allocated or freed
+    EthernetSocketStats _sockStats;       ///< Allocator statistics
+
+    uint8_t _asyncMask;                              ///< Sockets with an async operation running
+    unsigned long _asyncStart[MAX_SOCK_NUM];         ///< millis() when the operation started
+    uint16_t _asyncTimeout[MAX_SOCK_NUM];            ///< Operation timeout in ms, 0 = none
+    EthernetAsyncHandler _asyncHandler[MAX_SOCK_NUM];  ///< Completion handlers
+    void* _asyncCtx[MAX_SOCK_NUM];                   ///< Completion handler contexts
+    const uint8_t* _drainBuf[MAX_SOCK_NUM];          ///< DRAINING: write data not yet queued
+    uint16_t _drainLen[MAX_SOCK_NUM];                ///< DRAINING: bytes left at _drainBuf
+
+    uint8_t _writerMask;                     ///< Sockets whose client holds buffered writes
+    EthernetClient* _writers[MAX_SOCK_NUM];  ///< That client, for each socket in _writerMask
+
+    uint8_t pickSocket(uint8_t owner);
+    uint8_t reclaimSockets();
+
+    /** @brief Load the lease from the DHCP client into the chip */
+    void applyDhcpConfig();
+
+    /** @brief Load the static fallback configuration into the chip */
+    void applyFallbackConfig();
+
+    /**
+     * @brief Run the chip's init() and reset the socket allocator
+     * @return false if the chip failed its self-test; no sockets are then handed out
+     */
+    bool initChip();
+
+    /**
+     * @brief Reset the chip and create a fresh DHCP client for a MAC address
+     * @return false if the chip failed its self-test, leaving no DHCP client
+     */
+    bool startDhcp(uint8_t* mac_address);
+
+    /**
+     * @brief Start an asynchronous operation on a socket
+     * @param sock Socket number
+     * @param state SockAsync::CONNECTING or SockAsync::DRAINING
+     * @param timeout Timeout in ms, 0 for none
+     * @param handler Completion handler, or nullptr
+     * @param ctx Passed to the handler
+     */
+    void startAsync(uint8_t sock, uint8_t state, uint16_t timeout, EthernetAsyncHandler handler,
+                    void* ctx);
+
+    /**
+     * @brief Advance the operation of one socket
+     * @return true if the operation finished during this call
+     */
+    bool stepSocket(uint8_t sock);
+
+    bool finishAsync(uint8_t sock, uint8_t state, int8_t result);
+
+    /** @brief Send aged write buffers of the watched clients (see watchWrites()) */
+    void serviceWrites();
 
    public:
-    uint8_t _state[MAX_SOCK_NUM];      ///< Socket state array
+    uint8_t _state[MAX_SOCK_NUM];      ///< SockAsync state of each socket
     uint16_t _server_port[MAX_SOCK_NUM]; ///< Server port array for each socket
+    uint8_t _owner[MAX_SOCK_NUM];        ///< SockOwner of each socket, NONE if free
 
     /**
      * @brief Constructor for EthernetClass
@@ -64,12 +144,29 @@ class EthernetClass {
      * Creates an Ethernet instance using the specified chip interface.
      * The chip pointer must remain valid for the lifetime of this object.
      */
-    EthernetClass(EthernetChip* chip) : _chip(chip) { _dhcp = nullptr; }
+    EthernetClass(EthernetChip* chip) : _chip(chip) {
+        _dhcp = nullptr;
+        _dhcpHandler = nullptr;
+        _dhcpHandlerCtx = nullptr;
+        _bootLease = nullptr;
+        _bootLeaseAge = 0;
+        _fallbackAfter = 0;
+        _events = nullptr;
+        _resolver = nullptr;
+        _asyncMask = 0;
+        for (uint8_t i = 0; i < SockOwner::COUNT; i++) _reserve[i] = 0;
+        // resetSockets() reads _owner to invalidate old handles, so start from all-free
+        for (uint8_t i = 0; i < MAX_SOCK_NUM; i++) {
+            _generation[i] = 0;
+            _owner[i] = SockOwner::NONE;
+        }
+        resetSockets(MAX_SOCK_NUM);
+    }
 
 #if defined(WIZ550io_WITH_MACADDRESS)
     /**
      * @brief Initialize Ethernet with WIZ550io module (has built-in MAC address)
-     * @return 1 if DHCP configuration succeeded, 0 if failed
+     * @return 1 if DHCP configuration succeeded, 0 if it or the chip's init() failed
      * 
      * For WIZ550io modules that have a pre-programmed MAC address. The module
      * will attempt to configure itself using DHCP. This is only available when
@@ -117,13 +214,15 @@ class EthernetClass {
      * @param subnet Subnet mask
      * 
      * Uses WIZ550io's built-in MAC with complete static network configuration.
+     * If the chip fails its init() self-test nothing is configured; chipReady()
+     * then returns false and every socket request fails.
      */
     void begin(IPAddress local_ip, IPAddress dns_server, IPAddress gateway, IPAddress subnet);
 #else
     /**
      * @brief Initialize Ethernet with MAC address using DHCP
      * @param mac_address 6-byte MAC address array
-     * @return 1 if DHCP configuration succeeded, 0 if failed
+     * @return 1 if DHCP configuration succeeded, 0 if it or the chip's init() failed
      * 
      * Initialize the Ethernet shield with the provided MAC address and obtain
      * network configuration (IP, gateway, subnet, DNS) automatically via DHCP.
@@ -176,24 +275,298 @@ class EthernetClass {
      * 
      * Initialize with complete manual network configuration. This provides
      * full control over all network parameters.
+     * If the chip fails its init() self-test nothing is configured; chipReady()
+     * then returns false and every socket request fails.
      */
     void begin(uint8_t* mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway,
                IPAddress subnet);
 
+    /**
+     * @brief Initialize Ethernet with MAC address and start DHCP without waiting
+     * @param mac_address 6-byte MAC address array
+     *
+     * Returns as soon as the chip is set up. The lease is obtained in the
+     * background by maintain(), which must then be called from loop(); it
+     * returns DHCP_CHECK_BOUND once the lease is in use. If setDhcpFallback()
+     * was called, the static configuration is used after the fallback time
+     * and discovery goes on, switching to the lease when one arrives.
+     * If the chip fails its init() self-test no DHCP is started and
+     * chipReady() returns false.
+     */
+    void beginAsync(uint8_t* mac_address);
+
 #endif
 
+    /**
+     * @brief Configure a static fallback for DHCP
+     * @param afterMs Milliseconds without a lease before the fallback is used, 0 to disable
+     * @param local_ip Fallback IP address
+     * @param dns_server Fallback DNS server
+     * @param gateway Fallback gateway
+     * @param subnet Fallback subnet mask
+     *
+     * Applies to beginAsync(). The fallback is also loaded when a lease expires
+     * without being renewed.
+     */
+    void setDhcpFallback(unsigned long afterMs, IPAddress local_ip, IPAddress dns_server,
+                         IPAddress gateway, IPAddress subnet);
+
+    /**
+     * @brief Register a handler for DHCP state changes
+     * @param handler Called with the old and new DhcpState, or nullptr
+     * @param ctx Passed to the handler
+     */
+    void onDhcpState(DhcpStateHandler handler, void* ctx = nullptr);
+
+    /** @return DhcpState of the DHCP client, DhcpState::STOPPED without DHCP */
+    uint8_t dhcpState() const;
+
+    /**
+     * @brief Offer a saved lease to the next DHCP begin()
+     * @param lease Lease from dhcpLease(), e.g. read back from EEPROM, or nullptr
+     * @param elapsed Seconds since the lease was saved, if known (e.g. from an RTC)
+     *
+     * The next begin(mac) or beginAsync(mac) first asks the DHCP server to
+     * confirm this lease with one INIT-REBOOT request, which takes a single
+     * round trip instead of the full discovery. An empty or corrupt lease, one
+     * for another MAC address, or one with no more than elapsed seconds left
+     * when it was saved, is ignored. The lease is copied by begin(), so it
+     * only has to stay valid until then.
+     */
+    void setDhcpLease(const DhcpLease* lease, uint32_t elapsed = 0) {
+        _bootLease = lease;
+        _bootLeaseAge = elapsed;
+    }
+
+    /**
+     * @brief Copy out the current DHCP lease for saving
+     * @param lease Receives the lease
+     * @return false if no lease is held
+     *
+     * Save it when maintain() returns DHCP_CHECK_BOUND or DHCP_CHECK_RENEW_OK.
+     */
+    bool dhcpLease(DhcpLease& lease) const;
+
     /**
      * @brief Maintain DHCP lease and handle renewal/rebinding
      * @return DHCP status code (DHCP_CHECK_NONE, DHCP_CHECK_RENEW_OK, etc.)
      * 
      * Call this regularly in loop() to maintain DHCP lease. Handles automatic
      * lease renewal and rebinding. Returns status codes indicating any changes
-     * to network configuration.
+     * to network configuration. Never waits for the network: each call sends
+     * or reads at most one DHCP message.
      * 
-     * @note Only needed when using DHCP initialization
+     * Also services an attached event engine, advances asynchronous
+     * connects and closes, and sends aged client write buffers (see
+     * serviceSockets()).
+     * 
+     * @note Only needed when using DHCP initialization, an event engine
+     *       (see setEvents()), connectAsync()/stopAsync() or a client
+     *       write idle timeout
      */
     int maintain();
 
+    /**
+     * @brief Advance asynchronous connects and closes
+     *
+     * Called by maintain(); call it directly from a control loop that does
+     * not call maintain(). Costs nothing when no operation is in progress, and
+     * one Sn_SR read per busy socket otherwise. With an event engine attached
+     * (CON, DISCON and TIMEOUT enabled) sockets are only read when they raised
+     * an event, are draining queued data, or have timed out.
+     *
+     * Also sends the write buffer of any client whose buffered data has aged
+     * past its idle timeout (EthernetClient::setWriteIdleTimeout()), without
+     * waiting for the chip.
+     */
+    void serviceSockets();
+
+    /**
+     * @brief Have serviceSockets() send a client's buffered writes once they age
+     * @param sock Socket of the client
+     * @param client Client holding data in its write buffer
+     *
+     * Called by EthernetClient::write(); the registration ends when the
+     * buffer is empty, the socket is freed or the client is destroyed.
+     */
+    void watchWrites(uint8_t sock, EthernetClient* client) {
+        _writers[sock] = client;
+        _writerMask |= (1 << sock);
+    }
+
+    /** @brief Drop every watchWrites() registration of a client */
+    void unwatchWrites(EthernetClient* client);
+
+    /**
+     * @brief Get the asynchronous operation state of a socket
+     * @param sock Socket number
+     * @return SockAsync state
+     */
+    uint8_t socketState(uint8_t sock) const {
+        return sock < MAX_SOCK_NUM ? _state[sock] : SockAsync::IDLE;
+    }
+
+    /** @return Bitmask of sockets with an asynchronous operation in progress */
+    uint8_t pendingSockets() const { return _asyncMask; }
+
+    /**
+     * @brief Attach a socket interrupt event engine
+     * @param events Engine to service from maintain(), or nullptr to detach
+     *
+     * The engine must already have been started with EthernetEvents::begin().
+     */
+    void setEvents(EthernetEvents* events) { _events = events; }
+
+    /**
+     * @brief Get the attached event engine
+     * @return Event engine, or nullptr if none is attached
+     */
+    EthernetEvents* events() { return _events; }
+
+    // ===== Socket allocation =====
+
+    /**
+     * @brief Allocate a free hardware socket
+     * @param owner Kind of user taking the socket (SockOwner)
+     * @return Socket number, or MAX_SOCK_NUM if none is available
+     *
+     * The free socket comes from a mask in RAM, with no SPI traffic. Sockets
+     * reserved for other owner kinds are not handed out. Only when nothing is
+     * free are allocated sockets checked for ones their owner left CLOSED
+     * without freeing, and those are reclaimed.
+     */
+    uint8_t allocSocket(uint8_t owner = SockOwner::USER);
+
+    /**
+     * @brief Return a socket to the allocator
+     * @param sock Socket number
+     *
+     * Only the bookkeeping is released; close the socket first.
+     */
+    void freeSocket(uint8_t sock);
+
+    /**
+     * @brief Return a socket to the allocator if a handle still owns it
+     * @param sock Socket number
+     * @param generation socketGeneration() recorded when the handle got the socket
+     * @return false if the socket was freed or reallocated since, and nothing was done
+     */
+    bool freeSocket(uint8_t sock, uint8_t generation);
+
+    /**
+     * @brief Get the allocation generation of a socket
+     * @param sock Socket number
+     * @return Tag that changes every time the socket is allocated or freed
+     *
+     * A client or UDP object records it with its socket number, so once the
+     * socket is reclaimed and handed to someone else the old object can tell.
+     */
+    uint8_t socketGeneration(uint8_t sock) const {
+        return sock < MAX_SOCK_NUM ? _generation[sock] : 0;
+    }
+
+    /**
+     * @brief Check that a handle still owns its socket
+     * @param sock Socket number
+     * @param generation socketGeneration() recorded when the handle got the socket
+     * @return true if the socket is allocated and has not been freed since
+     */
+    bool ownsSocket(uint8_t sock, uint8_t generation) const {
+        return sock < MAX_SOCK_NUM && _owner[sock] != SockOwner::NONE &&
+               _generation[sock] == generation;
+    }
+
+    /**
+     * @brief Keep sockets available for one kind of owner
+     * @param owner Owner kind (SockOwner), e.g. SockOwner::DHCP
+     * @param count Sockets to keep for it, counting the ones it already holds
+     * @return true if there are enough sockets left to honour the reservation
+     *
+     * Other owners are refused sockets that would eat into the reservation.
+     */
+    bool reserveSockets(uint8_t owner, uint8_t count);
+
+    /**
+     * @brief Get the owner of a socket
+     * @param sock Socket number
+     * @return SockOwner kind holding it, SockOwner::NONE if free
+     */
+    uint8_t socketOwner(uint8_t sock) const {
+        return sock < MAX_SOCK_NUM ? _owner[sock] : SockOwner::NONE;
+    }
+
+    /** @return false if the chip failed its init() self-test in the last begin() */
+    bool chipReady() const { return _sockStats.total != 0; }
+
+    /** @return Number of sockets not allocated, including reserved ones */
+    uint8_t freeSockets() const;
+
+    /** @return Allocator usage statistics */
+    EthernetSocketStats socketStats() const;
+
+    /**
+     * @brief Forget every allocation
+     * @param count Number of sockets the chip provides
+     *
+     * Called by begin() after the chip is reset, which closes every socket.
+     * Reservations are kept.
+     */
+    void resetSockets(uint8_t count);
+
+    // ===== Name resolution =====
+
+    /**
+     * @brief Resolve a hostname, using the resolver cache
+     * @param host Hostname or dotted IP address
+     * @param result Receives the address
+     * @return 1 on success, else a negative DNS error code
+     *
+     * Used by EthernetClient::connect(host) and EthernetUDP::beginPacket(host).
+     * Call it ahead of time to pre-resolve names.
+     */
+    int hostByName(const char* host, IPAddress& result);
+
+    /**
+     * @brief Attach an asynchronous resolver
+     * @param resolver Resolver to service from maintain(), or nullptr to detach
+     */
+    void setResolver(DNSResolver* resolver) { _resolver = resolver; }
+
+    /**
+     * @brief Get the attached asynchronous resolver
+     * @return Resolver, or nullptr if none is attached
+     */
+    DNSResolver* resolver() { return _resolver; }
+
+    /**
+     * @brief Get the resolver cache
+     * @return Cache, for pinning names or reading its counters
+     */
+    DNSCache* dnsCache() { return &_dnsCache; }
+
+    /**
+     * @brief Copy the performance counters (see EthernetPerf.h)
+     * @param out Filled with the counters, or zeroed if they are not compiled in
+     * @return true if the library was built with ETHERNET3_PERF
+     *
+     * The counters are shared by every interface of the program.
+     */
+    bool perfSnapshot(EthernetPerfStats& out);
+
+    /**
+     * @brief Clear the performance counters
+     */
+    void perfReset();
+
+    /**
+     * @brief Set the function called at each timed event (see EthernetTrace)
+     * @param hook Trace hook, or nullptr to remove it
+     * @param ctx Passed to the hook
+     *
+     * Has no effect unless the library was built with ETHERNET3_PERF.
+     */
+    void setTraceHook(EthernetTraceHook hook, void* ctx = nullptr);
+
     /**
      * @brief Get current local IP address
      * @return Current IP address assigned to this device
@@ -217,6 +590,26 @@ class EthernetClass {
      * @return Current DNS server IP address
      */
     IPAddress dnsServerIP();
+
+    /**
+     * @brief Get the secondary DNS server IP address
+     * @return Second server of DHCP option 6, or INADDR_NONE if there is none
+     *
+     * DNSResolver fails over to this server when the primary does not answer.
+     */
+    IPAddress secondaryDnsServerIP() { return _dnsServerAddress2; }
+
+    /**
+     * @brief Set the DNS servers
+     * @param primary Server queried first
+     * @param secondary Failover server, or INADDR_NONE
+     *
+     * Overrides the servers from begin() or DHCP until the next begin() or lease renewal.
+     */
+    void setDnsServers(IPAddress primary, IPAddress secondary = INADDR_NONE) {
+        _dnsServerAddress = primary;
+        _dnsServerAddress2 = secondary;
+    }
     
     /**
      * @brief Get DNS domain name from DHCP
@@ -15,9 +15,6 @@ extern "C" {
 
 #include "EthernetClient.h"
 
-/// Static source port counter - increments for each new connection
-uint16_t EthernetClient::_srcport = 1024;
-
 /**
  * @brief Construct a new EthernetClient without a specific socket
  * @param eth Pointer to EthernetClass instance
@@ -26,7 +23,19 @@ uint16_t EthernetClient::_srcport = 1024;
  * Creates a client that will allocate a socket when connect() is called.
  */
 EthernetClient::EthernetClient(EthernetClass* eth, EthernetChip* chip)
-    : _ethernet(eth), _chip(chip), _sock(MAX_SOCK_NUM) {}
+    : _ethernet(eth),
+      _chip(chip),
+      _sock(MAX_SOCK_NUM),
+      _generation(0),
+      _nonBlocking(false),
+      _sendBusy(false),
+      _onWriteComplete(nullptr),
+      _txBuf(nullptr),
+      _txSize(0),
+      _txLen(0),
+      _txIdleTimeout(ETHERNET_CLIENT_WRITE_IDLE_TIMEOUT),
+      _txStart(0),
+      _connectTimeout(0) {}
 
 /**
  * @brief Construct a new EthernetClient with a specific socket
@@ -37,7 +46,23 @@ EthernetClient::EthernetClient(EthernetClass* eth, EthernetChip* chip)
  * Creates a client using the specified socket. Used internally by EthernetServer.
  */
 EthernetClient::EthernetClient(EthernetClass* eth, EthernetChip* chip, uint8_t sock)
-    : _ethernet(eth), _chip(chip), _sock(sock) {}
+    : _ethernet(eth),
+      _chip(chip),
+      _sock(sock),
+      _generation(eth != nullptr ? eth->socketGeneration(sock) : 0),
+      _nonBlocking(false),
+      _sendBusy(false),
+      _onWriteComplete(nullptr),
+      _txBuf(nullptr),
+      _txSize(0),
+      _txLen(0),
+      _txIdleTimeout(ETHERNET_CLIENT_WRITE_IDLE_TIMEOUT),
+      _txStart(0),
+      _connectTimeout(0) {}
+
+EthernetClient::~EthernetClient() {
+    if (_ethernet != nullptr) _ethernet->unwatchWrites(this);
+}
 
 /**
  * @brief Connect to a server using hostname resolution
@@ -51,11 +76,10 @@ EthernetClient::EthernetClient(EthernetClass* eth, EthernetChip* chip, uint8_t s
 int EthernetClient::connect(const char* host, uint16_t port) {
     // Look up the host first
     int ret = 0;
-    DNSClient dns(_ethernet, _chip);
     IPAddress remote_addr;
 
-    dns.begin(_ethernet->dnsServerIP());
-    ret = dns.getHostByName(host, remote_addr);
+    if (_ethernet == nullptr) return 0;
+    ret = _ethernet->hostByName(host, remote_addr);
     if (ret == 1) {
         return connect(remote_addr, port);
     } else {
@@ -74,36 +98,66 @@ int EthernetClient::connect(const char* host, uint16_t port) {
  * and waits for the connection to be established.
  */
 int EthernetClient::connect(IPAddress ip, uint16_t port) {
-    if (_sock != MAX_SOCK_NUM) return 0;
+    if (!connectAsync(ip, port)) return 0;
 
-    for (int i = 0; i < MAX_SOCK_NUM; i++) {
-        uint8_t s = _chip->readSnSR(i);
-        if (s == SnSR::CLOSED || s == SnSR::FIN_WAIT || s == SnSR::CLOSE_WAIT) {
-            _sock = i;
-            break;
-        }
-    }
+    int8_t ret;
+    while ((ret = connectStatus()) == 0) delay(1);
+    return ret > 0;
+}
+
+/**
+ * @brief Start a connection and return immediately
+ * @param ip IP address to connect to
+ * @param port Port number to connect to
+ * @param handler Completion handler, or nullptr
+ * @param ctx Passed to the handler
+ * @return 1 if the attempt was started, 0 if failed
+ */
+int EthernetClient::connectAsync(IPAddress ip, uint16_t port, EthernetAsyncHandler handler,
+                                 void* ctx) {
+    if (_ethernet == nullptr || (_sock != MAX_SOCK_NUM && !released())) return 0;
 
+    _sock = _ethernet->allocSocket(SockOwner::CLIENT);
     if (_sock == MAX_SOCK_NUM) return 0;
+    _generation = _ethernet->socketGeneration(_sock);
 
-    _srcport++;
-    if (_srcport == 0) _srcport = 1024;
-    socket(_chip, _sock, SnMR::TCP, _srcport, 0);
+    socket(_chip, _sock, SnMR::TCP, _chip->nextLocalPort(), 0);
 
     if (!::connect(_chip, _sock, rawIPAddress(ip), port)) {
+        close(_chip, _sock);
+        _ethernet->freeSocket(_sock, _generation);
         _sock = MAX_SOCK_NUM;
         return 0;
     }
 
-    while (status() != SnSR::ESTABLISHED) {
-        delay(1);
-        if (status() == SnSR::CLOSED) {
-            _sock = MAX_SOCK_NUM;
+    _ethernet->startAsync(_sock, SockAsync::CONNECTING, _connectTimeout, handler, ctx);
+    return 1;
+}
+
+/**
+ * @brief Check on a connection started with connectAsync()
+ * @return 1 connected, 0 in progress, -1 failed
+ */
+int8_t EthernetClient::connectStatus() {
+    if (_sock == MAX_SOCK_NUM || released()) return -1;
+
+    if (_ethernet->_state[_sock] == SockAsync::CONNECTING) {
+        _ethernet->stepSocket(_sock);
+        // a connect that failed has already given its socket back
+        if (released()) return -1;
+    }
+
+    switch (_ethernet->_state[_sock]) {
+        case SockAsync::CONNECTING:
             return 0;
+        case SockAsync::CONNECTED:
+            _ethernet->_state[_sock] = SockAsync::IDLE;
+            return 1;
+        default: {
+            uint8_t s = status();
+            return (s == SnSR::ESTABLISHED || s == SnSR::CLOSE_WAIT) ? 1 : -1;
         }
     }
-
-    return 1;
 }
 
 /**
@@ -125,15 +179,178 @@ size_t EthernetClient::write(uint8_t b) { return write(&b, 1); }
  * flag if the socket is invalid or send operation fails.
  */
 size_t EthernetClient::write(const uint8_t* buf, size_t size) {
-    if (_sock == MAX_SOCK_NUM) {
+    if (_sock == MAX_SOCK_NUM || released()) {
         setWriteError();
         return 0;
     }
-    if (!send(_chip, _sock, buf, size)) {
+    if (_txBuf == nullptr) return writeSocket(buf, size);
+
+    flushIfIdle();
+    // Large writes gain nothing from coalescing
+    if (_txLen == 0 && size >= _txSize) return writeSocket(buf, size);
+
+    size_t done = 0;
+    while (done < size) {
+        if (_txLen == _txSize) {
+            if (!pushBuffer()) break;
+            if (_txLen == _txSize) break;  // non-blocking and TX memory full
+        }
+        size_t n = _txSize - _txLen;
+        if (n > size - done) n = size - done;
+        if (_txLen == 0) _txStart = millis();
+        memcpy(_txBuf + _txLen, buf + done, n);
+        _txLen += n;
+        done += n;
+    }
+    if (_txLen == _txSize) pushBuffer();
+    if (_txLen > 0 && _ethernet != nullptr) _ethernet->watchWrites(_sock, this);
+    return done;
+}
+
+/**
+ * @brief Hand data straight to the socket
+ * @param buf Data to send
+ * @param size Number of bytes
+ * @return Number of bytes accepted; fewer than size if the connection failed
+ *         (write error flag set)
+ *
+ * Blocking mode sends in pieces of at most the socket's TX memory, each
+ * confirmed by the chip, until everything is out; non-blocking mode queues as
+ * much as fits and returns.
+ */
+size_t EthernetClient::writeSocket(const uint8_t* buf, size_t size) {
+    if (_nonBlocking) {
+        uint16_t accepted = sendChunk(buf, size > 0xFFFF ? 0xFFFF : size);
+        if (accepted > 0) _sendBusy = true;
+        return accepted;
+    }
+    size_t done = 0;
+    while (done < size) {
+        size_t n = size - done;
+        uint16_t sent = sendChunk(buf + done, n > 0xFFFF ? 0xFFFF : n);
+        if (sent == 0) {
+            setWriteError();
+            break;
+        }
+        done += sent;
+    }
+    return done;
+}
+
+uint16_t EthernetClient::sendChunk(const uint8_t* buf, uint16_t len) {
+    if (_nonBlocking) return sendAsync(_chip, _sock, buf, len);
+    return send(_chip, _sock, buf, len);
+}
+
+/**
+ * @brief Enable write coalescing in a caller-supplied buffer
+ * @param buf Buffer, or nullptr to disable (pending data is flushed first)
+ * @param size Buffer size in bytes
+ */
+void EthernetClient::setWriteBuffer(uint8_t* buf, uint16_t size) {
+    if (_txLen > 0) flush();
+    _txBuf = size ? buf : nullptr;
+    _txSize = _txBuf ? size : 0;
+    _txLen = 0;
+}
+
+/**
+ * @brief Move buffered write data to the socket
+ * @return false if the connection failed; the buffered data is discarded
+ *
+ * In non-blocking mode only part of the buffer may be accepted; the rest is
+ * moved to the front and kept.
+ */
+bool EthernetClient::pushBuffer() {
+    if (_txLen == 0) return true;
+
+    size_t sent = writeSocket(_txBuf, _txLen);
+    if (sent < _txLen && !_nonBlocking) {
+        _txLen = 0;
+        return false;
+    }
+    if (sent < _txLen) memmove(_txBuf, _txBuf + sent, _txLen - sent);
+    _txLen -= sent;
+    return true;
+}
+
+/**
+ * @brief Send buffered write data once the oldest byte exceeds the idle timeout
+ */
+void EthernetClient::flushIfIdle() {
+    if (_txLen > 0 && _txIdleTimeout > 0 && millis() - _txStart >= _txIdleTimeout) pushBuffer();
+}
+
+bool EthernetClient::serviceWrites(uint8_t sock) {
+    if (_sock != sock) return false;
+
+    if (_txLen > 0 && _txIdleTimeout > 0 && millis() - _txStart >= _txIdleTimeout) {
+        // Staged behind any SEND in flight; a later blocking send() drains it first
+        uint16_t sent = sendAsync(_chip, _sock, _txBuf, _txLen);
+        if (sent > 0) {
+            _sendBusy = true;
+            if (sent < _txLen) memmove(_txBuf, _txBuf + sent, _txLen - sent);
+            _txLen -= sent;
+        } else {
+            uint8_t s = _chip->readSnSR(_sock);
+            if (s != SnSR::ESTABLISHED && s != SnSR::CLOSE_WAIT) _txLen = 0;
+        }
+    }
+    if (_sendBusy) reapSend();
+    return _txLen > 0 || _sendBusy;
+}
+
+/**
+ * @brief Get the number of bytes write() can accept right now
+ * @return Free TX space less any data queued but not yet sent, or 0 if not connected
+ */
+int EthernetClient::availableForWrite() {
+    if (_sock == MAX_SOCK_NUM || released()) return 0;
+    uint16_t fsr = _chip->getTXFreeSize(_sock);
+    uint16_t staged = _chip->txStaged(_sock);
+    return fsr > staged ? fsr - staged : 0;
+}
+
+/**
+ * @brief Advance background transmission of non-blocking writes
+ *
+ * Reaps a completed SEND, issues the next one if data is queued and fires the
+ * write-complete callback once everything accepted has been sent.
+ */
+void EthernetClient::poll() {
+    if (_sock == MAX_SOCK_NUM || released()) return;
+    flushIfIdle();
+    if (_sendBusy) reapSend();
+}
+
+void EthernetClient::reapSend() {
+    int8_t r = sendPoll(_chip, _sock);
+    if (r == 0) return;
+
+    _sendBusy = false;
+    if (r < 0) {
         setWriteError();
-        return 0;
+        return;
     }
-    return size;
+    if (_onWriteComplete) _onWriteComplete(*this);
+}
+
+/**
+ * @brief Check whether all written data has been sent
+ * @return true when nothing is queued or in flight
+ */
+bool EthernetClient::writeComplete() {
+    poll();
+    return !_sendBusy;
+}
+
+/**
+ * @brief Wait for queued non-blocking data to be sent
+ * @param timeout Maximum time to wait in milliseconds
+ */
+void EthernetClient::drainPending(unsigned long timeout) {
+    unsigned long start = millis();
+    while (_sendBusy && millis() - start < timeout) poll();
 }
 
 /**
@@ -144,8 +361,9 @@ size_t EthernetClient::write(const uint8_t* buf, size_t size) {
  * without blocking.
  */
 int EthernetClient::available() {
-    if (_sock != MAX_SOCK_NUM) return _chip->getRXReceivedSize(_sock);
-    return 0;
+    if (_sock == MAX_SOCK_NUM || released()) return 0;
+    flushIfIdle();
+    return _chip->getRXReceivedSize(_sock);
 }
 
 /**
@@ -156,7 +374,8 @@ int EthernetClient::available() {
  */
 int EthernetClient::read() {
     uint8_t b;
-    if (recv(_chip, _sock, &b, 1) > 0) {
+    if (_sock == MAX_SOCK_NUM || released()) return -1;
+    if (recvChunk(&b, 1) > 0) {
         // recv worked
         return b;
     } else {
@@ -173,7 +392,72 @@ int EthernetClient::read() {
  * 
  * Reads up to 'size' bytes from the receive buffer.
  */
-int EthernetClient::read(uint8_t* buf, size_t size) { return recv(_chip, _sock, buf, size); }
+int EthernetClient::read(uint8_t* buf, size_t size) {
+    if (_sock == MAX_SOCK_NUM || released()) return -1;
+    return recvChunk(buf, size);
+}
+
+int16_t EthernetClient::recvChunk(uint8_t* buf, int16_t len) { return recv(_chip, _sock, buf, len); }
+
+/**
+ * @brief Stream received data to a visitor
+ * @param visitor Chunk consumer
+ * @param ctx Visitor context
+ * @param maxLen Maximum number of bytes to visit
+ * @return Bytes consumed, or -1 if the client has no socket
+ */
+int EthernetClient::readInto(SocketReadVisitor visitor, void* ctx, size_t maxLen) {
+    if (_sock == MAX_SOCK_NUM || released()) return -1;
+    if (maxLen > 0xFFFF) maxLen = 0xFFFF;
+    return recvVisit(_chip, _sock, maxLen, visitor, ctx);
+}
+
+/**
+ * @brief Send data produced straight into chip TX memory
+ * @param producer Chunk producer
+ * @param ctx Producer context
+ * @param maxLen Maximum number of bytes to send
+ * @return Bytes sent or queued
+ *
+ * Any coalesced write data goes out first so the stream stays in order.
+ */
+size_t EthernetClient::writeFrom(SocketWriteProducer producer, void* ctx, size_t maxLen) {
+    if (_sock == MAX_SOCK_NUM || released()) {
+        setWriteError();
+        return 0;
+    }
+    if (_txLen > 0) {
+        if (_nonBlocking) {
+            pushBuffer();
+            if (_txLen > 0) return 0;
+        } else {
+            flush();
+        }
+    }
+
+    size_t total = 0;
+    bool ended = false;
+    while (total < maxLen && !ended) {
+        size_t want = maxLen - total;
+        if (want > 0xFFFF) want = 0xFFFF;
+        uint16_t n = sendProduce(_chip, _sock, want, producer, ctx, &ended);
+        if (n > 0) _sendBusy = true;
+        total += n;
+        if (_nonBlocking) break;
+
+        // wait for the chip to drain so the next round has the whole TX buffer
+        ::flush(_chip, _sock);
+        poll();
+        if (n == 0 && !ended) {
+            uint8_t s = status();
+            if (s != SnSR::ESTABLISHED && s != SnSR::CLOSE_WAIT) {
+                setWriteError();
+                break;
+            }
+        }
+    }
+    return total;
+}
 
 /**
  * @brief Peek at the next byte without removing it
@@ -184,6 +468,7 @@ int EthernetClient::read(uint8_t* buf, size_t size) { return recv(_chip, _sock,
  */
 int EthernetClient::peek() {
     uint8_t b;
+    if (_sock == MAX_SOCK_NUM || released()) return -1;
     // Unlike recv, peek doesn't check to see if there's any data available, so we must
     if (!available()) return -1;
     ::peek(_chip, _sock, &b);
@@ -196,7 +481,19 @@ int EthernetClient::peek() {
  * Ensures all buffered outgoing data is transmitted. This is a blocking
  * operation that waits until transmission is complete.
  */
-void EthernetClient::flush() { ::flush(_chip, _sock); }
+void EthernetClient::flush() {
+    if (_sock == MAX_SOCK_NUM || released()) return;
+
+    while (_txLen > 0) {
+        uint8_t s = status();
+        if (!pushBuffer() || (s != SnSR::ESTABLISHED && s != SnSR::CLOSE_WAIT)) {
+            _txLen = 0;
+            break;
+        }
+    }
+    ::flush(_chip, _sock);
+    poll();
+}
 
 /**
  * @brief Close the connection gracefully
@@ -206,7 +503,11 @@ void EthernetClient::flush() { ::flush(_chip, _sock); }
  * Releases the socket for reuse.
  */
 void EthernetClient::stop() {
-    if (_sock == MAX_SOCK_NUM) return;
+    if (_sock == MAX_SOCK_NUM || released()) return;
+
+    // let buffered and queued non-blocking data go out ahead of the FIN
+    if (_txLen > 0) flush();
+    drainPending(1000);
 
     // attempt to close the connection gracefully (send a FIN to other side)
     disconnect(_chip, _sock);
@@ -218,7 +519,36 @@ void EthernetClient::stop() {
     // if it hasn't closed, close it forcefully
     if (status() != SnSR::CLOSED) close(_chip, _sock);
 
+    _ethernet->freeSocket(_sock, _generation);
+    _sock = MAX_SOCK_NUM;
+}
+
+/**
+ * @brief Close the connection in the background
+ * @param handler Completion handler, or nullptr
+ * @param ctx Passed to the handler
+ */
+void EthernetClient::stopAsync(EthernetAsyncHandler handler, void* ctx) {
+    if (_sock == MAX_SOCK_NUM || released()) return;
+
+    // What TX memory cannot take now stays in the write buffer, which the closing
+    // socket keeps until it has been queued
+    uint16_t sent = _txLen > 0 ? sendAsync(_chip, _sock, _txBuf, _txLen) : 0;
+    _ethernet->_drainBuf[_sock] = _txBuf + sent;
+    _ethernet->_drainLen[_sock] = _txLen - sent;
+    if (sent < _txLen) {
+        _txBuf = nullptr;
+        _txSize = 0;
+    }
+    _txLen = 0;
+
+    // a server must not hand the socket out again while it is closing
     _ethernet->_server_port[_sock] = 0;
+    _ethernet->unwatchWrites(this);
+    _ethernet->startAsync(_sock, SockAsync::DRAINING, ETHERNET_CLOSE_TIMEOUT, handler, ctx);
+    _ethernet->stepSocket(_sock);
+
+    _sendBusy = false;
     _sock = MAX_SOCK_NUM;
 }
 
@@ -246,10 +576,24 @@ uint8_t EthernetClient::connected() {
  * the Ethernet chip. Useful for detailed connection state analysis.
  */
 uint8_t EthernetClient::status() {
-    if (_sock == MAX_SOCK_NUM) return SnSR::CLOSED;
+    if (_sock == MAX_SOCK_NUM || released()) return SnSR::CLOSED;
     return _chip->readSnSR(_sock);
 }
 
+/**
+ * @brief Drop the socket if the allocator has taken it back
+ * @return true if the socket was reclaimed, and possibly handed to someone else
+ *
+ * The socket is left alone: it is either free or another object's now.
+ */
+bool EthernetClient::released() {
+    if (_ethernet == nullptr || _ethernet->ownsSocket(_sock, _generation)) return false;
+    _txLen = 0;
+    _sendBusy = false;
+    _sock = MAX_SOCK_NUM;
+    return true;
+}
+
 /**
  * @brief Boolean conversion operator
  * @return true if client has a valid socket, false otherwise
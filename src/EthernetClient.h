@@ -17,6 +17,15 @@
 #include "chips/EthernetChip.h"
 #include "chips/utility/socket.h"
 
+/**
+ * @brief Default age, in milliseconds, at which coalesced write data is sent
+ *
+ * Only applies to clients given a write buffer with setWriteBuffer().
+ */
+#ifndef ETHERNET_CLIENT_WRITE_IDLE_TIMEOUT
+#define ETHERNET_CLIENT_WRITE_IDLE_TIMEOUT 20
+#endif
+
 /**
  * @brief TCP client class for establishing outbound network connections
  * 
@@ -36,7 +45,7 @@
  * - Supports multiple simultaneous connections more reliably
  */
 class EthernetClient : public Client {
-   private:
+   protected:
     EthernetClass *_ethernet;  ///< Pointer to the Ethernet class instance
     EthernetChip *_chip;       ///< Pointer to the Ethernet chip interface
    public:
@@ -46,7 +55,8 @@ class EthernetClient : public Client {
      * @param chip Pointer to EthernetChip interface
      * 
      * Creates a new client instance that will use the specified Ethernet
-     * and chip instances for network operations.
+     * and chip instances for network operations. With eth nullptr the client
+     * has no chip: connect() fails and it never gets a socket.
      */
     EthernetClient(EthernetClass *eth, EthernetChip *chip);
     
@@ -61,6 +71,9 @@ class EthernetClient : public Client {
      */
     EthernetClient(EthernetClass *eth, EthernetChip *chip, uint8_t sock);
 
+    /** @brief Stop EthernetClass::maintain() from servicing this client's write buffer */
+    virtual ~EthernetClient();
+
     /**
      * @brief Get connection status
      * @return Socket status code (SnSR_ESTABLISHED, SnSR_CLOSED, etc.)
@@ -69,6 +82,9 @@ class EthernetClient : public Client {
      * determining the exact state of the connection.
      */
     uint8_t status();
+
+    /** @return Socket number in use, MAX_SOCK_NUM if none */
+    uint8_t getSocketNumber() const { return _sock; }
     
     /**
      * @brief Connect to a server by IP address
@@ -93,6 +109,38 @@ class EthernetClient : public Client {
      * an IP address before connecting. This is a blocking operation.
      */
     virtual int connect(const char *host, uint16_t port);
+
+    /**
+     * @brief Start connecting to a server without waiting
+     * @param ip IP address of the server to connect to
+     * @param port Port number to connect to
+     * @param handler Called once the attempt completes (1 connected, -1 failed),
+     *        or nullptr to poll connectStatus()
+     * @param ctx Passed to the handler
+     * @return 1 if the attempt was started, 0 if no socket was free or the
+     *         address is invalid
+     *
+     * The attempt is advanced by Ethernet.maintain() (or serviceSockets()) and
+     * by connectStatus(). Several clients can connect in parallel.
+     */
+    int connectAsync(IPAddress ip, uint16_t port, EthernetAsyncHandler handler = nullptr,
+                     void *ctx = nullptr);
+
+    /**
+     * @brief Check on a connectAsync() attempt
+     * @return 1 connected, 0 still connecting, -1 failed (the socket is released)
+     *
+     * Makes at most one register read.
+     */
+    int8_t connectStatus();
+
+    /**
+     * @brief Limit how long a connect may take
+     * @param ms Timeout in milliseconds, 0 to rely on the chip's retry limit
+     *
+     * Applies to connect() and connectAsync().
+     */
+    void setConnectionTimeout(uint16_t ms) { _connectTimeout = ms; }
     
     /**
      * @brief Write a single byte
@@ -114,6 +162,50 @@ class EthernetClient : public Client {
      * than requested if the send buffer is full.
      */
     virtual size_t write(const uint8_t *buf, size_t size);
+
+    /**
+     * @brief Get the number of bytes write() can accept right now
+     * @return Free space in the socket's TX memory, or 0 if not connected
+     */
+    virtual int availableForWrite();
+
+    /**
+     * @brief Select blocking or non-blocking writes
+     * @param enable true for non-blocking writes
+     *
+     * In non-blocking mode write() copies as much as fits into the chip's TX
+     * memory, queues it for transmission and returns immediately with the
+     * number of bytes accepted, which may be less than requested (or 0 when
+     * TX memory is full). Transmission continues in the background; call
+     * poll() or writeComplete() to advance it.
+     */
+    void setNonBlocking(bool enable) { _nonBlocking = enable; }
+
+    /** @return true if writes are non-blocking */
+    bool isNonBlocking() const { return _nonBlocking; }
+
+    /**
+     * @brief Advance background transmission of non-blocking writes
+     *
+     * Issues the next SEND once the previous one has completed and invokes
+     * the write-complete callback when everything written has been sent.
+     * Sets the write error flag if the connection failed.
+     */
+    void poll();
+
+    /**
+     * @brief Check whether all data written so far has left the chip
+     * @return true when no SEND is outstanding and nothing is queued
+     *
+     * Calls poll(), so it can be used directly in a wait loop.
+     */
+    bool writeComplete();
+
+    /**
+     * @brief Register a callback for completion of non-blocking writes
+     * @param callback Called from poll() once all written data has been sent
+     */
+    void onWriteComplete(void (*callback)(EthernetClient &client)) { _onWriteComplete = callback; }
     
     /**
      * @brief Get number of bytes available for reading
@@ -145,6 +237,34 @@ class EthernetClient : public Client {
      */
     virtual int read(uint8_t *buf, size_t size);
     
+    /**
+     * @brief Stream received data to a visitor without an intermediate buffer
+     * @param visitor Called with successive chunks of the socket's RX data;
+     *        returns how many bytes of each chunk it consumed
+     * @param ctx Passed through to the visitor
+     * @param maxLen Maximum number of bytes to visit
+     * @return Number of bytes consumed, or -1 if not connected
+     *
+     * Chunks are ETHERNET_STREAM_CHUNK_SIZE bytes. The read pointer is
+     * committed once, after the visitor returns; bytes it did not consume
+     * remain available to the next read.
+     */
+    int readInto(SocketReadVisitor visitor, void *ctx, size_t maxLen = 0xFFFF);
+
+    /**
+     * @brief Send data produced straight into chip TX memory
+     * @param producer Called to fill successive chunks; returning less than
+     *        asked ends the stream
+     * @param ctx Passed through to the producer
+     * @param maxLen Maximum number of bytes to send
+     * @return Number of bytes sent (blocking) or queued (non-blocking)
+     *
+     * In blocking mode the call keeps producing and sending until the
+     * producer ends or maxLen is reached. In non-blocking mode it fills only
+     * the TX memory that is free now.
+     */
+    size_t writeFrom(SocketWriteProducer producer, void *ctx, size_t maxLen = 0xFFFF);
+
     /**
      * @brief Peek at the next byte without removing it
      * @return Next byte value (0-255) or -1 if no data available
@@ -161,6 +281,32 @@ class EthernetClient : public Client {
      * This is a blocking operation that waits until all data is transmitted.
      */
     virtual void flush();
+
+    /**
+     * @brief Coalesce writes in a caller-supplied buffer
+     * @param buf Buffer to collect outgoing data in, or nullptr to disable
+     * @param size Size of buf in bytes
+     *
+     * Small writes (e.g. from print()) are gathered in buf and sent as one
+     * segment when the buffer fills, on flush(), or once the oldest buffered
+     * byte is older than the idle timeout. Writes at least as large as the
+     * buffer bypass it. The buffer must outlive the connection.
+     */
+    void setWriteBuffer(uint8_t *buf, uint16_t size);
+
+    /**
+     * @brief Set how long coalesced data may wait before it is sent
+     * @param ms Idle timeout in milliseconds (0 = only on full buffer or flush())
+     *
+     * The timeout is checked from write(), available() and poll(), and by
+     * EthernetClass::maintain() (serviceSockets()), which sends aged data
+     * without waiting, so a client that is written to and then left alone
+     * still gets its data out.
+     */
+    void setWriteIdleTimeout(uint16_t ms) { _txIdleTimeout = ms; }
+
+    /** @return Number of bytes waiting in the write buffer */
+    uint16_t bufferedWriteSize() const { return _txLen; }
     
     /**
      * @brief Close the connection
@@ -170,6 +316,24 @@ class EthernetClient : public Client {
      * connection is established.
      */
     virtual void stop();
+
+    /**
+     * @brief Close the connection without waiting
+     * @param handler Called once the socket is closed (1 graceful, 0 forced
+     *        after ETHERNET_CLOSE_TIMEOUT), or nullptr
+     * @param ctx Passed to the handler
+     *
+     * Hands the socket to Ethernet.maintain(), which lets queued data go out,
+     * sends the FIN, waits for the close and then releases the socket. The
+     * client is detached at once and can be reused. Buffered write data goes
+     * out before the FIN. If TX memory cannot take all of it now, the closing
+     * socket keeps the write buffer until the rest is queued, and the client
+     * continues without one until setWriteBuffer() is called again (do not
+     * give it the same buffer before the handler has run). Data
+     * still unsent after ETHERNET_CLOSE_TIMEOUT is dropped and the close is
+     * reported as forced (0).
+     */
+    void stopAsync(EthernetAsyncHandler handler = nullptr, void *ctx = nullptr);
     
     /**
      * @brief Check if the client is connected
@@ -212,14 +376,83 @@ class EthernetClient : public Client {
      */
     friend class EthernetServer;
 
+    /** @brief EthernetClass services buffered writes from maintain() */
+    friend class EthernetClass;
+
     /**
      * @brief Inherit write functions from Print class
      */
     using Print::write;
 
-   private:
-    static uint16_t _srcport; ///< Static source port counter for new connections
+   protected:
     uint8_t _sock;           ///< Socket number used by this client
+    uint8_t _generation;     ///< Allocation generation of _sock when this client got it
+    bool _nonBlocking;       ///< write() queues data instead of waiting for SEND_OK
+    bool _sendBusy;          ///< Non-blocking data accepted but not yet confirmed sent
+    void (*_onWriteComplete)(EthernetClient &client);  ///< Non-blocking completion callback
+    uint8_t *_txBuf;           ///< Caller-supplied write coalescing buffer (nullptr = none)
+    uint16_t _txSize;          ///< Size of _txBuf
+    uint16_t _txLen;           ///< Bytes currently held in _txBuf
+    uint16_t _txIdleTimeout;   ///< Age in ms at which buffered data is sent (0 = never)
+    unsigned long _txStart;    ///< millis() when the oldest buffered byte was written
+    uint16_t _connectTimeout;  ///< Connect timeout in ms (0 = chip's retry limit)
+
+    /**
+     * @brief Hand data to the socket, bypassing the write buffer
+     * @return Number of bytes accepted
+     */
+    size_t writeSocket(const uint8_t *buf, size_t size);
+
+    /**
+     * @brief Issue one send() (or sendAsync() when non-blocking) on the socket
+     * @return Number of bytes sent or queued; 0 if the connection failed
+     *
+     * The only step of writeSocket() that touches the chip, so
+     * EthernetClientT can bind it to the concrete chip type.
+     */
+    virtual uint16_t sendChunk(const uint8_t *buf, uint16_t len);
+
+    /**
+     * @brief Issue one recv() on the socket
+     * @return Number of bytes read, 0 or less if none
+     *
+     * The chip step of read(), bound to the concrete chip by EthernetClientT.
+     */
+    virtual int16_t recvChunk(uint8_t *buf, int16_t len);
+
+    /**
+     * @brief Move buffered write data to the socket
+     * @return false if the connection failed and the buffer was discarded
+     */
+    bool pushBuffer();
+
+    /** @brief Push buffered write data once it has aged past the idle timeout */
+    void flushIfIdle();
+
+    /** @brief Collect a finished non-blocking SEND and issue the next one */
+    void reapSend();
+
+    /**
+     * @brief Queue aged buffered data and reap finished SENDs, without waiting
+     * @param sock Socket the client was registered for
+     * @return true while the client has data buffered or in flight on sock
+     *
+     * Called from EthernetClass::serviceSockets().
+     */
+    bool serviceWrites(uint8_t sock);
+
+    /**
+     * @brief Forget a socket that was reclaimed since this client got it
+     * @return true if the socket was dropped
+     */
+    bool released();
+
+    /**
+     * @brief Wait (bounded) for queued non-blocking data to be sent
+     *
+     * Used before closing so staged data is not discarded with the socket.
+     */
+    void drainPending(unsigned long timeout);
 };
 
 #endif
@@ -0,0 +1,193 @@
+/**
+ * @file EthernetEvents.cpp
+ * @brief Implementation of the interrupt-driven socket event engine
+ *
+ * The INTn handler only records that the line fired; all SPI traffic happens
+ * in poll(), in the caller's context, so the engine never races the socket
+ * layer for the bus.
+ */
+
+#include "EthernetEvents.h"
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+#define ETHERNET_EVENTS_ISR_ATTR IRAM_ATTR
+#else
+#define ETHERNET_EVENTS_ISR_ATTR
+#endif
+
+// Maximum SIR passes per poll(); anything left over is picked up by the next poll()
+#define ETHERNET_EVENTS_MAX_PASSES 4
+
+EthernetEvents *EthernetEvents::_instances[ETHERNET_EVENTS_MAX_INSTANCES] = {};
+
+void ETHERNET_EVENTS_ISR_ATTR EthernetEvents::isr0() {
+    if (_instances[0]) _instances[0]->_irq = true;
+}
+
+void ETHERNET_EVENTS_ISR_ATTR EthernetEvents::isr1() {
+    if (_instances[1]) _instances[1]->_irq = true;
+}
+
+/**
+ * @brief Construct an event engine for a chip
+ * @param chip Chip to take interrupts from
+ */
+EthernetEvents::EthernetEvents(EthernetChip *chip)
+    : _chip(chip),
+      _pin(-1),
+      _slot(-1),
+      _socketMask(0),
+      _eventMask(0),
+      _irq(false),
+      _pending(0),
+      _changed(0),
+      _anyHandler(nullptr) {
+    for (int i = 0; i < MAX_SOCK_NUM; i++) {
+        _events[i] = 0;
+        _handlers[i] = nullptr;
+    }
+}
+
+/**
+ * @brief Enable socket interrupts and attach to the INTn pin
+ * @param intPin Pin wired to INTn, or -1 for no interrupt line
+ * @param socketMask Sockets to enable
+ * @param events Sn_IR events to enable
+ * @return true on success, false if every interrupt slot is taken
+ */
+bool EthernetEvents::begin(int8_t intPin, uint8_t socketMask, uint8_t events) {
+    end();
+
+    if (intPin >= 0) {
+        for (int i = 0; i < ETHERNET_EVENTS_MAX_INSTANCES; i++) {
+            if (_instances[i] == nullptr) {
+                _slot = i;
+                break;
+            }
+        }
+        if (_slot < 0) return false;
+        _instances[_slot] = this;
+    }
+
+    _pin = intPin;
+    _socketMask = socketMask;
+    _changed = 0;
+    setEventMask(events);
+    _chip->writeSIMR(_socketMask);
+
+    if (_pin >= 0) {
+        pinMode(_pin, INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(_pin), _slot == 0 ? isr0 : isr1, FALLING);
+    }
+
+    // INTn may already be asserted from before we attached; look once regardless
+    _irq = true;
+    return true;
+}
+
+/**
+ * @brief Disable socket interrupts and release the pin
+ */
+void EthernetEvents::end() {
+    if (_pin >= 0) detachInterrupt(digitalPinToInterrupt(_pin));
+    if (_slot >= 0) _instances[_slot] = nullptr;
+
+    if (_socketMask) {
+        _chip->writeSIMR(0);
+        for (SOCKET s = 0; s < _chip->maxSockets(); s++) {
+            if (_socketMask & (1 << s)) _chip->writeSnIMR(s, 0);
+        }
+    }
+
+    _pin = -1;
+    _slot = -1;
+    _socketMask = 0;
+    _irq = false;
+}
+
+/**
+ * @brief Change which events are enabled on the selected sockets
+ * @param events Sn_IR bits to enable
+ */
+void EthernetEvents::setEventMask(uint8_t events) {
+    _eventMask = events;
+    for (SOCKET s = 0; s < _chip->maxSockets(); s++) {
+        if (_socketMask & (1 << s)) _chip->writeSnIMR(s, _eventMask);
+    }
+}
+
+/**
+ * @brief Register a handler for one socket
+ * @param s Socket number
+ * @param handler Handler, or nullptr to collect events with take()
+ */
+void EthernetEvents::onSocket(SOCKET s, EthernetEventHandler handler) {
+    if (s < MAX_SOCK_NUM) _handlers[s] = handler;
+}
+
+/**
+ * @brief Read, acknowledge and deliver the events of one socket
+ * @param s Socket number
+ *
+ * Only enabled bits are acknowledged. SEND_OK and TIMEOUT are also latched
+ * for the socket layer, which waits on them in send()/sendto().
+ */
+void EthernetEvents::service(SOCKET s) {
+    uint8_t ir = _chip->readSnIR(s) & _eventMask;
+    if (!ir) return;
+
+    _chip->writeSnIR(s, ir);
+    _chip->latchSnIR(s, ir & (SnIR::SEND_OK | SnIR::TIMEOUT));
+    _changed |= (1 << s);
+
+    EthernetEventHandler handler = _handlers[s] ? _handlers[s] : _anyHandler;
+    if (handler) {
+        handler(s, ir);
+    } else {
+        _events[s] |= ir;
+        _pending |= (1 << s);
+    }
+}
+
+/**
+ * @brief Service pending interrupts
+ * @return Bitmask of sockets that had events
+ *
+ * INTn stays low while any enabled SIR bit is set, so SIR is re-read after
+ * each pass until it reads clear. Stopping early would leave the line low and
+ * the next falling edge would never come.
+ */
+uint8_t EthernetEvents::poll() {
+    if (_socketMask == 0) return 0;
+    if (_pin >= 0 && !_irq) return 0;
+
+    // Clear before touching the chip so an edge raised mid-service is kept
+    _irq = false;
+
+    uint8_t seen = 0;
+    uint8_t sir = 0;
+    for (uint8_t pass = 0; pass < ETHERNET_EVENTS_MAX_PASSES; pass++) {
+        sir = _chip->readSIR() & _socketMask;
+        if (!sir) break;
+        for (SOCKET s = 0; s < _chip->maxSockets(); s++) {
+            if (sir & (1 << s)) service(s);
+        }
+        seen |= sir;
+    }
+    if (sir) _irq = true;
+
+    return seen;
+}
+
+/**
+ * @brief Collect and clear the undelivered events of a socket
+ * @param s Socket number
+ * @return Accumulated Sn_IR bits
+ */
+uint8_t EthernetEvents::take(SOCKET s) {
+    if (s >= MAX_SOCK_NUM) return 0;
+    uint8_t ev = _events[s];
+    _events[s] = 0;
+    _pending &= ~(1 << s);
+    return ev;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file EthernetEvents.h
+ * @brief Interrupt-driven socket event engine for Ethernet3 library
+ *
+ * Instead of polling Sn_SR / Sn_RX_RSR on every socket each loop, the event
+ * engine enables the chip's socket interrupts (SIMR / Sn_IMR) and watches the
+ * INTn pin. The interrupt handler only sets a flag; poll() then reads SIR once
+ * to learn which sockets have events, reads and acknowledges Sn_IR for just
+ * those sockets, and hands the events to registered handlers or keeps them for
+ * the application to collect with take(). When nothing has happened, poll()
+ * makes no SPI transactions at all.
+ */
+
+#ifndef ethernetevents_h
+#define ethernetevents_h
+
+#include <Arduino.h>
+
+#include "chips/EthernetChip.h"
+#include "chips/utility/wiznet_registers.h"
+
+/** @brief Events enabled by begin() unless told otherwise */
+#define ETHERNET_EVENTS_DEFAULT (SnIR::CON | SnIR::DISCON | SnIR::RECV | SnIR::TIMEOUT)
+
+/** @brief Number of EthernetEvents instances that can own an interrupt pin at once */
+#ifndef ETHERNET_EVENTS_MAX_INSTANCES
+#define ETHERNET_EVENTS_MAX_INSTANCES 2
+#endif
+
+/**
+ * @brief Socket event handler
+ * @param s Socket the events occurred on
+ * @param events Sn_IR bits (SnIR::CON, DISCON, RECV, TIMEOUT, SEND_OK)
+ */
+typedef void (*EthernetEventHandler)(SOCKET s, uint8_t events);
+
+/**
+ * @brief Dispatches W5500 socket interrupts
+ *
+ * Typical use:
+ * @code
+ * EthernetEvents events(&chip);
+ * events.begin(2);                 // INTn wired to pin 2
+ * events.onSocket(0, handleSock0);
+ * ...
+ * void loop() { events.poll(); }
+ * @endcode
+ *
+ * SEND_OK is not enabled by default: blocking sends already wait for it, and
+ * enabling it raises an interrupt per segment. When it is enabled the engine
+ * acknowledges it on the chip and latches it for the socket layer, so blocking
+ * and non-blocking sends keep working.
+ */
+class EthernetEvents {
+   private:
+    EthernetChip *_chip;                          ///< Chip whose interrupts are handled
+    int8_t _pin;                                  ///< INTn pin, or -1 to read SIR on every poll
+    int8_t _slot;                                 ///< Interrupt thunk slot, -1 if none
+    uint8_t _socketMask;                          ///< Sockets with interrupts enabled
+    uint8_t _eventMask;                           ///< Sn_IR bits enabled on each socket
+    volatile bool _irq;                           ///< Set by the INTn interrupt handler
+    uint8_t _pending;                             ///< Sockets with undelivered events
+    uint8_t _changed;                             ///< Sockets with events since takeChanged()
+    uint8_t _events[MAX_SOCK_NUM];                ///< Undelivered events per socket
+    EthernetEventHandler _handlers[MAX_SOCK_NUM]; ///< Per-socket handlers
+    EthernetEventHandler _anyHandler;             ///< Handler for sockets without their own
+
+    static EthernetEvents *_instances[ETHERNET_EVENTS_MAX_INSTANCES];
+    static void isr0();
+    static void isr1();
+
+    void service(SOCKET s);
+
+   public:
+    /**
+     * @brief Construct an event engine for a chip
+     * @param chip Chip to take interrupts from
+     */
+    EthernetEvents(EthernetChip *chip);
+
+    /**
+     * @brief Enable socket interrupts and attach to the INTn pin
+     * @param intPin Pin wired to INTn, or -1 to run without an interrupt line
+     *        (poll() then reads SIR every call, still far cheaper than
+     *        scanning every socket)
+     * @param socketMask Sockets to enable (bit n = socket n)
+     * @param events Sn_IR events to enable on each of them
+     * @return true on success, false if no interrupt slot was free
+     */
+    bool begin(int8_t intPin, uint8_t socketMask = 0xFF,
+               uint8_t events = ETHERNET_EVENTS_DEFAULT);
+
+    /**
+     * @brief Disable socket interrupts and detach from the pin
+     */
+    void end();
+
+    /**
+     * @brief Change which events are enabled
+     * @param events Sn_IR bits to enable on every socket in the socket mask
+     */
+    void setEventMask(uint8_t events);
+
+    /**
+     * @brief Set the INTn assert holdoff
+     * @param level INTLEVEL value; the chip waits this long (in PLL clocks
+     *        times 4) after an acknowledge before asserting INTn again
+     */
+    void setInterruptHoldoff(uint16_t level) { _chip->writeINTLEVEL(level); }
+
+    /**
+     * @brief Register a handler for one socket
+     * @param s Socket number
+     * @param handler Handler, or nullptr to collect the socket's events with take()
+     */
+    void onSocket(SOCKET s, EthernetEventHandler handler);
+
+    /**
+     * @brief Register a handler for sockets without their own handler
+     * @param handler Handler, or nullptr
+     */
+    void onAny(EthernetEventHandler handler) { _anyHandler = handler; }
+
+    /**
+     * @brief Service pending interrupts
+     * @return Bitmask of sockets that had events during this call
+     *
+     * Call from loop(). Does nothing, with no SPI traffic, unless INTn has
+     * fired (or no pin is in use).
+     */
+    uint8_t poll();
+
+    /**
+     * @brief Sockets with events not yet collected by take()
+     * @return Bitmask, bit n = socket n
+     */
+    uint8_t pending() const { return _pending; }
+
+    /**
+     * @brief Collect and clear the undelivered events of a socket
+     * @param s Socket number
+     * @return Sn_IR bits accumulated since the last take()
+     */
+    uint8_t take(SOCKET s);
+
+    /**
+     * @brief Collect and clear the sockets that have had any event, delivered or not
+     * @param mask Sockets the caller is interested in; other bits are left alone
+     * @return Bitmask of sockets in mask with events since the last call
+     *
+     * Lets socket-level consumers (e.g. EthernetServer) refresh only what changed
+     * without taking events away from handlers or take().
+     */
+    uint8_t takeChanged(uint8_t mask) {
+        uint8_t changed = _changed & mask;
+        _changed &= ~mask;
+        return changed;
+    }
+
+    /** @return Sockets with interrupts enabled (0 until begin()) */
+    uint8_t socketMask() const { return _socketMask; }
+
+    /** @return Sn_IR events enabled on those sockets */
+    uint8_t eventMask() const { return _eventMask; }
+
+    /** @return true if the interrupt line has fired since the last poll() */
+    bool interruptPending() const { return _irq; }
+};
+
+#endif
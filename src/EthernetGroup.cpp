@@ -0,0 +1,128 @@
+/**
+ * @file EthernetGroup.cpp
+ * @brief Implementation of multi-chip socket groups and group servers
+ */
+
+#include "EthernetGroup.h"
+
+EthernetGroup::EthernetGroup() : _count(0), _next(0) {}
+
+bool EthernetGroup::add(EthernetClass* eth, EthernetChip* chip) {
+    if (_count == ETHERNET_GROUP_MAX_CHIPS || eth == nullptr || chip == nullptr) return false;
+    _ethernet[_count] = eth;
+    _chip[_count] = chip;
+    _count++;
+    return true;
+}
+
+uint8_t EthernetGroup::pick() {
+    uint8_t best = _count;
+    uint8_t bestFree = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        uint8_t m = (_next + i) % _count;
+        uint8_t free = _ethernet[m]->freeSockets();
+        if (free > bestFree) {
+            best = m;
+            bestFree = free;
+        }
+    }
+    if (best < _count) _next = (best + 1) % _count;
+    return best;
+}
+
+uint16_t EthernetGroup::allocSocket(uint8_t owner) {
+    // The member with the most free sockets may still refuse (reservations),
+    // so fall back to the others in order
+    uint8_t first = pick();
+    if (first == _count) return ETHERNET_GROUP_NO_SOCKET;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        uint8_t m = (first + i) % _count;
+        uint8_t sock = _ethernet[m]->allocSocket(owner);
+        if (sock != MAX_SOCK_NUM) return groupSocket(m, sock);
+    }
+    return ETHERNET_GROUP_NO_SOCKET;
+}
+
+void EthernetGroup::freeSocket(uint16_t groupSock) {
+    uint8_t m = memberOf(groupSock);
+    if (m < _count) _ethernet[m]->freeSocket(localSocket(groupSock));
+}
+
+EthernetClient EthernetGroup::client() {
+    if (_count == 0) return EthernetClient(nullptr, nullptr);
+    uint8_t m = pick();
+    if (m == _count) m = 0;
+    return EthernetClient(_ethernet[m], _chip[m]);
+}
+
+uint16_t EthernetGroup::socketCount() const {
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < _count; i++) total += _ethernet[i]->socketStats().total;
+    return total;
+}
+
+uint16_t EthernetGroup::freeSockets() const {
+    uint16_t free = 0;
+    for (uint8_t i = 0; i < _count; i++) free += _ethernet[i]->freeSockets();
+    return free;
+}
+
+EthernetSocketStats EthernetGroup::socketStats() const {
+    // Totals fit the uint8_t fields for up to 31 chips of 8 sockets; peak is
+    // the sum of the members' peaks, which need not have happened together
+    EthernetSocketStats sum = {};
+    for (uint8_t i = 0; i < _count; i++) {
+        EthernetSocketStats s = _ethernet[i]->socketStats();
+        sum.total += s.total;
+        sum.inUse += s.inUse;
+        sum.peak += s.peak;
+        sum.reserved += s.reserved;
+        sum.allocs += s.allocs;
+        sum.failures += s.failures;
+        sum.reclaims += s.reclaims;
+    }
+    return sum;
+}
+
+void EthernetGroup::maintain() {
+    for (uint8_t i = 0; i < _count; i++) _ethernet[i]->maintain();
+}
+
+EthernetGroupServer::EthernetGroupServer(EthernetGroup* group, uint16_t port, uint8_t listeners)
+    : _group(group), _port(port), _listeners(listeners ? listeners : 1), _count(0), _next(0) {}
+
+EthernetGroupServer::~EthernetGroupServer() {
+    for (uint8_t i = 0; i < _count; i++) delete _servers[i];
+}
+
+void EthernetGroupServer::begin() {
+    while (_count < _group->count()) {
+        _servers[_count] = new EthernetServer(_group->ethernet(_count), _group->chip(_count),
+                                              _port, _listeners);
+        _count++;
+    }
+    for (uint8_t i = 0; i < _count; i++) _servers[i]->begin();
+}
+
+EthernetClient EthernetGroupServer::available() {
+    for (uint8_t i = 0; i < _count; i++) {
+        uint8_t m = (_next + i) % _count;
+        EthernetClient client = _servers[m]->available();
+        if (client) {
+            _next = (m + 1) % _count;
+            return client;
+        }
+    }
+    // Nothing ready: an invalid client of the first member
+    return EthernetClient(_group->ethernet(0), _group->chip(0), MAX_SOCK_NUM);
+}
+
+size_t EthernetGroupServer::write(uint8_t b) { return write(&b, 1); }
+
+size_t EthernetGroupServer::write(const uint8_t* buf, size_t size) {
+    size_t n = 0;
+    for (uint8_t i = 0; i < _count; i++) n += _servers[i]->write(buf, size);
+    return n;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file EthernetGroup.h
+ * @brief Several WIZnet chips managed as one set of sockets
+ *
+ * One chip has MAX_SOCK_NUM hardware sockets and one SPI bus worth of
+ * bandwidth. An EthernetGroup combines several chips, each with its own
+ * EthernetClass, on separate CS lines or separate SPI buses:
+ *
+ * @code
+ * W5500 chip0(10);
+ * W5500 chip1(9, &SPI1);
+ * EthernetClass eth0(&chip0);
+ * EthernetClass eth1(&chip1);
+ * EthernetGroup group;
+ *
+ * group.add(&eth0, &chip0);
+ * group.add(&eth1, &chip1);
+ * eth0.begin(mac0, ip0);
+ * eth1.begin(mac1, ip1);
+ *
+ * EthernetGroupServer web(&group, 80);  // listens on port 80 of every chip
+ * EthernetClient upstream = group.client();  // on the chip with most free sockets
+ * @endcode
+ *
+ * Sockets are numbered across the group: socket s of member m is
+ * m * MAX_SOCK_NUM + s. Each member keeps its own allocator, address and
+ * DHCP lease, so the group adds no SPI traffic of its own.
+ *
+ * Each member's allocator, socket state and ephemeral source ports (the chip's
+ * nextLocalPort()) are its own. What the members do share is library-wide:
+ * the ETHERNET3_PERF counters and trace hook (ethernetPerf), and the table of
+ * EthernetEvents engines that EthernetEvents::begin()/end() update. Chips on
+ * separate SPI buses can therefore be serviced from separate tasks (e.g. one
+ * FreeRTOS task per chip on ESP32), each using only its own EthernetClass and
+ * the clients created on it, provided ETHERNET3_PERF is off (its counters are
+ * updated without locking) and event engines are begun and ended from one
+ * task. The group and EthernetGroupServer themselves are not thread safe: use
+ * them from one task.
+ */
+
+#ifndef ethernetgroup_h
+#define ethernetgroup_h
+
+#include "Ethernet3.h"
+#include "EthernetClient.h"
+#include "EthernetServer.h"
+#include "Server.h"
+
+/** @brief Most chips an EthernetGroup can hold */
+#ifndef ETHERNET_GROUP_MAX_CHIPS
+#define ETHERNET_GROUP_MAX_CHIPS 4
+#endif
+
+/** @brief Group socket number returned when no socket is available */
+#define ETHERNET_GROUP_NO_SOCKET 0xFFFF
+
+/**
+ * @brief Set of chips sharing one socket namespace
+ */
+class EthernetGroup {
+   private:
+    EthernetClass* _ethernet[ETHERNET_GROUP_MAX_CHIPS];  ///< Member interfaces
+    EthernetChip* _chip[ETHERNET_GROUP_MAX_CHIPS];       ///< Their chips
+    uint8_t _count;                                      ///< Members added
+    uint8_t _next;                                       ///< Member preferred on a tie
+
+   public:
+    /** @brief Construct an empty group */
+    EthernetGroup();
+
+    /**
+     * @brief Add a chip to the group
+     * @param eth Interface of the chip; begin() it as usual
+     * @param chip The chip
+     * @return false if the group is full
+     */
+    bool add(EthernetClass* eth, EthernetChip* chip);
+
+    /** @return Number of members */
+    uint8_t count() const { return _count; }
+
+    /** @return Interface of a member, nullptr if out of range */
+    EthernetClass* ethernet(uint8_t member) const {
+        return member < _count ? _ethernet[member] : nullptr;
+    }
+
+    /** @return Chip of a member, nullptr if out of range */
+    EthernetChip* chip(uint8_t member) const { return member < _count ? _chip[member] : nullptr; }
+
+    /** @return Group socket number of socket sock on a member */
+    static uint16_t groupSocket(uint8_t member, uint8_t sock) {
+        return (uint16_t)member * MAX_SOCK_NUM + sock;
+    }
+
+    /** @return Member holding a group socket */
+    static uint8_t memberOf(uint16_t groupSock) { return groupSock / MAX_SOCK_NUM; }
+
+    /** @return Chip socket number of a group socket */
+    static uint8_t localSocket(uint16_t groupSock) { return groupSock % MAX_SOCK_NUM; }
+
+    /**
+     * @brief Choose the member to put a new socket on
+     * @return Member with the most free sockets, or count() if none has any
+     *
+     * Ties go to the members in turn, so equal chips share new connections
+     * and their SPI traffic evenly. Reads only the allocators' RAM state.
+     */
+    uint8_t pick();
+
+    /**
+     * @brief Allocate a socket on the least loaded member
+     * @param owner Kind of user taking the socket (SockOwner)
+     * @return Group socket number, or ETHERNET_GROUP_NO_SOCKET
+     */
+    uint16_t allocSocket(uint8_t owner = SockOwner::USER);
+
+    /**
+     * @brief Return a group socket to its member's allocator
+     * @param groupSock Group socket number
+     */
+    void freeSocket(uint16_t groupSock);
+
+    /**
+     * @brief Create an unconnected client on the least loaded member
+     * @return Client bound to that member; call connect() on it
+     *
+     * If no member has a free socket the client is bound to member 0, and
+     * its connect() fails as it would on a single full chip. A group with no
+     * members returns a chipless client, whose connect() fails the same way.
+     */
+    EthernetClient client();
+
+    /** @return Sockets managed by all members */
+    uint16_t socketCount() const;
+
+    /** @return Free sockets on all members, including reserved ones */
+    uint16_t freeSockets() const;
+
+    /** @return Allocator statistics summed over the members */
+    EthernetSocketStats socketStats() const;
+
+    /**
+     * @brief Run maintain() on every member
+     *
+     * Keeps each member's DHCP lease and asynchronous socket operations going.
+     */
+    void maintain();
+};
+
+/**
+ * @brief TCP server listening on the same port of every chip in a group
+ *
+ * One EthernetServer is created per member on the first begin(). available()
+ * goes round the members, starting after the one that returned a client last
+ * time, so every chip's connections get served.
+ */
+class EthernetGroupServer : public Server {
+   private:
+    EthernetGroup* _group;                                ///< Chips to listen on
+    EthernetServer* _servers[ETHERNET_GROUP_MAX_CHIPS];  ///< Server of each member
+    uint16_t _port;                                        ///< Port to listen on
+    uint8_t _listeners;                                    ///< Listeners per member
+    uint8_t _count;                                        ///< Servers created
+    uint8_t _next;                                         ///< Member to try first
+
+   public:
+    /**
+     * @brief Construct a group server
+     * @param group Chips to listen on
+     * @param port Port number to listen on
+     * @param listeners Sockets to keep listening on each chip
+     */
+    EthernetGroupServer(EthernetGroup* group, uint16_t port, uint8_t listeners = 1);
+
+    ~EthernetGroupServer();
+
+    // Owns its member servers, so it cannot be copied
+    EthernetGroupServer(const EthernetGroupServer&) = delete;
+    EthernetGroupServer& operator=(const EthernetGroupServer&) = delete;
+
+    /**
+     * @brief Start listening on every member
+     *
+     * Members added to the group since the last begin() get a server too.
+     */
+    virtual void begin();
+
+    /**
+     * @brief Get a client with data from any member
+     * @return EthernetClient on the member it arrived on, or an invalid client
+     */
+    EthernetClient available();
+
+    /**
+     * @brief Get the server of one member
+     * @return The member's EthernetServer, nullptr before begin()
+     */
+    EthernetServer* server(uint8_t member) const {
+        return member < _count ? _servers[member] : nullptr;
+    }
+
+    /** @brief Write a byte to every connected client of every member */
+    virtual size_t write(uint8_t byte);
+
+    /** @brief Write data to every connected client of every member */
+    virtual size_t write(const uint8_t* buf, size_t size);
+
+    using Print::write;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @file EthernetMulticast.cpp
+ * @brief Implementation of multi-group multicast membership and dispatch
+ */
+
+#include "EthernetMulticast.h"
+
+#include "EthernetEvents.h"
+
+EthernetMulticast::EthernetMulticast(EthernetClass* eth, EthernetChip* chip)
+    : _ethernet(eth), _chip(chip), _count(0), _socketMask(0), _backlog(0) {}
+
+int8_t EthernetMulticast::find(IPAddress group, uint16_t port) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        const Membership& m = _members[i];
+        if (m.port == port && m.group[0] == group[0] && m.group[1] == group[1] &&
+            m.group[2] == group[2] && m.group[3] == group[3]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint8_t EthernetMulticast::join(IPAddress group, uint16_t port, MulticastHandler handler,
+                                void* ctx, uint8_t options) {
+    if (group[0] < 224 || group[0] > 239 || handler == nullptr) return 0;
+
+    int8_t existing = find(group, port);
+    if (existing >= 0) {
+        _members[existing].handler = handler;
+        _members[existing].ctx = ctx;
+        return 1;
+    }
+    if (_count == ETHERNET_MULTICAST_GROUPS) return 0;
+
+    uint8_t sock = _ethernet->allocSocket(SockOwner::UDP);
+    if (sock == MAX_SOCK_NUM) return 0;
+
+    Membership& m = _members[_count];
+    for (uint8_t i = 0; i < 4; i++) m.group[i] = group[i];
+    if (!socketMulticast(_chip, sock, m.group, port, options)) {
+        close(_chip, sock);
+        _ethernet->freeSocket(sock);
+        return 0;
+    }
+
+    m.sock = sock;
+    m.port = port;
+    m.handler = handler;
+    m.ctx = ctx;
+    _count++;
+    _socketMask |= 1 << sock;
+    return 1;
+}
+
+void EthernetMulticast::remove(uint8_t index) {
+    Membership& m = _members[index];
+    closeMulticast(_chip, m.sock, m.group, m.port);
+    _ethernet->freeSocket(m.sock);
+    _socketMask &= ~(1 << m.sock);
+    _backlog &= ~(1 << m.sock);
+
+    _count--;
+    if (index != _count) _members[index] = _members[_count];
+}
+
+uint8_t EthernetMulticast::leave(IPAddress group, uint16_t port) {
+    int8_t i = find(group, port);
+    if (i < 0) return 0;
+    remove(i);
+    return 1;
+}
+
+void EthernetMulticast::leaveAll() {
+    while (_count > 0) remove(_count - 1);
+}
+
+uint8_t EthernetMulticast::poll(uint8_t* buf, uint16_t size) {
+    // With socket interrupts, only sockets that received something need reading
+    uint8_t check = _socketMask;
+    EthernetEvents* ev = _ethernet->events();
+    if (ev != nullptr && (ev->eventMask() & SnIR::RECV)) {
+        ev->poll();
+        uint8_t covered = _socketMask & ev->socketMask();
+        check = ev->takeChanged(covered) | (_socketMask & ~covered) | _backlog;
+    }
+    _backlog = 0;
+
+    uint8_t dispatched = 0;
+    for (SOCKET s = 0; s < MAX_SOCK_NUM; s++) {
+        if (!(check & (1 << s))) continue;
+
+        uint8_t burst = 0;
+        for (;;) {
+            // Look the membership up again each time: a handler may have left it
+            int8_t index = -1;
+            for (uint8_t i = 0; i < _count; i++) {
+                if (_members[i].sock == s) index = i;
+            }
+            if (index < 0) break;
+
+            if (burst == ETHERNET_MULTICAST_BURST) {
+                // No new event is raised for data already waiting
+                _backlog |= 1 << s;
+                break;
+            }
+
+            uint8_t from[4];
+            uint16_t fromPort, len, ptr;
+            if (!beginRecvUDP(_chip, s, from, &fromPort, &len, &ptr)) break;
+
+            uint16_t got = len < size ? len : size;
+            if (got > 0) _chip->read_data(s, ptr, buf, got);
+            endRecvUDP(_chip, s, ptr + len);
+
+            const Membership& m = _members[index];
+            IPAddress group(m.group[0], m.group[1], m.group[2], m.group[3]);
+            m.handler(m.ctx, group, IPAddress(from), fromPort, buf, got);
+            dispatched++;
+            burst++;
+        }
+    }
+    return dispatched;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file EthernetMulticast.h
+ * @brief Membership of several multicast groups at once, with per-group dispatch
+ *
+ * The chip filters multicast in hardware on one group per socket: the group's
+ * MAC, address and port are programmed into the socket before it opens, and
+ * the chip sends the IGMP join and leave itself. Frames for other groups never
+ * reach socket memory, so they cost no SPI traffic. EthernetMulticast keeps one
+ * such socket per group and hands each received datagram to the handler
+ * registered for its group.
+ */
+
+#ifndef ethernetmulticast_h
+#define ethernetmulticast_h
+
+#include <Arduino.h>
+
+#include "Ethernet3.h"
+#include "EthernetUdp2.h"
+#include "chips/utility/socket.h"
+
+/** @brief Groups an EthernetMulticast can be a member of at once (one socket each) */
+#ifndef ETHERNET_MULTICAST_GROUPS
+#define ETHERNET_MULTICAST_GROUPS 4
+#endif
+
+/** @brief Datagrams read from one socket per poll() before moving to the next */
+#ifndef ETHERNET_MULTICAST_BURST
+#define ETHERNET_MULTICAST_BURST 4
+#endif
+
+/**
+ * @brief Handler for datagrams received on a group
+ * @param ctx Context given to join()
+ * @param group Group the datagram was received on
+ * @param from Sender address
+ * @param fromPort Sender port
+ * @param data Payload, valid during the call only
+ * @param len Payload bytes in data; a datagram longer than the poll() buffer is truncated
+ */
+typedef void (*MulticastHandler)(void* ctx, IPAddress group, IPAddress from, uint16_t fromPort,
+                                 const uint8_t* data, uint16_t len);
+
+/**
+ * @brief A set of multicast group memberships sharing one dispatch loop
+ *
+ * @code
+ * EthernetMulticast multicast(&Ethernet, &chip);
+ * multicast.join(IPAddress(239, 1, 2, 3), 5000, onTelemetry);
+ * multicast.join(IPAddress(239, 1, 2, 4), 5000, onAlarms);
+ * ...
+ * uint8_t buf[256];
+ * void loop() { multicast.poll(buf, sizeof(buf)); }
+ * @endcode
+ *
+ * When an EthernetEvents engine with RECV enabled is attached to the
+ * EthernetClass, poll() reads only the sockets that have raised an event.
+ */
+class EthernetMulticast {
+   private:
+    /** @brief One group membership */
+    struct Membership {
+        uint8_t sock;              ///< Socket receiving the group
+        uint8_t group[4];          ///< Group address
+        uint16_t port;             ///< UDP port
+        MulticastHandler handler;  ///< Datagram handler
+        void* ctx;                 ///< Handler context
+    };
+
+    EthernetClass* _ethernet;                        ///< Socket allocator
+    EthernetChip* _chip;                             ///< Chip the sockets live on
+    Membership _members[ETHERNET_MULTICAST_GROUPS];  ///< Active memberships
+    uint8_t _count;                                  ///< Entries in _members
+    uint8_t _socketMask;                             ///< Sockets held, bit n = socket n
+    uint8_t _backlog;                                ///< Sockets left with data by the last poll()
+
+    int8_t find(IPAddress group, uint16_t port) const;
+    void remove(uint8_t index);
+
+   public:
+    /**
+     * @brief Construct an empty membership set
+     * @param eth Ethernet instance to allocate sockets from
+     * @param chip Chip the sockets live on
+     */
+    EthernetMulticast(EthernetClass* eth, EthernetChip* chip);
+
+    /**
+     * @brief Join a group
+     * @param group Multicast group address (224.0.0.0/4)
+     * @param port UDP port to receive on
+     * @param handler Called with each datagram received on the group
+     * @param ctx Passed to handler
+     * @param options MulticastOpt bits (IGMP version, broadcast/unicast blocking)
+     * @return 1 on success, 0 if the address is not multicast or no socket or slot is free
+     *
+     * Takes one socket, which the chip opens already joined to the group.
+     * Joining a group and port that is already joined replaces the handler.
+     */
+    uint8_t join(IPAddress group, uint16_t port, MulticastHandler handler, void* ctx = nullptr,
+                 uint8_t options = MulticastOpt::IGMP_V2);
+
+    /**
+     * @brief Leave a group, sending the IGMP leave and freeing its socket
+     * @return 1 if the group was joined on that port, 0 otherwise
+     */
+    uint8_t leave(IPAddress group, uint16_t port);
+
+    /** @brief Leave every group */
+    void leaveAll();
+
+    /**
+     * @brief Dispatch received datagrams to their groups' handlers
+     * @param buf Scratch buffer the payload is read into
+     * @param size Size of buf; longer datagrams are truncated to it
+     * @return Number of datagrams dispatched
+     *
+     * Reads up to ETHERNET_MULTICAST_BURST datagrams from each socket. Handlers
+     * may call join() and leave().
+     */
+    uint8_t poll(uint8_t* buf, uint16_t size);
+
+    /** @return Number of groups joined */
+    uint8_t groupCount() const { return _count; }
+
+    /** @return Sockets held by the memberships, bit n = socket n */
+    uint8_t socketMask() const { return _socketMask; }
+};
+
+#endif
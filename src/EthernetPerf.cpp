@@ -0,0 +1,23 @@
+#include "EthernetPerf.h"
+
+#if ETHERNET3_PERF
+
+EthernetPerfStats ethernetPerf = {};
+volatile EthernetTraceHook ethernetTraceHook = nullptr;
+void* volatile ethernetTraceCtx = nullptr;
+
+void ethernetPerfRecord(EthernetPerfTimer& timer, uint32_t sample) {
+    if (timer.count == 0 || sample < timer.min) timer.min = sample;
+    if (sample > timer.max) timer.max = sample;
+    timer.total += sample;
+    timer.count++;
+}
+
+void ethernetPerfEvent(EthernetPerfTimer& timer, uint8_t event, uint8_t s, uint32_t sample) {
+    ethernetPerfRecord(timer, sample);
+    // Load the hook before its context: setTraceHook() stores them the other way round
+    EthernetTraceHook hook = ethernetTraceHook;
+    if (hook) hook(ethernetTraceCtx, event, s, sample);
+}
+
+#endif
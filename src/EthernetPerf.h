@@ -0,0 +1,124 @@
+/**
+ * @file EthernetPerf.h
+ * @brief Optional performance counters and trace hooks for Ethernet3 library
+ *
+ * Built with ETHERNET3_PERF defined to 1, the library counts SPI transactions
+ * and bytes, socket commands and how long the chip took to accept them, the
+ * wait for SEND_OK, bytes moved through each socket's buffers, UDP datagrams,
+ * server polls, and the latency of DNS lookups, DHCP and HTTP requests. The
+ * counters are read with EthernetClass::perfSnapshot() and cleared with
+ * perfReset(); a trace hook set with setTraceHook() is called at each timed
+ * event.
+ *
+ * Without ETHERNET3_PERF (the default) every hook below compiles to nothing:
+ * no counters are kept, no time is read and no code is added to the paths.
+ */
+
+#ifndef ethernetperf_h
+#define ethernetperf_h
+
+#include <Arduino.h>
+
+#include "chips/utility/wiznet_registers.h"
+
+/** @brief Set to 1 to compile the counters and trace hooks in */
+#ifndef ETHERNET3_PERF
+#define ETHERNET3_PERF 0
+#endif
+
+/**
+ * @brief Count, total, minimum and maximum of a measured duration
+ *
+ * The unit is given by the field of EthernetPerfStats holding the timer.
+ */
+struct EthernetPerfTimer {
+    uint32_t count;  ///< Samples taken
+    uint32_t total;  ///< Sum of the samples
+    uint32_t min;    ///< Shortest sample, 0 if none
+    uint32_t max;    ///< Longest sample
+
+    /** @return Mean sample, 0 if none */
+    uint32_t average() const { return count ? total / count : 0; }
+};
+
+/**
+ * @brief Counters kept while ETHERNET3_PERF is enabled
+ */
+struct EthernetPerfStats {
+    uint32_t spiReads;         ///< SPI read transactions (one per CS frame)
+    uint32_t spiWrites;        ///< SPI write transactions
+    uint32_t spiBytesRead;     ///< Payload bytes read, excluding frame headers
+    uint32_t spiBytesWritten;  ///< Payload bytes written
+    uint32_t commandSpins;     ///< Sn_CR polls spent waiting for commands to be accepted
+    EthernetPerfTimer command;   ///< execCmdSn() duration, in us
+    EthernetPerfTimer sendWait;  ///< SEND to SEND_OK or TIMEOUT in blocking sends, in us
+    uint32_t sendTimeouts;       ///< Blocking sends that ended in TIMEOUT or a closed socket
+    uint32_t txBytes[MAX_SOCK_NUM];  ///< Bytes copied into each socket's TX memory
+    uint32_t rxBytes[MAX_SOCK_NUM];  ///< Bytes copied out of each socket's RX memory
+    uint32_t udpSent;          ///< UDP datagrams sent
+    uint32_t udpReceived;      ///< UDP datagrams received
+    uint32_t serverPolls;      ///< EthernetServer::accept() passes
+    uint32_t serverRefreshes;  ///< Socket state reads made by those passes
+    EthernetPerfTimer dns;     ///< DNS lookups that went to the network, in ms
+    EthernetPerfTimer dhcp;    ///< DHCP start or restart to BOUND, in ms
+    EthernetPerfTimer http;    ///< HTTPServer request dispatch to response end, in us
+};
+
+/**
+ * @brief Events passed to the trace hook
+ */
+class EthernetTrace {
+   public:
+    static const uint8_t COMMAND = 1;       ///< Socket command accepted; value = duration in us
+    static const uint8_t SEND_DONE = 2;     ///< Blocking send completed; value = wait in us
+    static const uint8_t SEND_TIMEOUT = 3;  ///< Blocking send failed; value = wait in us
+    static const uint8_t DNS = 4;           ///< DNS lookup finished; value = duration in ms
+    static const uint8_t DHCP_BOUND = 5;    ///< Lease obtained; value = time since start in ms
+    static const uint8_t HTTP_REQUEST = 6;  ///< HTTP request answered; value = duration in us
+};
+
+/**
+ * @brief Trace hook
+ * @param ctx Context given to setTraceHook()
+ * @param event EthernetTrace event
+ * @param s Socket the event concerns, or MAX_SOCK_NUM if none
+ * @param value Event value, see EthernetTrace
+ *
+ * Called from inside the library's I/O paths: keep it short and make no
+ * socket calls from it.
+ */
+typedef void (*EthernetTraceHook)(void* ctx, uint8_t event, uint8_t s, uint32_t value);
+
+#if ETHERNET3_PERF
+
+extern EthernetPerfStats ethernetPerf;
+// volatile so setTraceHook()'s store order (hook cleared, context, hook) reaches memory as written
+extern volatile EthernetTraceHook ethernetTraceHook;
+extern void* volatile ethernetTraceCtx;
+
+/** @brief Add a sample to a timer */
+void ethernetPerfRecord(EthernetPerfTimer& timer, uint32_t sample);
+
+/** @brief Add a sample to a timer and pass it to the trace hook */
+void ethernetPerfEvent(EthernetPerfTimer& timer, uint8_t event, uint8_t s, uint32_t sample);
+
+#define ETHERNET_PERF_ADD(field, n) (ethernetPerf.field += (n))
+#define ETHERNET_PERF_START(var) uint32_t var = micros()
+#define ETHERNET_PERF_START_MS(var) uint32_t var = millis()
+#define ETHERNET_PERF_ELAPSED(var) (micros() - (var))
+#define ETHERNET_PERF_ELAPSED_MS(var) (millis() - (var))
+#define ETHERNET_PERF_EVENT(timer, event, s, sample) \
+    ethernetPerfEvent(ethernetPerf.timer, EthernetTrace::event, (s), (sample))
+
+#else
+
+#define ETHERNET_PERF_ADD(field, n) ((void)0)
+#define ETHERNET_PERF_START(var)
+#define ETHERNET_PERF_START_MS(var)
+#define ETHERNET_PERF_ELAPSED(var) 0
+#define ETHERNET_PERF_ELAPSED_MS(var) 0
+#define ETHERNET_PERF_EVENT(timer, event, s, sample) ((void)0)
+
+#endif
+
+#endif
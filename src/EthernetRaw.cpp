@@ -0,0 +1,207 @@
+/**
+ * @file EthernetRaw.cpp
+ * @brief Implementation of MACRAW capture and injection
+ */
+
+#include "EthernetRaw.h"
+
+#include "EthernetEvents.h"
+
+/** @brief Largest untagged frame without FCS; RX memory with less room may drop frames */
+static const uint16_t RAW_MAX_FRAME = 1514;
+
+EthernetRaw::EthernetRaw(EthernetClass* eth, EthernetChip* chip)
+    : _ethernet(eth),
+      _chip(chip),
+      _open(false),
+      _ring(nullptr),
+      _size(0),
+      _head(0),
+      _tail(0),
+      _used(0),
+      _queued(0),
+      _typeCount(0),
+      _matchDst(false),
+      _filter(nullptr),
+      _filterCtx(nullptr) {
+    resetStats();
+}
+
+bool EthernetRaw::begin(uint8_t* ring, uint16_t size, uint8_t flags) {
+    end();
+    if (ring == nullptr || size < 2 + ETHERNET_RAW_HEADER) return false;
+
+    uint8_t sock = _ethernet->allocSocket(SockOwner::RAW);
+    if (sock != 0) {
+        // MACRAW exists on socket 0 only
+        if (sock != MAX_SOCK_NUM) _ethernet->freeSocket(sock);
+        return false;
+    }
+    socket(_chip, 0, SnMR::MACRAW, 0, flags);
+    if (_chip->readSnSR(0) != SnSR::MACRAW) {
+        close(_chip, 0);
+        _ethernet->freeSocket(0);
+        return false;
+    }
+
+    _ring = ring;
+    _size = size;
+    _head = _tail = _used = _queued = 0;
+    _open = true;
+    return true;
+}
+
+void EthernetRaw::end() {
+    if (!_open) return;
+    close(_chip, 0);
+    _ethernet->freeSocket(0);
+    _open = false;
+}
+
+bool EthernetRaw::acceptEtherType(uint16_t type) {
+    for (uint8_t i = 0; i < _typeCount; i++) {
+        if (_types[i] == type) return true;
+    }
+    if (_typeCount == ETHERNET_RAW_ETHERTYPES) return false;
+    _types[_typeCount++] = type;
+    return true;
+}
+
+void EthernetRaw::acceptDestination(const uint8_t* mac) {
+    _matchDst = mac != nullptr;
+    if (_matchDst) memcpy(_dst, mac, 6);
+}
+
+void EthernetRaw::clearFilters() {
+    _typeCount = 0;
+    _matchDst = false;
+    _filter = nullptr;
+    _filterCtx = nullptr;
+}
+
+bool EthernetRaw::accept(const uint8_t* header, uint16_t len) {
+    if (len < ETHERNET_RAW_HEADER) return false;
+    if (_matchDst && memcmp(header, _dst, 6) != 0) return false;
+    if (_typeCount > 0) {
+        uint16_t type = ((uint16_t)header[12] << 8) | header[13];
+        bool known = false;
+        for (uint8_t i = 0; i < _typeCount && !known; i++) known = _types[i] == type;
+        if (!known) return false;
+    }
+    return _filter == nullptr || _filter(_filterCtx, header, len);
+}
+
+void EthernetRaw::ringWrite(const uint8_t* data, uint16_t len) {
+    uint16_t first = _size - _head;
+    if (first > len) first = len;
+    memcpy(_ring + _head, data, first);
+    memcpy(_ring, data + first, len - first);
+    _head = (uint16_t)((_head + len) % _size);
+    _used += len;
+}
+
+void EthernetRaw::ringFill(uint16_t ptr, uint16_t len) {
+    // At most two bursts: the chip side wraps inside read_data()
+    uint16_t first = _size - _head;
+    if (first > len) first = len;
+    if (first > 0) _chip->read_data(0, ptr, _ring + _head, first);
+    if (len > first) _chip->read_data(0, ptr + first, _ring, len - first);
+    _head = (uint16_t)((_head + len) % _size);
+    _used += len;
+}
+
+void EthernetRaw::ringRead(uint8_t* data, uint16_t len) {
+    uint16_t first = _size - _tail;
+    if (first > len) first = len;
+    if (data != nullptr) {
+        memcpy(data, _ring + _tail, first);
+        memcpy(data + first, _ring, len - first);
+    }
+    _tail = (uint16_t)((_tail + len) % _size);
+    _used -= len;
+}
+
+uint16_t EthernetRaw::poll() {
+    if (!_open) return 0;
+
+    // With socket interrupts, read nothing until socket 0 has received
+    EthernetEvents* ev = _ethernet->events();
+    if (ev != nullptr && (ev->eventMask() & SnIR::RECV)) {
+        ev->poll();
+        if ((ev->socketMask() & 1) && !ev->takeChanged(1)) return 0;
+    }
+
+    SnSnapshot snap;
+    _chip->readSnBlock(0, snap, SnSnapshot::POINTERS);
+    if (snap.rx_rsr < 2) return 0;
+    if (_chip->rxBufferSize(0) - snap.rx_rsr < RAW_MAX_FRAME + 2) _stats.rxFull++;
+
+    // Each frame is a 2-byte length (counting itself) followed by the frame. The length
+    // and the Ethernet header are read together, the payload only if the frame is kept.
+    uint16_t ptr = snap.rx_rd;
+    uint16_t left = snap.rx_rsr;
+    uint16_t captured = 0;
+    while (left >= 2) {
+        uint8_t head[2 + ETHERNET_RAW_HEADER];
+        uint16_t want = left < sizeof(head) ? left : sizeof(head);
+        _chip->read_data(0, ptr, head, want);
+
+        uint16_t total = ((uint16_t)head[0] << 8) | head[1];
+        if (total < 2 || total > left) break;  // not a whole frame: leave it for next time
+        uint16_t len = total - 2;
+
+        if (!accept(head + 2, len)) {
+            _stats.filtered++;
+        } else if ((uint32_t)len + 2 > (uint32_t)(_size - _used)) {
+            _stats.dropped++;
+        } else {
+            uint8_t prefix[2] = {(uint8_t)(len & 0xFF), (uint8_t)(len >> 8)};
+            ringWrite(prefix, 2);
+            ringWrite(head + 2, ETHERNET_RAW_HEADER);
+            ringFill(ptr + 2 + ETHERNET_RAW_HEADER, len - ETHERNET_RAW_HEADER);
+            _queued++;
+            _stats.frames++;
+            _stats.bytes += len;
+            captured++;
+        }
+        ptr += total;
+        left -= total;
+    }
+
+    if (left != snap.rx_rsr) {
+        _chip->writeSnRX_RD(0, ptr);
+        _chip->execCmdSn(0, Sock_RECV);
+    }
+    return captured;
+}
+
+uint16_t EthernetRaw::frameLength() const {
+    if (_queued == 0) return 0;
+    return _ring[_tail] | ((uint16_t)_ring[(_tail + 1) % _size] << 8);
+}
+
+uint16_t EthernetRaw::read(uint8_t* buf, uint16_t size) {
+    if (_queued == 0) return 0;
+
+    uint8_t prefix[2];
+    ringRead(prefix, 2);
+    uint16_t len = prefix[0] | ((uint16_t)prefix[1] << 8);
+    uint16_t got = len < size ? len : size;
+    ringRead(buf, got);
+    ringRead(nullptr, len - got);
+    _queued--;
+    return got;
+}
+
+bool EthernetRaw::send(const uint8_t* frame, uint16_t len) {
+    RawFrame f = {frame, len, 0};
+    return sendBatch(&f, 1) == 1;
+}
+
+uint16_t EthernetRaw::sendBatch(RawFrame* frames, uint16_t count) {
+    if (!_open) return 0;
+    uint16_t sent = sendRawBatch(_chip, 0, frames, count);
+    _stats.sent += sent;
+    _stats.sendFailures += count - sent;
+    return sent;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file EthernetRaw.h
+ * @brief MACRAW frame capture into a RAM ring buffer, and batched frame injection
+ *
+ * In MACRAW mode socket 0 receives whole Ethernet frames. EthernetRaw opens it
+ * and, on each poll(), drains every frame waiting in the chip's RX memory in
+ * one pass: a single pointer snapshot, one read of each frame's length and
+ * Ethernet header, and a single Sn_RX_RD write and RECV at the end. Frames the
+ * prefilter rejects are skipped by moving the read pointer past them, so their
+ * payload never crosses the SPI bus. Accepted frames are copied straight from
+ * chip memory into a ring buffer supplied by the caller and read from there at
+ * the application's pace.
+ */
+
+#ifndef ethernetraw_h
+#define ethernetraw_h
+
+#include <Arduino.h>
+
+#include "Ethernet3.h"
+#include "chips/utility/socket.h"
+
+/** @brief EtherTypes the prefilter can hold */
+#ifndef ETHERNET_RAW_ETHERTYPES
+#define ETHERNET_RAW_ETHERTYPES 4
+#endif
+
+/** @brief Ethernet header bytes: destination MAC, source MAC, EtherType */
+#define ETHERNET_RAW_HEADER 14
+
+/**
+ * @brief Capture and injection counters
+ */
+struct EthernetRawStats {
+    uint32_t frames;        ///< Frames stored in the ring
+    uint32_t bytes;         ///< Bytes of those frames
+    uint32_t filtered;      ///< Frames the prefilter rejected, skipped without reading them
+    uint32_t dropped;       ///< Frames that passed the prefilter but did not fit in the ring
+    uint32_t rxFull;        ///< Polls that found RX memory without room for another full frame
+    uint32_t sent;          ///< Frames injected
+    uint32_t sendFailures;  ///< Frames rejected or timed out while injecting
+};
+
+/**
+ * @brief Custom prefilter, run after the EtherType and destination checks
+ * @param ctx Context given to setFilter()
+ * @param header The frame's 14-byte Ethernet header
+ * @param len Length of the whole frame
+ * @return true to capture the frame
+ */
+typedef bool (*EthernetRawFilter)(void* ctx, const uint8_t* header, uint16_t len);
+
+/**
+ * @brief Raw Ethernet frame capture and injection on socket 0
+ *
+ * @code
+ * uint8_t ring[8192];
+ * EthernetRaw raw(&Ethernet, &chip);
+ * raw.begin(ring, sizeof(ring));
+ * raw.acceptEtherType(0x88B5);  // only our protocol
+ * ...
+ * void loop() {
+ *     raw.poll();
+ *     uint8_t frame[1514];
+ *     while (raw.available()) handle(frame, raw.read(frame, sizeof(frame)));
+ * }
+ * @endcode
+ *
+ * Only socket 0 can run MACRAW, so begin() must be called while socket 0 is
+ * free, typically right after Ethernet.begin(). Giving socket 0 more buffer
+ * memory (EthernetChip::setSocketBufferSizes()) lets more frames wait between polls.
+ *
+ * When an EthernetEvents engine with RECV enabled is attached to the
+ * EthernetClass, poll() reads nothing until socket 0 raises an event.
+ */
+class EthernetRaw {
+   private:
+    EthernetClass* _ethernet;  ///< Socket allocator
+    EthernetChip* _chip;       ///< Chip socket 0 lives on
+    bool _open;                ///< Socket 0 is ours and in MACRAW
+
+    uint8_t* _ring;     ///< Caller's buffer: frames stored as 2-byte length + frame
+    uint16_t _size;     ///< Ring size in bytes
+    uint16_t _head;     ///< Offset the next frame is written at
+    uint16_t _tail;     ///< Offset of the oldest frame
+    uint16_t _used;     ///< Bytes held, length prefixes included
+    uint16_t _queued;   ///< Frames held
+
+    uint16_t _types[ETHERNET_RAW_ETHERTYPES];  ///< EtherTypes accepted, none = all
+    uint8_t _typeCount;                        ///< Entries in _types
+    uint8_t _dst[6];                           ///< Destination accepted, if _matchDst
+    bool _matchDst;                            ///< Check the destination MAC
+    EthernetRawFilter _filter;                 ///< Custom prefilter, if any
+    void* _filterCtx;                          ///< Its context
+
+    EthernetRawStats _stats;
+
+    /** @return true if the prefilter accepts a frame with this header */
+    bool accept(const uint8_t* header, uint16_t len);
+
+    /** @brief Copy bytes into the ring at _head, wrapping */
+    void ringWrite(const uint8_t* data, uint16_t len);
+
+    /** @brief Copy len bytes of socket RX memory at ptr into the ring at _head, wrapping */
+    void ringFill(uint16_t ptr, uint16_t len);
+
+    /** @brief Copy bytes out of the ring at _tail, wrapping; data may be nullptr to skip */
+    void ringRead(uint8_t* data, uint16_t len);
+
+   public:
+    /**
+     * @brief Construct a closed capture
+     * @param eth Ethernet instance to take socket 0 from
+     * @param chip Chip socket 0 lives on
+     */
+    EthernetRaw(EthernetClass* eth, EthernetChip* chip);
+
+    /**
+     * @brief Open socket 0 in MACRAW mode
+     * @param ring Buffer captured frames are stored in, each with a 2-byte length
+     * @param size Size of ring in bytes
+     * @param flags Sn_MR filter bits: SnMR::MFEN (only frames to our MAC and broadcast),
+     *        SnMR::BCASTB, SnMR::MMB (block multicast), SnMR::MIP6B (block IPv6); W5500 only
+     * @return false if socket 0 is taken or the chip refused MACRAW
+     */
+    bool begin(uint8_t* ring, uint16_t size, uint8_t flags = 0);
+
+    /** @brief Close socket 0 and give it back; frames in the ring are kept */
+    void end();
+
+    /**
+     * @brief Accept frames of an EtherType
+     * @return false if ETHERNET_RAW_ETHERTYPES types are already set
+     *
+     * With no type set every EtherType is accepted.
+     */
+    bool acceptEtherType(uint16_t type);
+
+    /**
+     * @brief Accept only frames sent to one MAC address
+     * @param mac Destination to accept, or nullptr to accept any
+     */
+    void acceptDestination(const uint8_t* mac);
+
+    /** @brief Set a custom prefilter, or nullptr to remove it */
+    void setFilter(EthernetRawFilter filter, void* ctx = nullptr) {
+        _filter = filter;
+        _filterCtx = ctx;
+    }
+
+    /** @brief Remove every prefilter condition: capture all frames */
+    void clearFilters();
+
+    /**
+     * @brief Move every frame waiting in RX memory into the ring
+     * @return Frames captured by this call
+     *
+     * Frames that do not fit in the ring are dropped and counted.
+     */
+    uint16_t poll();
+
+    /** @return Frames waiting in the ring */
+    uint16_t available() const { return _queued; }
+
+    /** @return Length of the oldest frame in the ring, 0 if none */
+    uint16_t frameLength() const;
+
+    /**
+     * @brief Take the oldest frame out of the ring
+     * @param buf Receives the frame
+     * @param size Size of buf; the rest of a longer frame is discarded
+     * @return Bytes copied into buf, 0 if the ring is empty
+     */
+    uint16_t read(uint8_t* buf, uint16_t size);
+
+    /**
+     * @brief Send one frame
+     * @param frame Complete frame from the destination MAC on, without FCS
+     * @param len Frame length
+     * @return true if it was sent
+     */
+    bool send(const uint8_t* frame, uint16_t len);
+
+    /**
+     * @brief Send several frames, each copied while the previous one is on the wire
+     * @return Number of frames sent; each frame's status tells its result
+     */
+    uint16_t sendBatch(RawFrame* frames, uint16_t count);
+
+    /** @return true while socket 0 is open in MACRAW */
+    bool isOpen() const { return _open; }
+
+    /** @return Capture and injection counters */
+    const EthernetRawStats& stats() const { return _stats; }
+
+    /** @brief Clear the counters */
+    void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+};
+
+#endif
@@ -13,93 +13,156 @@ extern "C" {
 }
 
 #include "EthernetServer.h"
+#include "EthernetPerf.h"
 
 /**
  * @brief Construct a new EthernetServer object
  * @param eth Pointer to EthernetClass instance
  * @param chip Pointer to EthernetChip interface
  * @param port Port number to listen on
+ * @param listeners Sockets to keep listening
  * 
  * Creates a server that will listen on the specified port.
  */
-EthernetServer::EthernetServer(EthernetClass* eth, EthernetChip* chip, uint16_t port)
-    : _ethernet(eth), _chip(chip), _port(port) {}
+EthernetServer::EthernetServer(EthernetClass* eth, EthernetChip* chip, uint16_t port,
+                               uint8_t listeners)
+    : _ethernet(eth),
+      _chip(chip),
+      _port(port),
+      _listeners(listeners ? listeners : 1),
+      _next(0),
+      _lastSync(0) {
+    for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
+        _sr[sock] = SnSR::CLOSED;
+        _rsr[sock] = 0;
+    }
+}
 
 /**
  * @brief Start the server listening for connections
  * 
- * Initializes the server by finding an available socket and configuring
- * it to listen for incoming TCP connections on the specified port.
- * Only one socket is initially allocated; additional sockets are allocated
- * as needed when clients connect.
+ * Puts listeners() free sockets into LISTEN on the server's port. Additional
+ * sockets are armed as clients connect, so that many stay listening.
  */
 void EthernetServer::begin() {
+    uint8_t listening = 0;
+
     for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
-        EthernetClient client(_ethernet, _chip, sock);
-        if (client.status() == SnSR::CLOSED) {
-            socket(_chip, sock, SnMR::TCP, _port, 0);
-            listen(_chip, sock);
-            _ethernet->_server_port[sock] = _port;
-            break;
-        }
+        if (!owns(sock)) continue;
+        refresh(sock);
+        if (_sr[sock] == SnSR::LISTEN) listening++;
     }
+    while (listening < _listeners && arm()) listening++;
+
+    _lastSync = millis();
+}
+
+bool EthernetServer::owns(uint8_t sock) const { return _ethernet->_server_port[sock] == _port; }
+
+void EthernetServer::refresh(uint8_t sock) {
+    _sr[sock] = _chip->readSnSR(sock);
+    if (_sr[sock] == SnSR::ESTABLISHED || _sr[sock] == SnSR::CLOSE_WAIT) {
+        _rsr[sock] = _chip->getRXReceivedSize(sock);
+    } else {
+        _rsr[sock] = 0;
+    }
+}
+
+bool EthernetServer::arm() {
+    uint8_t sock = _ethernet->allocSocket(SockOwner::SERVER);
+    if (sock == MAX_SOCK_NUM) return false;
+
+    socket(_chip, sock, SnMR::TCP, _port, 0);
+    listen(_chip, sock);
+    _ethernet->_server_port[sock] = _port;
+    _sr[sock] = SnSR::LISTEN;
+    _rsr[sock] = 0;
+    return true;
 }
 
 /**
- * @brief Accept pending connections and maintain server state
+ * @brief Refresh the cached socket state and maintain server state
  * 
  * Internal function that handles server maintenance tasks:
- * - Cleans up closed connections in CLOSE_WAIT state
- * - Ensures at least one socket is always listening for new connections
- * - Allocates additional listening sockets if none are available
+ * - Refreshes the cached state of the server's sockets in one pass
+ * - Closes drained connections in CLOSE_WAIT state, without blocking (stopAsync())
+ * - Keeps listeners() sockets listening for new connections
+ * 
+ * Without an event engine every owned socket is re-read (one or two register
+ * reads each). With an EthernetEvents engine attached and CON, DISCON, RECV
+ * and TIMEOUT enabled, only sockets that raised events or still hold unread
+ * data are re-read, with a full pass every ETHERNET_SERVER_RESYNC_MS.
  * 
  * This function is called automatically by available() and write() methods.
  */
 void EthernetServer::accept() {
-    int listening = 0;
+    const uint8_t needed = SnIR::CON | SnIR::DISCON | SnIR::RECV | SnIR::TIMEOUT;
+    uint8_t owned = 0;
 
     for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
-        EthernetClient client(_ethernet, _chip, sock);
-
-        if (_ethernet->_server_port[sock] == _port) {
-            if (client.status() == SnSR::LISTEN) {
-                listening = 1;
-            } else if (client.status() == SnSR::CLOSE_WAIT && !client.available()) {
-                client.stop();
-            }
+        if (owns(sock)) owned |= (1 << sock);
+    }
+
+    // Let background closes progress even if the sketch never calls maintain()
+    _ethernet->serviceSockets();
+
+    uint8_t stale = owned;
+    ETHERNET_PERF_ADD(serverPolls, 1);
+    EthernetEvents* ev = _ethernet->events();
+    if (ev && (ev->eventMask() & needed) == needed &&
+        millis() - _lastSync < ETHERNET_SERVER_RESYNC_MS) {
+        ev->poll();
+        uint8_t covered = owned & ev->socketMask();
+        stale = ev->takeChanged(covered) | (owned & ~covered);
+        for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
+            // a partial read raises no new event
+            if ((covered & (1 << sock)) && _rsr[sock] > 0) stale |= (1 << sock);
         }
+    } else {
+        if (ev) ev->takeChanged(owned);
+        _lastSync = millis();
     }
 
-    if (!listening) {
-        begin();
+    uint8_t listening = 0;
+    for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
+        if (!(owned & (1 << sock))) continue;
+        if (stale & (1 << sock)) {
+            refresh(sock);
+            ETHERNET_PERF_ADD(serverRefreshes, 1);
+        }
+
+        if (_sr[sock] == SnSR::LISTEN) {
+            listening++;
+        } else if (_sr[sock] == SnSR::CLOSE_WAIT && _rsr[sock] == 0) {
+            // Close in the background: stop() could hold the caller for seconds
+            EthernetClient client(_ethernet, _chip, sock);
+            client.stopAsync();
+            _sr[sock] = SnSR::CLOSED;
+        }
     }
+
+    while (listening < _listeners && arm()) listening++;
 }
 
 /**
  * @brief Get a client with available data
  * @return EthernetClient object for a connected client with data, or invalid client if none
  * 
- * Checks all sockets associated with this server port for clients that have
- * data available to read. Returns the first client found with available data.
- * If no clients have data available, returns an invalid client object that
- * evaluates to false in boolean contexts.
- * 
- * This function also performs server maintenance by calling accept().
- * 
- * @note The function currently always returns the lowest-numbered socket with data.
- *       Future versions may implement round-robin selection for better fairness.
+ * Checks the sockets associated with this server port for clients that have
+ * data available to read, using the state table refreshed by accept(). The
+ * search starts just after the socket returned by the previous call, so
+ * clients are served round-robin. If no clients have data available, returns
+ * an invalid client object that evaluates to false in boolean contexts.
  */
 EthernetClient EthernetServer::available() {
     accept();
 
-    for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
-        EthernetClient client(_ethernet, _chip, sock);
-        if (_ethernet->_server_port[sock] == _port &&
-            (client.status() == SnSR::ESTABLISHED || client.status() == SnSR::CLOSE_WAIT)) {
-            if (client.available()) {
-                // XXX: don't always pick the lowest numbered socket.
-                return client;
-            }
+    for (int i = 0; i < MAX_SOCK_NUM; i++) {
+        uint8_t sock = (_next + i) % MAX_SOCK_NUM;
+        if (owns(sock) && (_sr[sock] == SnSR::ESTABLISHED || _sr[sock] == SnSR::CLOSE_WAIT) &&
+            _rsr[sock] > 0) {
+            _next = (sock + 1) % MAX_SOCK_NUM;
+            return EthernetClient(_ethernet, _chip, sock);
         }
     }
 
@@ -133,9 +196,8 @@ size_t EthernetServer::write(const uint8_t* buffer, size_t size) {
     accept();
 
     for (int sock = 0; sock < MAX_SOCK_NUM; sock++) {
-        EthernetClient client(_ethernet, _chip, sock);
-
-        if (_ethernet->_server_port[sock] == _port && client.status() == SnSR::ESTABLISHED) {
+        if (owns(sock) && _sr[sock] == SnSR::ESTABLISHED) {
+            EthernetClient client(_ethernet, _chip, sock);
             n += client.write(buffer, size);
         }
     }
@@ -37,6 +37,17 @@ class EthernetClient;
  * - Supports more reliable multi-client handling
  */
 
+/**
+ * @brief Full state refresh interval for servers driven by EthernetEvents, in ms
+ *
+ * With an event engine attached only sockets that raised events (or still hold
+ * unread data) are re-read; this periodic full pass catches anything an event
+ * could not report, such as a socket closed locally by another object.
+ */
+#ifndef ETHERNET_SERVER_RESYNC_MS
+#define ETHERNET_SERVER_RESYNC_MS 1000
+#endif
+
 // TODO: Implement support for different "server" class provided by esp32 frameworks. Then library
 // will be compatible with esp32 Arduino framework.
 class EthernetServer : public Server {
@@ -44,12 +55,35 @@ class EthernetServer : public Server {
     EthernetClass* _ethernet;  ///< Pointer to the Ethernet class instance
     EthernetChip* _chip;       ///< Pointer to the Ethernet chip interface
     uint16_t _port;            ///< Port number to listen on
+    uint8_t _listeners;        ///< Sockets to keep listening for burst connects
+    uint8_t _next;             ///< Round-robin cursor: socket to try first in available()
+    uint8_t _sr[MAX_SOCK_NUM];    ///< Cached Sn_SR of the sockets this server owns
+    uint16_t _rsr[MAX_SOCK_NUM];  ///< Cached Sn_RX_RSR of those sockets
+    unsigned long _lastSync;      ///< millis() of the last full refresh
+
+    /** @return true if socket s is bound to this server */
+    bool owns(uint8_t sock) const;
 
     /**
-     * @brief Accept pending connections on listening sockets
+     * @brief Re-read the cached state of one socket
      *
-     * Internal function that checks all sockets for incoming connections
-     * and transitions them from LISTEN to ESTABLISHED state when clients connect.
+     * One Sn_SR read, plus one Sn_RX_RSR read for connected sockets.
+     */
+    void refresh(uint8_t sock);
+
+    /**
+     * @brief Put one more socket into LISTEN on this server's port
+     * @return true if the allocator had a socket to give
+     */
+    bool arm();
+
+    /**
+     * @brief Refresh the state table and maintain the listeners
+     *
+     * Refreshes the cached state in one pass: every owned socket, or with an
+     * event engine just those that raised events or hold unread data. Then
+     * closes drained CLOSE_WAIT sockets and re-arms listeners up to the
+     * configured count.
      */
     void accept();
 
@@ -59,11 +93,12 @@ class EthernetServer : public Server {
      * @param eth Pointer to EthernetClass instance
      * @param chip Pointer to EthernetChip interface
      * @param port Port number to listen on
+     * @param listeners Sockets to keep listening, see setListeners()
      *
      * Creates a server that will listen on the specified port for incoming
      * TCP connections.
      */
-    EthernetServer(EthernetClass* eth, EthernetChip* chip, uint16_t port);
+    EthernetServer(EthernetClass* eth, EthernetChip* chip, uint16_t port, uint8_t listeners = 1);
 
     /**
      * @brief Get an available client connection
@@ -73,14 +108,30 @@ class EthernetServer : public Server {
      * Checks for clients with data available or newly connected clients.
      * Returns an EthernetClient object that can be used to communicate with the client.
      * If no clients are available, returns an invalid client (evaluates to false).
+     *
+     * Ready clients are served round-robin: the search starts after the socket
+     * returned last time, so a busy low-numbered client cannot starve the others.
      */
     EthernetClient available();
 
+    /**
+     * @brief Set how many sockets are kept listening
+     * @param count Listening sockets to keep armed (at least 1)
+     *
+     * With several sockets in LISTEN, a burst of simultaneous connects is
+     * accepted by the chip instead of being refused while the application
+     * re-arms a single listener. Takes effect on the next begin() or available().
+     */
+    void setListeners(uint8_t count) { _listeners = count ? count : 1; }
+
+    /** @return Number of sockets kept listening */
+    uint8_t listeners() const { return _listeners; }
+
     /**
      * @brief Start listening for incoming connections
      *
      * Initializes the server to listen for incoming connections on the specified port.
-     * Multiple sockets may be allocated to support simultaneous connections.
+     * listeners() sockets are put into LISTEN; more are allocated as clients connect.
      */
     virtual void begin();
 
@@ -0,0 +1,76 @@
+/**
+ * @file EthernetSockets.h
+ * @brief Socket ownership tags and statistics for the EthernetClass socket allocator
+ *
+ * EthernetClass hands out hardware sockets from a free mask kept in RAM, so
+ * finding a socket costs no SPI traffic. Each allocation is tagged with the
+ * kind of user holding it, which lets sockets be reserved per kind (e.g.
+ * always keep one for DHCP) and makes usage visible through the stats.
+ *
+ * The same per-socket table tracks asynchronous connects and closes
+ * (SockAsync), so they can be advanced without blocking the caller.
+ */
+
+#ifndef ethernetsockets_h
+#define ethernetsockets_h
+
+#include <Arduino.h>
+
+/**
+ * @brief Who holds a socket, as recorded by the allocator
+ */
+class SockOwner {
+   public:
+    static const uint8_t NONE = 0;    ///< Free
+    static const uint8_t CLIENT = 1;  ///< EthernetClient::connect()
+    static const uint8_t SERVER = 2;  ///< EthernetServer listener or accepted connection
+    static const uint8_t UDP = 3;     ///< EthernetUDP::begin() / beginMulticast()
+    static const uint8_t DNS = 4;     ///< DNSClient lookup
+    static const uint8_t DHCP = 5;    ///< DHCP client
+    static const uint8_t USER = 6;    ///< Application using the socket layer directly
+    static const uint8_t RAW = 7;     ///< EthernetRaw MACRAW capture
+    static const uint8_t COUNT = 8;   ///< Number of owner kinds
+};
+
+/**
+ * @brief Asynchronous operation state of a socket (EthernetClass::_state)
+ *
+ * Advanced by EthernetClass::serviceSockets(), which maintain() calls.
+ */
+class SockAsync {
+   public:
+    static const uint8_t IDLE = 0;        ///< No operation in progress
+    static const uint8_t CONNECTING = 1;  ///< connectAsync(): CONNECT issued
+    static const uint8_t CONNECTED = 2;   ///< connectAsync() succeeded, not yet collected
+    static const uint8_t DRAINING = 4;    ///< stopAsync(): waiting for queued data to go out
+    static const uint8_t CLOSING = 5;     ///< stopAsync(): DISCON sent, waiting for CLOSED
+};
+
+/**
+ * @brief Completion handler of an asynchronous connect or close
+ * @param ctx Context given with the request
+ * @param sock Socket the operation ran on
+ * @param result Connect: 1 connected, -1 failed. Close: 1 closed gracefully,
+ *        0 forced closed after the timeout
+ */
+typedef void (*EthernetAsyncHandler)(void* ctx, uint8_t sock, int8_t result);
+
+/** @brief Milliseconds stopAsync() waits for a graceful close before forcing it */
+#ifndef ETHERNET_CLOSE_TIMEOUT
+#define ETHERNET_CLOSE_TIMEOUT 1000
+#endif
+
+/**
+ * @brief Socket allocator usage statistics
+ */
+struct EthernetSocketStats {
+    uint8_t total;       ///< Sockets managed
+    uint8_t inUse;       ///< Sockets allocated now
+    uint8_t peak;        ///< Most sockets ever allocated at once
+    uint8_t reserved;    ///< Free sockets held back for reservations
+    uint16_t allocs;     ///< Successful allocations
+    uint16_t failures;   ///< Allocations refused for lack of a socket
+    uint16_t reclaims;   ///< Sockets taken back from owners that left them closed
+};
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file EthernetT.h
+ * @brief Compile-time chip specializations of EthernetClient and EthernetUDP
+ *
+ * EthernetClient and EthernetUDP talk to the chip through the virtual
+ * EthernetChip interface, so every register access in their read/write paths
+ * is an indirect call the compiler cannot inline. When a sketch only ever uses
+ * one chip, EthernetClientT<Chip> and EthernetUDPT<Chip> bind those paths to
+ * the concrete chip class instead:
+ *
+ * @code
+ * W5500 chip(10);
+ * EthernetClass Ethernet(&chip);
+ * EthernetClientT<W5500> client(&Ethernet, &chip);
+ * @endcode
+ *
+ * Both are drop-in subclasses of the virtual versions and can be passed
+ * wherever an EthernetClient / EthernetUDP is expected. Connection setup and
+ * teardown, and the client's socket ownership checks, still go through the
+ * base class; only the send()/recv() calls of the client and the per-packet
+ * path of UDP are specialized.
+ */
+
+#ifndef ethernet_t_h
+#define ethernet_t_h
+
+#include "EthernetClient.h"
+#include "EthernetUdp2.h"
+#include "chips/utility/socket_t.h"
+
+/**
+ * @brief EthernetClient with its data path bound to a concrete chip type
+ * @tparam Chip Final EthernetChip implementation, e.g. W5500
+ */
+template <class Chip>
+class EthernetClientT : public EthernetClient {
+   protected:
+    /** @brief The chip, as its concrete type */
+    inline Chip *chip() const { return static_cast<Chip *>(_chip); }
+
+    uint16_t sendChunk(const uint8_t *buf, uint16_t len) override {
+        if (_nonBlocking) return sendAsync(chip(), _sock, buf, len);
+        return send(chip(), _sock, buf, len);
+    }
+
+    int16_t recvChunk(uint8_t *buf, int16_t len) override { return recv(chip(), _sock, buf, len); }
+
+   public:
+    EthernetClientT(EthernetClass *eth, Chip *chip) : EthernetClient(eth, chip) {}
+    EthernetClientT(EthernetClass *eth, Chip *chip, uint8_t sock)
+        : EthernetClient(eth, chip, sock) {}
+
+    using EthernetClient::write;
+};
+
+/**
+ * @brief EthernetUDP with its packet path bound to a concrete chip type
+ * @tparam Chip Final EthernetChip implementation, e.g. W5500
+ */
+template <class Chip>
+class EthernetUDPT : public EthernetUDP {
+   protected:
+    /** @brief The chip, as its concrete type */
+    inline Chip *chip() const { return static_cast<Chip *>(_chip); }
+
+   public:
+    EthernetUDPT(EthernetClass *eth, Chip *chip) : EthernetUDP(eth, chip) {}
+
+    int endPacket() override { return sendUDP(chip(), _sock); }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        uint16_t bytes_written = bufferData(chip(), _sock, _offset, buffer, size);
+        _offset += bytes_written;
+        return bytes_written;
+    }
+
+    size_t sendBatch(UDPMessage *msgs, size_t count) override {
+        if (_sock == MAX_SOCK_NUM) return 0;
+        if (count > 0xFFFF) count = 0xFFFF;
+        return sendtoBatch(chip(), _sock, msgs, count);
+    }
+
+    int parsePacket() override {
+        // discard any remaining bytes in the last packet
+        flush();
+
+        uint8_t addr[4];
+        if (!beginRecvUDP(chip(), _sock, addr, &_remotePort, &_remaining, &_rxPtr)) return 0;
+        _remoteIP = addr;
+        _rxOpen = true;
+
+        if (_remaining == 0) flush();
+        return _remaining;
+    }
+
+    int read() override {
+        uint8_t byte;
+        if (read(&byte, 1) == 1) return byte;
+        return -1;
+    }
+
+    int read(unsigned char *buffer, size_t len) override {
+        if (_remaining == 0) return -1;
+        uint16_t got = _remaining <= len ? _remaining : len;
+        chip()->read_data(_sock, _rxPtr, buffer, got);
+        _rxPtr += got;
+        _remaining -= got;
+        if (_remaining == 0) flush();
+        return got;
+    }
+
+    int peek() override {
+        uint8_t b;
+        if (!_remaining) return -1;
+        chip()->read_data(_sock, _rxPtr, &b, 1);
+        return b;
+    }
+
+    void flush() override {
+        if (!_rxOpen) return;
+        endRecvUDP(chip(), _sock, _rxPtr + _remaining);
+        _remaining = 0;
+        _rxOpen = false;
+    }
+
+    using EthernetUDP::read;
+    using EthernetUDP::write;
+};
+
+#endif
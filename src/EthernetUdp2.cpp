@@ -34,24 +34,29 @@
 
 /* Constructor */
 EthernetUDP::EthernetUDP(EthernetClass* eth, EthernetChip* chip)
-    : _ethernet(eth), _chip(chip), _sock(MAX_SOCK_NUM) {}
+    : _ethernet(eth),
+      _chip(chip),
+      _sock(MAX_SOCK_NUM),
+      _generation(0),
+      _remaining(0),
+      _rxPtr(0),
+      _rxOpen(false),
+      _owner(SockOwner::UDP),
+      _group(0, 0, 0, 0),
+      _mcastOptions(0),
+      _groupDestChanged(false) {}
 
 /* Start EthernetUDP socket, listening at local port PORT */
 uint8_t EthernetUDP::begin(uint16_t port) {
-    if (_sock != MAX_SOCK_NUM) return 0;
-
-    for (int i = 0; i < MAX_SOCK_NUM; i++) {
-        uint8_t s = _chip->readSnSR(i);
-        if (s == SnSR::CLOSED || s == SnSR::FIN_WAIT) {
-            _sock = i;
-            break;
-        }
-    }
+    if (_sock != MAX_SOCK_NUM && !released()) return 0;
 
+    _sock = _ethernet->allocSocket(_owner);
     if (_sock == MAX_SOCK_NUM) return 0;
+    _generation = _ethernet->socketGeneration(_sock);
 
     _port = port;
     _remaining = 0;
+    _rxOpen = false;
     socket(_chip, _sock, SnMR::UDP, _port, 0);
 
     return 1;
@@ -63,22 +68,31 @@ int EthernetUDP::available() { return _remaining; }
 
 /* Release any resources being used by this EthernetUDP instance */
 void EthernetUDP::stop() {
-    if (_sock == MAX_SOCK_NUM) return;
+    if (_sock == MAX_SOCK_NUM || released()) return;
 
-    close(_chip, _sock);
+    closeSocket();
+
+    _ethernet->freeSocket(_sock, _generation);
+    _sock = MAX_SOCK_NUM;
+    _remaining = 0;
+    _rxOpen = false;
+}
 
-    _ethernet->_server_port[_sock] = 0;
+/* Forget a socket the allocator reclaimed since begin(); it may be someone else's now */
+bool EthernetUDP::released() {
+    if (_ethernet->ownsSocket(_sock, _generation)) return false;
     _sock = MAX_SOCK_NUM;
+    _remaining = 0;
+    _rxOpen = false;
+    return true;
 }
 
 int EthernetUDP::beginPacket(const char* host, uint16_t port) {
     // Look up the host first
     int ret = 0;
-    DNSClient dns(_ethernet, _chip);
     IPAddress remote_addr;
 
-    dns.begin(_ethernet->dnsServerIP());
-    ret = dns.getHostByName(host, remote_addr);
+    ret = _ethernet->hostByName(host, remote_addr);
     if (ret == 1) {
         return beginPacket(remote_addr, port);
     } else {
@@ -88,6 +102,16 @@ int EthernetUDP::beginPacket(const char* host, uint16_t port) {
 
 int EthernetUDP::beginPacket(IPAddress ip, uint16_t port) {
     _offset = 0;
+    if (_group != IPAddress(0, 0, 0, 0)) {
+        // Another peer's address replaces the group MAC in Sn_DHAR; put it back before
+        // sending to the group again
+        if (ip != _group) {
+            _groupDestChanged = true;
+        } else if (_groupDestChanged) {
+            setMulticastDest(_chip, _sock, rawIPAddress(ip), port);
+            _groupDestChanged = false;
+        }
+    }
     return startUDP(_chip, _sock, rawIPAddress(ip), port);
 }
 
@@ -101,89 +125,111 @@ size_t EthernetUDP::write(const uint8_t* buffer, size_t size) {
     return bytes_written;
 }
 
+size_t EthernetUDP::writeFrom(SocketWriteProducer producer, void* ctx, size_t maxLen) {
+    if (maxLen > 0xFFFF) maxLen = 0xFFFF;
+    uint16_t bytes_written = bufferProduce(_chip, _sock, _offset, maxLen, producer, ctx);
+    _offset += bytes_written;
+    return bytes_written;
+}
+
+size_t EthernetUDP::sendBatch(UDPMessage* msgs, size_t count) {
+    if (_sock == MAX_SOCK_NUM) return 0;
+    if (count > 0xFFFF) count = 0xFFFF;
+    return sendtoBatch(_chip, _sock, msgs, count);
+}
+
+void EthernetUDP::setMessage(UDPMessage& msg, IPAddress ip, uint16_t port, const uint8_t* buf,
+                             uint16_t len) {
+    for (int i = 0; i < 4; i++) msg.addr[i] = ip[i];
+    msg.port = port;
+    msg.buf = buf;
+    msg.len = len;
+    msg.status = -1;
+}
+
 int EthernetUDP::parsePacket() {
     // discard any remaining bytes in the last packet
     flush();
 
-    if (_chip->getRXReceivedSize(_sock) > 0) {
-        // HACK - hand-parse the UDP packet using TCP recv method
-        uint8_t tmpBuf[8];
-        int ret = 0;
-        // read 8 header bytes and get IP and port from it
-        ret = recv(_chip, _sock, tmpBuf, 8);
-        if (ret > 0) {
-            _remoteIP = tmpBuf;
-            _remotePort = tmpBuf[4];
-            _remotePort = (_remotePort << 8) + tmpBuf[5];
-            _remaining = tmpBuf[6];
-            _remaining = (_remaining << 8) + tmpBuf[7];
-
-            // When we get here, any remaining bytes are the data
-            ret = _remaining;
-        }
-        return ret;
+    uint8_t addr[4];
+    if (!beginRecvUDP(_chip, _sock, addr, &_remotePort, &_remaining, &_rxPtr)) {
+        // There aren't any packets available
+        return 0;
     }
-    // There aren't any packets available
-    return 0;
+    _remoteIP = addr;
+    _rxOpen = true;
+
+    // A zero-length packet has nothing to read; release it now
+    if (_remaining == 0) flush();
+    return _remaining;
 }
 
 int EthernetUDP::read() {
     uint8_t byte;
 
-    if ((_remaining > 0) && (recv(_chip, _sock, &byte, 1) > 0)) {
-        // We read things without any problems
-        _remaining--;
-        return byte;
-    }
+    if (read(&byte, 1) == 1) return byte;
 
     // If we get here, there's no data available
     return -1;
 }
 
 int EthernetUDP::read(unsigned char* buffer, size_t len) {
-    if (_remaining > 0) {
-        int got;
-
-        if (_remaining <= len) {
-            // data should fit in the buffer
-            got = recv(_chip, _sock, buffer, _remaining);
-        } else {
-            // too much data for the buffer,
-            // grab as much as will fit
-            got = recv(_chip, _sock, buffer, len);
-        }
+    if (_remaining == 0) return -1;
 
-        if (got > 0) {
-            _remaining -= got;
-            return got;
-        }
-    }
+    // grab as much as will fit
+    uint16_t got = _remaining <= len ? _remaining : len;
+    _chip->read_data(_sock, _rxPtr, buffer, got);
+    _rxPtr += got;
+    _remaining -= got;
 
-    // If we get here, there's no data available or recv failed
-    return -1;
+    if (_remaining == 0) flush();
+    return got;
+}
+
+int EthernetUDP::receivePacket(uint8_t* buf, size_t len, IPAddress* from, uint16_t* port) {
+    if (parsePacket() <= 0) return 0;
+    if (from) *from = _remoteIP;
+    if (port) *port = _remotePort;
+
+    int got = read(buf, len);
+    flush();
+    return got > 0 ? got : 0;
+}
+
+int EthernetUDP::readInto(SocketReadVisitor visitor, void* ctx, size_t maxLen) {
+    if (_remaining == 0) return -1;
+    if (maxLen > _remaining) maxLen = _remaining;
+    uint16_t got = visitData(_chip, _sock, _rxPtr, maxLen, visitor, ctx);
+    _rxPtr += got;
+    _remaining -= got;
+
+    if (_remaining == 0) flush();
+    return got;
 }
 
 int EthernetUDP::peek() {
     uint8_t b;
-    // Unlike recv, peek doesn't check to see if there's any data available, so we must.
     // If the user hasn't called parsePacket yet then return nothing otherwise they
     // may get the UDP header
     if (!_remaining) return -1;
-    ::peek(_chip, _sock, &b);
+    _chip->read_data(_sock, _rxPtr, &b, 1);
     return b;
 }
 
 void EthernetUDP::flush() {
-    // could this fail (loop endlessly) if _remaining > 0 and recv in read fails?
-    // should only occur if recv fails after telling us the data is there, lets
-    // hope the w5500 always behaves :)
+    if (!_rxOpen) return;
 
-    while (_remaining) {
-        read();
-    }
+    // Skip whatever is left unread and hand the whole packet back in one RECV
+    endRecvUDP(_chip, _sock, _rxPtr + _remaining);
+    _remaining = 0;
+    _rxOpen = false;
 }
 
 uint8_t EthernetUDP::beginMulticast(IPAddress multicast_ip, uint16_t port) {
+    return beginMulticast(multicast_ip, port, MulticastOpt::IGMP_V2);
+}
+
+uint8_t EthernetUDP::beginMulticast(IPAddress multicast_ip, uint16_t port, uint8_t options) {
     if (!isMulticastGroup(multicast_ip)) {
         return 0;  // Invalid multicast IP
     }
@@ -194,57 +240,59 @@ uint8_t EthernetUDP::beginMulticast(IPAddress multicast_ip, uint16_t port) {
     }
 
     // Find available socket
-    _sock = MAX_SOCK_NUM;
-    uint8_t max_sock = 8;  // Assuming W5500 supports 8 sockets
-    for (uint8_t i = 0; i < max_sock; i++) {
-        uint8_t s = _chip->readSnSR(i);
-        if (s == SnSR::CLOSED || s == SnSR::FIN_WAIT) {
-            _sock = i;
-            break;
-        }
-    }
-
-    if (_sock == max_sock) {
+    _sock = _ethernet->allocSocket(_owner);
+    if (_sock == MAX_SOCK_NUM) {
         return 0;  // No sockets available
     }
+    _generation = _ethernet->socketGeneration(_sock);
 
-    // Configure socket for UDP multicast using existing MULTI flag
-    uint8_t result = socket(_chip, _sock, SnMR::UDP | SnMR::MULTI, port, 0);
-    if (result) {
-        configureMulticastSocket(multicast_ip, port);
+    // The chip joins the group as the socket opens
+    if (socketMulticast(_chip, _sock, rawIPAddress(multicast_ip), port, options)) {
+        _group = multicast_ip;
+        _mcastOptions = options;
+        _groupDestChanged = false;
         _port = port;
         _remaining = 0;
+        _rxOpen = false;
         return 1;
     }
 
+    close(_chip, _sock);
+    _ethernet->freeSocket(_sock, _generation);
+    _sock = MAX_SOCK_NUM;
     return 0;
 }
 
 int EthernetUDP::joinMulticastGroup(IPAddress group_ip) {
-    if (!isMulticastGroup(group_ip)) {
-        return 0;  // Invalid multicast IP
+    if (!isMulticastGroup(group_ip) || _sock == MAX_SOCK_NUM) {
+        return 0;
+    }
+    if (group_ip == _group) {
+        return 1;  // Already a member
     }
 
-    // Calculate multicast MAC address
-    uint8_t multicast_mac[6];
-    calculateMulticastMAC(group_ip, multicast_mac);
-
-    // Note: W5500 doesn't have native IGMP support
-    // The socket configuration with MULTI flag handles basic multicast reception
-    // For full IGMP support, router configuration may be required
+    // One group per socket: leave the current one and reopen on the new group
+    flush();
+    closeSocket();
+    if (socketMulticast(_chip, _sock, rawIPAddress(group_ip), _port, _mcastOptions)) {
+        _group = group_ip;
+        _groupDestChanged = false;
+        return 1;
+    }
 
-    return 1;  // Indicate success for basic multicast setup
+    // Keep the socket usable for unicast
+    socket(_chip, _sock, SnMR::UDP, _port, 0);
+    return 0;
 }
 
 int EthernetUDP::leaveMulticastGroup(IPAddress group_ip) {
-    if (!isMulticastGroup(group_ip)) {
-        return 0;  // Invalid multicast IP
+    if (_sock == MAX_SOCK_NUM || !isMulticastGroup(group_ip) || group_ip != _group) {
+        return 0;  // Not a member
     }
 
-    // For W5500, leaving a group typically means closing the socket
-    // or reconfiguring it without multicast
-    // This is a simplified implementation
-
+    flush();
+    closeSocket();
+    socket(_chip, _sock, SnMR::UDP, _port, 0);
     return 1;
 }
 
@@ -254,28 +302,14 @@ bool EthernetUDP::isMulticastGroup(IPAddress ip) {
     return (ip[0] >= 224 && ip[0] <= 239);
 }
 
-// Private methods for multicast support
-
-void EthernetUDP::calculateMulticastMAC(IPAddress ip, uint8_t* mac) {
-    // Multicast MAC format: 01:00:5e:XX:XX:XX
-    // XX:XX:XX from lower 23 bits of multicast IP address
-    mac[0] = 0x01;
-    mac[1] = 0x00;
-    mac[2] = 0x5e;
-    mac[3] = ip[1] & 0x7F;  // Clear upper bit to fit in 23-bit range
-    mac[4] = ip[2];
-    mac[5] = ip[3];
+void EthernetUDP::closeSocket() {
+    if (_group != IPAddress(0, 0, 0, 0)) {
+        closeMulticast(_chip, _sock, rawIPAddress(_group), _port);
+        _group = IPAddress(0, 0, 0, 0);
+    } else {
+        close(_chip, _sock);
+    }
+    _groupDestChanged = false;
+    _remaining = 0;
+    _rxOpen = false;
 }
-
-void EthernetUDP::configureMulticastSocket(IPAddress group_ip, uint16_t port) {
-    // W5500 multicast configuration
-    // The MULTI flag in socket mode register enables multicast reception
-    // Additional configuration could be added here for specific multicast features
-
-    // Calculate multicast MAC for reference (though W5500 handles this internally)
-    uint8_t multicast_mac[6];
-    calculateMulticastMAC(group_ip, multicast_mac);
-
-    // Socket is already configured with SnMR::MULTI flag in beginMulticast()
-    // The W5500 hardware will handle multicast packet filtering
-}
\ No newline at end of file
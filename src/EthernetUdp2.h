@@ -36,12 +36,26 @@
 
 // #include "Dns.h"
 #include "Ethernet3.h"
+#include "EthernetSockets.h"
 #include "chips/EthernetChip.h"
 #include "chips/utility/socket.h"
 
 class DNSClient;      // Forward declaration to avoid circular dependency
 class EthernetClass;  // Forward declaration to avoid circular dependency
 
+/**
+ * @brief Options for EthernetUDP::beginMulticast() and EthernetMulticast::join()
+ *
+ * Sn_MR bits of a multicast UDP socket; combine with |. The blocking options are W5500 only.
+ */
+class MulticastOpt {
+   public:
+    static const uint8_t IGMP_V2 = 0x00;                  ///< Join and leave with IGMPv2 (default)
+    static const uint8_t IGMP_V1 = SnMR::MC;              ///< Join with IGMPv1 reports
+    static const uint8_t BLOCK_BROADCAST = SnMR::BCASTB;  ///< Drop broadcast datagrams
+    static const uint8_t BLOCK_UNICAST = SnMR::UCASTB;    ///< Drop unicast datagrams
+};
+
 /**
  * @brief UDP communication class for sending and receiving UDP packets
  * 
@@ -62,15 +76,22 @@ class EthernetClass;  // Forward declaration to avoid circular dependency
  * - Supports enhanced buffering mechanisms
  */
 class EthernetUDP : public UDP {
-   private:
+   protected:
     EthernetClass* _ethernet;  ///< Pointer to the Ethernet class instance
     EthernetChip* _chip;       ///< Pointer to the Ethernet chip interface
     uint8_t _sock;             ///< Socket ID for the UDP connection
+    uint8_t _generation;       ///< Allocation generation of _sock when it was allocated
     uint16_t _port;            ///< Local port to listen on
     IPAddress _remoteIP;       ///< Remote IP address for the current incoming packet
     uint16_t _remotePort;      ///< Remote port for the current incoming packet
     uint16_t _offset;          ///< Offset into the packet being sent
     uint16_t _remaining;       ///< Remaining bytes of incoming packet yet to be processed
+    uint16_t _rxPtr;           ///< RX memory pointer of the next unread byte of that packet
+    bool _rxOpen;              ///< An incoming packet is open and not yet released to the chip
+    uint8_t _owner;            ///< SockOwner kind recorded when the socket is allocated
+    IPAddress _group;          ///< Multicast group the socket is a member of, 0.0.0.0 if none
+    uint8_t _mcastOptions;     ///< MulticastOpt bits the socket was opened with
+    bool _groupDestChanged;    ///< A send to another peer overwrote the group destination
 
    public:
     /**
@@ -101,6 +122,15 @@ class EthernetUDP : public UDP {
      */
     virtual void stop();
 
+    /**
+     * @brief Set the owner kind this instance allocates its socket as
+     * @param owner SockOwner kind (default SockOwner::UDP)
+     *
+     * Used by DNS and DHCP so that EthernetClass::reserveSockets() can keep
+     * sockets for them. Takes effect on the next begin().
+     */
+    void setSocketOwner(uint8_t owner) { _owner = owner; }
+
     // ===== Sending UDP packets =====
 
     /**
@@ -158,6 +188,44 @@ class EthernetUDP : public UDP {
      */
     virtual size_t write(const uint8_t* buffer, size_t size);
 
+    /**
+     * @brief Add data produced straight into chip TX memory to the current packet
+     * @param producer Called to fill successive chunks; returning less than
+     *        asked ends the stream
+     * @param ctx Passed through to the producer
+     * @param maxLen Maximum number of bytes to add
+     * @return Number of bytes added to the packet
+     *
+     * Must be called between beginPacket() and endPacket(), and can be mixed
+     * with write().
+     */
+    size_t writeFrom(SocketWriteProducer producer, void* ctx, size_t maxLen = 0xFFFF);
+
+    /**
+     * @brief Send several datagrams in one pipelined batch
+     * @param msgs Datagrams to send, each with its own destination
+     * @param count Number of datagrams
+     * @return Number of datagrams sent
+     *
+     * Each datagram is copied into chip memory while the previous one is being
+     * transmitted, and the destination registers are only rewritten when the
+     * destination changes. On return every message's status is 1 (sent), 0
+     * (timed out) or -1 (rejected: bad destination, empty, or too large).
+     * Must not be called between beginPacket() and endPacket().
+     */
+    virtual size_t sendBatch(UDPMessage* msgs, size_t count);
+
+    /**
+     * @brief Fill in a batch entry
+     * @param msg Entry to fill
+     * @param ip Destination IP address
+     * @param port Destination port number
+     * @param buf Payload; must stay valid until sendBatch() returns
+     * @param len Payload length
+     */
+    static void setMessage(UDPMessage& msg, IPAddress ip, uint16_t port, const uint8_t* buf,
+                           uint16_t len);
+
     /**
      * @brief Inherit write functions from Print class
      */
@@ -173,6 +241,10 @@ class EthernetUDP : public UDP {
      * packet for reading. Returns the size of the packet, which can then
      * be read using read() methods. Must be called before attempting to
      * read packet data.
+     *
+     * The 8-byte packet header is read in one burst and the packet stays in
+     * chip memory; reads walk a local pointer through it and the packet is
+     * released with a single RECV once it has been read or flushed.
      */
     virtual int parsePacket();
     
@@ -216,6 +288,31 @@ class EthernetUDP : public UDP {
      * Equivalent to read((unsigned char*)buffer, len).
      */
     virtual int read(char* buffer, size_t len) { return read((unsigned char*)buffer, len); };
+
+    /**
+     * @brief Receive one whole packet into a buffer
+     * @param buf Buffer for the packet data
+     * @param len Size of buf; a longer packet is truncated and the rest discarded
+     * @param from If not null, receives the sender's IP address
+     * @param port If not null, receives the sender's port
+     * @return Number of bytes stored in buf, or 0 if no packet was waiting
+     *
+     * Equivalent to parsePacket() + read() + flush().
+     */
+    int receivePacket(uint8_t* buf, size_t len, IPAddress* from = nullptr,
+                      uint16_t* port = nullptr);
+
+    /**
+     * @brief Stream the current packet's data to a visitor without an intermediate buffer
+     * @param visitor Called with successive chunks of packet data; returns how
+     *        many bytes of each chunk it consumed
+     * @param ctx Passed through to the visitor
+     * @param maxLen Maximum number of bytes to visit
+     * @return Number of bytes consumed, or -1 if no packet data is available
+     *
+     * Never reads past the end of the current packet.
+     */
+    int readInto(SocketReadVisitor visitor, void* ctx, size_t maxLen = 0xFFFF);
     
     /**
      * @brief Peek at the next byte without removing it
@@ -231,7 +328,8 @@ class EthernetUDP : public UDP {
      * 
      * Discards any remaining data in the current incoming packet and
      * prepares for the next packet. Call this when you're done reading
-     * a packet to clean up the receive state.
+     * a packet to clean up the receive state. Unread data is skipped by
+     * moving the read pointer, not by reading it.
      */
     virtual void flush();
 
@@ -262,34 +360,51 @@ class EthernetUDP : public UDP {
      * @param multicast_ip Multicast group IP address (224.0.0.0/4 range)
      * @param port UDP port to listen on
      * @return 1 if successful, 0 if failed
-     * 
-     * Initializes the UDP socket for multicast communication and joins
-     * the specified multicast group. The IP address must be in the
-     * multicast range (224.0.0.0 to 239.255.255.255).
+     *
+     * Opens the socket as a member of the group: the group's MAC, address and
+     * port are programmed before the socket opens, so the chip filters
+     * incoming frames in hardware and sends the IGMPv2 join itself.
      */
     virtual uint8_t beginMulticast(IPAddress multicast_ip, uint16_t port);
 
+    /**
+     * @brief Begin UDP multicast with options
+     * @param multicast_ip Multicast group IP address
+     * @param port UDP port to listen on
+     * @param options MulticastOpt bits: IGMP version, broadcast/unicast blocking
+     * @return 1 if successful, 0 if failed
+     */
+    uint8_t beginMulticast(IPAddress multicast_ip, uint16_t port, uint8_t options);
+
     /**
      * @brief Join a multicast group
      * @param group_ip Multicast group IP address
      * @return 1 if successful, 0 if failed
-     * 
-     * Joins the specified multicast group, allowing reception of packets
-     * sent to that group. The socket must already be initialized with
-     * begin() or beginMulticast().
+     *
+     * The chip filters on one group per socket, so this moves the socket to
+     * group_ip: it leaves its current group (IGMP leave) and joins the new
+     * one on the same port. A socket opened with begin() becomes a multicast
+     * socket. To receive several groups at once use EthernetMulticast, which
+     * gives each group its own socket.
      */
     virtual int joinMulticastGroup(IPAddress group_ip);
 
     /**
      * @brief Leave a multicast group
      * @param group_ip Multicast group IP address
-     * @return 1 if successful, 0 if failed
-     * 
-     * Leaves the specified multicast group, stopping reception of packets
-     * sent to that group. Other multicast groups remain active.
+     * @return 1 if successful, 0 if the socket is not a member of group_ip
+     *
+     * Sends the IGMP leave and reopens the socket as a plain UDP socket on
+     * the same port.
      */
     virtual int leaveMulticastGroup(IPAddress group_ip);
 
+    /**
+     * @brief Multicast group the socket is a member of
+     * @return The group, or 0.0.0.0 if none
+     */
+    IPAddress multicastGroup() const { return _group; }
+
     /**
      * @brief Check if IP address is in multicast range
      * @param ip IP address to check
@@ -301,27 +416,14 @@ class EthernetUDP : public UDP {
     virtual bool isMulticastGroup(IPAddress ip);
 
    private:
-    /**
-     * @brief Calculate multicast MAC address from IP
-     * @param ip Multicast IP address
-     * @param mac Output buffer for MAC address (6 bytes)
-     * 
-     * Converts a multicast IP address to the corresponding multicast
-     * MAC address according to RFC 1112. The MAC address follows the
-     * pattern 01:00:5E:xx:xx:xx where xx:xx:xx are the lower 23 bits
-     * of the IP address.
-     */
-    void calculateMulticastMAC(IPAddress ip, uint8_t* mac);
+    /** @brief Close the socket, sending the IGMP leave if it is a multicast member */
+    void closeSocket();
 
     /**
-     * @brief Configure socket for multicast reception
-     * @param group_ip Multicast group IP address
-     * @param port UDP port
-     * 
-     * Internal function that configures the Ethernet chip's socket
-     * and MAC filter settings for multicast packet reception.
+     * @brief Forget a socket that was reclaimed since it was allocated
+     * @return true if the socket was dropped
      */
-    void configureMulticastSocket(IPAddress group_ip, uint16_t port);
+    bool released();
 };
 
 #endif
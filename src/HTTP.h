@@ -11,6 +11,9 @@
  * - HTTPClient for making HTTP requests (GET, POST, PUT, DELETE)
  * - HTTPServer for handling HTTP requests with routing
  * - HTTPRequest and HTTPResponse classes for message parsing
+ * - HTTPRequestParser, an allocation-free incremental request parser
+ * - HTTPResponseWriter for streaming responses, chunked when the length is unknown
+ * - Static files served from flash with ETag/304 and gzip (HTTPServer::serveAssets())
  * - Support for common HTTP headers and status codes
  * - URL parsing utilities
  * 
@@ -20,8 +23,11 @@
  */
 
 #include "HTTPConfig.h"
+#include "HTTPAsset.h"
+#include "HTTPParser.h"
 #include "HTTPRequest.h"
 #include "HTTPResponse.h"
+#include "HTTPResponseWriter.h"
 #include "HTTPClient.h"
 #include "HTTPServer.h"
 
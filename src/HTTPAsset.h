@@ -0,0 +1,40 @@
+#ifndef HTTPASSET_H
+#define HTTPASSET_H
+
+#include "Arduino.h"
+
+/*
+ * Static files served from flash
+ *
+ * A table of HTTPAsset entries, normally generated at build time by
+ * extras/embed_assets.py, describes files compiled into PROGMEM. The entries,
+ * and every string and body they point to, live in flash; HTTPServer copies
+ * one entry at a time to the stack while looking a path up and streams the
+ * body from flash into the chip's TX memory, so serving an asset uses no heap.
+ *
+ * headers holds the precomputed header lines of the entry ("Name: value\r\n"
+ * each: Content-Type, ETag, Cache-Control and, for compressed bodies,
+ * Content-Encoding and Vary). Content-Length and Connection are added by the
+ * server. etag is the quoted entity tag also found in headers; a request
+ * whose If-None-Match lists it is answered with 304 and no body.
+ *
+ * A path may have two entries, one plain and one HTTP_ASSET_GZIP; clients
+ * that accept gzip get the compressed one. A path with only a compressed
+ * entry is served compressed to every client.
+ *
+ * On AVR, near PROGMEM pointers reach the first 64 KB of flash only.
+ */
+
+// The body is gzip-encoded
+#define HTTP_ASSET_GZIP 0x01
+
+struct HTTPAsset {
+    const char* path;     // URL path, e.g. "/" or "/app.js"
+    const char* headers;  // Precomputed header lines
+    const char* etag;     // Quoted entity tag
+    const uint8_t* body;
+    uint32_t length;      // Bytes in body
+    uint8_t flags;        // HTTP_ASSET_*
+};
+
+#endif
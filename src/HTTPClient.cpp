@@ -1,31 +1,91 @@
 #include "HTTPClient.h"
 
+// exchange() failures
+static const int EXCHANGE_NOT_CONNECTED = -1;
+static const int EXCHANGE_SEND_FAILED = -2;
+static const int EXCHANGE_NO_RESPONSE = -3;
+static const int EXCHANGE_PARSE_ERROR = -4;
+
 HTTPClient::HTTPClient(EthernetClass* eth, EthernetChip* chip)
-    : _client(eth, chip), _userAgent("Arduino-Ethernet3/1.0"), _timeout(HTTP_DEFAULT_TIMEOUT) {}
+    : _client(eth, chip), _userAgent("Arduino-Ethernet3/1.0"), _timeout(HTTP_DEFAULT_TIMEOUT),
+      _port(0), _keepAlive(true), _inResponse(false), _served(0) {
+    _body.begin(&_response, &_client);
+    _body.setTimeout(_timeout);
+}
 
 void HTTPClient::setUserAgent(const String& userAgent) { _userAgent = userAgent; }
 
-void HTTPClient::setTimeout(unsigned long timeout) { _timeout = timeout; }
+void HTTPClient::setTimeout(unsigned long timeout) {
+    _timeout = timeout;
+    _body.setTimeout(timeout);
+}
+
+void HTTPClient::setKeepAlive(bool keepAlive) { _keepAlive = keepAlive; }
+
+bool HTTPClient::connect(const char* host, uint16_t port) {
+    if (_inResponse) endResponse();
+    if (connected() && _port == port && _host == host) return true;
+
+    _client.stop();
+    _host = host;
+    _ip = IPAddress(0, 0, 0, 0);
+    _port = port;
+    _served = 0;
+    return _client.connect(host, port);
+}
 
-bool HTTPClient::connect(const char* host, uint16_t port) { return _client.connect(host, port); }
+bool HTTPClient::connect(IPAddress ip, uint16_t port) {
+    if (_inResponse) endResponse();
+    if (connected() && _port == port && _host.length() == 0 && _ip == ip) return true;
 
-bool HTTPClient::connect(IPAddress ip, uint16_t port) { return _client.connect(ip, port); }
+    _client.stop();
+    _host = "";
+    _ip = ip;
+    _port = port;
+    _served = 0;
+    return _client.connect(ip, port);
+}
 
-void HTTPClient::disconnect() { _client.stop(); }
+void HTTPClient::disconnect() {
+    _client.stop();
+    _port = 0;
+    _inResponse = false;
+    _served = 0;
+}
 
 bool HTTPClient::connected() { return _client.connected(); }
 
+// Open a new connection to the last target
+bool HTTPClient::reconnect() {
+    _client.stop();
+    _served = 0;
+    if (_port == 0) return false;
+    if (_host.length() > 0) return _client.connect(_host.c_str(), _port);
+    return _client.connect(_ip, _port);
+}
+
+void HTTPClient::addDefaultHeaders(HTTPRequest& request) {
+    if (_port != 0) {
+        String host = _host;
+        if (host.length() == 0) {
+            host = String(_ip[0]) + "." + String(_ip[1]) + "." + String(_ip[2]) + "." + String(_ip[3]);
+        }
+        if (_port != 80) host += ":" + String(_port);
+        request.addHeader("Host", host);
+    }
+    request.addHeader(HTTP_HEADER_USER_AGENT, _userAgent);
+    if (!_keepAlive) request.addHeader(HTTP_HEADER_CONNECTION, "close");
+}
+
 HTTPResponse HTTPClient::GET(const String& path) {
     HTTPRequest request = HTTPRequest::GET(path);
-    request.addHeader("User-Agent", _userAgent);
-    request.addHeader("Connection", "close");
+    addDefaultHeaders(request);
     return sendRequest(request);
 }
 
 HTTPResponse HTTPClient::POST(const String& path, const String& body, const String& contentType) {
     HTTPRequest request = HTTPRequest::POST(path, body);
-    request.addHeader("User-Agent", _userAgent);
-    request.addHeader("Connection", "close");
+    addDefaultHeaders(request);
     if (body.length() > 0) {
         request.addHeader("Content-Type", contentType);
     }
@@ -34,8 +94,7 @@ HTTPResponse HTTPClient::POST(const String& path, const String& body, const Stri
 
 HTTPResponse HTTPClient::PUT(const String& path, const String& body, const String& contentType) {
     HTTPRequest request = HTTPRequest::PUT(path, body);
-    request.addHeader("User-Agent", _userAgent);
-    request.addHeader("Connection", "close");
+    addDefaultHeaders(request);
     if (body.length() > 0) {
         request.addHeader("Content-Type", contentType);
     }
@@ -44,23 +103,95 @@ HTTPResponse HTTPClient::PUT(const String& path, const String& body, const Strin
 
 HTTPResponse HTTPClient::DELETE(const String& path) {
     HTTPRequest request = HTTPRequest::DELETE(path);
-    request.addHeader("User-Agent", _userAgent);
-    request.addHeader("Connection", "close");
+    addDefaultHeaders(request);
     return sendRequest(request);
 }
 
 HTTPResponse HTTPClient::sendRequest(const HTTPRequest& request) {
-    if (!connected()) {
-        return HTTPResponse(0, "Not Connected");
+    int result = exchange(request);
+
+    switch (result) {
+        case EXCHANGE_NOT_CONNECTED:
+            return HTTPResponse(0, "Not Connected");
+        case EXCHANGE_SEND_FAILED:
+            return HTTPResponse(0, "Send Failed");
+        case EXCHANGE_NO_RESPONSE:
+            return HTTPResponse(0, "No Response");
+        case EXCHANGE_PARSE_ERROR:
+            return HTTPResponse(0, "Parse Error");
     }
+    return collectResponse();
+}
 
+int HTTPClient::startRequest(const HTTPRequest& request) {
+    int result = exchange(request);
+    return result > 0 ? result : 0;
+}
+
+void HTTPClient::endResponse() {
+    if (!_inResponse) return;
+    _inResponse = false;
+
+    // Drain the body so the next response starts at its status line
+    uint8_t scratch[32];
+    unsigned long last = millis();
+    while (_response.state() == HTTPResponseParser::BODY) {
+        if (_response.readBody(&_client, scratch, sizeof(scratch)) > 0) {
+            last = millis();
+        } else if (millis() - last >= _timeout) {
+            break;
+        } else {
+            delay(1);
+        }
+    }
+
+    if (!_response.complete() || !_response.keepAlive() || !_keepAlive) {
+        _client.stop();
+        _served = 0;
+    }
+}
+
+// Methods a server may see twice without harm (RFC 9110 9.2.2)
+static bool idempotent(const String& method) {
+    return method == "GET" || method == "HEAD" || method == "OPTIONS" || method == "PUT" ||
+           method == "DELETE";
+}
+
+// Send a request and read the response headers. Returns the status code, or
+// one of the EXCHANGE_* failures.
+int HTTPClient::exchange(const HTTPRequest& request) {
+    if (_inResponse) endResponse();
+
+    String method = request.getMethod();
     String requestString = request.toString();
+    bool noBody = method == "HEAD";
+    // Only an idempotent request may be resent: a POST the server received
+    // before closing could otherwise be applied twice
+    bool reused = _served > 0 && connected() && idempotent(method);
+    if (!connected() && !reconnect()) return EXCHANGE_NOT_CONNECTED;
+
+    for (;;) {
+        _response.reset(noBody);
+        bool sent = sendRawRequest(requestString);
+        if (sent && readHeaders()) break;
+
+        // The server may have closed a reused connection while we were idle;
+        // try once more on a fresh one
+        if (reused && _response.idle()) {
+            reused = false;
+            if (reconnect()) continue;
+            return EXCHANGE_NOT_CONNECTED;
+        }
 
-    if (!sendRawRequest(requestString)) {
-        return HTTPResponse(0, "Send Failed");
+        _client.stop();
+        _served = 0;
+        if (!sent) return EXCHANGE_SEND_FAILED;
+        return _response.idle() ? EXCHANGE_NO_RESPONSE : EXCHANGE_PARSE_ERROR;
     }
 
-    return readResponseObject();
+    _served++;
+    _inResponse = true;
+    return _response.statusCode();
 }
 
 bool HTTPClient::sendRawRequest(const String& requestString) {
@@ -72,47 +203,74 @@ bool HTTPClient::sendRawRequest(const String& requestString) {
     return written == requestString.length();
 }
 
-HTTPResponse HTTPClient::readResponseObject() {
-    String responseString = readResponse();
-    HTTPResponse response;
-
-    if (responseString.length() == 0) {
-        return HTTPResponse(0, "No Response");
+// Wait for the status line and headers; the timeout restarts with each read
+bool HTTPClient::readHeaders() {
+    unsigned long last = millis();
+    while (!_response.headersComplete() && !_response.failed()) {
+        if (_response.readFrom(_client) > 0) {
+            last = millis();
+        } else if (!_client.connected() || millis() - last >= _timeout) {
+            return false;
+        } else {
+            delay(1);
+        }
     }
+    return _response.headersComplete();
+}
 
-    if (!response.parseFromString(responseString)) {
-        return HTTPResponse(0, "Parse Error");
+HTTPResponse HTTPClient::readResponseObject() {
+    if (_inResponse) endResponse();
+
+    _response.reset();
+    if (!readHeaders()) {
+        bool idle = _response.idle();
+        _client.stop();
+        _served = 0;
+        return HTTPResponse(0, idle ? "No Response" : "Parse Error");
     }
 
-    return response;
+    _served++;
+    _inResponse = true;
+    return collectResponse();
 }
 
-String HTTPClient::readResponse() {
-    String response = "";
-    unsigned long startTime = millis();
-
-    // Wait for response to start arriving
-    while (!_client.available() && (millis() - startTime) < _timeout) {
-        delay(1);
-    }
-
-    if (!_client.available()) {
-        return "";  // Timeout
+// Build an HTTPResponse from the parsed headers, reading the body into it
+HTTPResponse HTTPClient::collectResponse() {
+    HTTPResponse response(_response.statusCode(), _response.reason());
+    response.setProtocol(_response.version());
+    for (uint8_t i = 0; i < _response.headerCount(); i++) {
+        // The body is returned decoded, framed by the Content-Length setBody() adds
+        if (_response.chunked() && strcasecmp(_response.headerName(i), "Transfer-Encoding") == 0) {
+            continue;
+        }
+        response.addHeader(_response.headerName(i), _response.headerValue(i));
     }
 
-    // Read response
-    while (_client.available() || (millis() - startTime) < _timeout) {
-        if (_client.available()) {
-            char c = _client.read();
-            response += c;
-
-            // Reset timeout on each character received
-            startTime = millis();
+    // Content-Length tells how much to reserve up front
+    uint32_t length = _response.hasContentLength() ? _response.contentLength() : 0;
+    if (length > HTTP_MAX_BODY_SIZE) length = HTTP_MAX_BODY_SIZE;
+    String body;
+    body.reserve(length);
+
+    char chunk[32];
+    unsigned long last = millis();
+    while (_response.state() == HTTPResponseParser::BODY && body.length() < HTTP_MAX_BODY_SIZE) {
+        size_t want = HTTP_MAX_BODY_SIZE - body.length();
+        if (want > sizeof(chunk)) want = sizeof(chunk);
+        int n = _response.readBody(&_client, (uint8_t*)chunk, want);
+        if (n > 0) {
+            body.concat(chunk, n);
+            last = millis();
+        } else if (millis() - last >= _timeout) {
+            break;
         } else {
             delay(1);
         }
     }
+    response.setBody(body);
 
+    // Anything past HTTP_MAX_BODY_SIZE is dropped
+    endResponse();
     return response;
 }
 
@@ -176,6 +334,7 @@ HTTPResponse HTTPClient::request(const String& method, const String& url, const
         return HTTPResponse(0, "Protocol Not Supported");
     }
 
+    // An open connection to the same host is reused
     if (!connect(host.c_str(), port)) {
         return HTTPResponse(0, "Connection Failed");
     }
@@ -192,14 +351,13 @@ HTTPResponse HTTPClient::request(const String& method, const String& url, const
         response = DELETE(path);
     } else {
         HTTPRequest request(method, path);
-        request.addHeader("User-Agent", _userAgent);
-        request.addHeader("Connection", "close");
+        addDefaultHeaders(request);
         if (body.length() > 0) {
             request.setBody(body);
+            request.addHeader("Content-Length", String(body.length()));
         }
         response = sendRequest(request);
     }
 
-    disconnect();
     return response;
 }
\ No newline at end of file
@@ -6,25 +6,58 @@
 #include "HTTPRequest.h"
 #include "HTTPResponse.h"
 #include "HTTPConfig.h"
+#include "HTTPParser.h"
 #include "IPAddress.h"
 
+/*
+ * HTTP/1.1 client
+ *
+ * Responses are parsed as they arrive and end exactly at the end of their
+ * body (Content-Length or chunked), without waiting for a timeout. The
+ * connection is kept open when the server allows it and reused by the next
+ * request to the same host; it is reopened transparently if the server has
+ * closed it in the meantime. If the server closes a reused connection after
+ * the request was sent but before any response byte arrives, the request is
+ * resent once on a new connection only if its method is idempotent (GET,
+ * HEAD, OPTIONS, PUT, DELETE); a POST or PATCH fails with "No Response"
+ * instead, since the server may have acted on it.
+ *
+ * GET()/POST()/... return the whole response with the body in a String (up
+ * to HTTP_MAX_BODY_SIZE bytes). For larger bodies use startRequest() and
+ * read responseBody() as a Stream.
+ */
 class HTTPClient {
 private:
     EthernetClient _client;
     String _userAgent;
     unsigned long _timeout;
-    
-    // Helper method to read response from client
-    String readResponse();
-    
+    HTTPResponseParser _response;
+    HTTPResponseBody _body;
+    String _host;          // Target of the last connect(); "" for an IP
+    IPAddress _ip;
+    uint16_t _port;
+    bool _keepAlive;       // Ask for persistent connections
+    bool _inResponse;      // A response is being read through startRequest()
+    uint8_t _served;       // Responses read on the current connection
+
+    bool reconnect();
+    void addDefaultHeaders(HTTPRequest& request);
+    int exchange(const HTTPRequest& request);
+    bool readHeaders();
+    HTTPResponse collectResponse();
+
 public:
     HTTPClient(EthernetClass* eth, EthernetChip* chip);
     
     // Configuration
     void setUserAgent(const String& userAgent);
-    void setTimeout(unsigned long timeout);
-    
-    // Connection management
+    void setTimeout(unsigned long timeout);  // Longest wait for more data, in ms
+
+    // Ask servers to keep connections open between requests (the default)
+    void setKeepAlive(bool keepAlive);
+
+    // Connection management. Connecting to the host and port the client is
+    // already connected to keeps the open connection.
     bool connect(const char* host, uint16_t port = 80);
     bool connect(IPAddress ip, uint16_t port = 80);
     void disconnect();
@@ -38,6 +71,17 @@ public:
     
     // Generic request method
     HTTPResponse sendRequest(const HTTPRequest& request);
+
+    // Streaming: send a request and read the response's status line and
+    // headers. Returns the status code, 0 on failure. Then read the body from
+    // responseBody() and call endResponse() before the next request.
+    int startRequest(const HTTPRequest& request);
+    const HTTPResponseParser& responseHeaders() const { return _response; }
+    HTTPResponseBody& responseBody() { return _body; }
+
+    // Skip what is left of the body and close the connection unless it can
+    // be reused
+    void endResponse();
     
     // Low-level methods for custom requests
     bool sendRawRequest(const String& requestString);
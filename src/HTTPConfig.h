@@ -28,16 +28,50 @@
 #define HTTP_DEFAULT_TIMEOUT 5000
 #endif
 
-// Maximum routes for HTTP server
+// Maximum routes registered with HTTPServer::on() (held in RAM; tables given to
+// HTTPServer::setRouteTable() stay in flash and are not limited)
 #ifndef HTTP_MAX_ROUTES
 #define HTTP_MAX_ROUTES 8
 #endif
 
+// Path parameters (":name" and "*" route segments) captured per request
+#ifndef HTTP_MAX_PARAMS
+#define HTTP_MAX_PARAMS 4
+#endif
+
 // Buffer size for reading HTTP requests
 #ifndef HTTP_REQUEST_BUFFER_SIZE
 #define HTTP_REQUEST_BUFFER_SIZE 512
 #endif
 
+// Buffer HTTPClient reads a response's status line and headers into
+#ifndef HTTP_CLIENT_BUFFER_SIZE
+#define HTTP_CLIENT_BUFFER_SIZE 512
+#endif
+
+// Buffer for streaming responses; also the largest chunk sent (16 to 4096)
+#ifndef HTTP_RESPONSE_BUFFER_SIZE
+#define HTTP_RESPONSE_BUFFER_SIZE 128
+#endif
+#if HTTP_RESPONSE_BUFFER_SIZE < 16 || HTTP_RESPONSE_BUFFER_SIZE > 4096
+#error "HTTP_RESPONSE_BUFFER_SIZE must be between 16 and 4096"
+#endif
+
+// Connections HTTPServer tracks at once; each holds a request buffer
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 2
+#endif
+
+// Idle time in milliseconds before a persistent connection is closed
+#ifndef HTTP_KEEPALIVE_TIMEOUT
+#define HTTP_KEEPALIVE_TIMEOUT 5000
+#endif
+
+// Requests served on one persistent connection before it is closed
+#ifndef HTTP_KEEPALIVE_MAX_REQUESTS
+#define HTTP_KEEPALIVE_MAX_REQUESTS 16
+#endif
+
 // Common HTTP strings (stored in PROGMEM to save RAM)
 #define HTTP_VERSION_1_1 "HTTP/1.1"
 #define HTTP_METHOD_GET "GET"
@@ -0,0 +1,655 @@
+#include "HTTPParser.h"
+
+HTTPRequestParser::HTTPRequestParser() { reset(); }
+
+void HTTPRequestParser::reset() {
+    _len = 0;
+    _scan = 0;
+    _line = 0;
+    _method = 0;
+    _path = 0;
+    _query = 0;
+    _version = 0;
+    _headerCount = 0;
+    _state = REQUEST_LINE;
+    _error = 0;
+    _contentLength = 0;
+    _haveLength = false;
+    _connection = 0;
+    _bodyPos = 0;
+    _bodyLeft = 0;
+    _buf[0] = '\0';
+}
+
+bool HTTPRequestParser::next() {
+    if (_state != BODY || _bodyLeft > 0) return false;
+
+    uint16_t start = _bodyPos;
+    uint16_t keep = _len - start;
+    reset();
+    memmove(_buf, _buf + start, keep);
+    _len = keep;
+    parse();
+    return true;
+}
+
+int HTTPRequestParser::readFrom(Client& client) {
+    if (_state >= BODY) return 0;
+
+    int n = client.available();
+    if (n <= 0) return 0;
+
+    uint16_t room = HTTP_REQUEST_BUFFER_SIZE - _len;
+    if ((uint16_t)n > room) n = room;
+
+    // One bulk read straight into the buffer
+    n = client.read((uint8_t*)_buf + _len, n);
+    if (n <= 0) return 0;
+
+    _len += n;
+    parse();
+    return n;
+}
+
+size_t HTTPRequestParser::feed(const uint8_t* data, size_t len) {
+    if (_state >= BODY) return 0;
+
+    size_t room = HTTP_REQUEST_BUFFER_SIZE - _len;
+    if (len > room) len = room;
+
+    memcpy(_buf + _len, data, len);
+    _len += len;
+    parse();
+    return len;
+}
+
+const char* HTTPRequestParser::header(const char* name) const {
+    for (uint8_t i = 0; i < _headerCount; i++) {
+        if (strcasecmp(_buf + _hname[i], name) == 0) return _buf + _hvalue[i];
+    }
+    return nullptr;
+}
+
+bool HTTPRequestParser::keepAlive() const {
+    if (_connection & CONNECTION_CLOSE) return false;
+    if (strcmp(version(), "HTTP/1.0") == 0) return (_connection & CONNECTION_KEEP_ALIVE) != 0;
+    return true;
+}
+
+// Look for a token in a comma-separated header value
+static bool hasToken(const char* list, const char* token) {
+    size_t len = strlen(token);
+    while (*list) {
+        while (*list == ' ' || *list == '\t' || *list == ',') list++;
+        const char* end = list;
+        while (*end && *end != ',') end++;
+        const char* last = end;
+        while (last > list && (last[-1] == ' ' || last[-1] == '\t')) last--;
+        if ((size_t)(last - list) == len && strncasecmp(list, token, len) == 0) return true;
+        list = end;
+    }
+    return false;
+}
+
+void HTTPRequestParser::parse() {
+    while (_state < BODY && _scan < _len) {
+        if (_buf[_scan] != '\n') {
+            _scan++;
+            continue;
+        }
+
+        // Terminate the line in place, dropping the CR of a CRLF
+        _buf[_scan] = '\0';
+        if (_scan > _line && _buf[_scan - 1] == '\r') _buf[_scan - 1] = '\0';
+        char* line = _buf + _line;
+
+        if (_state == REQUEST_LINE) {
+            if (*line == '\0') {
+                // Stray CRLF before the request line (RFC 7230 3.5)
+                dropLine();
+                continue;
+            }
+            if (!parseRequestLine(line)) return;
+            _state = HEADERS;
+        } else if (*line == '\0') {
+            _bodyPos = _scan + 1;
+            _bodyLeft = _contentLength;
+            _state = BODY;
+            return;
+        } else {
+            uint8_t count = _headerCount;
+            if (!parseHeader(line)) return;
+            if (_headerCount == count) {
+                // No slot left for it; reclaim the space
+                dropLine();
+                continue;
+            }
+        }
+
+        _scan++;
+        _line = _scan;
+    }
+
+    if (_state < BODY && _len == HTTP_REQUEST_BUFFER_SIZE) {
+        fail(_state == REQUEST_LINE ? 414 : 431);
+    }
+}
+
+bool HTTPRequestParser::parseRequestLine(char* line) {
+    // method SP request-target SP HTTP-version
+    char* target = strchr(line, ' ');
+    if (target == nullptr || target == line) {
+        fail(400);
+        return false;
+    }
+    *target++ = '\0';
+
+    char* version = strchr(target, ' ');
+    if (version == nullptr || version == target) {
+        fail(400);
+        return false;
+    }
+    *version++ = '\0';
+    if (strncmp(version, "HTTP/", 5) != 0) {
+        fail(400);
+        return false;
+    }
+
+    _method = line - _buf;
+    _path = target - _buf;
+    _version = version - _buf;
+
+    // Point an absent query at the path's terminator so it reads as ""
+    char* query = strchr(target, '?');
+    if (query != nullptr) {
+        *query++ = '\0';
+        _query = query - _buf;
+    } else {
+        _query = version - 1 - _buf;
+    }
+    return true;
+}
+
+bool HTTPRequestParser::parseHeader(char* line) {
+    char* colon = strchr(line, ':');
+    if (colon == nullptr || colon == line) {
+        fail(400);
+        return false;
+    }
+    *colon = '\0';
+
+    char* value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+    char* end = value + strlen(value);
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+
+    if (strcasecmp(line, HTTP_HEADER_CONTENT_LENGTH) == 0) {
+        if (*value == '\0') {
+            fail(400);
+            return false;
+        }
+        uint32_t length = 0;
+        for (const char* p = value; *p; p++) {
+            if (*p < '0' || *p > '9' || length > 0x0FFFFFFFUL) {
+                fail(400);
+                return false;
+            }
+            length = length * 10 + (*p - '0');
+        }
+        if (_haveLength && length != _contentLength) {
+            fail(400);
+            return false;
+        }
+        _contentLength = length;
+        _haveLength = true;
+    } else if (strcasecmp(line, HTTP_HEADER_CONNECTION) == 0) {
+        if (hasToken(value, "close")) _connection |= CONNECTION_CLOSE;
+        if (hasToken(value, "keep-alive")) _connection |= CONNECTION_KEEP_ALIVE;
+    } else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasecmp(value, "identity") != 0) {
+        // Chunked request bodies are not supported
+        fail(501);
+        return false;
+    }
+
+    if (_headerCount < HTTP_MAX_HEADERS) {
+        _hname[_headerCount] = line - _buf;
+        _hvalue[_headerCount] = value - _buf;
+        _headerCount++;
+    }
+    return true;
+}
+
+void HTTPRequestParser::dropLine() {
+    uint16_t next = _scan + 1;
+    memmove(_buf + _line, _buf + next, _len - next);
+    _len -= next - _line;
+    _scan = _line;
+}
+
+void HTTPRequestParser::fail(int status) {
+    _state = ERROR;
+    _error = status;
+}
+
+int HTTPBodyStream::available() {
+    if (_parser == nullptr || _parser->_bodyLeft == 0) return 0;
+
+    uint32_t n = _parser->_len - _parser->_bodyPos;
+    if (n == 0 && _client != nullptr) n = _client->available();
+    if (n > _parser->_bodyLeft) n = _parser->_bodyLeft;
+    if (n > 0x7FFF) n = 0x7FFF;
+    return n;
+}
+
+int HTTPBodyStream::read() {
+    if (_parser == nullptr || _parser->_bodyLeft == 0) return -1;
+
+    int c = -1;
+    if (_parser->_bodyPos < _parser->_len) {
+        c = (uint8_t)_parser->_buf[_parser->_bodyPos++];
+    } else if (_client != nullptr) {
+        c = _client->read();
+    }
+    if (c >= 0) _parser->_bodyLeft--;
+    return c;
+}
+
+int HTTPBodyStream::peek() {
+    if (_parser == nullptr || _parser->_bodyLeft == 0) return -1;
+
+    if (_parser->_bodyPos < _parser->_len) return (uint8_t)_parser->_buf[_parser->_bodyPos];
+    return _client != nullptr ? _client->peek() : -1;
+}
+
+int HTTPBodyStream::read(uint8_t* buf, size_t len) {
+    if (_parser == nullptr) return 0;
+    if (len > _parser->_bodyLeft) len = _parser->_bodyLeft;
+
+    // Body bytes that arrived with the headers come first
+    size_t n = _parser->_len - _parser->_bodyPos;
+    if (n > len) n = len;
+    memcpy(buf, _parser->_buf + _parser->_bodyPos, n);
+    _parser->_bodyPos += n;
+
+    if (n < len && _client != nullptr && _client->available() > 0) {
+        int got = _client->read(buf + n, len - n);
+        if (got > 0) n += got;
+    }
+
+    _parser->_bodyLeft -= n;
+    return n;
+}
+
+uint32_t HTTPBodyStream::skip() {
+    uint8_t scratch[32];
+    while (read(scratch, sizeof(scratch)) > 0) {
+    }
+    return remaining();
+}
+
+HTTPResponseParser::HTTPResponseParser() { reset(); }
+
+void HTTPResponseParser::reset(bool noBody) {
+    _len = 0;
+    _scan = 0;
+    _line = 0;
+    _version = 0;
+    _reason = 0;
+    _headerCount = 0;
+    _state = STATUS_LINE;
+    _status = 0;
+    _contentLength = 0;
+    _haveLength = false;
+    _noBody = noBody;
+    _skipLine = false;
+    _connection = 0;
+    _frame = FRAME_NONE;  // Set by Transfer-Encoding, otherwise by startBody()
+    _chunkState = CHUNK_SIZE;
+    _chunkDigits = 0;
+    _trailerLen = 0;
+    _bodyPos = 0;
+    _bodyLeft = 0;
+    _buf[0] = '\0';
+}
+
+int HTTPResponseParser::readFrom(Client& client) {
+    if (_state >= BODY) return 0;
+
+    int n = client.available();
+    if (n <= 0) return 0;
+
+    uint16_t room = HTTP_CLIENT_BUFFER_SIZE - _len;
+    if ((uint16_t)n > room) n = room;
+
+    // One bulk read straight into the buffer
+    n = client.read((uint8_t*)_buf + _len, n);
+    if (n <= 0) return 0;
+
+    _len += n;
+    parse();
+    return n;
+}
+
+size_t HTTPResponseParser::feed(const uint8_t* data, size_t len) {
+    if (_state >= BODY) return 0;
+
+    size_t room = HTTP_CLIENT_BUFFER_SIZE - _len;
+    if (len > room) len = room;
+
+    memcpy(_buf + _len, data, len);
+    _len += len;
+    parse();
+    return len;
+}
+
+const char* HTTPResponseParser::header(const char* name) const {
+    for (uint8_t i = 0; i < _headerCount; i++) {
+        if (strcasecmp(_buf + _hname[i], name) == 0) return _buf + _hvalue[i];
+    }
+    return nullptr;
+}
+
+bool HTTPResponseParser::keepAlive() const {
+    if (_frame == FRAME_CLOSE || (_connection & CONNECTION_CLOSE)) return false;
+    if (strcmp(version(), "HTTP/1.0") == 0) return (_connection & CONNECTION_KEEP_ALIVE) != 0;
+    return true;
+}
+
+void HTTPResponseParser::parse() {
+    while (_state < BODY && _scan < _len) {
+        if (_buf[_scan] != '\n') {
+            _scan++;
+            continue;
+        }
+
+        if (_skipLine) {
+            // End of a header line too long to keep
+            _skipLine = false;
+            dropLine();
+            continue;
+        }
+
+        // Terminate the line in place, dropping the CR of a CRLF
+        _buf[_scan] = '\0';
+        if (_scan > _line && _buf[_scan - 1] == '\r') _buf[_scan - 1] = '\0';
+        char* line = _buf + _line;
+
+        if (_state == STATUS_LINE) {
+            if (*line == '\0') {
+                dropLine();
+                continue;
+            }
+            if (!parseStatusLine(line)) return;
+            _state = HEADERS;
+        } else if (*line == '\0') {
+            _bodyPos = _scan + 1;
+            if (_status < 200 && _status != 101) {
+                // Interim response (100 Continue); the real one follows
+                uint16_t start = _bodyPos;
+                uint16_t keep = _len - start;
+                reset(_noBody);
+                memmove(_buf, _buf + start, keep);
+                _len = keep;
+                continue;
+            }
+            startBody();
+            return;
+        } else {
+            uint8_t count = _headerCount;
+            parseHeader(line);
+            if (_state == ERROR) return;
+            if (_headerCount == count) {
+                // Not kept; reclaim the space
+                dropLine();
+                continue;
+            }
+        }
+
+        _scan++;
+        _line = _scan;
+    }
+
+    if (_state < BODY && _len == HTTP_CLIENT_BUFFER_SIZE) makeRoom();
+}
+
+bool HTTPResponseParser::parseStatusLine(char* line) {
+    // HTTP-version SP status-code SP [reason-phrase]
+    char* code = strchr(line, ' ');
+    if (strncmp(line, "HTTP/", 5) != 0 || code == nullptr) {
+        _state = ERROR;
+        return false;
+    }
+    *code++ = '\0';
+
+    for (uint8_t i = 0; i < 3; i++) {
+        if (code[i] < '0' || code[i] > '9') {
+            _state = ERROR;
+            return false;
+        }
+    }
+    if (code[3] != ' ' && code[3] != '\0') {
+        _state = ERROR;
+        return false;
+    }
+
+    _status = (code[0] - '0') * 100 + (code[1] - '0') * 10 + (code[2] - '0');
+    _version = line - _buf;
+    _reason = (code[3] == ' ' ? code + 4 : code + 3) - _buf;
+    return true;
+}
+
+void HTTPResponseParser::parseHeader(char* line) {
+    char* colon = strchr(line, ':');
+    if (colon == nullptr || colon == line) return;  // Not a header; ignored
+    *colon = '\0';
+
+    char* value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+    char* end = value + strlen(value);
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+
+    if (strcasecmp(line, HTTP_HEADER_CONTENT_LENGTH) == 0) {
+        uint32_t length = 0;
+        for (const char* p = value; *p; p++) {
+            if (*p < '0' || *p > '9' || length > 0x0FFFFFFFUL) {
+                _state = ERROR;
+                return;
+            }
+            length = length * 10 + (*p - '0');
+        }
+        if (*value == '\0' || (_haveLength && length != _contentLength)) {
+            _state = ERROR;
+            return;
+        }
+        _contentLength = length;
+        _haveLength = true;
+    } else if (strcasecmp(line, HTTP_HEADER_CONNECTION) == 0) {
+        if (hasToken(value, "close")) _connection |= CONNECTION_CLOSE;
+        if (hasToken(value, "keep-alive")) _connection |= CONNECTION_KEEP_ALIVE;
+    } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+        // Overrides Content-Length; without chunked the body ends at close
+        _frame = hasToken(value, "chunked") ? FRAME_CHUNKED : FRAME_CLOSE;
+    }
+
+    if (_headerCount < HTTP_MAX_HEADERS) {
+        _hname[_headerCount] = line - _buf;
+        _hvalue[_headerCount] = value - _buf;
+        _headerCount++;
+    }
+}
+
+void HTTPResponseParser::startBody() {
+    if (_noBody || _status < 200 || _status == 204 || _status == 304) {
+        _frame = FRAME_NONE;
+    } else if (_frame == FRAME_NONE) {
+        _frame = _haveLength ? FRAME_LENGTH : FRAME_CLOSE;
+    }
+
+    _bodyLeft = _frame == FRAME_LENGTH ? _contentLength : 0;
+    bool empty = _frame == FRAME_NONE || (_frame == FRAME_LENGTH && _bodyLeft == 0);
+    _state = empty ? DONE : BODY;
+}
+
+// The buffer filled before the end of the headers: forget the oldest header
+// kept, or, with none left, the rest of the line being read
+void HTTPResponseParser::makeRoom() {
+    if (_state == STATUS_LINE) {
+        _state = ERROR;
+        return;
+    }
+
+    if (_headerCount > 0) {
+        uint16_t start = _hname[0];
+        uint16_t end = _headerCount > 1 ? _hname[1] : _line;
+        uint16_t shift = end - start;
+        memmove(_buf + start, _buf + end, _len - end);
+        for (uint8_t i = 1; i < _headerCount; i++) {
+            _hname[i - 1] = _hname[i] - shift;
+            _hvalue[i - 1] = _hvalue[i] - shift;
+        }
+        _headerCount--;
+        _len -= shift;
+        _scan -= shift;
+        _line -= shift;
+        return;
+    }
+
+    _skipLine = true;
+    _len = _line;
+    _scan = _line;
+}
+
+void HTTPResponseParser::dropLine() {
+    uint16_t next = _scan + 1;
+    memmove(_buf + _line, _buf + next, _len - next);
+    _len -= next - _line;
+    _scan = _line;
+}
+
+int HTTPResponseParser::readByte(Client* client) {
+    if (_bodyPos < _len) return (uint8_t)_buf[_bodyPos++];
+    if (client != nullptr && client->available() > 0) return client->read();
+    return -1;
+}
+
+int HTTPResponseParser::readRaw(Client* client, uint8_t* buf, size_t len) {
+    // Body bytes that arrived with the headers come first
+    size_t n = _len - _bodyPos;
+    if (n > len) n = len;
+    memcpy(buf, _buf + _bodyPos, n);
+    _bodyPos += n;
+
+    if (n < len && client != nullptr && client->available() > 0) {
+        int got = client->read(buf + n, len - n);
+        if (got > 0) n += got;
+    }
+    return n;
+}
+
+// Consume chunk framing up to the next chunk's data. True once there is
+// chunk data to read; false if more framing is still to arrive, or at the end
+// of the body.
+bool HTTPResponseParser::readChunkFraming(Client* client) {
+    for (;;) {
+        int c = readByte(client);
+        if (c < 0) return false;
+
+        if (_chunkState == CHUNK_SIZE || _chunkState == CHUNK_EXT) {
+            if (c == '\n') {
+                if (_chunkDigits == 0) {
+                    _state = ERROR;
+                    return false;
+                }
+                _chunkDigits = 0;
+                if (_bodyLeft == 0) {
+                    // Last chunk; trailer lines follow
+                    _chunkState = CHUNK_TRAILER;
+                    _trailerLen = 0;
+                    continue;
+                }
+                _chunkState = CHUNK_END;
+                return true;
+            }
+            if (_chunkState == CHUNK_EXT || c == '\r') continue;
+
+            int8_t digit = -1;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+
+            if (digit >= 0 && _chunkDigits < 8) {
+                _bodyLeft = (_bodyLeft << 4) | digit;
+                _chunkDigits++;
+            } else if (digit < 0 && _chunkDigits > 0 && (c == ';' || c == ' ' || c == '\t')) {
+                _chunkState = CHUNK_EXT;
+            } else {
+                _state = ERROR;
+                return false;
+            }
+        } else if (_chunkState == CHUNK_END) {
+            if (c == '\n') {
+                _chunkState = CHUNK_SIZE;
+            } else if (c != '\r') {
+                _state = ERROR;
+                return false;
+            }
+        } else if (c == '\n') {
+            if (_trailerLen == 0) {
+                _state = DONE;
+                return false;
+            }
+            _trailerLen = 0;
+        } else if (c != '\r') {
+            _trailerLen++;
+        }
+    }
+}
+
+int HTTPResponseParser::readBody(Client* client, uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && _state == BODY) {
+        if (_frame == FRAME_CHUNKED && _bodyLeft == 0 && !readChunkFraming(client)) break;
+
+        size_t want = len - n;
+        if (_frame != FRAME_CLOSE && want > _bodyLeft) want = _bodyLeft;
+        int got = readRaw(client, buf + n, want);
+        if (got <= 0) break;
+
+        n += got;
+        if (_frame != FRAME_CLOSE) {
+            _bodyLeft -= got;
+            if (_frame == FRAME_LENGTH && _bodyLeft == 0) _state = DONE;
+        }
+    }
+
+    // Nothing left to read and the server has closed: the body ends here
+    if (_state == BODY && _bodyPos == _len && client != nullptr && !client->connected()) {
+        _state = _frame == FRAME_CLOSE ? DONE : ERROR;
+    }
+    return n;
+}
+
+int HTTPResponseParser::bodyAvailable(Client* client) {
+    if (_state != BODY) return 0;
+    if (_frame == FRAME_CHUNKED && _bodyLeft == 0 && !readChunkFraming(client)) return 0;
+
+    uint32_t n = _len - _bodyPos;
+    if (n == 0 && client != nullptr) {
+        int pending = client->available();
+        n = pending > 0 ? pending : 0;
+    }
+    if (_frame != FRAME_CLOSE && n > _bodyLeft) n = _bodyLeft;
+    if (n > 0x7FFF) n = 0x7FFF;
+    return n;
+}
+
+int HTTPResponseParser::peekBody(Client* client) {
+    if (bodyAvailable(client) <= 0) return -1;
+    if (_bodyPos < _len) return (uint8_t)_buf[_bodyPos];
+    return client->peek();
+}
+
+int HTTPResponseBody::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
@@ -0,0 +1,301 @@
+#ifndef HTTPPARSER_H
+#define HTTPPARSER_H
+
+#include "Arduino.h"
+#include "Client.h"
+#include "HTTPConfig.h"
+
+/*
+ * Incremental HTTP/1.1 request parser
+ *
+ * Socket data is read in bulk straight into a fixed buffer of
+ * HTTP_REQUEST_BUFFER_SIZE bytes and parsed as it arrives. The request line
+ * and headers are split in place: method, path, query, version and each
+ * header name and value become NUL-terminated strings inside the buffer, so
+ * parsing allocates nothing. The body is not buffered; it is read through
+ * HTTPBodyStream, which first returns the body bytes that arrived with the
+ * headers and then reads the rest from the socket.
+ *
+ * Headers beyond HTTP_MAX_HEADERS are dropped (Content-Length and
+ * Transfer-Encoding are still honoured). A request whose request line and
+ * headers do not fit in the buffer is rejected with 431 (414 if the request
+ * line itself is too long).
+ */
+class HTTPRequestParser {
+public:
+    // Parser states
+    static const uint8_t REQUEST_LINE = 0;  // Waiting for the request line
+    static const uint8_t HEADERS = 1;       // Reading header lines
+    static const uint8_t BODY = 2;          // Headers complete; body (if any) is in the stream
+    static const uint8_t ERROR = 3;         // Malformed or oversized; see error()
+
+    HTTPRequestParser();
+
+    // Forget the current request
+    void reset();
+
+    // Move on to the next request on a persistent connection, keeping any
+    // pipelined bytes that followed the body. False if the body is unread.
+    bool next();
+
+    // Read whatever the client has buffered (one bulk read) and parse it.
+    // Does nothing once the headers are complete. Returns the bytes read.
+    int readFrom(Client& client);
+
+    // Parse bytes from another source; returns how many were taken
+    size_t feed(const uint8_t* data, size_t len);
+
+    uint8_t state() const { return _state; }
+    bool headersComplete() const { return _state == BODY; }
+    bool failed() const { return _state == ERROR; }
+
+    // No part of a request received yet
+    bool idle() const { return _state == REQUEST_LINE && _len == 0; }
+
+    // HTTP status code describing a parse failure (400, 414, 431, 501), 0 if none
+    int error() const { return _error; }
+
+    // Request line, valid once headersComplete()
+    const char* method() const { return _buf + _method; }
+    const char* path() const { return _buf + _path; }      // Target up to '?'
+    const char* query() const { return _buf + _query; }    // After '?', "" if none
+    const char* version() const { return _buf + _version; }
+
+    // Headers; names are matched case-insensitively. Returns nullptr if absent
+    const char* header(const char* name) const;
+    uint8_t headerCount() const { return _headerCount; }
+    const char* headerName(uint8_t i) const { return _buf + _hname[i]; }
+    const char* headerValue(uint8_t i) const { return _buf + _hvalue[i]; }
+
+    // Declared body length, 0 without Content-Length
+    uint32_t contentLength() const { return _contentLength; }
+
+    // Whether the client wants the connection kept open: the HTTP/1.1
+    // default, unless it sent "Connection: close"; HTTP/1.0 only with
+    // "Connection: keep-alive"
+    bool keepAlive() const;
+
+private:
+    friend class HTTPBodyStream;
+
+    static const uint8_t CONNECTION_CLOSE = 0x01;
+    static const uint8_t CONNECTION_KEEP_ALIVE = 0x02;
+
+    char _buf[HTTP_REQUEST_BUFFER_SIZE];
+    uint16_t _len;       // Bytes in _buf
+    uint16_t _scan;      // Next byte to examine
+    uint16_t _line;      // Start of the line being assembled
+    uint16_t _method;
+    uint16_t _path;
+    uint16_t _query;
+    uint16_t _version;
+    uint16_t _hname[HTTP_MAX_HEADERS];
+    uint16_t _hvalue[HTTP_MAX_HEADERS];
+    uint8_t _headerCount;
+    uint8_t _state;
+    int _error;
+    uint32_t _contentLength;
+    bool _haveLength;
+    uint8_t _connection;  // CONNECTION_* tokens seen
+    uint16_t _bodyPos;   // Next unread body byte in _buf
+    uint32_t _bodyLeft;  // Body bytes not yet read through the stream
+
+    void parse();
+    bool parseRequestLine(char* line);
+    bool parseHeader(char* line);
+    void dropLine();
+    void fail(int status);
+};
+
+/*
+ * The body of a parsed request, as a Stream
+ *
+ * Returns end of stream (-1) once Content-Length bytes have been read. The
+ * inherited readBytes()/readString() helpers wait up to setTimeout() ms for
+ * body data that is still on its way.
+ */
+class HTTPBodyStream : public Stream {
+public:
+    HTTPBodyStream() : _parser(nullptr), _client(nullptr) {}
+
+    void begin(HTTPRequestParser* parser, Client* client) {
+        _parser = parser;
+        _client = client;
+    }
+
+    // Body bytes not yet read, whether buffered or still in the socket
+    uint32_t remaining() const { return _parser ? _parser->_bodyLeft : 0; }
+
+    // Read up to len body bytes in bulk; returns the count, 0 if none are ready
+    int read(uint8_t* buf, size_t len);
+
+    // Read and drop the rest of the body that has arrived; returns bytes left
+    uint32_t skip();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t) override { return 0; }
+    using Print::write;
+
+private:
+    HTTPRequestParser* _parser;
+    Client* _client;
+};
+
+/*
+ * Incremental HTTP/1.1 response parser, used by HTTPClient
+ *
+ * Reads the status line and headers in bulk into a fixed buffer of
+ * HTTP_CLIENT_BUFFER_SIZE bytes and splits them in place, like
+ * HTTPRequestParser. The body is then decoded by readBody() according to its
+ * framing (Content-Length, Transfer-Encoding: chunked, or until the server
+ * closes), so the end of the body is known as soon as its last byte arrives.
+ *
+ * Interim 1xx responses are skipped. If the headers outgrow the buffer, the
+ * oldest ones are forgotten; their effect on the framing is kept.
+ */
+class HTTPResponseParser {
+public:
+    // Parser states
+    static const uint8_t STATUS_LINE = 0;  // Waiting for the status line
+    static const uint8_t HEADERS = 1;      // Reading header lines
+    static const uint8_t BODY = 2;         // Headers complete, body being read
+    static const uint8_t DONE = 3;         // The whole response has been read
+    static const uint8_t ERROR = 4;        // Malformed or truncated
+
+    HTTPResponseParser();
+
+    // Expect a new response; noBody for the response to a HEAD request
+    void reset(bool noBody = false);
+
+    // Read whatever the client has buffered (one bulk read) and parse the
+    // status line and headers. Does nothing once they are complete.
+    int readFrom(Client& client);
+
+    // Parse bytes from another source; returns how many were taken
+    size_t feed(const uint8_t* data, size_t len);
+
+    uint8_t state() const { return _state; }
+    bool headersComplete() const { return _state == BODY || _state == DONE; }
+    bool complete() const { return _state == DONE; }
+    bool failed() const { return _state == ERROR; }
+
+    // No part of a response received yet
+    bool idle() const { return _state == STATUS_LINE && _len == 0; }
+
+    // Status line, valid once headersComplete()
+    int statusCode() const { return _status; }
+    const char* version() const { return _buf + _version; }
+    const char* reason() const { return _buf + _reason; }
+
+    // Headers; names are matched case-insensitively. Returns nullptr if absent
+    const char* header(const char* name) const;
+    uint8_t headerCount() const { return _headerCount; }
+    const char* headerName(uint8_t i) const { return _buf + _hname[i]; }
+    const char* headerValue(uint8_t i) const { return _buf + _hvalue[i]; }
+
+    bool chunked() const { return _frame == FRAME_CHUNKED; }
+    bool hasContentLength() const { return _haveLength; }
+    uint32_t contentLength() const { return _contentLength; }
+
+    // Whether the connection can carry another request once the body has
+    // been read: the body is delimited and the server did not ask to close
+    bool keepAlive() const;
+
+    // Read up to len body bytes, first those that arrived with the headers,
+    // then from client (which may be null). Returns the count, 0 if none are
+    // ready. Reaches DONE after the last byte, ERROR if the server closes
+    // before the body is complete.
+    int readBody(Client* client, uint8_t* buf, size_t len);
+
+    // Body bytes that can be read now without waiting
+    int bodyAvailable(Client* client);
+
+    // Next body byte without consuming it, -1 if none is ready
+    int peekBody(Client* client);
+
+private:
+    static const uint8_t CONNECTION_CLOSE = 0x01;
+    static const uint8_t CONNECTION_KEEP_ALIVE = 0x02;
+
+    // Body framing
+    static const uint8_t FRAME_NONE = 0;     // No body (HEAD, 1xx, 204, 304)
+    static const uint8_t FRAME_LENGTH = 1;   // Content-Length
+    static const uint8_t FRAME_CHUNKED = 2;  // Transfer-Encoding: chunked
+    static const uint8_t FRAME_CLOSE = 3;    // Ends when the server closes
+
+    // Position within the chunked encoding, between chunk data
+    static const uint8_t CHUNK_SIZE = 0;     // Hex digits of the size line
+    static const uint8_t CHUNK_EXT = 1;      // Rest of the size line
+    static const uint8_t CHUNK_END = 2;      // CRLF after the data
+    static const uint8_t CHUNK_TRAILER = 3;  // Trailer lines after the last chunk
+
+    char _buf[HTTP_CLIENT_BUFFER_SIZE];
+    uint16_t _len;      // Bytes in _buf
+    uint16_t _scan;     // Next byte to examine
+    uint16_t _line;     // Start of the line being assembled
+    uint16_t _version;
+    uint16_t _reason;
+    uint16_t _hname[HTTP_MAX_HEADERS];
+    uint16_t _hvalue[HTTP_MAX_HEADERS];
+    uint8_t _headerCount;
+    uint8_t _state;
+    int _status;
+    uint32_t _contentLength;
+    bool _haveLength;
+    bool _noBody;
+    bool _skipLine;       // Dropping an oversized header line
+    uint8_t _connection;  // CONNECTION_* tokens seen
+    uint8_t _frame;
+    uint8_t _chunkState;
+    uint8_t _chunkDigits;
+    uint16_t _trailerLen;  // Bytes in the current trailer line
+    uint16_t _bodyPos;     // Next unread body byte in _buf
+    uint32_t _bodyLeft;    // Bytes left in the body or the current chunk
+
+    void parse();
+    bool parseStatusLine(char* line);
+    void parseHeader(char* line);
+    void startBody();
+    void makeRoom();
+    void dropLine();
+    bool readChunkFraming(Client* client);
+    int readByte(Client* client);
+    int readRaw(Client* client, uint8_t* buf, size_t len);
+};
+
+/*
+ * The body of a response read by HTTPClient, as a Stream
+ *
+ * Chunked bodies come out decoded. Returns end of stream (-1) once the whole
+ * body has been read. The inherited readBytes()/readString() helpers wait up
+ * to setTimeout() ms for body data that is still on its way.
+ */
+class HTTPResponseBody : public Stream {
+public:
+    HTTPResponseBody() : _parser(nullptr), _client(nullptr) {}
+
+    void begin(HTTPResponseParser* parser, Client* client) {
+        _parser = parser;
+        _client = client;
+    }
+
+    // Whether the whole body has been read
+    bool complete() const { return _parser == nullptr || _parser->state() != HTTPResponseParser::BODY; }
+
+    // Read up to len body bytes in bulk; returns the count, 0 if none are ready
+    int read(uint8_t* buf, size_t len) { return _parser ? _parser->readBody(_client, buf, len) : 0; }
+
+    int available() override { return _parser ? _parser->bodyAvailable(_client) : 0; }
+    int read() override;
+    int peek() override { return _parser ? _parser->peekBody(_client) : -1; }
+    size_t write(uint8_t) override { return 0; }
+    using Print::write;
+
+private:
+    HTTPResponseParser* _parser;
+    Client* _client;
+};
+
+#endif
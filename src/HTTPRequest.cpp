@@ -1,9 +1,23 @@
 #include "HTTPRequest.h"
 
-HTTPRequest::HTTPRequest() : _method("GET"), _path("/"), _protocol("HTTP/1.1"), _headerCount(0) {}
+HTTPRequest::HTTPRequest()
+    : _method("GET"), _path("/"), _protocol("HTTP/1.1"), _headerCount(0), _parsed(nullptr),
+      _bodyStream(nullptr), _bodyRead(true), _paramCount(0), _paramNamesP(false) {}
 
 HTTPRequest::HTTPRequest(const String& method, const String& path)
-    : _method(method), _path(path), _protocol("HTTP/1.1"), _headerCount(0) {}
+    : _method(method), _path(path), _protocol("HTTP/1.1"), _headerCount(0), _parsed(nullptr),
+      _bodyStream(nullptr), _bodyRead(true), _paramCount(0), _paramNamesP(false) {}
+
+// The String fields stay empty; getters fall back to the parser's buffer
+HTTPRequest::HTTPRequest(const HTTPRequestParser& parsed, Stream* body)
+    : _headerCount(0), _parsed(&parsed), _bodyStream(body), _bodyRead(body == nullptr),
+      _paramCount(0), _paramNamesP(false) {}
+
+String HTTPSpan::toString() const {
+    String s;
+    if (data != nullptr) s.concat(data, length);
+    return s;
+}
 
 void HTTPRequest::setMethod(const String& method) { _method = method; }
 
@@ -11,7 +25,10 @@ void HTTPRequest::setPath(const String& path) { _path = path; }
 
 void HTTPRequest::setProtocol(const String& protocol) { _protocol = protocol; }
 
-void HTTPRequest::setBody(const String& body) { _body = body; }
+void HTTPRequest::setBody(const String& body) {
+    _body = body;
+    _bodyRead = true;
+}
 
 void HTTPRequest::addHeader(const String& name, const String& value) {
     if (_headerCount < HTTP_MAX_HEADERS) {
@@ -32,7 +49,7 @@ void HTTPRequest::setHeader(const String& name, const String& value) {
     addHeader(name, value);
 }
 
-String HTTPRequest::getHeader(const String& name) {
+String HTTPRequest::getHeader(const String& name) const {
     for (uint8_t i = 0; i < _headerCount; i++) {
         if (_headers[i].startsWith(name + ":")) {
             int colonIndex = _headers[i].indexOf(':');
@@ -43,18 +60,60 @@ String HTTPRequest::getHeader(const String& name) {
             }
         }
     }
-    return "";
+    const char* value = header(name.c_str());
+    return value != nullptr ? String(value) : String("");
 }
 
-String HTTPRequest::getMethod() const { return _method; }
+String HTTPRequest::getMethod() const {
+    if (_method.length() > 0 || _parsed == nullptr) return _method;
+    return String(_parsed->method());
+}
 
-String HTTPRequest::getPath() const { return _path; }
+String HTTPRequest::getPath() const {
+    if (_path.length() > 0 || _parsed == nullptr) return _path;
+    String path = _parsed->path();
+    if (*_parsed->query()) {
+        path += '?';
+        path += _parsed->query();
+    }
+    return path;
+}
+
+String HTTPRequest::getProtocol() const {
+    if (_protocol.length() > 0 || _parsed == nullptr) return _protocol;
+    return String(_parsed->version());
+}
+
+String HTTPRequest::getBody() const {
+    if (!_bodyRead) {
+        _bodyRead = true;
+        uint32_t length = _parsed != nullptr ? _parsed->contentLength() : HTTP_MAX_BODY_SIZE;
+        if (length > HTTP_MAX_BODY_SIZE) length = HTTP_MAX_BODY_SIZE;
+        _body.reserve(length);
+        char chunk[32];
+        while (length > 0) {
+            size_t n = _bodyStream->readBytes(chunk, length < sizeof(chunk) ? length : sizeof(chunk));
+            if (n == 0) break;
+            _body.concat(chunk, n);
+            length -= n;
+        }
+    }
+    return _body;
+}
+
+uint8_t HTTPRequest::getHeaderCount() const {
+    return _headerCount + (_parsed != nullptr ? _parsed->headerCount() : 0);
+}
 
-String HTTPRequest::getProtocol() const { return _protocol; }
+const char* HTTPRequest::method() const { return _parsed != nullptr ? _parsed->method() : ""; }
 
-String HTTPRequest::getBody() const { return _body; }
+const char* HTTPRequest::path() const { return _parsed != nullptr ? _parsed->path() : ""; }
 
-uint8_t HTTPRequest::getHeaderCount() const { return _headerCount; }
+const char* HTTPRequest::query() const { return _parsed != nullptr ? _parsed->query() : ""; }
+
+const char* HTTPRequest::header(const char* name) const {
+    return _parsed != nullptr ? _parsed->header(name) : nullptr;
+}
 
 bool HTTPRequest::parseFromString(const String& requestString) {
     int firstLineEnd = requestString.indexOf('\n');
@@ -74,6 +133,9 @@ bool HTTPRequest::parseFromString(const String& requestString) {
     _method = firstLine.substring(0, firstSpace);
     _path = firstLine.substring(firstSpace + 1, secondSpace);
     _protocol = firstLine.substring(secondSpace + 1);
+    _parsed = nullptr;
+    _bodyStream = nullptr;
+    _bodyRead = true;
 
     // Parse headers
     _headerCount = 0;
@@ -106,21 +168,54 @@ bool HTTPRequest::parseFromString(const String& requestString) {
 }
 
 String HTTPRequest::toString() const {
-    String request = _method + " " + _path + " " + _protocol + "\r\n";
+    String request = getMethod() + " " + getPath() + " " + getProtocol() + "\r\n";
 
     for (uint8_t i = 0; i < _headerCount; i++) {
         request += _headers[i] + "\r\n";
     }
+    if (_parsed != nullptr) {
+        for (uint8_t i = 0; i < _parsed->headerCount(); i++) {
+            request += String(_parsed->headerName(i)) + ": " + _parsed->headerValue(i) + "\r\n";
+        }
+    }
 
     request += "\r\n";
 
-    if (_body.length() > 0) {
-        request += _body;
+    String body = getBody();
+    if (body.length() > 0) {
+        request += body;
     }
 
     return request;
 }
 
+HTTPSpan HTTPRequest::param(const char* name) const {
+    size_t len = strlen(name);
+    for (uint8_t i = 0; i < _paramCount; i++) {
+        // Pattern names end at the next '/' or at the end of the pattern
+        const char* p = _paramNames[i];
+        size_t n = 0;
+        while (n < len) {
+            char c = _paramNamesP ? pgm_read_byte(p + n) : p[n];
+            if (c != name[n]) break;
+            n++;
+        }
+        if (n < len) continue;
+        char next = _paramNamesP ? pgm_read_byte(p + n) : p[n];
+        if (next == '/' || next == '\0') return _params[i];
+    }
+    HTTPSpan none = {nullptr, 0};
+    return none;
+}
+
+String HTTPRequest::getParam(const String& name) const { return param(name.c_str()).toString(); }
+
+HTTPSpan HTTPRequest::paramAt(uint8_t index) const {
+    if (index < _paramCount) return _params[index];
+    HTTPSpan none = {nullptr, 0};
+    return none;
+}
+
 HTTPRequest HTTPRequest::GET(const String& path) { return HTTPRequest("GET", path); }
 
 HTTPRequest HTTPRequest::POST(const String& path, const String& body) {
@@ -3,19 +3,41 @@
 
 #include "Arduino.h"
 #include "HTTPConfig.h"
+#include "HTTPParser.h"
+
+// A run of characters inside a request buffer; not NUL-terminated
+struct HTTPSpan {
+    const char* data;  // nullptr if absent
+    uint16_t length;
+
+    bool valid() const { return data != nullptr; }
+    String toString() const;
+};
 
 class HTTPRequest {
 private:
+    friend class HTTPServer;
+
     String _method;
     String _path;
     String _protocol;
     String _headers[HTTP_MAX_HEADERS];  // Support for configurable headers
     uint8_t _headerCount;
-    String _body;
-    
+    mutable String _body;
+    const HTTPRequestParser* _parsed;  // Request received by HTTPServer, read in place
+    Stream* _bodyStream;
+    mutable bool _bodyRead;
+    HTTPSpan _params[HTTP_MAX_PARAMS];        // Values, inside the request path
+    const char* _paramNames[HTTP_MAX_PARAMS]; // Names, inside the route pattern
+    uint8_t _paramCount;
+    bool _paramNamesP;                        // Route pattern is in PROGMEM
+
 public:
     HTTPRequest();
     HTTPRequest(const String& method, const String& path);
+    // View of a request held by a parser; its body is read from bodyStream.
+    // Valid only as long as the parser is not reset.
+    HTTPRequest(const HTTPRequestParser& parsed, Stream* body);
     
     // Basic setters
     void setMethod(const String& method);
@@ -26,14 +48,27 @@ public:
     // Header management
     void addHeader(const String& name, const String& value);
     void setHeader(const String& name, const String& value);
-    String getHeader(const String& name);
+    String getHeader(const String& name) const;
     
     // Getters
     String getMethod() const;
     String getPath() const;
     String getProtocol() const;
-    String getBody() const;
+    String getBody() const;  // Reads a streamed body, up to HTTP_MAX_BODY_SIZE
     uint8_t getHeaderCount() const;
+
+    // Zero-copy access to a received request; nullptr/"" when not parsed
+    const char* method() const;
+    const char* path() const;   // Without the query string
+    const char* query() const;
+    const char* header(const char* name) const;
+    Stream* bodyStream() const { return _bodyStream; }
+
+    // Path parameters captured by the matched route ("/users/:id" or "/files/*")
+    HTTPSpan param(const char* name) const;   // Invalid span if there is none
+    String getParam(const String& name) const;
+    uint8_t paramCount() const { return _paramCount; }
+    HTTPSpan paramAt(uint8_t index) const;
     
     // Parse from raw HTTP request string
     bool parseFromString(const String& requestString);
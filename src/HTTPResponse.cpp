@@ -72,6 +72,21 @@ String HTTPResponse::getBody() const { return _body; }
 
 uint8_t HTTPResponse::getHeaderCount() const { return _headerCount; }
 
+String HTTPResponse::getHeaderName(uint8_t index) const {
+    if (index >= _headerCount) return "";
+    int colonIndex = _headers[index].indexOf(':');
+    return colonIndex != -1 ? _headers[index].substring(0, colonIndex) : _headers[index];
+}
+
+String HTTPResponse::getHeaderValue(uint8_t index) const {
+    if (index >= _headerCount) return "";
+    int colonIndex = _headers[index].indexOf(':');
+    if (colonIndex == -1) return "";
+    String value = _headers[index].substring(colonIndex + 1);
+    value.trim();
+    return value;
+}
+
 bool HTTPResponse::parseFromString(const String& responseString) {
     int firstLineEnd = responseString.indexOf('\n');
     if (firstLineEnd == -1) return false;
@@ -144,6 +159,10 @@ String HTTPResponse::toString() const {
     return response;
 }
 
+size_t HTTPResponse::writeBody(Print& out) const {
+    return out.write((const uint8_t*)_body.c_str(), _body.length());
+}
+
 HTTPResponse HTTPResponse::OK(const String& body) {
     HTTPResponse response(200, "OK");
     if (body.length() > 0) {
@@ -188,6 +207,12 @@ String HTTPResponse::getStandardStatusMessage(int statusCode) {
             return "Not Found";
         case 405:
             return "Method Not Allowed";
+        case 413:
+            return "Payload Too Large";
+        case 414:
+            return "URI Too Long";
+        case 431:
+            return "Request Header Fields Too Large";
         case 500:
             return "Internal Server Error";
         case 501:
@@ -34,12 +34,17 @@ public:
     String getProtocol() const;
     String getBody() const;
     uint8_t getHeaderCount() const;
+    String getHeaderName(uint8_t index) const;
+    String getHeaderValue(uint8_t index) const;
     
     // Parse from raw HTTP response string
     bool parseFromString(const String& responseString);
     
     // Generate HTTP response string
     String toString() const;
+
+    // Write the body without copying it
+    size_t writeBody(Print& out) const;
     
     // Common status code helpers
     static HTTPResponse OK(const String& body = "");
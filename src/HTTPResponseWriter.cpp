@@ -0,0 +1,307 @@
+#include "HTTPResponseWriter.h"
+#include "HTTPResponse.h"
+#include "EthernetClient.h"
+
+HTTPResponseWriter::HTTPResponseWriter(Client& client, bool chunked, bool keepAlive)
+    : _client(&client), _len(0), _chunk(0), _state(IDLE), _frame(FRAME_CLOSE),
+      _chunkedOK(chunked), _keepAlive(keepAlive), _failed(false), _length(0), _remaining(0) {}
+
+void HTTPResponseWriter::begin(int statusCode, const String& message) {
+    if (_state != IDLE) return;
+
+    char code[8];
+    snprintf(code, sizeof(code), " %d ", statusCode);
+    put(HTTP_VERSION_1_1);
+    put(code);
+    if (message.length() > 0) {
+        put(message.c_str());
+    } else {
+        put(HTTPResponse::getStandardStatusMessage(statusCode).c_str());
+    }
+    put("\r\n");
+
+    if (statusCode < 200 || statusCode == 204 || statusCode == 304) {
+        _frame = FRAME_NONE;
+    } else {
+        _frame = _chunkedOK ? FRAME_CHUNKED : FRAME_CLOSE;
+    }
+    _state = HEADERS;
+}
+
+void HTTPResponseWriter::header(const char* name, const char* value) {
+    if (_state == IDLE) begin(200);
+    if (_state != HEADERS) return;
+
+    // Framing headers are written by startBody() so they always match the body
+    if (strcasecmp(name, HTTP_HEADER_CONTENT_LENGTH) == 0) {
+        contentLength(strtoul(value, nullptr, 10));
+        return;
+    }
+    if (strcasecmp(name, HTTP_HEADER_CONNECTION) == 0) {
+        if (strcasecmp(value, "close") == 0) _keepAlive = false;
+        return;
+    }
+    if (strcasecmp(name, "Transfer-Encoding") == 0) return;
+
+    put(name);
+    put(": ");
+    put(value);
+    put("\r\n");
+}
+
+void HTTPResponseWriter::contentLength(uint32_t length) {
+    if (_state == IDLE) begin(200);
+    if (_state != HEADERS || _frame == FRAME_NONE) return;
+
+    _frame = FRAME_LENGTH;
+    _length = length;
+    _remaining = length;
+}
+
+void HTTPResponseWriter::headersP(const char* lines) {
+    if (_state == IDLE) begin(200);
+    if (_state != HEADERS) return;
+
+    size_t len = strlen_P(lines);
+    while (len > 0) {
+        if (_len == HTTP_RESPONSE_BUFFER_SIZE) drain();
+        size_t n = HTTP_RESPONSE_BUFFER_SIZE - _len;
+        if (n > len) n = len;
+        memcpy_P(_buf + _len, lines, n);
+        _len += n;
+        lines += n;
+        len -= n;
+    }
+}
+
+// Produces the writer's buffered bytes ahead of the caller's data
+struct HTTPResponseProducer {
+    const uint8_t* head;
+    uint16_t headLen;
+    SocketWriteProducer producer;
+    void* ctx;
+};
+
+static uint16_t produceAfterHead(void* ctx, uint8_t* data, uint16_t len) {
+    HTTPResponseProducer* p = (HTTPResponseProducer*)ctx;
+    uint16_t n = 0;
+    if (p->headLen > 0) {
+        n = p->headLen < len ? p->headLen : len;
+        memcpy(data, p->head, n);
+        p->head += n;
+        p->headLen -= n;
+        if (n == len) return n;
+    }
+    return n + p->producer(p->ctx, data + n, len - n);
+}
+
+uint32_t HTTPResponseWriter::writeFrom(EthernetClient& client, SocketWriteProducer producer,
+                                       void* ctx, uint32_t len) {
+    if (_state < BODY) startBody();
+    if (_state != BODY || _failed || _frame == FRAME_NONE) return 0;
+
+    if (_frame == FRAME_CHUNKED) {
+        // Chunks need their size up front; pull the data through the buffer
+        uint32_t total = 0;
+        while (total < len) {
+            uint8_t chunk[32];
+            uint16_t want = len - total < sizeof(chunk) ? len - total : sizeof(chunk);
+            uint16_t n = producer(ctx, chunk, want);
+            if (write(chunk, n) != n) break;
+            total += n;
+            if (n < want) break;
+        }
+        return total;
+    }
+
+    if (_frame == FRAME_LENGTH && len > _remaining) len = _remaining;
+
+    uint32_t body = 0;
+    while (len > 0 && !_failed) {
+        uint32_t piece = len;
+        if (piece > 0xFFFFUL - _len) piece = 0xFFFFUL - _len;
+
+        HTTPResponseProducer head = {_buf, _len, producer, ctx};
+        size_t want = _len + piece;
+        size_t sent = client.writeFrom(produceAfterHead, &head, want);
+        body += sent > _len ? sent - _len : 0;
+        if (sent < want) {
+            _failed = true;
+            _keepAlive = false;
+            setWriteError();
+        }
+        _len = 0;
+        len -= piece;
+    }
+
+    if (_frame == FRAME_LENGTH) _remaining -= body;
+    return body;
+}
+
+size_t HTTPResponseWriter::write(uint8_t b) { return write(&b, 1); }
+
+size_t HTTPResponseWriter::write(const uint8_t* buf, size_t size) {
+    if (_state < BODY) startBody();
+    if (_state != BODY || _failed || _frame == FRAME_NONE) return 0;
+
+    // Never send more than was announced; the client would read it as the next response
+    if (_frame == FRAME_LENGTH) {
+        if (size > _remaining) size = _remaining;
+        _remaining -= size;
+    }
+
+    if (_frame == FRAME_CHUNKED) {
+        const size_t capacity = HTTP_RESPONSE_BUFFER_SIZE - CHUNK_HEAD - CHUNK_TAIL;
+        if (size >= capacity) {
+            // Too big to buffer: send it as chunks of its own, straight from the caller
+            flushChunk();
+            const uint8_t* p = buf;
+            size_t left = size;
+            while (left > 0 && !_failed) {
+                uint16_t n = left > 0xFFFF ? 0xFFFF : left;
+                char line[CHUNK_HEAD];
+                hex4(line, n);
+                line[4] = '\r';
+                line[5] = '\n';
+                send((const uint8_t*)line, CHUNK_HEAD);
+                send(p, n);
+                send((const uint8_t*)"\r\n", CHUNK_TAIL);
+                p += n;
+                left -= n;
+            }
+            openChunk();
+        } else {
+            const uint8_t* p = buf;
+            size_t left = size;
+            while (left > 0) {
+                size_t room = HTTP_RESPONSE_BUFFER_SIZE - CHUNK_TAIL - _len;
+                if (room == 0) {
+                    flushChunk();
+                    openChunk();
+                    continue;
+                }
+                size_t n = left < room ? left : room;
+                memcpy(_buf + _len, p, n);
+                _len += n;
+                p += n;
+                left -= n;
+            }
+        }
+    } else if (size >= HTTP_RESPONSE_BUFFER_SIZE) {
+        drain();
+        send(buf, size);
+    } else {
+        put(buf, size);
+    }
+
+    return _failed ? 0 : size;
+}
+
+void HTTPResponseWriter::flush() {
+    if (_state == BODY && _frame == FRAME_CHUNKED) {
+        flushChunk();
+        openChunk();
+    } else {
+        drain();
+    }
+    _client->flush();
+}
+
+void HTTPResponseWriter::end() {
+    if (_state == DONE) return;
+    if (_state < BODY) startBody();
+
+    if (_frame == FRAME_CHUNKED) {
+        closeChunk();
+        put("0\r\n\r\n");
+    } else if (_frame == FRAME_LENGTH && _remaining > 0) {
+        // Short body: the client can only recover if the connection closes
+        _keepAlive = false;
+    }
+
+    drain();
+    _client->flush();
+    _state = DONE;
+}
+
+void HTTPResponseWriter::put(const char* s) { put((const uint8_t*)s, strlen(s)); }
+
+void HTTPResponseWriter::put(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        if (_len == HTTP_RESPONSE_BUFFER_SIZE) drain();
+        size_t n = HTTP_RESPONSE_BUFFER_SIZE - _len;
+        if (n > len) n = len;
+        memcpy(_buf + _len, data, n);
+        _len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void HTTPResponseWriter::send(const uint8_t* data, size_t len) {
+    if (_failed || len == 0) return;
+    if (_client->write(data, len) != len) {
+        _failed = true;
+        _keepAlive = false;
+        setWriteError();
+    }
+}
+
+void HTTPResponseWriter::drain() {
+    send(_buf, _len);
+    _len = 0;
+}
+
+void HTTPResponseWriter::startBody() {
+    if (_state == IDLE) begin(200);
+
+    if (_frame == FRAME_LENGTH) {
+        char line[32];
+        snprintf(line, sizeof(line), "%s: %lu\r\n", HTTP_HEADER_CONTENT_LENGTH,
+                 (unsigned long)_length);
+        put(line);
+    } else if (_frame == FRAME_CHUNKED) {
+        put("Transfer-Encoding: chunked\r\n");
+    } else if (_frame == FRAME_CLOSE) {
+        _keepAlive = false;
+    }
+    put(_keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+
+    _state = BODY;
+    if (_frame == FRAME_CHUNKED) openChunk();
+}
+
+// Reserve the size line of a new chunk, after whatever is already buffered
+void HTTPResponseWriter::openChunk() {
+    if (_len > HTTP_RESPONSE_BUFFER_SIZE - CHUNK_HEAD - CHUNK_TAIL - 1) drain();
+    _chunk = _len;
+    _len += CHUNK_HEAD;
+}
+
+// Frame the current chunk in the buffer; an empty one is removed
+void HTTPResponseWriter::closeChunk() {
+    uint16_t n = _len - _chunk - CHUNK_HEAD;
+    if (n == 0) {
+        _len = _chunk;
+        return;
+    }
+    hex4((char*)_buf + _chunk, n);
+    _buf[_chunk + 4] = '\r';
+    _buf[_chunk + 5] = '\n';
+    _buf[_len++] = '\r';
+    _buf[_len++] = '\n';
+}
+
+void HTTPResponseWriter::flushChunk() {
+    closeChunk();
+    drain();
+}
+
+// Chunk sizes are written as four hex digits; leading zeros are allowed
+void HTTPResponseWriter::hex4(char* out, uint16_t n) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (int8_t i = 3; i >= 0; i--) {
+        out[i] = digits[n & 0x0F];
+        n >>= 4;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef HTTPRESPONSEWRITER_H
+#define HTTPRESPONSEWRITER_H
+
+#include "Arduino.h"
+#include "Client.h"
+#include "HTTPConfig.h"
+#include "chips/utility/socket.h"
+
+class EthernetClient;
+
+/*
+ * Streaming HTTP response writer
+ *
+ * Sends a response straight to the client as it is produced: begin() writes
+ * the status line, header() adds headers, and everything printed afterwards
+ * is body. Memory use is one HTTP_RESPONSE_BUFFER_SIZE buffer, whatever the
+ * size of the response.
+ *
+ * With a Content-Length header the body is sent as is. Without one it is sent
+ * with Transfer-Encoding: chunked, one chunk per buffer, or to an HTTP/1.0
+ * client delimited by closing the connection. Each buffer goes out in a
+ * single client write, so headers and the first body bytes share a segment.
+ *
+ * Usage:
+ *   out.begin(200);
+ *   out.contentType("text/csv");
+ *   for (...) out.println(row);
+ *   out.end();
+ */
+class HTTPResponseWriter : public Print {
+public:
+    // chunked: the client accepts chunked encoding (HTTP/1.1)
+    // keepAlive: the connection may stay open after the response
+    HTTPResponseWriter(Client& client, bool chunked = true, bool keepAlive = false);
+
+    // Write the status line; message defaults to the standard reason phrase
+    void begin(int statusCode, const String& message = "");
+
+    // Add a header; ignored once body data has been written. Content-Length
+    // selects identity encoding and "Connection: close" ends keep-alive.
+    void header(const char* name, const char* value);
+    void contentType(const char* type) { header(HTTP_HEADER_CONTENT_TYPE, type); }
+    void contentLength(uint32_t length);
+
+    // Add header lines kept in PROGMEM, each "Name: value\r\n"; must not
+    // include Content-Length, Connection or Transfer-Encoding
+    void headersP(const char* lines);
+
+    // Body data. Starts the body: the header block is closed on the first write.
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+
+    // Body data produced straight into the chip's TX memory, len bytes at
+    // most; client must be the writer's client. Buffered header bytes go out
+    // in the same segments. The client must be in blocking mode. Returns the
+    // body bytes sent.
+    uint32_t writeFrom(EthernetClient& client, SocketWriteProducer producer, void* ctx,
+                       uint32_t len);
+
+    // Send buffered data now
+    void flush() override;
+
+    // Finish the response: write the last chunk and send everything buffered
+    void end();
+
+    bool started() const { return _state != IDLE; }
+    bool headersSent() const { return _state >= BODY; }
+    bool finished() const { return _state == DONE; }
+
+    // Whether the connection can carry another request after end()
+    bool keepAlive() const { return _keepAlive; }
+
+private:
+    // Writer states
+    static const uint8_t IDLE = 0;     // Nothing sent
+    static const uint8_t HEADERS = 1;  // Status line written, headers may follow
+    static const uint8_t BODY = 2;     // Header block closed
+    static const uint8_t DONE = 3;     // end() called
+
+    // Body framing
+    static const uint8_t FRAME_NONE = 0;     // No body allowed (1xx, 204, 304)
+    static const uint8_t FRAME_LENGTH = 1;   // Content-Length given
+    static const uint8_t FRAME_CHUNKED = 2;  // Transfer-Encoding: chunked
+    static const uint8_t FRAME_CLOSE = 3;    // Ends when the connection closes
+
+    // A chunk is framed in place: a zero-padded size line is reserved in
+    // front of its data and the CRLF after it
+    static const uint8_t CHUNK_HEAD = 6;  // "XXXX\r\n"
+    static const uint8_t CHUNK_TAIL = 2;  // "\r\n"
+
+    Client* _client;
+    uint8_t _buf[HTTP_RESPONSE_BUFFER_SIZE];
+    uint16_t _len;
+    uint16_t _chunk;  // Offset of the current chunk's size line
+    uint8_t _state;
+    uint8_t _frame;
+    bool _chunkedOK;
+    bool _keepAlive;
+    bool _failed;
+    uint32_t _length;     // Declared Content-Length
+    uint32_t _remaining;  // Body bytes still owed under Content-Length
+
+    void put(const char* s);
+    void put(const uint8_t* data, size_t len);
+    void send(const uint8_t* data, size_t len);
+    void drain();
+    void startBody();
+    void openChunk();
+    void closeChunk();
+    void flushChunk();
+    static void hex4(char* out, uint16_t n);
+};
+
+#endif
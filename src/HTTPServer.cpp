@@ -1,7 +1,55 @@
 #include "HTTPServer.h"
+#include "EthernetPerf.h"
+
+// Whether an Accept-Encoding value allows gzip (and does not refuse it with q=0)
+static bool acceptsGzip(const char* value) {
+    while (value != nullptr && *value) {
+        while (*value == ' ' || *value == ',') value++;
+        const char* next = strchr(value, ',');
+        if (strncasecmp(value, "gzip", 4) == 0 && strchr(" ;,", value[4]) != nullptr) {
+            const char* q = strstr(value, "q=");
+            return q == nullptr || (next != nullptr && q > next) || atof(q + 2) > 0;
+        }
+        value = next;
+    }
+    return false;
+}
+
+// Whether an If-None-Match value lists the PROGMEM entity tag (weak comparison)
+static bool etagMatches(const char* value, const char* etag) {
+    if (value == nullptr) return false;
+    size_t len = strlen_P(etag);
+    while (*value) {
+        while (*value == ' ' || *value == ',') value++;
+        if (*value == '*') return true;
+        if (strncmp(value, "W/", 2) == 0) value += 2;
+        const char* end = value;
+        while (*end && *end != ',' && *end != ' ') end++;
+        if ((size_t)(end - value) == len && strncmp_P(value, etag, len) == 0) return true;
+        value = end;
+    }
+    return false;
+}
+
+// Producer streaming an asset body from flash
+static uint16_t readFlash(void* ctx, uint8_t* data, uint16_t len) {
+    const uint8_t** body = (const uint8_t**)ctx;
+    memcpy_P(data, *body, len);
+    *body += len;
+    return len;
+}
+
+// Method names in HTTPMethod bit order
+static const char* const methodNames[] = {"GET", "POST", "PUT", "DELETE", "PATCH", "HEAD", "OPTIONS"};
+static const uint8_t METHOD_COUNT = sizeof(methodNames) / sizeof(methodNames[0]);
 
 HTTPServer::HTTPServer(EthernetClass* eth, EthernetChip* chip, uint16_t port)
-    : _server(eth, chip, port), _routeCount(0), _defaultHandler(nullptr) {
+    : _ethernet(eth), _chip(chip), _server(eth, chip, port), _routeCount(0),
+      _routeTable(nullptr), _routeTableCount(0), _defaultHandler(nullptr),
+      _keepAliveTimeout(HTTP_KEEPALIVE_TIMEOUT), _maxRequests(HTTP_KEEPALIVE_MAX_REQUESTS), _assets(nullptr), _assetCount(0) {
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        _connections[i].sock = MAX_SOCK_NUM;
+    }
 }
 
 void HTTPServer::begin() {
@@ -9,136 +57,401 @@ void HTTPServer::begin() {
 }
 
 void HTTPServer::handleClient() {
-    EthernetClient client = _server.available();
-    if (client) {
-        String requestString = readRequestFromClient(client);
-        
-        if (requestString.length() > 0) {
-            HTTPRequest request;
-            if (request.parseFromString(requestString)) {
-                HTTPResponse response;
-                Route matchedRoute;
-                
-                if (matchRoute(request.getMethod(), request.getPath(), matchedRoute)) {
-                    // Call the matched route handler
-                    response = matchedRoute.handler(request);
-                } else if (_defaultHandler != nullptr) {
-                    // Call the default handler
-                    response = _defaultHandler(request);
-                } else {
-                    // Use built-in 404 handler
-                    response = defaultNotFoundHandler(request);
-                }
-                
-                sendResponseToClient(client, response);
-            } else {
-                // Failed to parse request
-                HTTPResponse errorResponse = HTTPResponse::BadRequest("Invalid HTTP Request");
-                sendResponseToClient(client, errorResponse);
-            }
+    // Let background closes progress even if the sketch never calls maintain()
+    _ethernet->serviceSockets();
+
+    // Every socket with data gets one read per call, round-robin
+    for (uint8_t i = 0; i < MAX_SOCK_NUM; i++) {
+        EthernetClient client = _server.available();
+        if (!client) break;
+
+        HTTPConnection* conn = connectionFor(client.getSocketNumber());
+        if (conn == nullptr) {
+            sendError(client, 503);
+            client.stopAsync();
+            continue;
+        }
+        serviceConnection(*conn, client);
+    }
+
+    // Drop connections that went quiet or were closed by the client
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        HTTPConnection& conn = _connections[i];
+        if (conn.sock == MAX_SOCK_NUM) continue;
+
+        // A socket closing in the background (e.g. by the server after the peer's FIN)
+        // is no longer this connection's
+        if (_ethernet->socketState(conn.sock) != SockAsync::IDLE ||
+            !_ethernet->ownsSocket(conn.sock, conn.generation)) {
+            conn.sock = MAX_SOCK_NUM;
+            continue;
+        }
+
+        EthernetClient client(_ethernet, _chip, conn.sock);
+        uint8_t status = client.status();
+        if (status != SnSR::ESTABLISHED && status != SnSR::CLOSE_WAIT) {
+            // Already closed, and the socket may be listening again
+            conn.sock = MAX_SOCK_NUM;
+            continue;
+        }
+
+        unsigned long limit = conn.parser.idle() ? _keepAliveTimeout : HTTP_DEFAULT_TIMEOUT;
+        if ((status == SnSR::CLOSE_WAIT && client.available() == 0) ||
+            millis() - conn.lastActive >= limit) {
+            closeConnection(conn, client);
         }
-        
-        // Give client time to receive data
-        delay(1);
-        client.stop();
     }
 }
 
-void HTTPServer::on(const String& method, const String& path, RequestHandler handler) {
-    if (_routeCount < HTTP_MAX_ROUTES) {
-        _routes[_routeCount].method = method;
+void HTTPServer::setKeepAlive(uint16_t timeout, uint8_t maxRequests) {
+    _keepAliveTimeout = timeout;
+    _maxRequests = maxRequests ? maxRequests : 1;
+}
+
+uint8_t HTTPServer::connectionCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        if (_connections[i].sock != MAX_SOCK_NUM) count++;
+    }
+    return count;
+}
+
+void HTTPServer::addRoute(uint8_t methods, const char* path, RequestHandler handler,
+                          StreamingRequestHandler streamHandler) {
+    if (_routeCount < HTTP_MAX_ROUTES && methods != 0) {
+        _routes[_routeCount].methods = methods;
         _routes[_routeCount].path = path;
         _routes[_routeCount].handler = handler;
+        _routes[_routeCount].streamHandler = streamHandler;
         _routeCount++;
     }
 }
 
-void HTTPServer::onGET(const String& path, RequestHandler handler) {
-    on("GET", path, handler);
+void HTTPServer::on(const char* method, const char* path, RequestHandler handler) {
+    addRoute(methodBit(method), path, handler, nullptr);
+}
+
+void HTTPServer::on(uint8_t methods, const char* path, RequestHandler handler) {
+    addRoute(methods, path, handler, nullptr);
+}
+
+void HTTPServer::onGET(const char* path, RequestHandler handler) {
+    addRoute(HTTPMethod::GET, path, handler, nullptr);
+}
+
+void HTTPServer::onPOST(const char* path, RequestHandler handler) {
+    addRoute(HTTPMethod::POST, path, handler, nullptr);
+}
+
+void HTTPServer::onPUT(const char* path, RequestHandler handler) {
+    addRoute(HTTPMethod::PUT, path, handler, nullptr);
+}
+
+void HTTPServer::onDELETE(const char* path, RequestHandler handler) {
+    addRoute(HTTPMethod::DELETE, path, handler, nullptr);
+}
+
+void HTTPServer::on(const char* method, const char* path, StreamingRequestHandler handler) {
+    addRoute(methodBit(method), path, nullptr, handler);
+}
+
+void HTTPServer::on(uint8_t methods, const char* path, StreamingRequestHandler handler) {
+    addRoute(methods, path, nullptr, handler);
+}
+
+void HTTPServer::onGET(const char* path, StreamingRequestHandler handler) {
+    addRoute(HTTPMethod::GET, path, nullptr, handler);
+}
+
+void HTTPServer::onPOST(const char* path, StreamingRequestHandler handler) {
+    addRoute(HTTPMethod::POST, path, nullptr, handler);
+}
+
+void HTTPServer::onPUT(const char* path, StreamingRequestHandler handler) {
+    addRoute(HTTPMethod::PUT, path, nullptr, handler);
 }
 
-void HTTPServer::onPOST(const String& path, RequestHandler handler) {
-    on("POST", path, handler);
+void HTTPServer::onDELETE(const char* path, StreamingRequestHandler handler) {
+    addRoute(HTTPMethod::DELETE, path, nullptr, handler);
 }
 
-void HTTPServer::onPUT(const String& path, RequestHandler handler) {
-    on("PUT", path, handler);
+void HTTPServer::setRouteTable(const HTTPRoute* routes, uint8_t count) {
+    _routeTable = routes;
+    _routeTableCount = count;
 }
 
-void HTTPServer::onDELETE(const String& path, RequestHandler handler) {
-    on("DELETE", path, handler);
+uint8_t HTTPServer::methodBit(const char* method) {
+    for (uint8_t i = 0; i < METHOD_COUNT; i++) {
+        if (strcmp(method, methodNames[i]) == 0) return 1 << i;
+    }
+    return 0;
 }
 
 void HTTPServer::onNotFound(RequestHandler handler) {
     _defaultHandler = handler;
 }
 
-String HTTPServer::readRequestFromClient(EthernetClient& client) {
-    String request = "";
-    bool headerComplete = false;
-    int contentLength = 0;
-    int bodyBytesRead = 0;
-    
-    unsigned long timeout = millis() + 5000; // 5 second timeout
-    
-    while (client.connected() && millis() < timeout) {
-        if (client.available()) {
-            char c = client.read();
-            request += c;
-            
-            if (!headerComplete) {
-                // Check for end of headers (double CRLF)
-                if (request.endsWith("\r\n\r\n")) {
-                    headerComplete = true;
-                    
-                    // Parse Content-Length header if present
-                    int contentLengthIndex = request.indexOf("Content-Length:");
-                    if (contentLengthIndex != -1) {
-                        int valueStart = contentLengthIndex + 15; // Length of "Content-Length:"
-                        int lineEnd = request.indexOf('\r', valueStart);
-                        if (lineEnd != -1) {
-                            String lengthStr = request.substring(valueStart, lineEnd);
-                            lengthStr.trim();
-                            contentLength = lengthStr.toInt();
-                        }
-                    }
-                    
-                    // If no content length, we're done
-                    if (contentLength == 0) {
-                        break;
-                    }
-                }
-            } else {
-                // Reading body
-                bodyBytesRead++;
-                if (bodyBytesRead >= contentLength) {
-                    break;
-                }
+void HTTPServer::serveAssets(const HTTPAsset* assets, uint8_t count) {
+    _assets = assets;
+    _assetCount = count;
+}
+
+// Find the connection reading from a socket, or take a free slot for it
+HTTPConnection* HTTPServer::connectionFor(uint8_t sock) {
+    HTTPConnection* free = nullptr;
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        HTTPConnection& conn = _connections[i];
+        // The socket was freed and given to a new client since this slot took it
+        if (conn.sock == sock && !_ethernet->ownsSocket(sock, conn.generation)) {
+            conn.sock = MAX_SOCK_NUM;
+        }
+        if (conn.sock == sock) return &conn;
+        if (conn.sock == MAX_SOCK_NUM && free == nullptr) free = &conn;
+    }
+    if (free == nullptr) {
+        // Every slot is taken: reclaim the one that has been quiet longest, if it sits
+        // idle between requests (nothing received and nothing waiting on the socket)
+        for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+            HTTPConnection& conn = _connections[i];
+            if (!conn.parser.idle()) continue;
+            if (free == nullptr || millis() - conn.lastActive > millis() - free->lastActive) {
+                if (_chip->getRXReceivedSize(conn.sock) == 0) free = &conn;
             }
-            
-            // Reset timeout when data is received
-            timeout = millis() + 5000;
+        }
+        if (free != nullptr) {
+            EthernetClient evicted(_ethernet, _chip, free->sock);
+            closeConnection(*free, evicted);
+        }
+    }
+    if (free != nullptr) {
+        free->sock = sock;
+        free->generation = _ethernet->socketGeneration(sock);
+        free->requests = 0;
+        free->lastActive = millis();
+        free->parser.reset();
+    }
+    return free;
+}
+
+void HTTPServer::serviceConnection(HTTPConnection& conn, EthernetClient& client) {
+    if (conn.parser.readFrom(client) > 0) conn.lastActive = millis();
+
+    // A read can complete more than one pipelined request
+    while (conn.parser.headersComplete()) {
+        if (!dispatch(conn, client)) {
+            closeConnection(conn, client);
+            return;
+        }
+    }
+
+    if (conn.parser.failed()) {
+        sendError(client, conn.parser.error());
+        closeConnection(conn, client);
+    }
+}
+
+// Answer the parsed request; returns false if the connection should close
+bool HTTPServer::dispatch(HTTPConnection& conn, EthernetClient& client) {
+    ETHERNET_PERF_START(start);
+    _body.begin(&conn.parser, &client);
+    HTTPRequest request(conn.parser, &_body);
+    HTTPRoute matchedRoute;
+    uint8_t allowed = 0;
+
+    conn.requests++;
+    bool http11 = strcmp(conn.parser.version(), "HTTP/1.0") != 0;
+    bool keepAlive = _keepAliveTimeout > 0 && conn.requests < _maxRequests &&
+                     conn.parser.keepAlive();
+    HTTPResponseWriter out(client, http11, keepAlive);
+    HTTPAsset asset;
+
+    if (_assetCount > 0 && strcmp(conn.parser.method(), HTTP_METHOD_GET) == 0 &&
+        findAsset(conn.parser.path(), acceptsGzip(conn.parser.header("Accept-Encoding")),
+                  asset)) {
+        sendAsset(asset, conn.parser, out, client);
+    } else if ((allowed = matchRoute(methodBit(conn.parser.method()), conn.parser.path(), request,
+                                     matchedRoute)) == 0xFF) {
+        if (matchedRoute.streamHandler != nullptr) {
+            // The handler writes the response itself
+            matchedRoute.streamHandler(request, out);
         } else {
-            delay(1);
+            // Call the matched route handler
+            sendResponseToClient(out, matchedRoute.handler(request));
         }
+    } else if (allowed != 0) {
+        // The path exists, but not for this method
+        sendMethodNotAllowed(out, allowed);
+    } else if (_defaultHandler != nullptr) {
+        // Call the default handler
+        sendResponseToClient(out, _defaultHandler(request));
+    } else {
+        // Use built-in 404 handler
+        sendResponseToClient(out, defaultNotFoundHandler(request));
     }
-    
-    return request;
+    out.end();
+    ETHERNET_PERF_EVENT(http, HTTP_REQUEST, client.getSocketNumber(),
+                        ETHERNET_PERF_ELAPSED(start));
+
+    // Whatever of the body the handler left would be read as the next request
+    _body.skip();
+    bool reuse = out.keepAlive() && _body.remaining() == 0;
+    _body.begin(nullptr, nullptr);
+    conn.lastActive = millis();
+
+    return reuse && conn.parser.next();
+}
+
+void HTTPServer::closeConnection(HTTPConnection& conn, EthernetClient& client) {
+    client.stopAsync();
+    conn.sock = MAX_SOCK_NUM;
+}
+
+void HTTPServer::sendError(EthernetClient& client, int statusCode) {
+    HTTPResponse response(statusCode);
+    response.setBody(HTTPResponse::getStandardStatusMessage(statusCode));
+
+    HTTPResponseWriter out(client, true, false);
+    sendResponseToClient(out, response);
+    out.end();
+}
+
+void HTTPServer::sendResponseToClient(HTTPResponseWriter& out, const HTTPResponse& response) {
+    out.begin(response.getStatusCode(), response.getStatusMessage());
+    for (uint8_t i = 0; i < response.getHeaderCount(); i++) {
+        out.header(response.getHeaderName(i).c_str(), response.getHeaderValue(i).c_str());
+    }
+    response.writeBody(out);
 }
 
-void HTTPServer::sendResponseToClient(EthernetClient& client, const HTTPResponse& response) {
-    String responseString = response.toString();
-    client.print(responseString);
+// Look a path up; with several entries for it, the compressed one is
+// preferred if gzip is accepted and the plain one otherwise
+bool HTTPServer::findAsset(const char* path, bool gzip, HTTPAsset& found) {
+    bool have = false;
+    for (uint8_t i = 0; i < _assetCount; i++) {
+        HTTPAsset entry;
+        memcpy_P(&entry, &_assets[i], sizeof(entry));
+        if (strcmp_P(path, entry.path) != 0) continue;
+
+        bool compressed = (entry.flags & HTTP_ASSET_GZIP) != 0;
+        if (!have || compressed == gzip) {
+            found = entry;
+            have = true;
+        }
+        if (compressed == gzip) break;
+    }
+    return have;
+}
+
+void HTTPServer::sendAsset(const HTTPAsset& asset, const HTTPRequestParser& request,
+                           HTTPResponseWriter& out, EthernetClient& client) {
+    if (etagMatches(request.header("If-None-Match"), asset.etag)) {
+        char etag[40];
+        size_t len = strlen_P(asset.etag);
+        if (len >= sizeof(etag)) len = sizeof(etag) - 1;
+        memcpy_P(etag, asset.etag, len);
+        etag[len] = '\0';
+
+        out.begin(304);
+        out.header("ETag", etag);
+        if (asset.flags & HTTP_ASSET_GZIP) out.header("Vary", "Accept-Encoding");
+        return;
+    }
+
+    out.begin(200);
+    out.headersP(asset.headers);
+    out.contentLength(asset.length);
+    const uint8_t* body = asset.body;
+    out.writeFrom(client, readFlash, &body, asset.length);
+}
+
+// Match a path against a pattern, capturing its parameters into the request
+bool HTTPServer::matchPath(const char* pattern, bool progmem, const char* path,
+                           HTTPRequest& request) {
+    request._paramCount = 0;
+    request._paramNamesP = progmem;
+
+    for (;;) {
+        char c = progmem ? pgm_read_byte(pattern) : *pattern;
+        // Only look past a '*': past the terminator there is nothing to read
+        char next = c != '*' ? c : progmem ? pgm_read_byte(pattern + 1) : pattern[1];
+
+        if (c == ':' || (c == '*' && next == '\0')) {
+            const char* name = c == ':' ? pattern + 1 : pattern;
+            const char* start = path;
+            if (c == ':') {
+                while (*path && *path != '/') path++;
+                if (path == start) return false;
+                do {
+                    pattern++;
+                    c = progmem ? pgm_read_byte(pattern) : *pattern;
+                } while (c && c != '/');
+            } else {
+                path += strlen(path);
+                pattern++;
+            }
+            if (request._paramCount < HTTP_MAX_PARAMS) {
+                HTTPSpan value = {start, (uint16_t)(path - start)};
+                request._params[request._paramCount] = value;
+                request._paramNames[request._paramCount] = name;
+                request._paramCount++;
+            }
+            continue;
+        }
+
+        if (c != *path) return false;
+        if (c == '\0') return true;
+        pattern++;
+        path++;
+    }
 }
 
-bool HTTPServer::matchRoute(const String& method, const String& path, Route& matchedRoute) {
+// Find the route for a request. Returns 0xFF when one matched (copied to
+// matchedRoute), otherwise the methods the path accepts, 0 for none.
+uint8_t HTTPServer::matchRoute(uint8_t method, const char* path, HTTPRequest& request,
+                               HTTPRoute& matchedRoute) {
+    uint8_t allowed = 0;
+
+    for (uint8_t i = 0; i < _routeTableCount; i++) {
+        HTTPRoute route;
+        memcpy_P(&route, &_routeTable[i], sizeof(route));
+        // Check the cheap method bit first, the path only if it could matter
+        if (!(route.methods & method) && (allowed & route.methods) == route.methods) continue;
+        if (!matchPath(route.path, true, path, request)) continue;
+        if (route.methods & method) {
+            matchedRoute = route;
+            return 0xFF;
+        }
+        allowed |= route.methods;
+    }
+
     for (uint8_t i = 0; i < _routeCount; i++) {
-        if (_routes[i].method == method && _routes[i].path == path) {
-            matchedRoute = _routes[i];
-            return true;
+        const HTTPRoute& route = _routes[i];
+        if (!(route.methods & method) && (allowed & route.methods) == route.methods) continue;
+        if (!matchPath(route.path, false, path, request)) continue;
+        if (route.methods & method) {
+            matchedRoute = route;
+            return 0xFF;
         }
+        allowed |= route.methods;
     }
-    return false;
+
+    request._paramCount = 0;
+    return allowed & 0x7F;
+}
+
+void HTTPServer::sendMethodNotAllowed(HTTPResponseWriter& out, uint8_t allowed) {
+    char list[48] = "";
+    for (uint8_t i = 0; i < METHOD_COUNT; i++) {
+        if (!(allowed & (1 << i))) continue;
+        if (list[0]) strcat(list, ", ");
+        strcat(list, methodNames[i]);
+    }
+
+    out.begin(405);
+    out.header("Allow", list);
+    out.contentType(HTTP_CONTENT_TYPE_PLAIN);
+    out.contentLength(18);
+    out.print("Method Not Allowed");
 }
 
 HTTPResponse HTTPServer::defaultNotFoundHandler(const HTTPRequest& request) {
@@ -4,30 +4,102 @@
 #include "Arduino.h"
 #include "EthernetServer.h"
 #include "EthernetClient.h"
+#include "HTTPAsset.h"
+#include "HTTPParser.h"
 #include "HTTPRequest.h"
 #include "HTTPResponse.h"
+#include "HTTPResponseWriter.h"
 #include "HTTPConfig.h"
 
 // Forward declaration for request handler function type
 typedef HTTPResponse (*RequestHandler)(const HTTPRequest& request);
 
-struct Route {
-    String method;
-    String path;
+// Handler that streams its response through the writer instead of returning it
+typedef void (*StreamingRequestHandler)(const HTTPRequest& request, HTTPResponseWriter& response);
+
+// Request methods, as bits so a route can accept several
+class HTTPMethod {
+public:
+    static const uint8_t GET = 0x01;
+    static const uint8_t POST = 0x02;
+    static const uint8_t PUT = 0x04;
+    static const uint8_t DELETE = 0x08;
+    static const uint8_t PATCH = 0x10;
+    static const uint8_t HEAD = 0x20;
+    static const uint8_t OPTIONS = 0x40;
+    static const uint8_t ANY = 0x7F;
+};
+
+/*
+ * A route: the methods it accepts, a path pattern and its handler
+ *
+ * Patterns are matched segment by segment without copying the path.
+ * ":name" matches one non-empty segment and "*" at the end matches the rest
+ * of the path (possibly empty); both are captured as parameters, see
+ * HTTPRequest::param(). Routes are tried in the order registered, so put
+ * specific patterns before general ones.
+ *
+ * The pattern is not copied: it must stay valid as long as the server
+ * (a string literal, or PROGMEM in a table given to setRouteTable()).
+ */
+struct HTTPRoute {
+    uint8_t methods;                        // HTTPMethod bits
+    const char* path;
     RequestHandler handler;
+    StreamingRequestHandler streamHandler;  // Used instead of handler when set
+};
+
+// A client connection HTTPServer is reading requests from
+struct HTTPConnection {
+    uint8_t sock;              // MAX_SOCK_NUM when the slot is free
+    uint8_t generation;        // Socket generation when the slot was taken
+    uint8_t requests;          // Requests served on this connection
+    unsigned long lastActive;  // millis() of the last data received or response sent
+    HTTPRequestParser parser;
 };
 
+/*
+ * Connections are persistent (HTTP/1.1 keep-alive) and serviced without
+ * blocking: each handleClient() call reads whatever has arrived on every
+ * connection with data, answers the requests that are complete and closes
+ * connections in the background (EthernetClient::stopAsync()). Up to
+ * HTTP_MAX_CONNECTIONS clients can have requests in progress at once; an
+ * idle keep-alive connection gives up its slot to a new client.
+ */
 class HTTPServer {
 private:
+    EthernetClass* _ethernet;
+    EthernetChip* _chip;
     EthernetServer _server;
-    Route _routes[HTTP_MAX_ROUTES];  // Support for configurable routes
+    HTTPRoute _routes[HTTP_MAX_ROUTES];  // Registered with on()
     uint8_t _routeCount;
+    const HTTPRoute* _routeTable;        // PROGMEM, from setRouteTable()
+    uint8_t _routeTableCount;
     RequestHandler _defaultHandler;
+    HTTPConnection _connections[HTTP_MAX_CONNECTIONS];
+    HTTPBodyStream _body;
+    uint16_t _keepAliveTimeout;
+    uint8_t _maxRequests;
+    const HTTPAsset* _assets;  // PROGMEM table
+    uint8_t _assetCount;
     
     // Helper methods
-    String readRequestFromClient(EthernetClient& client);
-    void sendResponseToClient(EthernetClient& client, const HTTPResponse& response);
-    bool matchRoute(const String& method, const String& path, Route& matchedRoute);
+    HTTPConnection* connectionFor(uint8_t sock);
+    void serviceConnection(HTTPConnection& conn, EthernetClient& client);
+    bool dispatch(HTTPConnection& conn, EthernetClient& client);
+    void closeConnection(HTTPConnection& conn, EthernetClient& client);
+    void sendError(EthernetClient& client, int statusCode);
+    void sendResponseToClient(HTTPResponseWriter& out, const HTTPResponse& response);
+    void sendMethodNotAllowed(HTTPResponseWriter& out, uint8_t allowed);
+    static bool matchPath(const char* pattern, bool progmem, const char* path,
+                          HTTPRequest& request);
+    uint8_t matchRoute(uint8_t method, const char* path, HTTPRequest& request,
+                       HTTPRoute& matchedRoute);
+    void addRoute(uint8_t methods, const char* path, RequestHandler handler,
+                  StreamingRequestHandler streamHandler);
+    bool findAsset(const char* path, bool gzip, HTTPAsset& found);
+    void sendAsset(const HTTPAsset& asset, const HTTPRequestParser& request,
+                   HTTPResponseWriter& out, EthernetClient& client);
     HTTPResponse defaultNotFoundHandler(const HTTPRequest& request);
     
 public:
@@ -36,16 +108,43 @@ public:
     // Server lifecycle
     void begin();
     void handleClient();
+
+    // Keep connections open for further requests. A timeout of 0 closes
+    // every connection after one response.
+    void setKeepAlive(uint16_t timeout, uint8_t maxRequests = HTTP_KEEPALIVE_MAX_REQUESTS);
+
+    // Connections with a request in progress or kept alive
+    uint8_t connectionCount() const;
     
-    // Route management
-    void on(const String& method, const String& path, RequestHandler handler);
-    void onGET(const String& path, RequestHandler handler);
-    void onPOST(const String& path, RequestHandler handler);
-    void onPUT(const String& path, RequestHandler handler);
-    void onDELETE(const String& path, RequestHandler handler);
+    // Route management; path patterns are kept by pointer (see HTTPRoute)
+    void on(const char* method, const char* path, RequestHandler handler);
+    void on(uint8_t methods, const char* path, RequestHandler handler);
+    void onGET(const char* path, RequestHandler handler);
+    void onPOST(const char* path, RequestHandler handler);
+    void onPUT(const char* path, RequestHandler handler);
+    void onDELETE(const char* path, RequestHandler handler);
+
+    // Streaming routes
+    void on(const char* method, const char* path, StreamingRequestHandler handler);
+    void on(uint8_t methods, const char* path, StreamingRequestHandler handler);
+    void onGET(const char* path, StreamingRequestHandler handler);
+    void onPOST(const char* path, StreamingRequestHandler handler);
+    void onPUT(const char* path, StreamingRequestHandler handler);
+    void onDELETE(const char* path, StreamingRequestHandler handler);
+
+    // Routes kept in flash: the table and the patterns it points to are
+    // PROGMEM and cost no RAM. Tried before the routes added with on().
+    void setRouteTable(const HTTPRoute* routes, uint8_t count);
+
+    // HTTPMethod bit of a method name, 0 if unknown
+    static uint8_t methodBit(const char* method);
     
     // Default handler for unmatched routes
     void onNotFound(RequestHandler handler);
+
+    // Serve GET requests for the paths in a PROGMEM asset table (see
+    // HTTPAsset.h) before trying the routes
+    void serveAssets(const HTTPAsset* assets, uint8_t count);
     
     // Static utility methods
     static HTTPResponse send(int statusCode, const String& contentType, const String& content);
@@ -12,6 +12,7 @@
 #include <SPI.h>
 #include <stdint.h>
 
+#include "utility/fast_cs.h"
 #include "utility/socket.h"
 #include "utility/wiznet_registers.h"
 
@@ -21,15 +22,16 @@
     inline void write##name(SOCKET _s, uint8_t _data) override { writeSn(_s, address, _data); } \
     inline uint8_t read##name(SOCKET _s) override { return readSn(_s, address); }
 
-#define __SOCKET_REGISTER16(name, address)                 \
-    void write##name(SOCKET _s, uint16_t _data) override { \
-        writeSn(_s, address, _data >> 8);                  \
-        writeSn(_s, address + 1, _data & 0xFF);            \
-    }                                                      \
-    uint16_t read##name(SOCKET _s) override {              \
-        uint16_t res = readSn(_s, address);                \
-        res = (res << 8) + readSn(_s, address + 1);        \
-        return res;                                        \
+// 16-bit registers are moved as one 2-byte sequential burst (single CS frame)
+#define __SOCKET_REGISTER16(name, address)                                \
+    void write##name(SOCKET _s, uint16_t _data) override {                \
+        uint8_t _buf[2] = {(uint8_t)(_data >> 8), (uint8_t)(_data & 0xFF)}; \
+        writeSn(_s, address, _buf, 2);                                    \
+    }                                                                     \
+    uint16_t read##name(SOCKET _s) override {                             \
+        uint8_t _buf[2];                                                  \
+        readSn(_s, address, _buf, 2);                                     \
+        return ((uint16_t)_buf[0] << 8) | _buf[1];                        \
     }
 
 #define __SOCKET_REGISTER_N(name, address, size)               \
@@ -59,15 +61,15 @@
 #define __GP_REGISTER8(name, address)                                                \
     inline void write##name(uint8_t _data) override { write(address, 0x04, _data); } \
     inline uint8_t read##name() override { return read(address, 0x00); }
-#define __GP_REGISTER16(name, address)              \
-    void write##name(uint16_t _data) override {     \
-        write(address, 0x04, _data >> 8);           \
-        write(address + 1, 0x04, _data & 0xFF);     \
-    }                                               \
-    uint16_t read##name() override {                \
-        uint16_t res = read(address, 0x00);         \
-        res = (res << 8) + read(address + 1, 0x00); \
-        return res;                                 \
+#define __GP_REGISTER16(name, address)                                    \
+    void write##name(uint16_t _data) override {                           \
+        uint8_t _buf[2] = {(uint8_t)(_data >> 8), (uint8_t)(_data & 0xFF)}; \
+        write(address, 0x04, _buf, 2);                                    \
+    }                                                                     \
+    uint16_t read##name() override {                                      \
+        uint8_t _buf[2];                                                  \
+        read(address, 0x00, _buf, 2);                                     \
+        return ((uint16_t)_buf[0] << 8) | _buf[1];                        \
     }
 #define __GP_REGISTER_N(name, address, size)                                                    \
     uint16_t write##name(uint8_t* _buff) override { return write(address, 0x04, _buff, size); } \
@@ -90,16 +92,77 @@
 class EthernetChip {
    protected:
     uint8_t _cs_pin;
+    SPIClass* _spi;       ///< SPI bus the chip is attached to
+    uint32_t _spi_clock;  ///< Active SCLK frequency in Hz
+    ChipSelect _cs;       ///< Chip-select driver (port registers where supported)
+    bool _fast_cs;        ///< Use the port-register chip-select path if available
 
-    inline void initSS() { pinMode(_cs_pin, OUTPUT); }
-    inline void setSS() { digitalWrite(_cs_pin, LOW); }
-    inline void resetSS() { digitalWrite(_cs_pin, HIGH); }
+    bool _initialized;                ///< init() has succeeded; buffer sizes go straight to the chip
+    uint8_t _tx_kb[MAX_SOCK_NUM];     ///< Per-socket TX buffer size in KB
+    uint8_t _rx_kb[MAX_SOCK_NUM];     ///< Per-socket RX buffer size in KB
+    uint16_t _local_port = 1024;      ///< Last ephemeral source port handed out on this chip
+
+    inline void initSS() { _cs.begin(_fast_cs); }
+    inline void setSS() { _cs.select(); }
+    inline void resetSS() { _cs.deselect(); }
+
+    /**
+     * Write the configured per-socket buffer sizes to the chip
+     */
+    virtual void applyBufferSizes() = 0;
+
+    /** @return true if kb is a buffer size the chip can allocate (0, 1, 2, 4, 8 or 16) */
+    static bool validBufferKB(uint8_t kb) {
+        return kb == 0 || kb == 1 || kb == 2 || kb == 4 || kb == 8 || kb == 16;
+    }
+
+   private:
+    /// The socket layer (socket_t.h) keeps its per-socket state here
+    friend struct SocketLayer;
+
+    // Non-blocking send bookkeeping, maintained by sendAsync()/sendPoll() in the socket layer
+    uint8_t _tx_inflight = 0;                ///< Bitmask of sockets with a SEND awaiting SEND_OK
+    uint16_t _tx_staged[MAX_SOCK_NUM] = {};  ///< Bytes written behind Sn_TX_WR but not yet SENT
+    uint16_t _tx_stage_wr[MAX_SOCK_NUM] = {};  ///< Sn_TX_WR as last written while data is staged
+    /// Sn_IR bits (SEND_OK/TIMEOUT) the event engine cleared on the chip but the socket
+    /// layer has not consumed yet
+    uint8_t _ir_latch[MAX_SOCK_NUM] = {};
+
+    // UDP destination last written to Sn_DIPR/Sn_DPORT, so repeat sends to one peer skip it
+    uint8_t _udp_dest_valid = 0;             ///< Sockets whose cached destination is current
+    uint8_t _udp_dip[MAX_SOCK_NUM][4] = {};  ///< Cached Sn_DIPR
+    uint16_t _udp_dport[MAX_SOCK_NUM] = {};  ///< Cached Sn_DPORT
 
    public:
-    const uint16_t SSIZE = 0;  // REDEFINE in derived classes
-    const uint16_t RSIZE = 0;
+    /** @return Bytes sendAsync() has written to a socket's TX memory but not yet SENT */
+    uint16_t txStaged(SOCKET s) const { return _tx_staged[s]; }
+
+    /**
+     * @brief Keep Sn_IR bits an event engine acknowledged for the socket layer
+     * @param s Socket number
+     * @param bits SnIR::SEND_OK and/or SnIR::TIMEOUT just cleared on the chip
+     */
+    void latchSnIR(SOCKET s, uint8_t bits) { _ir_latch[s] |= bits; }
+
+    /** @return Next ephemeral source port of this chip, from 1025 up, wrapping to 1024 */
+    uint16_t nextLocalPort() {
+        if (++_local_port == 0) _local_port = 1024;
+        return _local_port;
+    }
 
-    EthernetChip(uint8_t cs_pin) : _cs_pin(cs_pin) {}
+    EthernetChip(uint8_t cs_pin, SPIClass* spi = &SPI, uint32_t spi_clock = 8000000,
+                 uint8_t buffer_kb = 2)
+        : _cs_pin(cs_pin),
+          _spi(spi),
+          _spi_clock(spi_clock),
+          _cs(cs_pin),
+          _fast_cs(true),
+          _initialized(false) {
+        for (int i = 0; i < MAX_SOCK_NUM; i++) {
+            _tx_kb[i] = buffer_kb;
+            _rx_kb[i] = buffer_kb;
+        }
+    }
 
     /**
      * Initialize the chip
@@ -130,6 +193,85 @@ class EthernetChip {
      */
     uint8_t getCSPin() const { return _cs_pin; }
 
+    // ---------------------------------------------------------------------
+    // SPI transport configuration
+    // ---------------------------------------------------------------------
+    /**
+     * Select the SPI bus the chip is wired to (defaults to the global SPI).
+     * Must be called before init().
+     */
+    void setSPIBus(SPIClass* spi) { _spi = spi; }
+    /** Get the SPI bus in use */
+    SPIClass* getSPIBus() const { return _spi; }
+    /**
+     * Request an SCLK frequency in Hz. init() verifies the chip responds at
+     * this speed and lowers it if it does not.
+     */
+    virtual void setSPIClock(uint32_t hz) { _spi_clock = hz; }
+    /** Get the active SCLK frequency in Hz (after any init() fallback) */
+    uint32_t getSPIClock() const { return _spi_clock; }
+    /**
+     * Enable or disable the port-register chip-select path (enabled by default).
+     * Must be called before init(). Disabled, CS is driven with digitalWrite().
+     */
+    void setFastChipSelect(bool enable) { _fast_cs = enable; }
+    /** @return true if chip select is being driven through port registers */
+    bool fastChipSelectActive() const { return _cs.isFast(); }
+
+    // ---------------------------------------------------------------------
+    // Socket buffer memory allocation
+    // ---------------------------------------------------------------------
+    /** Total TX (and, separately, RX) buffer memory the chip shares between sockets, in KB */
+    virtual uint8_t bufferMemoryKB() = 0;
+
+    /**
+     * Set the TX and RX buffer sizes of every socket.
+     * @param tx_kb maxSockets() TX sizes in KB, each 0, 1, 2, 4, 8 or 16
+     * @param rx_kb maxSockets() RX sizes in KB, each 0, 1, 2, 4, 8 or 16
+     * @return false (and nothing changed) if a size is invalid or a pool total exceeds
+     *         bufferMemoryKB()
+     *
+     * May be called before or after init(); after init() the sizes are written
+     * to the chip immediately, so affected sockets should be closed first.
+     */
+    bool setSocketBufferSizes(const uint8_t* tx_kb, const uint8_t* rx_kb) {
+        uint16_t tx_total = 0, rx_total = 0;
+        for (uint8_t i = 0; i < maxSockets(); i++) {
+            if (!validBufferKB(tx_kb[i]) || !validBufferKB(rx_kb[i])) return false;
+            tx_total += tx_kb[i];
+            rx_total += rx_kb[i];
+        }
+        if (tx_total > bufferMemoryKB() || rx_total > bufferMemoryKB()) return false;
+
+        for (uint8_t i = 0; i < maxSockets(); i++) {
+            _tx_kb[i] = tx_kb[i];
+            _rx_kb[i] = rx_kb[i];
+        }
+        if (_initialized) applyBufferSizes();
+        return true;
+    }
+
+    /**
+     * Set the TX and RX buffer sizes of one socket, leaving the others unchanged.
+     * @return false if a size is invalid or the new totals would not fit
+     */
+    bool setSocketBufferSize(SOCKET s, uint8_t tx_kb, uint8_t rx_kb) {
+        if (s >= maxSockets()) return false;
+        uint8_t tx[MAX_SOCK_NUM], rx[MAX_SOCK_NUM];
+        for (uint8_t i = 0; i < maxSockets(); i++) {
+            tx[i] = _tx_kb[i];
+            rx[i] = _rx_kb[i];
+        }
+        tx[s] = tx_kb;
+        rx[s] = rx_kb;
+        return setSocketBufferSizes(tx, rx);
+    }
+
+    /** Size of a socket's TX buffer in bytes; the most a single send can carry */
+    uint16_t txBufferSize(SOCKET s) const { return (uint16_t)_tx_kb[s] << 10; }
+    /** Size of a socket's RX buffer in bytes */
+    uint16_t rxBufferSize(SOCKET s) const { return (uint16_t)_rx_kb[s] << 10; }
+
     // ---------------------------------------------------------------------
     // Common network configuration accessors (must be implemented)
     // ---------------------------------------------------------------------
@@ -229,10 +371,28 @@ class EthernetChip {
     __SOCKET_REGISTER16_DEF(SnRX_RSR)  // RX Free Size
     __SOCKET_REGISTER16_DEF(SnRX_RD)   // RX Read Pointer
     __SOCKET_REGISTER16_DEF(SnRX_WR)   // RX Write Pointer (supported?)
+    __SOCKET_REGISTER8_DEF(SnIMR)      // Interrupt Mask
 
     virtual uint16_t getTXFreeSize(uint8_t sock) = 0;
     virtual uint16_t getRXReceivedSize(uint8_t sock) = 0;
 
+    /**
+     * @brief Read a socket's status and pointer registers in burst transfers
+     * @param s Socket number
+     * @param snap Snapshot to fill
+     * @param parts SnSnapshot::STATUS, SnSnapshot::POINTERS or SnSnapshot::ALL;
+     *        fields of parts not requested are left untouched
+     */
+    virtual void readSnBlock(SOCKET s, SnSnapshot& snap, uint8_t parts = SnSnapshot::ALL) = 0;
+
+    /**
+     * @brief Copy application data into the socket's TX memory at a known offset
+     *
+     * Counterpart of read_data(): the caller supplies the TX pointer (usually
+     * from a snapshot) and is responsible for advancing Sn_TX_WR afterwards.
+     */
+    virtual void write_data(SOCKET s, uint16_t dst, const uint8_t* src, uint16_t len) = 0;
+
     virtual uint8_t readSn(SOCKET _s, uint16_t _addr) = 0;
     virtual uint8_t writeSn(SOCKET _s, uint16_t _addr, uint8_t _data) = 0;
     virtual uint16_t readSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t len) = 0;
@@ -258,6 +418,9 @@ class EthernetChip {
     __GP_REGISTER_N_DEF(UIPR);    // Unreachable IP address in UDP mode
     __GP_REGISTER16_DEF(UPORT);   // Unreachable Port address in UDP mode
     __GP_REGISTER8_DEF(PHYCFGR);  // PHY Configuration register, default value: 0b 1011 1xxx
+    __GP_REGISTER16_DEF(INTLEVEL);  // Interrupt Low Level Timer
+    __GP_REGISTER8_DEF(SIR);        // Socket Interrupt (one bit per socket)
+    __GP_REGISTER8_DEF(SIMR);       // Socket Interrupt Mask
 };
 
 #endif  // ETHERNET_CHIP_H
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "w5500sim.h"
+
+/*
+ * W5500 register-level simulator
+ *
+ * Block select (control byte bits 7..3): 0 common registers, then for socket
+ * n, 1 + 4n its registers, 2 + 4n its TX memory and 3 + 4n its RX memory.
+ * Bit 2 is the write flag, which the addressing below does not need.
+ */
+
+// PHYCFGR after reset with the link up: reset released, all-capable auto-negotiation,
+// 100 Mbps full duplex
+static const uint8_t SIM_PHYCFGR = 0xBF;
+
+W5500Sim::W5500Sim()
+    : EthernetChip(0xFF, &SPI, W5500_SPI_DEFAULT_CLOCK, W5500SIM_MEM_KB / W5500_MAX_SOCK_NUM),
+      _link(true),
+      _refuse(false),
+      _onTransmit(nullptr),
+      _transmitCtx(nullptr) {
+    swReset();
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool W5500Sim::init() {
+    swReset();
+    applyBufferSizes();
+    _initialized = true;
+    return true;
+}
+
+void W5500Sim::swReset() {
+    memset(_common, 0, sizeof(_common));
+    memset(_sn, 0, sizeof(_sn));
+    memset(_rxRead, 0, sizeof(_rxRead));
+
+    _common[0x0019] = 0x07;  // RTR = 2000 (200 ms)
+    _common[0x001A] = 0xD0;
+    _common[0x001B] = 0x08;  // RCR
+    _common[W5500_PHYCFGR] = _link ? SIM_PHYCFGR : (SIM_PHYCFGR & ~W5500PHYCFGR::LNK_ON);
+    _common[W5500_VERSIONR] = W5500_VERSION;
+
+    for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+        _sn[s][0x0012] = 0xFF;  // MSSR
+        _sn[s][0x0013] = 0xFF;
+        _sn[s][0x0016] = 0x80;  // TTL
+        _sn[s][0x001E] = W5500SIM_MEM_KB / W5500_MAX_SOCK_NUM;  // RXBUF_SIZE
+        _sn[s][0x001F] = W5500SIM_MEM_KB / W5500_MAX_SOCK_NUM;  // TXBUF_SIZE
+        _sn[s][0x002C] = 0xFF;  // IMR
+    }
+    layout();
+}
+
+// Place each socket's buffers after the previous socket's, as the chip does
+void W5500Sim::layout() {
+    uint16_t tx = 0, rx = 0;
+    for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+        _txBase[s] = tx;
+        _rxBase[s] = rx;
+        tx += txSize(s);
+        rx += rxSize(s);
+    }
+}
+
+void W5500Sim::applyBufferSizes() {
+    for (int i = 0; i < this->maxSockets(); i++) {
+        uint8_t cntl_byte = (0x0C + (i << 5));
+        write(0x1E, cntl_byte, _rx_kb[i]);  // 0x1E - Sn_RXBUF_SIZE
+        write(0x1F, cntl_byte, _tx_kb[i]);  // 0x1F - Sn_TXBUF_SIZE
+    }
+}
+
+void W5500Sim::setLink(bool up) {
+    _link = up;
+    if (up) {
+        _common[W5500_PHYCFGR] |= W5500PHYCFGR::LNK_ON;
+    } else {
+        _common[W5500_PHYCFGR] &= ~W5500PHYCFGR::LNK_ON;
+    }
+}
+
+uint16_t W5500Sim::get16(SOCKET s, uint8_t addr) const {
+    return ((uint16_t)_sn[s][addr] << 8) | _sn[s][addr + 1];
+}
+
+void W5500Sim::set16(SOCKET s, uint8_t addr, uint16_t value) {
+    _sn[s][addr] = value >> 8;
+    _sn[s][addr + 1] = value & 0xFF;
+}
+
+uint16_t W5500Sim::rxFree(SOCKET s) const {
+    return rxSize(s) - (uint16_t)(get16(s, 0x002A) - _rxRead[s]);
+}
+
+// Bring the registers the chip computes up to date before they are read
+void W5500Sim::refresh(SOCKET s) {
+    // SEND completes at once, so everything up to Sn_TX_RD has left and the buffer is free
+    set16(s, 0x0020, txSize(s));
+    set16(s, 0x0026, get16(s, 0x002A) - _rxRead[s]);
+}
+
+uint8_t W5500Sim::readByte(uint16_t addr, uint8_t cb) {
+    uint8_t bsb = cb >> 3;
+    if (bsb == 0) {
+        if (addr == W5500_SIR) {
+            uint8_t sir = 0;
+            for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+                if (_sn[s][0x0002] & _sn[s][0x002C]) sir |= (1 << s);
+            }
+            return sir;
+        }
+        return addr < COMMON_SIZE ? _common[addr] : 0;
+    }
+
+    SOCKET s = (bsb - 1) >> 2;
+    if (s >= MAX_SOCK_NUM) return 0;
+    switch ((bsb - 1) & 0x03) {
+        case 0:
+            return addr < SN_SIZE ? _sn[s][addr] : 0;
+        case 1:
+            return txSize(s) ? _tx[_txBase[s] + (addr & (txSize(s) - 1))] : 0;
+        case 2:
+            return rxSize(s) ? _rx[_rxBase[s] + (addr & (rxSize(s) - 1))] : 0;
+        default:
+            return 0;
+    }
+}
+
+void W5500Sim::writeByte(uint16_t addr, uint8_t cb, uint8_t data) {
+    uint8_t bsb = cb >> 3;
+    if (bsb == 0) {
+        if (addr >= COMMON_SIZE || addr == W5500_SIR || addr == W5500_VERSIONR) return;
+        if (addr == 0x0000 && (data & WIZ_MR_RST)) {
+            swReset();
+            return;
+        }
+        if (addr == 0x0015) {
+            _common[addr] &= ~data;  // IR: write 1 to clear
+        } else if (addr == W5500_PHYCFGR) {
+            // Link status is read-only
+            _common[addr] = (data & ~W5500PHYCFGR::LNK_ON) | (_link ? W5500PHYCFGR::LNK_ON : 0);
+        } else {
+            _common[addr] = data;
+        }
+        return;
+    }
+
+    SOCKET s = (bsb - 1) >> 2;
+    if (s >= MAX_SOCK_NUM) return;
+    switch ((bsb - 1) & 0x03) {
+        case 0:
+            if (addr >= SN_SIZE) return;
+            switch (addr) {
+                case 0x0001:  // CR: the command completes before the next frame
+                    command(s, data);
+                    break;
+                case 0x0002:  // IR: write 1 to clear
+                    _sn[s][addr] &= ~data;
+                    break;
+                case 0x0003:  // SR, TX_FSR, TX_RD, RX_RSR and RX_WR are read-only
+                case 0x0020:
+                case 0x0021:
+                case 0x0022:
+                case 0x0023:
+                case 0x0026:
+                case 0x0027:
+                case 0x002A:
+                case 0x002B:
+                    break;
+                case 0x001E:  // RXBUF_SIZE / TXBUF_SIZE move every later socket's memory
+                case 0x001F:
+                    _sn[s][addr] = data;
+                    layout();
+                    break;
+                default:
+                    _sn[s][addr] = data;
+                    break;
+            }
+            break;
+        case 1:
+            if (txSize(s)) _tx[_txBase[s] + (addr & (txSize(s) - 1))] = data;
+            break;
+        case 2:
+            if (rxSize(s)) _rx[_rxBase[s] + (addr & (rxSize(s) - 1))] = data;
+            break;
+        default:
+            break;
+    }
+}
+
+uint8_t W5500Sim::write(uint16_t _addr, uint8_t _cb, uint8_t _data) {
+    _stats.writes++;
+    _stats.bytesWritten++;
+    writeByte(_addr, _cb, _data);
+    return 1;
+}
+
+uint16_t W5500Sim::write(uint16_t _addr, uint8_t _cb, const uint8_t* _buf, uint16_t _len) {
+    _stats.writes++;
+    _stats.bytesWritten += _len;
+    for (uint16_t i = 0; i < _len; i++) writeByte(_addr + i, _cb, _buf[i]);
+    return _len;
+}
+
+uint8_t W5500Sim::read(uint16_t _addr, uint8_t _cb) {
+    uint8_t data;
+    read(_addr, _cb, &data, 1);
+    return data;
+}
+
+uint16_t W5500Sim::read(uint16_t _addr, uint8_t _cb, uint8_t* _buf, uint16_t _len) {
+    _stats.reads++;
+    _stats.bytesRead += _len;
+    uint8_t bsb = _cb >> 3;
+    if (bsb != 0 && ((bsb - 1) & 0x03) == 0 && ((bsb - 1) >> 2) < MAX_SOCK_NUM) {
+        refresh((bsb - 1) >> 2);
+    }
+    for (uint16_t i = 0; i < _len; i++) _buf[i] = readByte(_addr + i, _cb);
+    return _len;
+}
+
+void W5500Sim::execCmdSn(SOCKET s, SockCMD _cmd) {
+    // Send command to socket
+    writeSnCR(s, _cmd);
+    // Wait for command to complete
+    while (readSnCR(s));
+}
+
+void W5500Sim::command(SOCKET s, uint8_t cmd) {
+    uint8_t& sr = _sn[s][0x0003];
+    uint8_t& ir = _sn[s][0x0002];
+    _stats.commands++;
+
+    switch (cmd) {
+        case Sock_OPEN:
+            switch (_sn[s][0x0000] & 0x0F) {
+                case SnMR::TCP:
+                    sr = SnSR::INIT;
+                    break;
+                case SnMR::UDP:
+                    sr = SnSR::UDP;
+                    break;
+                case SnMR::IPRAW:
+                    sr = SnSR::IPRAW;
+                    break;
+                case SnMR::MACRAW:
+                    sr = s == 0 ? SnSR::MACRAW : SnSR::CLOSED;
+                    break;
+                default:
+                    sr = SnSR::CLOSED;
+                    break;
+            }
+            ir = 0;
+            set16(s, 0x0022, 0);
+            set16(s, 0x0024, 0);
+            set16(s, 0x0028, 0);
+            set16(s, 0x002A, 0);
+            _rxRead[s] = 0;
+            break;
+        case Sock_LISTEN:
+            if (sr == SnSR::INIT) sr = SnSR::LISTEN;
+            break;
+        case Sock_CONNECT:
+            if (sr != SnSR::INIT) break;
+            if (_refuse) {
+                ir |= SnIR::TIMEOUT;
+                sr = SnSR::CLOSED;
+            } else {
+                ir |= SnIR::CON;
+                sr = SnSR::ESTABLISHED;
+            }
+            break;
+        case Sock_DISCON:
+            if (sr == SnSR::ESTABLISHED || sr == SnSR::CLOSE_WAIT) {
+                ir |= SnIR::DISCON;
+                sr = SnSR::CLOSED;
+            }
+            break;
+        case Sock_CLOSE:
+            sr = SnSR::CLOSED;
+            break;
+        case Sock_SEND:
+        case Sock_SEND_MAC:
+            if (sr == SnSR::ESTABLISHED || sr == SnSR::CLOSE_WAIT || sr == SnSR::UDP ||
+                sr == SnSR::IPRAW || sr == SnSR::MACRAW) {
+                transmit(s);
+                ir |= SnIR::SEND_OK;
+            }
+            break;
+        case Sock_RECV:
+            _rxRead[s] = get16(s, 0x0028);
+            // Data still waiting raises RECV again
+            if (get16(s, 0x002A) != _rxRead[s]) ir |= SnIR::RECV;
+            break;
+        default:
+            break;
+    }
+    _sn[s][0x0001] = 0;
+}
+
+// Hand everything between Sn_TX_RD and Sn_TX_WR to the transmit handler, in two pieces
+// if it wraps around the end of the socket's buffer
+void W5500Sim::transmit(SOCKET s) {
+    uint16_t size = txSize(s);
+    uint16_t rd = get16(s, 0x0022);
+    uint16_t wr = get16(s, 0x0024);
+    uint16_t len = wr - rd;
+    if (size == 0 || len == 0) return;
+    if (len > size) len = size;
+
+    if (_onTransmit) {
+        uint16_t offset = rd & (size - 1);
+        uint16_t first = size - offset < len ? size - offset : len;
+        _onTransmit(_transmitCtx, s, _tx + _txBase[s] + offset, first);
+        if (first < len) _onTransmit(_transmitCtx, s, _tx + _txBase[s], len - first);
+    }
+    set16(s, 0x0022, wr);
+}
+
+void W5500Sim::putRX(SOCKET s, const uint8_t* data, uint16_t len) {
+    uint16_t size = rxSize(s);
+    uint16_t wr = get16(s, 0x002A);
+    for (uint16_t i = 0; i < len; i++) {
+        _rx[_rxBase[s] + ((uint16_t)(wr + i) & (size - 1))] = data[i];
+    }
+    set16(s, 0x002A, wr + len);
+}
+
+bool W5500Sim::peerConnect(SOCKET s, const uint8_t* ip, uint16_t port) {
+    if (s >= MAX_SOCK_NUM || _sn[s][0x0003] != SnSR::LISTEN) return false;
+    memcpy(&_sn[s][0x000C], ip, 4);
+    set16(s, 0x0010, port);
+    _sn[s][0x0003] = SnSR::ESTABLISHED;
+    _sn[s][0x0002] |= SnIR::CON;
+    return true;
+}
+
+uint16_t W5500Sim::peerSend(SOCKET s, const uint8_t* data, uint16_t len) {
+    if (s >= MAX_SOCK_NUM || _sn[s][0x0003] != SnSR::ESTABLISHED) return 0;
+    uint16_t room = rxFree(s);
+    if (len > room) len = room;
+    if (len == 0) return 0;
+    putRX(s, data, len);
+    _sn[s][0x0002] |= SnIR::RECV;
+    return len;
+}
+
+bool W5500Sim::peerSendUDP(SOCKET s, const uint8_t* ip, uint16_t port, const uint8_t* data,
+                           uint16_t len) {
+    if (s >= MAX_SOCK_NUM || _sn[s][0x0003] != SnSR::UDP) return false;
+    if ((uint32_t)len + 8 > rxFree(s)) return false;
+    uint8_t head[8] = {ip[0], ip[1], ip[2], ip[3], (uint8_t)(port >> 8), (uint8_t)(port & 0xFF),
+                       (uint8_t)(len >> 8), (uint8_t)(len & 0xFF)};
+    putRX(s, head, 8);
+    putRX(s, data, len);
+    _sn[s][0x0002] |= SnIR::RECV;
+    return true;
+}
+
+bool W5500Sim::peerSendRaw(SOCKET s, const uint8_t* frame, uint16_t len) {
+    if (s >= MAX_SOCK_NUM || _sn[s][0x0003] != SnSR::MACRAW) return false;
+    if ((uint32_t)len + 2 > rxFree(s)) return false;
+    // The length prefix counts itself
+    uint16_t total = len + 2;
+    uint8_t head[2] = {(uint8_t)(total >> 8), (uint8_t)(total & 0xFF)};
+    putRX(s, head, 2);
+    putRX(s, frame, len);
+    _sn[s][0x0002] |= SnIR::RECV;
+    return true;
+}
+
+void W5500Sim::peerClose(SOCKET s) {
+    if (s >= MAX_SOCK_NUM || _sn[s][0x0003] != SnSR::ESTABLISHED) return;
+    _sn[s][0x0003] = SnSR::CLOSE_WAIT;
+    _sn[s][0x0002] |= SnIR::DISCON;
+}
+
+void W5500Sim::readSnBlock(SOCKET s, SnSnapshot& snap, uint8_t parts) {
+    uint8_t buf[12];
+    if (parts & SnSnapshot::STATUS) {
+        // Sn_IR (0x0002) and Sn_SR (0x0003) are adjacent
+        readSn(s, 0x0002, buf, 2);
+        snap.ir = buf[0];
+        snap.sr = buf[1];
+    }
+    if (parts & SnSnapshot::POINTERS) {
+        // Sn_TX_FSR (0x0020) through Sn_RX_WR (0x002A) are contiguous
+        readSn(s, 0x0020, buf, 12);
+        snap.tx_fsr = ((uint16_t)buf[0] << 8) | buf[1];
+        snap.tx_rd = ((uint16_t)buf[2] << 8) | buf[3];
+        snap.tx_wr = ((uint16_t)buf[4] << 8) | buf[5];
+        snap.rx_rsr = ((uint16_t)buf[6] << 8) | buf[7];
+        snap.rx_rd = ((uint16_t)buf[8] << 8) | buf[9];
+        snap.rx_wr = ((uint16_t)buf[10] << 8) | buf[11];
+    }
+}
+
+void W5500Sim::write_data(SOCKET s, uint16_t dst, const uint8_t* src, uint16_t len) {
+    uint8_t cntl_byte = (0x14 + (s << 5));
+    write(dst, cntl_byte, src, len);
+}
+
+void W5500Sim::send_data_processing(SOCKET s, const uint8_t* data, uint16_t len) {
+    send_data_processing_offset(s, 0, data, len);
+}
+
+void W5500Sim::send_data_processing_offset(SOCKET s, uint16_t data_offset, const uint8_t* data,
+                                           uint16_t len) {
+    uint16_t ptr = readSnTX_WR(s);
+    ptr += data_offset;
+    write_data(s, ptr, data, len);
+    ptr += len;
+    writeSnTX_WR(s, ptr);
+}
+
+void W5500Sim::recv_data_processing(SOCKET s, uint8_t* data, uint16_t len, uint8_t peek) {
+    uint16_t ptr = readSnRX_RD(s);
+    read_data(s, ptr, data, len);
+    if (!peek) {
+        ptr += len;
+        writeSnRX_RD(s, ptr);
+    }
+}
+
+void W5500Sim::read_data(SOCKET s, volatile uint16_t src, volatile uint8_t* dst, uint16_t len) {
+    uint8_t cntl_byte = (0x18 + (s << 5));
+    read((uint16_t)src, cntl_byte, (uint8_t*)dst, len);
+}
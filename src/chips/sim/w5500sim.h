@@ -0,0 +1,269 @@
+#ifndef w5500sim_h
+#define w5500sim_h
+
+#include "../EthernetChip.h"
+#include "../utility/socket.h"
+#include "../utility/wiznet_registers.h"
+
+/**
+ * @brief TX and RX memory of the simulated chip in KB, each
+ *
+ * The real chip has 16; 8 halves the simulator's RAM for smaller boards
+ * (each socket then defaults to 1 KB buffers).
+ */
+#ifndef W5500SIM_MEM_KB
+#define W5500SIM_MEM_KB W5500_BUF_MEM_KB
+#endif
+
+/**
+ * @brief SPI traffic counted by the simulator
+ *
+ * A transaction is one chip-select frame, exactly as the W5500 driver would
+ * issue it; bytes are payload bytes, excluding the 3-byte frame header.
+ */
+struct W5500SimStats {
+    uint32_t reads;         ///< Read transactions
+    uint32_t writes;        ///< Write transactions
+    uint32_t bytesRead;     ///< Payload bytes read
+    uint32_t bytesWritten;  ///< Payload bytes written
+    uint32_t commands;      ///< Socket commands issued through Sn_CR
+};
+
+/**
+ * @brief Receives what a simulated socket transmits
+ * @param ctx Context given to onTransmit()
+ * @param s Socket that sent
+ * @param data Bytes sent: TCP payload, a UDP datagram's payload or a raw frame
+ * @param len Number of bytes
+ *
+ * May call the W5500Sim::peer*() functions, e.g. to answer a request.
+ */
+typedef void (*W5500SimTransmitHandler)(void* ctx, SOCKET s, const uint8_t* data, uint16_t len);
+
+/**
+ * @brief W5500 register-level simulator
+ *
+ * An EthernetChip that keeps the W5500 register file, socket state machine and
+ * TX/RX ring memory in RAM instead of on the SPI bus. The driver layers run on
+ * it unchanged, so it measures the SPI transactions and bytes each operation
+ * would cost on the real chip, and lets the library be exercised where no chip
+ * is attached (a host build, or a board without a W5500).
+ *
+ * Registers are addressed exactly as on the W5500 (address plus block select
+ * control byte), and the accessor structure is the W5500 driver's, so every
+ * read() or write() the simulator counts is one CS frame on the real chip.
+ *
+ * The network side is played by the program through the peer*() functions:
+ * a connection to a listening socket is made with peerConnect(), data arrives
+ * with peerSend() or peerSendUDP(), and the peer closes with peerClose(). What
+ * a socket transmits is handed to the onTransmit() handler. CONNECT succeeds
+ * immediately, SEND completes immediately with SEND_OK, and DISCON completes
+ * immediately, so blocking calls never wait.
+ *
+ * Uses 2 * W5500SIM_MEM_KB KB of RAM for socket memory.
+ */
+class W5500Sim final : public EthernetChip {
+   protected:
+    static const uint8_t COMMON_SIZE = 0x40;  // Common registers modelled (through VERSIONR)
+    static const uint8_t SN_SIZE = 0x30;      // Socket registers modelled (through KPALVTR)
+
+    uint8_t _common[COMMON_SIZE];
+    uint8_t _sn[MAX_SOCK_NUM][SN_SIZE];
+    uint8_t _tx[W5500SIM_MEM_KB << 10];
+    uint8_t _rx[W5500SIM_MEM_KB << 10];
+    uint16_t _txBase[MAX_SOCK_NUM];  ///< Offset of each socket's TX buffer in _tx
+    uint16_t _rxBase[MAX_SOCK_NUM];  ///< Offset of each socket's RX buffer in _rx
+    uint16_t _rxRead[MAX_SOCK_NUM];  ///< Sn_RX_RD as of the last RECV
+    bool _link;
+    bool _refuse;  ///< CONNECT times out instead of succeeding
+    W5500SimStats _stats;
+    W5500SimTransmitHandler _onTransmit;
+    void* _transmitCtx;
+
+    virtual void applyBufferSizes() override;
+
+    uint16_t get16(SOCKET s, uint8_t addr) const;
+    void set16(SOCKET s, uint8_t addr, uint16_t value);
+    uint16_t txSize(SOCKET s) const { return (uint16_t)_sn[s][0x1F] << 10; }
+    uint16_t rxSize(SOCKET s) const { return (uint16_t)_sn[s][0x1E] << 10; }
+    uint16_t rxFree(SOCKET s) const;
+    void layout();
+    void refresh(SOCKET s);
+    void command(SOCKET s, uint8_t cmd);
+    void transmit(SOCKET s);
+    void putRX(SOCKET s, const uint8_t* data, uint16_t len);
+    uint8_t readByte(uint16_t addr, uint8_t cb);
+    void writeByte(uint16_t addr, uint8_t cb, uint8_t data);
+
+   public:
+    W5500Sim();
+
+    /**
+     * @brief Reset the simulated chip
+     * @return Always true
+     *
+     * Touches no hardware: the chip-select pin and SPI bus are never used.
+     */
+    virtual bool init() override;
+    virtual void setSPIClock(uint32_t hz) override { _spi_clock = hz; }
+    virtual bool linkActive() override { return _link; }
+    virtual uint8_t getChipType() override { return readMR() & 0x07; }
+    virtual void swReset() override;
+    virtual uint8_t bufferMemoryKB() override { return W5500SIM_MEM_KB; }
+
+    virtual void setGatewayIp(uint8_t* addr) override { writeGAR(addr); }
+    virtual void getGatewayIp(uint8_t* addr) override { readGAR(addr); }
+    virtual void setSubnetMask(uint8_t* addr) override { writeSUBR(addr); }
+    virtual void getSubnetMask(uint8_t* addr) override { readSUBR(addr); }
+    virtual void setMACAddress(uint8_t* addr) override { writeSHAR(addr); }
+    virtual void getMACAddress(uint8_t* addr) override { readSHAR(addr); }
+    virtual void setIPAddress(uint8_t* addr) override { writeSIPR(addr); }
+    virtual void getIPAddress(uint8_t* addr) override { readSIPR(addr); }
+    virtual void setRetransmissionTime(uint16_t timeout) override { writeRTR(timeout); }
+    virtual void setRetransmissionCount(uint8_t retry) override { writeRCR(retry); }
+
+    virtual void read_data(SOCKET s, volatile uint16_t src, volatile uint8_t* dst,
+                           uint16_t len) override;
+    virtual void send_data_processing(SOCKET s, const uint8_t* data, uint16_t len) override;
+    virtual void send_data_processing_offset(SOCKET s, uint16_t data_offset, const uint8_t* data,
+                                             uint16_t len) override;
+    virtual void recv_data_processing(SOCKET s, uint8_t* data, uint16_t len,
+                                      uint8_t peek = 0) override;
+
+    virtual void setPHYCFGR(uint8_t val) override { writePHYCFGR(val); }
+    virtual uint8_t getPHYCFGR() override { return readPHYCFGR(); }
+
+    virtual uint8_t maxSockets() override { return W5500_MAX_SOCK_NUM; }
+    virtual uint16_t getTXFreeSize(SOCKET s) override { return readSnTX_FSR(s); }
+    virtual uint16_t getRXReceivedSize(SOCKET s) override { return readSnRX_RSR(s); }
+
+    virtual void readSnBlock(SOCKET s, SnSnapshot& snap,
+                             uint8_t parts = SnSnapshot::ALL) override;
+    virtual void write_data(SOCKET s, uint16_t dst, const uint8_t* src, uint16_t len) override;
+
+    // Socket register block select: read (s << 5) + 0x08, write (s << 5) + 0x0C
+    uint8_t readSn(SOCKET _s, uint16_t _addr) override { return read(_addr, (_s << 5) + 0x08); }
+    uint8_t writeSn(SOCKET _s, uint16_t _addr, uint8_t _data) override {
+        return write(_addr, (_s << 5) + 0x0C, _data);
+    }
+    uint16_t readSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t _len) override {
+        return read(_addr, (_s << 5) + 0x08, _buf, _len);
+    }
+    uint16_t writeSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t _len) override {
+        return write(_addr, (_s << 5) + 0x0C, _buf, _len);
+    }
+
+    /** One SPI write frame of a single byte */
+    uint8_t write(uint16_t _addr, uint8_t _cb, uint8_t _data) override;
+    /** One SPI write frame of _len bytes at sequential addresses */
+    uint16_t write(uint16_t _addr, uint8_t _cb, const uint8_t* _buf, uint16_t _len) override;
+    /** One SPI read frame of a single byte */
+    uint8_t read(uint16_t _addr, uint8_t _cb) override;
+    /** One SPI read frame of _len bytes at sequential addresses */
+    uint16_t read(uint16_t _addr, uint8_t _cb, uint8_t* _buf, uint16_t _len) override;
+
+    virtual void execCmdSn(SOCKET s, SockCMD _cmd) override;
+
+    /** Read the chip version register (0x04, as on a W5500) */
+    uint8_t readVERSIONR() { return read(W5500_VERSIONR, 0x00); }
+
+    __SOCKET_REGISTER8(SnMR, 0x0000)        // Mode
+    __SOCKET_REGISTER8(SnCR, 0x0001)        // Command
+    __SOCKET_REGISTER8(SnIR, 0x0002)        // Interrupt
+    __SOCKET_REGISTER8(SnSR, 0x0003)        // Status
+    __SOCKET_REGISTER16(SnPORT, 0x0004)     // Source Port
+    __SOCKET_REGISTER_N(SnDHAR, 0x0006, 6)  // Destination Hardw Addr
+    __SOCKET_REGISTER_N(SnDIPR, 0x000C, 4)  // Destination IP Addr
+    __SOCKET_REGISTER16(SnDPORT, 0x0010)    // Destination Port
+    __SOCKET_REGISTER16(SnMSSR, 0x0012)     // Max Segment Size
+    __SOCKET_REGISTER8(SnPROTO, 0x0014)     // Protocol in IP RAW Mode
+    __SOCKET_REGISTER8(SnTOS, 0x0015)       // IP TOS
+    __SOCKET_REGISTER8(SnTTL, 0x0016)       // IP TTL
+    __SOCKET_REGISTER16(SnTX_FSR, 0x0020)   // TX Free Size
+    __SOCKET_REGISTER16(SnTX_RD, 0x0022)    // TX Read Pointer
+    __SOCKET_REGISTER16(SnTX_WR, 0x0024)    // TX Write Pointer
+    __SOCKET_REGISTER16(SnRX_RSR, 0x0026)   // RX Free Size
+    __SOCKET_REGISTER16(SnRX_RD, 0x0028)    // RX Read Pointer
+    __SOCKET_REGISTER16(SnRX_WR, 0x002A)    // RX Write Pointer
+    __SOCKET_REGISTER8(SnIMR, 0x002C)       // Interrupt Mask
+
+    __GP_REGISTER8(MR, 0x0000);        // Mode
+    __GP_REGISTER_N(GAR, 0x0001, 4);   // Gateway IP address
+    __GP_REGISTER_N(SUBR, 0x0005, 4);  // Subnet mask address
+    __GP_REGISTER_N(SHAR, 0x0009, 6);  // Source MAC address
+    __GP_REGISTER_N(SIPR, 0x000F, 4);  // Source IP address
+    __GP_REGISTER8(IR, 0x0015);        // Interrupt
+    __GP_REGISTER8(IMR, 0x0016);       // Interrupt Mask
+    __GP_REGISTER16(RTR, 0x0019);      // Timeout address
+    __GP_REGISTER8(RCR, 0x001B);       // Retry count
+    __GP_REGISTER_N(UIPR, 0x0028, 4);  // Unreachable IP address in UDP mode
+    __GP_REGISTER16(UPORT, 0x002C);    // Unreachable Port address in UDP mode
+    __GP_REGISTER8(PHYCFGR, 0x002E);   // PHY Configuration register
+    __GP_REGISTER16(INTLEVEL, 0x0013); // Interrupt Low Level Timer
+    __GP_REGISTER8(SIR, 0x0017);       // Socket Interrupt (one bit per socket)
+    __GP_REGISTER8(SIMR, 0x0018);      // Socket Interrupt Mask
+
+    // ---------------------------------------------------------------------
+    // Instrumentation
+    // ---------------------------------------------------------------------
+    /** SPI traffic since construction or the last resetStats() */
+    const W5500SimStats& stats() const { return _stats; }
+    /** Clear the SPI counters */
+    void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+    // ---------------------------------------------------------------------
+    // Simulated network
+    // ---------------------------------------------------------------------
+    /** Report the link as up or down (up by default) */
+    void setLink(bool up);
+    /** Make CONNECT time out (TIMEOUT, then CLOSED) instead of succeeding */
+    void setConnectRefused(bool refuse) { _refuse = refuse; }
+    /**
+     * @brief Set the function that receives transmitted data
+     * @param handler Handler, or nullptr to discard transmitted data
+     * @param ctx Passed to the handler
+     */
+    void onTransmit(W5500SimTransmitHandler handler, void* ctx = nullptr) {
+        _onTransmit = handler;
+        _transmitCtx = ctx;
+    }
+
+    /**
+     * @brief Connect a remote peer to a listening TCP socket
+     * @return false if the socket is not in LISTEN
+     *
+     * The socket goes to ESTABLISHED and raises CON.
+     */
+    bool peerConnect(SOCKET s, const uint8_t* ip, uint16_t port);
+
+    /**
+     * @brief Deliver TCP data from the peer into the socket's RX memory
+     * @return Bytes accepted, limited by the free RX space (the peer's window)
+     */
+    uint16_t peerSend(SOCKET s, const uint8_t* data, uint16_t len);
+
+    /**
+     * @brief Deliver a UDP datagram, 8-byte header and payload, to a UDP socket
+     * @return false if the socket is not open for UDP or the datagram does not fit
+     */
+    bool peerSendUDP(SOCKET s, const uint8_t* ip, uint16_t port, const uint8_t* data,
+                     uint16_t len);
+
+    /**
+     * @brief Deliver an Ethernet frame to a MACRAW socket
+     * @param frame Frame from the destination MAC on, without FCS
+     * @return false if the socket is not in MACRAW or the frame does not fit
+     *
+     * The chip's Sn_MR filter bits are not applied: every frame is delivered.
+     */
+    bool peerSendRaw(SOCKET s, const uint8_t* frame, uint16_t len);
+
+    /**
+     * @brief Receive a FIN from the peer
+     *
+     * An ESTABLISHED socket goes to CLOSE_WAIT and raises DISCON.
+     */
+    void peerClose(SOCKET s);
+};
+
+#endif  // w5500sim_h
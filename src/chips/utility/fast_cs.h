@@ -0,0 +1,141 @@
+/*
+ * fast_cs.h - Chip-select pin driver for WIZnet chips
+ *
+ * Every register access toggles chip select twice, and on AVR/SAMD a
+ * digitalWrite() costs more than the 4-byte SPI frame it brackets. Where the
+ * architecture is known, the pin's port registers are resolved once in begin()
+ * and CS is driven with a single register store. Unknown architectures, and
+ * pins the fast path can't address, fall back to digitalWrite().
+ *
+ * Define WIZNET_FAST_CS 0 to compile the fast path out entirely.
+ */
+
+#ifndef FAST_CS_H
+#define FAST_CS_H
+
+#include <Arduino.h>
+
+#ifndef WIZNET_FAST_CS
+#define WIZNET_FAST_CS 1
+#endif
+
+#if WIZNET_FAST_CS
+#if defined(ARDUINO_ARCH_AVR)
+#define WIZNET_FAST_CS_AVR
+#elif defined(ARDUINO_ARCH_SAMD)
+#define WIZNET_FAST_CS_SETCLR
+#elif defined(ARDUINO_ARCH_STM32)
+#define WIZNET_FAST_CS_SETCLR
+#elif defined(ARDUINO_ARCH_RP2040)
+#include <hardware/structs/sio.h>
+#define WIZNET_FAST_CS_SETCLR
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <soc/gpio_reg.h>
+#define WIZNET_FAST_CS_SETCLR
+#endif
+#endif
+
+class ChipSelect {
+   private:
+    uint8_t _pin;
+    bool _fast;
+#if defined(WIZNET_FAST_CS_AVR)
+    volatile uint8_t* _out;
+    uint8_t _mask;
+#elif defined(WIZNET_FAST_CS_SETCLR)
+    volatile uint32_t* _set;
+    volatile uint32_t* _clr;
+    uint32_t _setMask;
+    uint32_t _clrMask;
+#endif
+
+   public:
+    ChipSelect(uint8_t pin) : _pin(pin), _fast(false) {}
+
+    /**
+     * @brief Configure the pin as an output and resolve its port registers
+     * @param fast Use the direct register path if this architecture has one
+     */
+    void begin(bool fast = true) {
+        pinMode(_pin, OUTPUT);
+        _fast = false;
+        if (!fast) return;
+#if defined(WIZNET_FAST_CS_AVR)
+        _out = portOutputRegister(digitalPinToPort(_pin));
+        _mask = digitalPinToBitMask(_pin);
+        _fast = (_out != NULL);
+#elif defined(ARDUINO_ARCH_SAMD) && defined(WIZNET_FAST_CS_SETCLR)
+        PortGroup* port = &PORT->Group[g_APinDescription[_pin].ulPort];
+        _set = &port->OUTSET.reg;
+        _clr = &port->OUTCLR.reg;
+        _setMask = _clrMask = 1ul << g_APinDescription[_pin].ulPin;
+        _fast = true;
+#elif defined(ARDUINO_ARCH_STM32) && defined(WIZNET_FAST_CS_SETCLR)
+        PinName pn = digitalPinToPinName(_pin);
+        if (pn == NC) return;
+        GPIO_TypeDef* port = get_GPIO_Port(STM_PORT(pn));
+        // BSRR sets with the low half-word and resets with the high half-word. The
+        // mask is the plain pin bit: on F1 the LL pin constants also carry CRL/CRH bits
+        _set = _clr = &port->BSRR;
+        _setMask = 1ul << STM_PIN(pn);
+        _clrMask = _setMask << 16;
+        _fast = true;
+#elif defined(ARDUINO_ARCH_RP2040) && defined(WIZNET_FAST_CS_SETCLR)
+        _set = &sio_hw->gpio_set;
+        _clr = &sio_hw->gpio_clr;
+        _setMask = _clrMask = 1ul << _pin;
+        _fast = true;
+#elif defined(ARDUINO_ARCH_ESP32) && defined(WIZNET_FAST_CS_SETCLR)
+        if (_pin >= 32) return;  // GPIO32+ live in a second bank; keep digitalWrite
+        _set = (volatile uint32_t*)GPIO_OUT_W1TS_REG;
+        _clr = (volatile uint32_t*)GPIO_OUT_W1TC_REG;
+        _setMask = _clrMask = 1ul << _pin;
+        _fast = true;
+#endif
+    }
+
+    /** @return true if the direct register path is active */
+    bool isFast() const { return _fast; }
+
+    /** Drive CS low (chip selected) */
+    inline void select() {
+#if defined(WIZNET_FAST_CS_AVR)
+        if (_fast) {
+            // Ports are shared with other pins, so the read-modify-write must not
+            // be interrupted
+            uint8_t sreg = SREG;
+            cli();
+            *_out &= ~_mask;
+            SREG = sreg;
+            return;
+        }
+#elif defined(WIZNET_FAST_CS_SETCLR)
+        if (_fast) {
+            *_clr = _clrMask;
+            return;
+        }
+#endif
+        digitalWrite(_pin, LOW);
+    }
+
+    /** Drive CS high (chip released) */
+    inline void deselect() {
+#if defined(WIZNET_FAST_CS_AVR)
+        if (_fast) {
+            uint8_t sreg = SREG;
+            cli();
+            *_out |= _mask;
+            SREG = sreg;
+            return;
+        }
+#elif defined(WIZNET_FAST_CS_SETCLR)
+        if (_fast) {
+            *_set = _setMask;
+            return;
+        }
+#endif
+        digitalWrite(_pin, HIGH);
+    }
+};
+
+#endif  // FAST_CS_H
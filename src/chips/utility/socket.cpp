@@ -4,350 +4,116 @@
  * by Arduino.org team
  */
 
-#include "socket.h"
+#include "socket_t.h"
 
-static uint16_t local_port;
+// Virtual-dispatch entry points: the shared implementation in socket_t.h
+// instantiated with the abstract chip interface.
 
-/**
- * @brief	This Socket function initialize the channel in perticular mode, and set the port and
- * wait for w5500 done it.
- * @return 	1 for success else 0.
- */
 uint8_t socket(EthernetChip* chip, SOCKET s, uint8_t protocol, uint16_t port, uint8_t flag) {
-    if ((protocol == SnMR::TCP) || (protocol == SnMR::UDP) || (protocol == SnMR::IPRAW) ||
-        (protocol == SnMR::MACRAW) || (protocol == SnMR::PPPOE)) {
-        close(chip, s);
-        chip->writeSnMR(s, protocol | flag);
-        if (port != 0) {
-            chip->writeSnPORT(s, port);
-        } else {
-            local_port++;  // if don't set the source port, set local_port number.
-            chip->writeSnPORT(s, local_port);
-        }
-
-        chip->execCmdSn(s, Sock_OPEN);
-
-        return 1;
-    }
-
-    return 0;
+    return socket<EthernetChip>(chip, s, protocol, port, flag);
 }
 
-/**
- * @brief	This function close the socket and parameter is "s" which represent the socket
- * number
- */
-void close(EthernetChip* chip, SOCKET s) {
-    chip->execCmdSn(s, Sock_CLOSE);
-    chip->writeSnIR(s, 0xFF);
-}
+void close(EthernetChip* chip, SOCKET s) { close<EthernetChip>(chip, s); }
 
-/**
- * @brief	This function established  the connection for the channel in passive (server) mode.
- * This function waits for the request from the peer.
- * @return	1 for success else 0.
- */
-uint8_t listen(EthernetChip* chip, SOCKET s) {
-    if (chip->readSnSR(s) != SnSR::INIT) return 0;
-    chip->execCmdSn(s, Sock_LISTEN);
-    return 1;
-}
+uint8_t listen(EthernetChip* chip, SOCKET s) { return listen<EthernetChip>(chip, s); }
 
-/**
- * @brief	This function established  the connection for the channel in Active (client) mode.
- * 		This function waits for the untill the connection is established.
- *
- * @return	1 for success else 0.
- */
 uint8_t connect(EthernetChip* chip, SOCKET s, uint8_t* addr, uint16_t port) {
-    if (((addr[0] == 0xFF) && (addr[1] == 0xFF) && (addr[2] == 0xFF) && (addr[3] == 0xFF)) ||
-        ((addr[0] == 0x00) && (addr[1] == 0x00) && (addr[2] == 0x00) && (addr[3] == 0x00)) ||
-        (port == 0x00))
-        return 0;
-
-    // set destination IP
-    chip->writeSnDIPR(s, addr);
-    chip->writeSnDPORT(s, port);
-    chip->execCmdSn(s, Sock_CONNECT);
-
-    return 1;
+    return connect<EthernetChip>(chip, s, addr, port);
 }
 
-/**
- * @brief	This function used for disconnect the socket and parameter is "s" which represent
- * the socket number
- * @return	1 for success else 0.
- */
-void disconnect(EthernetChip* chip, SOCKET s) { chip->execCmdSn(s, Sock_DISCON); }
+void disconnect(EthernetChip* chip, SOCKET s) { disconnect<EthernetChip>(chip, s); }
 
-/**
- * @brief	This function used to send the data in TCP mode
- * @return	1 for success else 0.
- */
 uint16_t send(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len) {
-    uint8_t status = 0;
-    uint16_t ret = 0;
-    uint16_t freesize = 0;
+    return send<EthernetChip>(chip, s, buf, len);
+}
 
-    if (len > chip->SSIZE)
-        ret = chip->SSIZE;  // check size not to exceed MAX size.
-    else
-        ret = len;
+int16_t recv(EthernetChip* chip, SOCKET s, uint8_t* buf, int16_t len) {
+    return recv<EthernetChip>(chip, s, buf, len);
+}
 
-    // if freebuf is available, start.
-    do {
-        freesize = chip->getTXFreeSize(s);
-        status = chip->readSnSR(s);
-        if ((status != SnSR::ESTABLISHED) && (status != SnSR::CLOSE_WAIT)) {
-            ret = 0;
-            break;
-        }
-    } while (freesize < ret);
+uint16_t sendAsync(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len) {
+    return sendAsync<EthernetChip>(chip, s, buf, len);
+}
 
-    // copy data
-    chip->send_data_processing(s, (uint8_t*)buf, ret);
-    chip->execCmdSn(s, Sock_SEND);
+int8_t sendPoll(EthernetChip* chip, SOCKET s) { return sendPoll<EthernetChip>(chip, s); }
 
-    /* +2008.01 bj */
-    while ((chip->readSnIR(s) & SnIR::SEND_OK) != SnIR::SEND_OK) {
-        /* m2008.01 [bj] : reduce code */
-        if (chip->readSnSR(s) == SnSR::CLOSED) {
-            close(chip, s);
-            return 0;
-        }
-    }
-    /* +2008.01 bj */
-    chip->writeSnIR(s, SnIR::SEND_OK);
-    return ret;
+uint16_t recvVisit(EthernetChip* chip, SOCKET s, uint16_t len, SocketReadVisitor visitor,
+                   void* ctx) {
+    return recvVisit<EthernetChip>(chip, s, len, visitor, ctx);
 }
 
-/**
- * @brief	This function is an application I/F function which is used to receive the data in
- * TCP mode. It continues to wait for data as much as the application wants to receive.
- *
- * @return	received data size for success else -1.
- */
-int16_t recv(EthernetChip* chip, SOCKET s, uint8_t* buf, int16_t len) {
-    // Check how much data is available
-    int16_t ret = chip->getRXReceivedSize(s);
-    if (ret == 0) {
-        // No data available.
-        uint8_t status = chip->readSnSR(s);
-        if (status == SnSR::LISTEN || status == SnSR::CLOSED || status == SnSR::CLOSE_WAIT) {
-            // The remote end has closed its side of the connection, so this is the eof state
-            ret = 0;
-        } else {
-            // The connection is still up, but there's no data waiting to be read
-            ret = -1;
-        }
-    } else if (ret > len) {
-        ret = len;
-    }
+uint16_t visitData(EthernetChip* chip, SOCKET s, uint16_t ptr, uint16_t len,
+                   SocketReadVisitor visitor, void* ctx) {
+    return visitData<EthernetChip>(chip, s, ptr, len, visitor, ctx);
+}
 
-    if (ret > 0) {
-        chip->recv_data_processing(s, buf, ret);
-        chip->execCmdSn(s, Sock_RECV);
-    }
-    return ret;
+uint16_t sendProduce(EthernetChip* chip, SOCKET s, uint16_t len, SocketWriteProducer producer,
+                     void* ctx, bool* ended) {
+    return sendProduce<EthernetChip>(chip, s, len, producer, ctx, ended);
 }
 
-/**
- * @brief	Returns the first byte in the receive queue (no checking)
- *
- * @return
- */
-uint16_t peek(EthernetChip* chip, SOCKET s, uint8_t* buf) {
-    chip->recv_data_processing(s, buf, 1, 1);
+uint16_t bufferProduce(EthernetChip* chip, SOCKET s, uint16_t offset, uint16_t len,
+                       SocketWriteProducer producer, void* ctx) {
+    return bufferProduce<EthernetChip>(chip, s, offset, len, producer, ctx);
+}
 
-    return 1;
+uint16_t peek(EthernetChip* chip, SOCKET s, uint8_t* buf) {
+    return peek<EthernetChip>(chip, s, buf);
 }
 
-/**
- * @brief	This function is an application I/F function which is used to send the data for
- * other then TCP mode. Unlike TCP transmission, The peer's destination address and the port is
- * needed.
- *
- * @return	This function return send data size for success else -1.
- */
 uint16_t sendto(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len, uint8_t* addr,
                 uint16_t port) {
-    uint16_t ret = 0;
-
-    if (len > chip->SSIZE)
-        ret = chip->SSIZE;  // check size not to exceed MAX size.
-    else
-        ret = len;
-
-    if (((addr[0] == 0x00) && (addr[1] == 0x00) && (addr[2] == 0x00) && (addr[3] == 0x00)) ||
-        ((port == 0x00)) || (ret == 0)) {
-        /* +2008.01 [bj] : added return value */
-        ret = 0;
-    } else {
-        chip->writeSnDIPR(s, addr);
-        chip->writeSnDPORT(s, port);
-
-        // copy data
-        chip->send_data_processing(s, (uint8_t*)buf, ret);
-        chip->execCmdSn(s, Sock_SEND);
-
-        /* +2008.01 bj */
-        while ((chip->readSnIR(s) & SnIR::SEND_OK) != SnIR::SEND_OK) {
-            if (chip->readSnIR(s) & SnIR::TIMEOUT) {
-                /* +2008.01 [bj]: clear interrupt */
-                chip->writeSnIR(s, (SnIR::SEND_OK | SnIR::TIMEOUT)); /* clear SEND_OK & TIMEOUT */
-                return 0;
-            }
-        }
-
-        /* +2008.01 bj */
-        chip->writeSnIR(s, SnIR::SEND_OK);
-    }
-    return ret;
+    return sendto<EthernetChip>(chip, s, buf, len, addr, port);
 }
 
-/**
- * @brief	This function is an application I/F function which is used to receive the data in
- * other then TCP mode. This function is used to receive UDP, IP_RAW and MAC_RAW mode, and handle
- * the header as well.
- *
- * @return	This function return received data size for success else -1.
- */
 uint16_t recvfrom(EthernetChip* chip, SOCKET s, uint8_t* buf, uint16_t len, uint8_t* addr,
                   uint16_t* port) {
-    uint8_t head[8];
-    uint16_t data_len = 0;
-    uint16_t ptr = 0;
-
-    if (len > 0) {
-        ptr = chip->readSnRX_RD(s);
-        switch (chip->readSnMR(s) & 0x07) {
-            case SnMR::UDP:
-                chip->read_data(s, ptr, head, 0x08);
-                ptr += 8;
-                // read peer's IP address, port number.
-                addr[0] = head[0];
-                addr[1] = head[1];
-                addr[2] = head[2];
-                addr[3] = head[3];
-                *port = head[4];
-                *port = (*port << 8) + head[5];
-                data_len = head[6];
-                data_len = (data_len << 8) + head[7];
-
-                chip->read_data(s, ptr, buf, data_len);  // data copy.
-                ptr += data_len;
-
-                chip->writeSnRX_RD(s, ptr);
-                break;
-
-            case SnMR::IPRAW:
-                chip->read_data(s, ptr, head, 0x06);
-                ptr += 6;
-
-                addr[0] = head[0];
-                addr[1] = head[1];
-                addr[2] = head[2];
-                addr[3] = head[3];
-                data_len = head[4];
-                data_len = (data_len << 8) + head[5];
-
-                chip->read_data(s, ptr, buf, data_len);  // data copy.
-                ptr += data_len;
-
-                chip->writeSnRX_RD(s, ptr);
-                break;
-
-            case SnMR::MACRAW:
-                chip->read_data(s, ptr, head, 2);
-                ptr += 2;
-                data_len = head[0];
-                data_len = (data_len << 8) + head[1] - 2;
+    return recvfrom<EthernetChip>(chip, s, buf, len, addr, port);
+}
 
-                chip->read_data(s, ptr, buf, data_len);
-                ptr += data_len;
-                chip->writeSnRX_RD(s, ptr);
-                break;
+void flush(EthernetChip* chip, SOCKET s) { flush<EthernetChip>(chip, s); }
 
-            default:
-                break;
-        }
-        chip->execCmdSn(s, Sock_RECV);
-    }
-    return data_len;
+uint8_t beginRecvUDP(EthernetChip* chip, SOCKET s, uint8_t* addr, uint16_t* port, uint16_t* len,
+                     uint16_t* ptr) {
+    return beginRecvUDP<EthernetChip>(chip, s, addr, port, len, ptr);
 }
 
-/**
- * @brief	Wait for buffered transmission to complete.
- */
-void flush(EthernetChip* chip, SOCKET s) {
-    // TODO
+void endRecvUDP(EthernetChip* chip, SOCKET s, uint16_t end) {
+    endRecvUDP<EthernetChip>(chip, s, end);
 }
 
 uint16_t igmpsend(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len) {
-    uint16_t ret = 0;
-
-    if (len > chip->SSIZE)
-        ret = chip->SSIZE;  // check size not to exceed MAX size.
-    else
-        ret = len;
-
-    if (ret == 0) return 0;
+    return igmpsend<EthernetChip>(chip, s, buf, len);
+}
 
-    chip->send_data_processing(s, (uint8_t*)buf, ret);
-    chip->execCmdSn(s, Sock_SEND);
+uint8_t socketMulticast(EthernetChip* chip, SOCKET s, const uint8_t* group, uint16_t port,
+                        uint8_t flags) {
+    return socketMulticast<EthernetChip>(chip, s, group, port, flags);
+}
 
-    while ((chip->readSnIR(s) & SnIR::SEND_OK) != SnIR::SEND_OK) {
-        chip->readSnSR(s);
-        if (chip->readSnIR(s) & SnIR::TIMEOUT) {
-            /* in case of igmp, if send fails, then socket closed */
-            /* if you want change, remove this code. */
-            close(chip, s);
-            return 0;
-        }
-    }
+void closeMulticast(EthernetChip* chip, SOCKET s, const uint8_t* group, uint16_t port) {
+    closeMulticast<EthernetChip>(chip, s, group, port);
+}
 
-    chip->writeSnIR(s, SnIR::SEND_OK);
-    return ret;
+void setMulticastDest(EthernetChip* chip, SOCKET s, const uint8_t* group, uint16_t port) {
+    setMulticastDest<EthernetChip>(chip, s, group, port);
 }
 
 uint16_t bufferData(EthernetChip* chip, SOCKET s, uint16_t offset, const uint8_t* buf,
                     uint16_t len) {
-    uint16_t ret = 0;
-    if (len > chip->getTXFreeSize(s)) {
-        ret = chip->getTXFreeSize(s);  // check size not to exceed MAX size.
-    } else {
-        ret = len;
-    }
-    chip->send_data_processing_offset(s, offset, buf, ret);
-    return ret;
+    return bufferData<EthernetChip>(chip, s, offset, buf, len);
 }
 
 int startUDP(EthernetChip* chip, SOCKET s, uint8_t* addr, uint16_t port) {
-    if (((addr[0] == 0x00) && (addr[1] == 0x00) && (addr[2] == 0x00) && (addr[3] == 0x00)) ||
-        ((port == 0x00))) {
-        return 0;
-    } else {
-        chip->writeSnDIPR(s, addr);
-        chip->writeSnDPORT(s, port);
-        return 1;
-    }
+    return startUDP<EthernetChip>(chip, s, addr, port);
 }
 
-int sendUDP(EthernetChip* chip, SOCKET s) {
-    chip->execCmdSn(s, Sock_SEND);
-
-    /* +2008.01 bj */
-    while ((chip->readSnIR(s) & SnIR::SEND_OK) != SnIR::SEND_OK) {
-        if (chip->readSnIR(s) & SnIR::TIMEOUT) {
-            /* +2008.01 [bj]: clear interrupt */
-            chip->writeSnIR(s, (SnIR::SEND_OK | SnIR::TIMEOUT));
-            return 0;
-        }
-    }
+int sendUDP(EthernetChip* chip, SOCKET s) { return sendUDP<EthernetChip>(chip, s); }
 
-    /* +2008.01 bj */
-    chip->writeSnIR(s, SnIR::SEND_OK);
+uint16_t sendtoBatch(EthernetChip* chip, SOCKET s, UDPMessage* msgs, uint16_t count) {
+    return sendtoBatch<EthernetChip>(chip, s, msgs, count);
+}
 
-    /* Sent ok */
-    return 1;
+uint16_t sendRawBatch(EthernetChip* chip, SOCKET s, RawFrame* frames, uint16_t count) {
+    return sendRawBatch<EthernetChip>(chip, s, frames, count);
 }
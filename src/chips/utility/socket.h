@@ -13,6 +13,47 @@
 
 class EthernetChip;  // Forward declare the class to break the circular dependency.
 
+// Scratch buffer used by the streaming (visitor / producer) socket functions. Kept small so it
+// fits on the stack of small MCUs; larger values mean fewer SPI frames per stream.
+#ifndef ETHERNET_STREAM_CHUNK_SIZE
+#define ETHERNET_STREAM_CHUNK_SIZE 64
+#endif
+
+/*
+  @brief Receives a chunk of socket RX data. Returns how many of the len bytes it consumed;
+  returning less than len stops the stream, and unconsumed bytes stay in the socket.
+*/
+typedef uint16_t (*SocketReadVisitor)(void* ctx, const uint8_t* data, uint16_t len);
+/*
+  @brief Supplies up to len bytes of TX data into data. Returns how many it produced;
+  returning less than len ends the stream.
+*/
+typedef uint16_t (*SocketWriteProducer)(void* ctx, uint8_t* data, uint16_t len);
+
+/*
+  @brief One datagram of a sendtoBatch() call. status is filled in by the call: 1 sent,
+  0 timed out, -1 rejected (bad destination, empty, larger than the TX buffer, or the socket
+  is no longer open for UDP).
+*/
+struct UDPMessage {
+    const uint8_t* buf;  ///< Payload
+    uint16_t len;        ///< Payload length
+    uint8_t addr[4];     ///< Destination IP
+    uint16_t port;       ///< Destination port
+    int8_t status;       ///< Result, set by sendtoBatch()
+};
+
+/*
+  @brief One frame of a sendRawBatch() call: a complete Ethernet frame, header included and
+  FCS excluded. status is filled in by the call: 1 sent, 0 timed out, -1 rejected (shorter
+  than a header, larger than the TX buffer, or the socket is no longer in MACRAW mode).
+*/
+struct RawFrame {
+    const uint8_t* buf;  ///< Frame, starting at the destination MAC
+    uint16_t len;        ///< Frame length
+    int8_t status;       ///< Result, set by sendRawBatch()
+};
+
 extern uint8_t socket(EthernetChip* chip, SOCKET s, uint8_t protocol, uint16_t port,
                       uint8_t flag);              // Opens a socket(TCP or UDP or IP_RAW mode)
 extern void close(EthernetChip* chip, SOCKET s);  // Close socket
@@ -24,6 +65,48 @@ extern uint8_t listen(EthernetChip* chip,
 extern uint16_t send(EthernetChip* chip, SOCKET s, const uint8_t* buf,
                      uint16_t len);                                            // Send data (TCP)
 extern int16_t recv(EthernetChip* chip, SOCKET s, uint8_t* buf, int16_t len);  // Receive data (TCP)
+
+// Non-blocking TCP send
+/*
+  @brief Copy as much of buf as fits into the socket's TX memory and return without waiting.
+  The data is sent by sendPoll() as soon as the previous SEND has completed.
+  @return Number of bytes accepted (0 if TX memory is full or the connection is not open)
+*/
+extern uint16_t sendAsync(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len);
+/*
+  @brief Advance the non-blocking send pipeline: reap a completed SEND and issue the next one.
+  @return 1 once all accepted data has been sent, 0 while a SEND is in flight, -1 if the
+  connection failed
+*/
+extern int8_t sendPoll(EthernetChip* chip, SOCKET s);
+
+// Streaming access to socket memory, through a small scratch chunk instead of a caller buffer
+/*
+  @brief Pass up to len bytes of received data to visitor, chunk by chunk; Sn_RX_RD and RECV
+  are committed once for everything consumed.
+  @return Number of bytes consumed
+*/
+extern uint16_t recvVisit(EthernetChip* chip, SOCKET s, uint16_t len, SocketReadVisitor visitor,
+                          void* ctx);
+/*
+  @brief Pass len bytes of RX memory at ptr to visitor without committing anything.
+  @return Number of bytes consumed
+*/
+extern uint16_t visitData(EthernetChip* chip, SOCKET s, uint16_t ptr, uint16_t len,
+                          SocketReadVisitor visitor, void* ctx);
+/*
+  @brief Fill TX memory from producer, chunk by chunk, and queue it like sendAsync(). ended,
+  if given, is set when the producer returned less than asked.
+  @return Number of bytes produced and queued
+*/
+extern uint16_t sendProduce(EthernetChip* chip, SOCKET s, uint16_t len,
+                            SocketWriteProducer producer, void* ctx, bool* ended = nullptr);
+/*
+  @brief Fill a UDP datagram being built with startUDP() from producer, like bufferData().
+  @return Number of bytes produced into the datagram
+*/
+extern uint16_t bufferProduce(EthernetChip* chip, SOCKET s, uint16_t offset, uint16_t len,
+                              SocketWriteProducer producer, void* ctx);
 extern uint16_t peek(EthernetChip* chip, SOCKET s, uint8_t* buf);
 extern uint16_t sendto(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len,
                        uint8_t* addr,
@@ -32,8 +115,38 @@ extern uint16_t recvfrom(EthernetChip* chip, SOCKET s, uint8_t* buf, uint16_t le
                          uint16_t* port);         // Receive data (UDP/IP RAW)
 extern void flush(EthernetChip* chip, SOCKET s);  // Wait for transmission to complete
 
+// Single-RECV UDP receive
+/*
+  @brief Open the next UDP datagram without consuming it: reads the 8-byte header in one burst
+  and returns the payload pointer in ptr.
+  @return 1 if a datagram is waiting, 0 otherwise
+*/
+extern uint8_t beginRecvUDP(EthernetChip* chip, SOCKET s, uint8_t* addr, uint16_t* port,
+                            uint16_t* len, uint16_t* ptr);
+/*
+  @brief Release a datagram opened with beginRecvUDP(), read or not, with one RECV.
+*/
+extern void endRecvUDP(EthernetChip* chip, SOCKET s, uint16_t end);
+
 extern uint16_t igmpsend(EthernetChip* chip, SOCKET s, const uint8_t* buf, uint16_t len);
 
+// Multicast membership
+/*
+  @brief Open s as a UDP socket receiving group on port; the chip sends the IGMP join.
+  flags adds Sn_MR bits (SnMR::MC for IGMPv1, SnMR::BCASTB, SnMR::UCASTB).
+  @return 1 if the socket opened, 0 otherwise
+*/
+extern uint8_t socketMulticast(EthernetChip* chip, SOCKET s, const uint8_t* group, uint16_t port,
+                               uint8_t flags);
+/*
+  @brief Close a socket opened with socketMulticast(), sending the IGMP leave for group.
+*/
+extern void closeMulticast(EthernetChip* chip, SOCKET s, const uint8_t* group, uint16_t port);
+/*
+  @brief Restore a multicast socket's destination registers (Sn_DHAR/DIPR/DPORT) to its group.
+*/
+extern void setMulticastDest(EthernetChip* chip, SOCKET s, const uint8_t* group, uint16_t port);
+
 // Functions to allow buffered UDP send (i.e. where the UDP datagram is built up over a
 // number of calls before being sent
 /*
@@ -55,6 +168,18 @@ uint16_t bufferData(EthernetChip* chip, SOCKET s, uint16_t offset, const uint8_t
   @return 1 if the datagram was successfully sent, or 0 if there was an error
 */
 int sendUDP(EthernetChip* chip, SOCKET s);
+/*
+  @brief Send count datagrams through one UDP socket, copying each into TX memory while the
+  previous one is on the wire and rewriting the destination only when it changes.
+  @return Number of datagrams sent; per-datagram results are in each message's status
+*/
+uint16_t sendtoBatch(EthernetChip* chip, SOCKET s, UDPMessage* msgs, uint16_t count);
+/*
+  @brief Send count frames through a MACRAW socket (socket 0), copying each into TX memory
+  while the previous one is on the wire.
+  @return Number of frames sent; per-frame results are in each frame's status
+*/
+uint16_t sendRawBatch(EthernetChip* chip, SOCKET s, RawFrame* frames, uint16_t count);
 
 #endif
 /* _SOCKET_H_ */
@@ -0,0 +1,883 @@
+/*
+ * socket_t.h - Compile-time chip socket layer
+ *
+ * The socket functions below are templates over the chip type. Instantiated
+ * with a concrete chip (e.g. send<W5500>(&chip, ...), or simply by passing a
+ * W5500*), every register access binds statically and can be inlined, so the
+ * control-byte and address arithmetic in readSn()/writeSn() folds to constants.
+ *
+ * The EthernetChip* functions declared in socket.h are these same templates
+ * instantiated with EthernetChip, so both paths share one implementation and
+ * boards that mix chips keep using virtual dispatch.
+ */
+
+#ifndef _SOCKET_T_H_
+#define _SOCKET_T_H_
+
+#include "../../EthernetPerf.h"
+#include "socket.h"
+
+/**
+ * @brief The socket layer's view of the per-socket state an EthernetChip keeps for it
+ *
+ * That state is private to EthernetChip; only these functions reach it.
+ */
+struct SocketLayer {
+    static uint8_t& txInflight(EthernetChip* chip) { return chip->_tx_inflight; }
+    static uint16_t& txStaged(EthernetChip* chip, SOCKET s) { return chip->_tx_staged[s]; }
+    static uint16_t& txStageWr(EthernetChip* chip, SOCKET s) { return chip->_tx_stage_wr[s]; }
+    static uint8_t& irLatch(EthernetChip* chip, SOCKET s) { return chip->_ir_latch[s]; }
+    static uint8_t& udpDestValid(EthernetChip* chip) { return chip->_udp_dest_valid; }
+    static uint8_t* udpDip(EthernetChip* chip, SOCKET s) { return chip->_udp_dip[s]; }
+    static uint16_t& udpDport(EthernetChip* chip, SOCKET s) { return chip->_udp_dport[s]; }
+};
+
+/**
+ * @brief Sn_IR as seen by the socket layer
+ *
+ * The register value plus any SEND_OK/TIMEOUT bits the event engine
+ * (EthernetEvents) has already acknowledged on the chip and latched for us.
+ */
+template <class Chip>
+inline uint8_t socketIR(Chip* chip, SOCKET s) {
+    return chip->readSnIR(s) | SocketLayer::irLatch(chip, s);
+}
+
+/**
+ * @brief Acknowledge Sn_IR bits, both on the chip and in the event engine latch
+ */
+template <class Chip>
+inline void clearSocketIR(Chip* chip, SOCKET s, uint8_t bits) {
+    chip->writeSnIR(s, bits);
+    SocketLayer::irLatch(chip, s) &= ~bits;
+}
+
+/**
+ * @brief Point a UDP socket at a destination, skipping register writes it already holds
+ *
+ * Sn_DIPR and Sn_DPORT are written only where they differ from what the socket layer last
+ * wrote; close() and connect() drop the cached copy.
+ */
+template <class Chip>
+inline void setUDPDest(Chip* chip, SOCKET s, const uint8_t* addr, uint16_t port) {
+    uint8_t bit = 1 << s;
+    uint8_t* dip = SocketLayer::udpDip(chip, s);
+    bool valid = SocketLayer::udpDestValid(chip) & bit;
+
+    if (!valid || memcmp(dip, addr, 4) != 0) {
+        chip->writeSnDIPR(s, (uint8_t*)addr);
+        memcpy(dip, addr, 4);
+    }
+    if (!valid || SocketLayer::udpDport(chip, s) != port) {
+        chip->writeSnDPORT(s, port);
+        SocketLayer::udpDport(chip, s) = port;
+    }
+    SocketLayer::udpDestValid(chip) |= bit;
+}
+
+/**
+ * @brief	This Socket function initialize the channel in perticular mode, and set the port and
+ * wait for w5500 done it.
+ * @return 	1 for success else 0.
+ */
+template <class Chip>
+uint8_t socket(Chip* chip, SOCKET s, uint8_t protocol, uint16_t port, uint8_t flag) {
+    if ((protocol == SnMR::TCP) || (protocol == SnMR::UDP) || (protocol == SnMR::IPRAW) ||
+        (protocol == SnMR::MACRAW) || (protocol == SnMR::PPPOE)) {
+        close(chip, s);
+        chip->writeSnMR(s, protocol | flag);
+        if (port != 0) {
+            chip->writeSnPORT(s, port);
+        } else {
+            chip->writeSnPORT(s, chip->nextLocalPort());  // no source port given: take the chip's next
+        }
+
+        chip->execCmdSn(s, Sock_OPEN);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief	This function close the socket and parameter is "s" which represent the socket
+ * number
+ */
+template <class Chip>
+void close(Chip* chip, SOCKET s) {
+    chip->execCmdSn(s, Sock_CLOSE);
+    chip->writeSnIR(s, 0xFF);
+    SocketLayer::txInflight(chip) &= ~(1 << s);
+    SocketLayer::txStaged(chip, s) = 0;
+    SocketLayer::irLatch(chip, s) = 0;
+    SocketLayer::udpDestValid(chip) &= ~(1 << s);
+}
+
+/**
+ * @brief Point a multicast socket's destination registers at its group
+ *
+ * Writes the group MAC derived from the address (01:00:5E plus its low 23 bits, RFC 1112)
+ * to Sn_DHAR, the group to Sn_DIPR and the port to Sn_DPORT, and records them as the cached
+ * UDP destination.
+ */
+template <class Chip>
+void setMulticastDest(Chip* chip, SOCKET s, const uint8_t* group, uint16_t port) {
+    uint8_t mac[6] = {0x01, 0x00, 0x5E, (uint8_t)(group[1] & 0x7F), group[2], group[3]};
+    chip->writeSnDHAR(s, mac);
+    chip->writeSnDIPR(s, (uint8_t*)group);
+    chip->writeSnDPORT(s, port);
+    memcpy(SocketLayer::udpDip(chip, s), group, 4);
+    SocketLayer::udpDport(chip, s) = port;
+    SocketLayer::udpDestValid(chip) |= 1 << s;
+}
+
+/**
+ * @brief Open a UDP socket as a member of a multicast group
+ * @param flags Further Sn_MR bits: SnMR::MC (IGMPv1 instead of v2), SnMR::BCASTB, SnMR::UCASTB
+ * @return 1 if the socket opened, 0 otherwise
+ *
+ * The group must be in Sn_DHAR/Sn_DIPR/Sn_DPORT before OPEN: the chip then accepts only
+ * that group's frames (plus unicast and broadcast unless blocked) and sends the IGMP join
+ * itself. closeMulticast() sends the leave.
+ */
+template <class Chip>
+uint8_t socketMulticast(Chip* chip, SOCKET s, const uint8_t* group, uint16_t port,
+                        uint8_t flags) {
+    close(chip, s);
+    chip->writeSnMR(s, SnMR::UDP | SnMR::MULTI | flags);
+    chip->writeSnPORT(s, port);
+    setMulticastDest(chip, s, group, port);
+    chip->execCmdSn(s, Sock_OPEN);
+    return chip->readSnSR(s) == SnSR::UDP;
+}
+
+/**
+ * @brief Close a multicast socket, sending the IGMP leave for its group
+ *
+ * The chip addresses the leave from the destination registers, which sends to other
+ * peers overwrite; the group is written back first.
+ */
+template <class Chip>
+void closeMulticast(Chip* chip, SOCKET s, const uint8_t* group, uint16_t port) {
+    setMulticastDest(chip, s, group, port);
+    close(chip, s);
+}
+
+/**
+ * @brief	This function established  the connection for the channel in passive (server) mode.
+ * This function waits for the request from the peer.
+ * @return	1 for success else 0.
+ */
+template <class Chip>
+uint8_t listen(Chip* chip, SOCKET s) {
+    if (chip->readSnSR(s) != SnSR::INIT) return 0;
+    chip->execCmdSn(s, Sock_LISTEN);
+    return 1;
+}
+
+/**
+ * @brief	This function established  the connection for the channel in Active (client) mode.
+ * 		This function waits for the untill the connection is established.
+ *
+ * @return	1 for success else 0.
+ */
+template <class Chip>
+uint8_t connect(Chip* chip, SOCKET s, uint8_t* addr, uint16_t port) {
+    if (((addr[0] == 0xFF) && (addr[1] == 0xFF) && (addr[2] == 0xFF) && (addr[3] == 0xFF)) ||
+        ((addr[0] == 0x00) && (addr[1] == 0x00) && (addr[2] == 0x00) && (addr[3] == 0x00)) ||
+        (port == 0x00))
+        return 0;
+
+    // set destination IP
+    chip->writeSnDIPR(s, addr);
+    chip->writeSnDPORT(s, port);
+    SocketLayer::udpDestValid(chip) &= ~(1 << s);
+    chip->execCmdSn(s, Sock_CONNECT);
+
+    return 1;
+}
+
+/**
+ * @brief	This function used for disconnect the socket and parameter is "s" which represent
+ * the socket number
+ * @return	1 for success else 0.
+ */
+template <class Chip>
+void disconnect(Chip* chip, SOCKET s) { chip->execCmdSn(s, Sock_DISCON); }
+
+/**
+ * @brief	This function used to send the data in TCP mode
+ * @return	1 for success else 0.
+ */
+template <class Chip>
+uint16_t send(Chip* chip, SOCKET s, const uint8_t* buf, uint16_t len) {
+    SnSnapshot snap;
+    uint16_t ret = 0;
+
+    // Let anything queued by sendAsync() go out first so SEND_OK stays unambiguous
+    int8_t pending;
+    while ((pending = sendPoll(chip, s)) == 0);
+    if (pending < 0) return 0;
+
+    if (len > chip->txBufferSize(s))
+        ret = chip->txBufferSize(s);  // check size not to exceed MAX size.
+    else
+        ret = len;
+
+    // if freebuf is available, start. Status, free size and the write pointer
+    // all come from the same snapshot.
+    do {
+        chip->readSnBlock(s, snap);
+        if ((snap.sr != SnSR::ESTABLISHED) && (snap.sr != SnSR::CLOSE_WAIT)) {
+            ret = 0;
+            break;
+        }
+    } while (snap.tx_fsr < ret);
+
+    // copy data
+    chip->write_data(s, snap.tx_wr, buf, ret);
+    chip->writeSnTX_WR(s, snap.tx_wr + ret);
+    chip->execCmdSn(s, Sock_SEND);
+    ETHERNET_PERF_START(start);
+
+    /* +2008.01 bj */
+    for (;;) {
+        chip->readSnBlock(s, snap, SnSnapshot::STATUS);
+        if (((snap.ir | SocketLayer::irLatch(chip, s)) & SnIR::SEND_OK) == SnIR::SEND_OK) break;
+        /* m2008.01 [bj] : reduce code */
+        if (snap.sr == SnSR::CLOSED) {
+            ETHERNET_PERF_ADD(sendTimeouts, 1);
+            ETHERNET_PERF_EVENT(sendWait, SEND_TIMEOUT, s, ETHERNET_PERF_ELAPSED(start));
+            close(chip, s);
+            return 0;
+        }
+    }
+    /* +2008.01 bj */
+    clearSocketIR(chip, s, SnIR::SEND_OK);
+    ETHERNET_PERF_EVENT(sendWait, SEND_DONE, s, ETHERNET_PERF_ELAPSED(start));
+    return ret;
+}
+
+/**
+ * @brief	Advance the non-blocking send pipeline of a socket.
+ *
+ * Reaps the SEND issued last time once the chip reports SEND_OK, then issues SEND for any
+ * data sendAsync() has staged since. At most one SEND is outstanding per socket.
+ * @return	1 once all accepted data has been sent, 0 while a SEND is in flight, -1 if the
+ * connection failed (the socket is closed).
+ */
+template <class Chip>
+int8_t sendPoll(Chip* chip, SOCKET s) {
+    uint8_t bit = 1 << s;
+    if (SocketLayer::txInflight(chip) & bit) {
+        SnSnapshot snap;
+        chip->readSnBlock(s, snap, SnSnapshot::STATUS);
+        if ((snap.ir | SocketLayer::irLatch(chip, s)) & SnIR::SEND_OK) {
+            clearSocketIR(chip, s, SnIR::SEND_OK);
+            SocketLayer::txInflight(chip) &= ~bit;
+        } else if (snap.sr == SnSR::CLOSED) {
+            close(chip, s);
+            return -1;
+        } else {
+            return 0;
+        }
+    }
+    if (SocketLayer::txStaged(chip, s) > 0) {
+        chip->execCmdSn(s, Sock_SEND);
+        SocketLayer::txStaged(chip, s) = 0;
+        SocketLayer::txInflight(chip) |= bit;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief	Locate the free TX window behind the data already staged for a socket.
+ *
+ * Sn_TX_WR may read back its value as of the last SEND, so while data is staged the write
+ * position continues from the pointer we last wrote rather than from the register.
+ * @return	false if the connection is not open.
+ */
+template <class Chip>
+bool stageWindow(Chip* chip, SOCKET s, uint16_t* wr, uint16_t* room) {
+    SnSnapshot snap;
+    chip->readSnBlock(s, snap);
+    if ((snap.sr != SnSR::ESTABLISHED) && (snap.sr != SnSR::CLOSE_WAIT)) return false;
+
+    uint16_t staged = SocketLayer::txStaged(chip, s);
+    *room = snap.tx_fsr > staged ? snap.tx_fsr - staged : 0;
+    *wr = staged ? SocketLayer::txStageWr(chip, s) : snap.tx_wr;
+    return true;
+}
+
+/**
+ * @brief	Record len bytes written at wr as staged and advance Sn_TX_WR past them.
+ */
+template <class Chip>
+void stageCommit(Chip* chip, SOCKET s, uint16_t wr, uint16_t len) {
+    chip->writeSnTX_WR(s, wr + len);
+    SocketLayer::txStageWr(chip, s) = wr + len;
+    SocketLayer::txStaged(chip, s) += len;
+}
+
+/**
+ * @brief	Non-blocking counterpart of send().
+ *
+ * Copies as much of buf as currently fits into the socket's TX memory, advances Sn_TX_WR and
+ * returns. The staged bytes are handed to the chip by sendPoll() (called here and by the
+ * application) as soon as the previous SEND has completed, so the caller can prepare the
+ * next chunk while the chip transmits. Room is taken as Sn_TX_FSR minus the bytes already
+ * staged, which never overwrites unsent data.
+ * @return	Number of bytes accepted, 0 if TX memory is full or the connection is not open.
+ */
+template <class Chip>
+uint16_t sendAsync(Chip* chip, SOCKET s, const uint8_t* buf, uint16_t len) {
+    uint16_t wr, room;
+    uint16_t ret = 0;
+
+    if (!stageWindow(chip, s, &wr, &room)) return 0;
+
+    ret = len < room ? len : room;
+    if (ret > 0) {
+        chip->write_data(s, wr, buf, ret);
+        stageCommit(chip, s, wr, ret);
+    }
+    sendPoll(chip, s);
+    return ret;
+}
+
+/**
+ * @brief	Fill the socket's TX memory straight from a producer callback (non-blocking).
+ *
+ * The producer is asked for up to ETHERNET_STREAM_CHUNK_SIZE bytes at a time and its output is
+ * written to chip memory chunk by chunk, until it returns less than asked, len bytes have been
+ * produced or TX memory is full. The data is then staged and sent exactly like sendAsync().
+ * If ended is given it is set to true when the producer signalled the end of its data.
+ * @return	Number of bytes produced and queued.
+ */
+template <class Chip>
+uint16_t sendProduce(Chip* chip, SOCKET s, uint16_t len, SocketWriteProducer producer,
+                     void* ctx, bool* ended = nullptr) {
+    uint8_t chunk[ETHERNET_STREAM_CHUNK_SIZE];
+    uint16_t wr, room;
+    uint16_t ret = 0;
+
+    if (!stageWindow(chip, s, &wr, &room)) return 0;
+    if (len > room) len = room;
+
+    while (ret < len) {
+        uint16_t want = len - ret;
+        if (want > sizeof(chunk)) want = sizeof(chunk);
+        uint16_t got = producer(ctx, chunk, want);
+        if (got > want) got = want;
+        if (got > 0) chip->write_data(s, wr + ret, chunk, got);
+        ret += got;
+        if (got < want) {
+            if (ended) *ended = true;
+            break;
+        }
+    }
+    if (ret > 0) stageCommit(chip, s, wr, ret);
+    sendPoll(chip, s);
+    return ret;
+}
+
+/**
+ * @brief	Pass len bytes of socket RX memory starting at ptr to a visitor, chunk by chunk.
+ *
+ * Nothing is committed: the caller advances Sn_RX_RD by the returned count.
+ * @return	Number of bytes the visitor consumed.
+ */
+template <class Chip>
+uint16_t visitData(Chip* chip, SOCKET s, uint16_t ptr, uint16_t len, SocketReadVisitor visitor,
+                   void* ctx) {
+    uint8_t chunk[ETHERNET_STREAM_CHUNK_SIZE];
+    uint16_t ret = 0;
+
+    while (ret < len) {
+        uint16_t n = len - ret;
+        if (n > sizeof(chunk)) n = sizeof(chunk);
+        chip->read_data(s, ptr + ret, chunk, n);
+        uint16_t used = visitor(ctx, chunk, n);
+        if (used > n) used = n;
+        ret += used;
+        if (used < n) break;
+    }
+    return ret;
+}
+
+/**
+ * @brief	Hand the socket's received data to a visitor callback, chunk by chunk.
+ *
+ * Up to len bytes of the RX window are read from chip memory ETHERNET_STREAM_CHUNK_SIZE bytes
+ * at a time and passed to the visitor, which returns how many it consumed. Visiting stops when
+ * the visitor consumes less than it was given. Sn_RX_RD is advanced and RECV issued once, for
+ * everything consumed, after the visitor is done.
+ * @return	Number of bytes consumed.
+ */
+template <class Chip>
+uint16_t recvVisit(Chip* chip, SOCKET s, uint16_t len, SocketReadVisitor visitor, void* ctx) {
+    SnSnapshot snap;
+
+    chip->readSnBlock(s, snap, SnSnapshot::POINTERS);
+    if (len > snap.rx_rsr) len = snap.rx_rsr;
+
+    uint16_t ret = visitData(chip, s, snap.rx_rd, len, visitor, ctx);
+    if (ret > 0) {
+        chip->writeSnRX_RD(s, snap.rx_rd + ret);
+        chip->execCmdSn(s, Sock_RECV);
+    }
+    return ret;
+}
+
+/**
+ * @brief	This function is an application I/F function which is used to receive the data in
+ * TCP mode. It continues to wait for data as much as the application wants to receive.
+ *
+ * @return	received data size for success else -1.
+ */
+template <class Chip>
+int16_t recv(Chip* chip, SOCKET s, uint8_t* buf, int16_t len) {
+    // Check how much data is available, along with status and the read pointer
+    SnSnapshot snap;
+    chip->readSnBlock(s, snap);
+    int16_t ret = snap.rx_rsr;
+    if (ret == 0) {
+        // No data available.
+        uint8_t status = snap.sr;
+        if (status == SnSR::LISTEN || status == SnSR::CLOSED || status == SnSR::CLOSE_WAIT) {
+            // The remote end has closed its side of the connection, so this is the eof state
+            ret = 0;
+        } else {
+            // The connection is still up, but there's no data waiting to be read
+            ret = -1;
+        }
+    } else if (ret > len) {
+        ret = len;
+    }
+
+    if (ret > 0) {
+        chip->read_data(s, snap.rx_rd, buf, ret);
+        chip->writeSnRX_RD(s, snap.rx_rd + ret);
+        chip->execCmdSn(s, Sock_RECV);
+    }
+    return ret;
+}
+
+/**
+ * @brief	Returns the first byte in the receive queue (no checking)
+ *
+ * @return
+ */
+template <class Chip>
+uint16_t peek(Chip* chip, SOCKET s, uint8_t* buf) {
+    chip->recv_data_processing(s, buf, 1, 1);
+
+    return 1;
+}
+
+/**
+ * @brief	Wait for the SEND_OK or TIMEOUT of a datagram or raw frame and acknowledge it.
+ * @return	1 if it was sent, 0 on timeout.
+ */
+template <class Chip>
+int8_t waitSendOK(Chip* chip, SOCKET s) {
+    ETHERNET_PERF_START(start);
+    uint8_t ir;
+    while (((ir = socketIR(chip, s)) & SnIR::SEND_OK) != SnIR::SEND_OK) {
+        if (ir & SnIR::TIMEOUT) {
+            /* +2008.01 [bj]: clear interrupt */
+            /* clear SEND_OK & TIMEOUT */
+            clearSocketIR(chip, s, (SnIR::SEND_OK | SnIR::TIMEOUT));
+            ETHERNET_PERF_ADD(sendTimeouts, 1);
+            ETHERNET_PERF_EVENT(sendWait, SEND_TIMEOUT, s, ETHERNET_PERF_ELAPSED(start));
+            return 0;
+        }
+    }
+    /* +2008.01 bj */
+    clearSocketIR(chip, s, SnIR::SEND_OK);
+    ETHERNET_PERF_EVENT(sendWait, SEND_DONE, s, ETHERNET_PERF_ELAPSED(start));
+    return 1;
+}
+
+/**
+ * @brief	Wait for the SEND_OK or TIMEOUT of a UDP datagram and acknowledge it.
+ * @return	1 if it was sent, 0 on timeout.
+ */
+template <class Chip>
+int8_t waitSendUDP(Chip* chip, SOCKET s) {
+    if (!waitSendOK(chip, s)) return 0;
+    ETHERNET_PERF_ADD(udpSent, 1);
+    return 1;
+}
+
+/**
+ * @brief	This function is an application I/F function which is used to send the data for
+ * other then TCP mode. Unlike TCP transmission, The peer's destination address and the port is
+ * needed.
+ *
+ * @return	This function return send data size for success else -1.
+ */
+template <class Chip>
+uint16_t sendto(Chip* chip, SOCKET s, const uint8_t* buf, uint16_t len, uint8_t* addr,
+                uint16_t port) {
+    uint16_t ret = 0;
+
+    if (len > chip->txBufferSize(s))
+        ret = chip->txBufferSize(s);  // check size not to exceed MAX size.
+    else
+        ret = len;
+
+    if (((addr[0] == 0x00) && (addr[1] == 0x00) && (addr[2] == 0x00) && (addr[3] == 0x00)) ||
+        ((port == 0x00)) || (ret == 0)) {
+        /* +2008.01 [bj] : added return value */
+        ret = 0;
+    } else {
+        setUDPDest(chip, s, addr, port);
+
+        // copy data
+        chip->send_data_processing(s, (uint8_t*)buf, ret);
+        chip->execCmdSn(s, Sock_SEND);
+        if (!waitSendUDP(chip, s)) return 0;
+    }
+    return ret;
+}
+
+/**
+ * @brief	This function is an application I/F function which is used to receive the data in
+ * other then TCP mode. This function is used to receive UDP, IP_RAW and MAC_RAW mode, and handle
+ * the header as well.
+ *
+ * @return	This function return received data size for success else -1.
+ */
+template <class Chip>
+uint16_t recvfrom(Chip* chip, SOCKET s, uint8_t* buf, uint16_t len, uint8_t* addr,
+                  uint16_t* port) {
+    uint8_t head[8];
+    uint16_t data_len = 0;
+    uint16_t ptr = 0;
+
+    if (len > 0) {
+        ptr = chip->readSnRX_RD(s);
+        switch (chip->readSnMR(s) & 0x07) {
+            case SnMR::UDP:
+                ETHERNET_PERF_ADD(udpReceived, 1);
+                chip->read_data(s, ptr, head, 0x08);
+                ptr += 8;
+                // read peer's IP address, port number.
+                addr[0] = head[0];
+                addr[1] = head[1];
+                addr[2] = head[2];
+                addr[3] = head[3];
+                *port = head[4];
+                *port = (*port << 8) + head[5];
+                data_len = head[6];
+                data_len = (data_len << 8) + head[7];
+
+                chip->read_data(s, ptr, buf, data_len);  // data copy.
+                ptr += data_len;
+
+                chip->writeSnRX_RD(s, ptr);
+                break;
+
+            case SnMR::IPRAW:
+                chip->read_data(s, ptr, head, 0x06);
+                ptr += 6;
+
+                addr[0] = head[0];
+                addr[1] = head[1];
+                addr[2] = head[2];
+                addr[3] = head[3];
+                data_len = head[4];
+                data_len = (data_len << 8) + head[5];
+
+                chip->read_data(s, ptr, buf, data_len);  // data copy.
+                ptr += data_len;
+
+                chip->writeSnRX_RD(s, ptr);
+                break;
+
+            case SnMR::MACRAW:
+                chip->read_data(s, ptr, head, 2);
+                ptr += 2;
+                data_len = head[0];
+                data_len = (data_len << 8) + head[1] - 2;
+
+                chip->read_data(s, ptr, buf, data_len);
+                ptr += data_len;
+                chip->writeSnRX_RD(s, ptr);
+                break;
+
+            default:
+                break;
+        }
+        chip->execCmdSn(s, Sock_RECV);
+    }
+    return data_len;
+}
+
+/**
+ * @brief	Open the next datagram in a UDP socket's RX memory without consuming it.
+ *
+ * Takes one pointer snapshot and reads the 8-byte header in one burst. No RECV is issued: the
+ * payload is read at *ptr with read_data() and the whole datagram is released, read or not,
+ * by a single endRecvUDP().
+ * @return	1 if a datagram was found (payload length in *len), 0 if none is waiting.
+ */
+template <class Chip>
+uint8_t beginRecvUDP(Chip* chip, SOCKET s, uint8_t* addr, uint16_t* port, uint16_t* len,
+                     uint16_t* ptr) {
+    SnSnapshot snap;
+    uint8_t head[8];
+
+    chip->readSnBlock(s, snap, SnSnapshot::POINTERS);
+    if (snap.rx_rsr < 8) return 0;
+
+    chip->read_data(s, snap.rx_rd, head, 8);
+    ETHERNET_PERF_ADD(udpReceived, 1);
+    addr[0] = head[0];
+    addr[1] = head[1];
+    addr[2] = head[2];
+    addr[3] = head[3];
+    *port = head[4];
+    *port = (*port << 8) + head[5];
+    *len = head[6];
+    *len = (*len << 8) + head[7];
+    *ptr = snap.rx_rd + 8;
+    return 1;
+}
+
+/**
+ * @brief	Release a datagram opened with beginRecvUDP(): one Sn_RX_RD write and one RECV.
+ * @param	end RX pointer just past the datagram's payload
+ */
+template <class Chip>
+void endRecvUDP(Chip* chip, SOCKET s, uint16_t end) {
+    chip->writeSnRX_RD(s, end);
+    chip->execCmdSn(s, Sock_RECV);
+}
+
+/**
+ * @brief	Wait for buffered transmission to complete.
+ */
+template <class Chip>
+void flush(Chip* chip, SOCKET s) {
+    // Blocking send() already waits for SEND_OK; only sendAsync() data can be outstanding
+    while (sendPoll(chip, s) == 0);
+}
+
+template <class Chip>
+uint16_t igmpsend(Chip* chip, SOCKET s, const uint8_t* buf, uint16_t len) {
+    uint16_t ret = 0;
+
+    if (len > chip->txBufferSize(s))
+        ret = chip->txBufferSize(s);  // check size not to exceed MAX size.
+    else
+        ret = len;
+
+    if (ret == 0) return 0;
+
+    chip->send_data_processing(s, (uint8_t*)buf, ret);
+    chip->execCmdSn(s, Sock_SEND);
+
+    uint8_t ir;
+    while (((ir = socketIR(chip, s)) & SnIR::SEND_OK) != SnIR::SEND_OK) {
+        if (ir & SnIR::TIMEOUT) {
+            /* in case of igmp, if send fails, then socket closed */
+            /* if you want change, remove this code. */
+            close(chip, s);
+            return 0;
+        }
+    }
+
+    clearSocketIR(chip, s, SnIR::SEND_OK);
+    return ret;
+}
+
+template <class Chip>
+uint16_t bufferData(Chip* chip, SOCKET s, uint16_t offset, const uint8_t* buf,
+                    uint16_t len) {
+    uint16_t ret = 0;
+    uint16_t freesize = chip->getTXFreeSize(s);
+    if (len > freesize) {
+        ret = freesize;  // check size not to exceed MAX size.
+    } else {
+        ret = len;
+    }
+    chip->send_data_processing_offset(s, offset, buf, ret);
+    return ret;
+}
+
+/**
+ * @brief	Producer counterpart of bufferData(): fill a UDP datagram being built with startUDP()
+ * straight from a producer callback, chunk by chunk.
+ * @return	Number of bytes produced into the datagram.
+ */
+template <class Chip>
+uint16_t bufferProduce(Chip* chip, SOCKET s, uint16_t offset, uint16_t len,
+                       SocketWriteProducer producer, void* ctx) {
+    uint8_t chunk[ETHERNET_STREAM_CHUNK_SIZE];
+    uint16_t ret = 0;
+
+    uint16_t freesize = chip->getTXFreeSize(s);
+    uint16_t room = freesize > offset ? freesize - offset : 0;
+    if (len > room) len = room;
+
+    // Same pointer convention as send_data_processing_offset(): Sn_TX_WR plus the offset
+    uint16_t ptr = chip->readSnTX_WR(s) + offset;
+    while (ret < len) {
+        uint16_t want = len - ret;
+        if (want > sizeof(chunk)) want = sizeof(chunk);
+        uint16_t got = producer(ctx, chunk, want);
+        if (got > want) got = want;
+        if (got == 0) break;
+        chip->write_data(s, ptr + ret, chunk, got);
+        ret += got;
+        if (got < want) break;
+    }
+    if (ret > 0) chip->writeSnTX_WR(s, ptr + ret);
+    return ret;
+}
+
+template <class Chip>
+int startUDP(Chip* chip, SOCKET s, uint8_t* addr, uint16_t port) {
+    if (((addr[0] == 0x00) && (addr[1] == 0x00) && (addr[2] == 0x00) && (addr[3] == 0x00)) ||
+        ((port == 0x00))) {
+        return 0;
+    } else {
+        setUDPDest(chip, s, addr, port);
+        return 1;
+    }
+}
+
+template <class Chip>
+int sendUDP(Chip* chip, SOCKET s) {
+    chip->execCmdSn(s, Sock_SEND);
+    return waitSendUDP(chip, s);
+}
+
+/**
+ * @brief	Wait until the socket has len bytes of free TX memory.
+ * @return	false if the socket left the given Sn_SR state (e.g. it was closed) first.
+ */
+template <class Chip>
+bool waitTXRoom(Chip* chip, SOCKET s, uint16_t len, uint8_t state) {
+    SnSnapshot snap;
+    do {
+        chip->readSnBlock(s, snap);
+        if (snap.sr != state) return false;
+    } while (snap.tx_fsr < len);
+    return true;
+}
+
+/**
+ * @brief	Send a batch of UDP datagrams, pipelined through one socket.
+ *
+ * Each datagram is copied into TX memory behind the one the chip is transmitting, and SENT as
+ * soon as that one completes, so the SPI copy of datagram N+1 overlaps the transmission of N.
+ * The destination registers are only rewritten when the destination changes. Each message's
+ * status is set to 1 if it was sent, 0 if it timed out (e.g. ARP failure) or -1 if it was
+ * rejected without sending (null address, port 0, empty, larger than the TX buffer, or the
+ * socket is no longer open for UDP).
+ * @return	Number of datagrams sent.
+ */
+template <class Chip>
+uint16_t sendtoBatch(Chip* chip, SOCKET s, UDPMessage* msgs, uint16_t count) {
+    uint16_t sent = 0;
+    UDPMessage* inflight = nullptr;
+    uint16_t wr = chip->readSnTX_WR(s);
+
+    for (uint16_t i = 0; i < count; i++) {
+        UDPMessage* m = &msgs[i];
+        const uint8_t* a = m->addr;
+        if ((a[0] == 0 && a[1] == 0 && a[2] == 0 && a[3] == 0) || m->port == 0 || m->len == 0 ||
+            m->len > chip->txBufferSize(s)) {
+            m->status = -1;
+            continue;
+        }
+
+        // Copy behind the datagram in flight if it fits; otherwise let that one finish first
+        if (inflight && chip->getTXFreeSize(s) < m->len) {
+            inflight->status = waitSendUDP(chip, s);
+            sent += inflight->status;
+            inflight = nullptr;
+        }
+        if (!waitTXRoom(chip, s, m->len, SnSR::UDP)) {
+            m->status = -1;
+            continue;
+        }
+        chip->write_data(s, wr, m->buf, m->len);
+        wr += m->len;
+
+        if (inflight) {
+            inflight->status = waitSendUDP(chip, s);
+            sent += inflight->status;
+        }
+        setUDPDest(chip, s, m->addr, m->port);
+        chip->writeSnTX_WR(s, wr);
+        chip->execCmdSn(s, Sock_SEND);
+        inflight = m;
+    }
+
+    if (inflight) {
+        inflight->status = waitSendUDP(chip, s);
+        sent += inflight->status;
+    }
+    return sent;
+}
+
+/**
+ * @brief	Send a batch of frames through a MACRAW socket, pipelined like sendtoBatch().
+ *
+ * Each frame is copied into TX memory behind the one the chip is transmitting and SENT as soon
+ * as that one completes. A frame must hold the whole Ethernet header; the chip adds only the
+ * preamble and FCS. Each frame's status is set to 1 if it was sent, 0 if it timed out or -1 if
+ * it was rejected without sending (shorter than a header, larger than the TX buffer, or the
+ * socket is no longer in MACRAW mode).
+ * @return	Number of frames sent.
+ */
+template <class Chip>
+uint16_t sendRawBatch(Chip* chip, SOCKET s, RawFrame* frames, uint16_t count) {
+    uint16_t sent = 0;
+    RawFrame* inflight = nullptr;
+    uint16_t wr = chip->readSnTX_WR(s);
+
+    for (uint16_t i = 0; i < count; i++) {
+        RawFrame* f = &frames[i];
+        if (f->len < 14 || f->len > chip->txBufferSize(s)) {
+            f->status = -1;
+            continue;
+        }
+
+        // Copy behind the frame in flight if it fits; otherwise let that one finish first
+        if (inflight && chip->getTXFreeSize(s) < f->len) {
+            inflight->status = waitSendOK(chip, s);
+            sent += inflight->status;
+            inflight = nullptr;
+        }
+        if (!waitTXRoom(chip, s, f->len, SnSR::MACRAW)) {
+            f->status = -1;
+            continue;
+        }
+        chip->write_data(s, wr, f->buf, f->len);
+        wr += f->len;
+
+        if (inflight) {
+            inflight->status = waitSendOK(chip, s);
+            sent += inflight->status;
+        }
+        chip->writeSnTX_WR(s, wr);
+        chip->execCmdSn(s, Sock_SEND);
+        inflight = f;
+    }
+
+    if (inflight) {
+        inflight->status = waitSendOK(chip, s);
+        sent += inflight->status;
+    }
+    return sent;
+}
+
+#endif
+/* _SOCKET_T_H_ */
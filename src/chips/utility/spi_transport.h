@@ -0,0 +1,93 @@
+/*
+ * spi_transport.h - Block SPI transfer back-ends for WIZnet chips
+ *
+ * Bulk copies to and from chip TX/RX memory dominate SPI time. Calling
+ * SPI.transfer() once per byte leaves most of the bus idle on 32-bit cores, so
+ * the copy is routed through one of the back-ends below, chosen at compile time:
+ *
+ *   WIZNET_SPI_BACKEND_BYTE    one SPI.transfer() call per byte (portable fallback)
+ *   WIZNET_SPI_BACKEND_BUFFER  the core's in-place block transfer / writeBytes()
+ *   WIZNET_SPI_BACKEND_DMA     the core's separate tx/rx buffer transfer, which is
+ *                              DMA or FIFO driven on the cores that provide it
+ *
+ * Define WIZNET_SPI_BACKEND before including the library to override the default.
+ */
+
+#ifndef SPI_TRANSPORT_H
+#define SPI_TRANSPORT_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <string.h>
+
+#define WIZNET_SPI_BACKEND_BYTE 0
+#define WIZNET_SPI_BACKEND_BUFFER 1
+#define WIZNET_SPI_BACKEND_DMA 2
+
+#ifndef WIZNET_SPI_BACKEND
+#if defined(TEENSYDUINO) || (defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED))
+#define WIZNET_SPI_BACKEND WIZNET_SPI_BACKEND_DMA
+#elif defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || \
+    defined(ARDUINO_ARCH_STM32) || defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_SAMD)
+#define WIZNET_SPI_BACKEND WIZNET_SPI_BACKEND_BUFFER
+#else
+#define WIZNET_SPI_BACKEND WIZNET_SPI_BACKEND_BYTE
+#endif
+#endif
+
+// Stack scratch used when a core only offers an in-place transfer and the
+// caller's buffer is const. Kept small for AVR.
+#ifndef WIZNET_SPI_CHUNK_SIZE
+#define WIZNET_SPI_CHUNK_SIZE 32
+#endif
+
+class SPITransport {
+   public:
+    static const uint8_t backend = WIZNET_SPI_BACKEND;
+
+    /**
+     * @brief Clock len bytes from buf out on the bus, discarding what comes back.
+     */
+    static inline void write(SPIClass& spi, const uint8_t* buf, uint16_t len) {
+#if WIZNET_SPI_BACKEND == WIZNET_SPI_BACKEND_DMA
+        spi.transfer(buf, NULL, len);
+#elif WIZNET_SPI_BACKEND == WIZNET_SPI_BACKEND_BUFFER && \
+    (defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266))
+        spi.writeBytes(buf, len);
+#elif WIZNET_SPI_BACKEND == WIZNET_SPI_BACKEND_BUFFER
+        uint8_t chunk[WIZNET_SPI_CHUNK_SIZE];
+        while (len > 0) {
+            uint16_t n = len < sizeof(chunk) ? len : sizeof(chunk);
+            memcpy(chunk, buf, n);
+            spi.transfer(chunk, n);
+            buf += n;
+            len -= n;
+        }
+#else
+        for (uint16_t i = 0; i < len; i++) {
+            spi.transfer(buf[i]);
+        }
+#endif
+    }
+
+    /**
+     * @brief Clock len bytes in from the bus into buf.
+     *
+     * The W5500 ignores MOSI during the data phase of a read, so whatever the
+     * back-end shifts out is harmless.
+     */
+    static inline void read(SPIClass& spi, uint8_t* buf, uint16_t len) {
+#if WIZNET_SPI_BACKEND == WIZNET_SPI_BACKEND_DMA
+        spi.transfer(NULL, buf, len);
+#elif WIZNET_SPI_BACKEND == WIZNET_SPI_BACKEND_BUFFER
+        memset(buf, 0, len);
+        spi.transfer(buf, len);
+#else
+        for (uint16_t i = 0; i < len; i++) {
+            buf[i] = spi.transfer(0);
+        }
+#endif
+    }
+};
+
+#endif  // SPI_TRANSPORT_H
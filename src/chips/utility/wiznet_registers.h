@@ -43,6 +43,22 @@ typedef uint8_t SOCKET;
 #define W5500_UIPR 0x0028     // Unreachable IP Address
 #define W5500_UPORT 0x002C    // Unreachable Port
 #define W5500_PHYCFGR 0x002E  // PHY Configuration Register
+#define W5500_INTLEVEL 0x0013  // Interrupt Low Level Timer (2 bytes)
+#define W5500_SIR 0x0017       // Socket Interrupt Register
+#define W5500_SIMR 0x0018      // Socket Interrupt Mask Register
+#define W5500_VERSIONR 0x0039  // Chip Version Register
+
+#define W5500_VERSION 0x04  // VERSIONR value read back from a W5500
+#define W5500_SOCK_BUF_SIZE 2048  // Default per-socket TX/RX buffer size (8 x 2KB = 16KB)
+#define W5500_BUF_MEM_KB 16       // TX and RX memory, each shared by all sockets
+
+// SPI clock defaults (the W5500 is rated for up to 80 MHz SCLK)
+#ifndef W5500_SPI_DEFAULT_CLOCK
+#define W5500_SPI_DEFAULT_CLOCK 8000000
+#endif
+#ifndef W5500_SPI_MIN_CLOCK
+#define W5500_SPI_MIN_CLOCK 1000000  // Lowest clock init() falls back to
+#endif
 
 // W5100 Specific Memory Size Registers (for TX/RX buffer allocation)
 #define W5100_RMSR 0x001A  // RX Memory Size Register (W5100 only)
@@ -70,6 +86,7 @@ typedef uint8_t SOCKET;
 #define WIZ_Sn_RX_RSR 0x0026  // Socket n RX Received Size (2 bytes)
 #define WIZ_Sn_RX_RD 0x0028   // Socket n RX Read Pointer (2 bytes)
 #define W5500_SnRX_WR 0x002A  // W5500 Socket n RX Write Pointer
+#define W5500_Sn_IMR 0x002C   // W5500 Socket n Interrupt Mask
 
 // W5100 uses a fixed address for each socket block
 #define W5100_S0_MR 0x0400
@@ -157,8 +174,14 @@ class SnMR {
     static const uint8_t IPRAW = 0x03;
     static const uint8_t MACRAW = 0x04;
     static const uint8_t PPPOE = 0x05;
+    static const uint8_t UCASTB = 0x10;  // Block unicast (UDP multicast mode, W5500)
+    static const uint8_t MIP6B = 0x10;   // Block IPv6 frames (MACRAW, W5500)
     static const uint8_t ND = 0x20;
+    static const uint8_t MC = 0x20;      // IGMPv1 instead of v2 (UDP multicast mode)
+    static const uint8_t MMB = 0x20;     // Block multicast frames (MACRAW, W5500)
+    static const uint8_t BCASTB = 0x40;  // Block broadcast (UDP and MACRAW, W5500)
     static const uint8_t MULTI = 0x80;
+    static const uint8_t MFEN = 0x80;    // Only frames to our MAC or broadcast (MACRAW, W5500)
 };
 
 class SnIR {
@@ -189,6 +212,28 @@ class SnSR {
     static const uint8_t PPPOE = 0x5F;
 };
 
+/**
+ * @brief Copy of a socket's status and buffer pointer registers
+ *
+ * Filled by EthernetChip::readSnBlock() using sequential-address burst reads
+ * rather than one transaction per byte. TX_FSR and RX_RSR are taken from a
+ * single sample; see the note above W5500::getTXFreeSize() in w5500.cpp.
+ */
+struct SnSnapshot {
+    static const uint8_t STATUS = 0x01;    // Sn_IR and Sn_SR (one 2-byte burst)
+    static const uint8_t POINTERS = 0x02;  // Sn_TX_FSR .. Sn_RX_WR (one 12-byte burst)
+    static const uint8_t ALL = STATUS | POINTERS;
+
+    uint8_t ir;       // Sn_IR
+    uint8_t sr;       // Sn_SR
+    uint16_t tx_fsr;  // Sn_TX_FSR
+    uint16_t tx_rd;   // Sn_TX_RD
+    uint16_t tx_wr;   // Sn_TX_WR
+    uint16_t rx_rsr;  // Sn_RX_RSR
+    uint16_t rx_rd;   // Sn_RX_RD
+    uint16_t rx_wr;   // Sn_RX_WR
+};
+
 // PHY Configuration Register (W5500 only)
 class W5500PHYCFGR {
    public:
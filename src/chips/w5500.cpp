@@ -46,58 +46,76 @@ uint8_t W5500::getPHYCFGR() {
 
 void W5500::swReset() { writeMR((readMR() | 0x80)); }
 
-uint8_t W5500::readSn(SOCKET _s, uint16_t _addr) {
-    uint8_t cntl_byte = (_s << 5) + 0x08;
-    return read(_addr, cntl_byte);
+void W5500::setSPIClock(uint32_t hz) {
+    _spi_clock = hz;
+    wiznet_SPI_settings = SPISettings(_spi_clock, MSBFIRST, SPI_MODE0);
 }
 
-uint8_t W5500::writeSn(SOCKET _s, uint16_t _addr, uint8_t _data) {
-    uint8_t cntl_byte = (_s << 5) + 0x0C;
-    return write(_addr, cntl_byte, _data);
-}
+bool W5500::init() {
+    initSS();
+    resetSS();
+    _spi->begin();
 
-uint16_t W5500::readSn(SOCKET _s, uint16_t _addr, uint8_t *_buf, uint16_t _len) {
-    uint8_t cntl_byte = (_s << 5) + 0x08;
-    return read(_addr, cntl_byte, _buf, _len);
-}
+    // Self-test: VERSIONR is fixed, so a bad read means the bus can't run this fast
+    while (readVERSIONR() != W5500_VERSION) {
+        if (_spi_clock / 2 < W5500_SPI_MIN_CLOCK) return false;
+        setSPIClock(_spi_clock / 2);
+    }
 
-uint16_t W5500::writeSn(SOCKET _s, uint16_t _addr, uint8_t *_buf, uint16_t _len) {
-    uint8_t cntl_byte = (_s << 5) + 0x0C;
-    return write(_addr, cntl_byte, _buf, _len);
+    this->swReset();
+    applyBufferSizes();
+    _initialized = true;
+    return true;
 }
 
-bool W5500::init() {
-    initSS();
-    SPI.begin();
-    this->swReset();
+void W5500::applyBufferSizes() {
     for (int i = 0; i < this->maxSockets(); i++) {
         uint8_t cntl_byte = (0x0C + (i << 5));
-        write(0x1E, cntl_byte, 2);  // 0x1E - Sn_RXBUF_SIZE
-        write(0x1F, cntl_byte, 2);  // 0x1F - Sn_TXBUF_SIZE
+        write(0x1E, cntl_byte, _rx_kb[i]);  // 0x1E - Sn_RXBUF_SIZE
+        write(0x1F, cntl_byte, _tx_kb[i]);  // 0x1F - Sn_TXBUF_SIZE
     }
-    return true;  // assuming initialization is always successful
 }
 
 bool W5500::linkActive() {
     return getPHYCFGR() & W5500PHYCFGR::LNK_ON;  // Check if link is active
 }
 
-uint16_t W5500::getTXFreeSize(SOCKET s) {
-    uint16_t val = 0, val1 = 0;
-    do {
-        val1 = readSnTX_FSR(s);
-        if (val1 != 0) val = readSnTX_FSR(s);
-    } while (val != val1);
-    return val;
+/*
+ * Sn_TX_FSR and Sn_RX_RSR are read with a single sample, here and in readSnBlock().
+ * The chip can update them during the transfer, but both only grow between our own SEND and
+ * RECV commands and the high byte is clocked out first, so a torn sample is the old high byte
+ * with the new low byte: never more than the true value. The worst case is under-reporting
+ * free space or received data, which the next read corrects, so the repeat-until-two-samples-
+ * agree loop of the WIZnet reference driver is not needed.
+ */
+uint16_t W5500::getTXFreeSize(SOCKET s) { return readSnTX_FSR(s); }
+
+uint16_t W5500::getRXReceivedSize(SOCKET s) { return readSnRX_RSR(s); }
+
+void W5500::readSnBlock(SOCKET s, SnSnapshot &snap, uint8_t parts) {
+    uint8_t buf[12];
+    if (parts & SnSnapshot::STATUS) {
+        // Sn_IR (0x0002) and Sn_SR (0x0003) are adjacent
+        readSn(s, 0x0002, buf, 2);
+        snap.ir = buf[0];
+        snap.sr = buf[1];
+    }
+    if (parts & SnSnapshot::POINTERS) {
+        // Sn_TX_FSR (0x0020) through Sn_RX_WR (0x002A) are contiguous
+        readSn(s, 0x0020, buf, 12);
+        snap.tx_fsr = ((uint16_t)buf[0] << 8) | buf[1];
+        snap.tx_rd = ((uint16_t)buf[2] << 8) | buf[3];
+        snap.tx_wr = ((uint16_t)buf[4] << 8) | buf[5];
+        snap.rx_rsr = ((uint16_t)buf[6] << 8) | buf[7];
+        snap.rx_rd = ((uint16_t)buf[8] << 8) | buf[9];
+        snap.rx_wr = ((uint16_t)buf[10] << 8) | buf[11];
+    }
 }
 
-uint16_t W5500::getRXReceivedSize(SOCKET s) {
-    uint16_t val = 0, val1 = 0;
-    do {
-        val1 = readSnRX_RSR(s);
-        if (val1 != 0) val = readSnRX_RSR(s);
-    } while (val != val1);
-    return val;
+void W5500::write_data(SOCKET s, uint16_t dst, const uint8_t *src, uint16_t len) {
+    uint8_t cntl_byte = (0x14 + (s << 5));
+    write(dst, cntl_byte, src, len);
+    ETHERNET_PERF_ADD(txBytes[s], len);
 }
 
 void W5500::send_data_processing(SOCKET s, const uint8_t *data, uint16_t len) {
@@ -108,9 +126,8 @@ void W5500::send_data_processing(SOCKET s, const uint8_t *data, uint16_t len) {
 void W5500::send_data_processing_offset(SOCKET s, uint16_t data_offset, const uint8_t *data,
                                         uint16_t len) {
     uint16_t ptr = readSnTX_WR(s);
-    uint8_t cntl_byte = (0x14 + (s << 5));
     ptr += data_offset;
-    write(ptr, cntl_byte, data, len);
+    write_data(s, ptr, data, len);
     ptr += len;
     writeSnTX_WR(s, ptr);
 }
@@ -129,69 +146,16 @@ void W5500::recv_data_processing(SOCKET s, uint8_t *data, uint16_t len, uint8_t
 void W5500::read_data(SOCKET s, volatile uint16_t src, volatile uint8_t *dst, uint16_t len) {
     uint8_t cntl_byte = (0x18 + (s << 5));
     read((uint16_t)src, cntl_byte, (uint8_t *)dst, len);
-}
-
-uint8_t W5500::write(uint16_t _addr, uint8_t _cb, uint8_t _data) {
-    SPI.beginTransaction(wiznet_SPI_settings);
-    setSS();
-    SPI.transfer(_addr >> 8);
-    SPI.transfer(_addr & 0xFF);
-    SPI.transfer(_cb);
-    SPI.transfer(_data);
-    resetSS();
-    SPI.endTransaction();
-
-    return 1;
-}
-
-uint16_t W5500::write(uint16_t _addr, uint8_t _cb, const uint8_t *_buf, uint16_t _len) {
-    SPI.beginTransaction(wiznet_SPI_settings);
-    setSS();
-    SPI.transfer(_addr >> 8);
-    SPI.transfer(_addr & 0xFF);
-    SPI.transfer(_cb);
-    for (uint16_t i = 0; i < _len; i++) {
-        SPI.transfer(_buf[i]);
-    }
-    resetSS();
-    SPI.endTransaction();
-
-    return _len;
-}
-
-uint8_t W5500::read(uint16_t _addr, uint8_t _cb) {
-    SPI.beginTransaction(wiznet_SPI_settings);
-    setSS();
-    SPI.transfer(_addr >> 8);
-    SPI.transfer(_addr & 0xFF);
-    SPI.transfer(_cb);
-    uint8_t _data = SPI.transfer(0);
-    resetSS();
-    SPI.endTransaction();
-
-    return _data;
-}
-
-uint16_t W5500::read(uint16_t _addr, uint8_t _cb, uint8_t *_buf, uint16_t _len) {
-    SPI.beginTransaction(wiznet_SPI_settings);
-    setSS();
-    SPI.transfer(_addr >> 8);
-    SPI.transfer(_addr & 0xFF);
-    SPI.transfer(_cb);
-    for (uint16_t i = 0; i < _len; i++) {
-        _buf[i] = SPI.transfer(0);
-    }
-    resetSS();
-    SPI.endTransaction();
-
-    return _len;
+    ETHERNET_PERF_ADD(rxBytes[s], len);
 }
 
 void W5500::execCmdSn(SOCKET s, SockCMD _cmd) {
+    ETHERNET_PERF_START(start);
     // Send command to socket
     writeSnCR(s, _cmd);
     // Wait for command to complete
-    while (readSnCR(s));
+    while (readSnCR(s)) ETHERNET_PERF_ADD(commandSpins, 1);
+    ETHERNET_PERF_EVENT(command, COMMAND, s, ETHERNET_PERF_ELAPSED(start));
 }
 
 uint8_t W5500::getChipType() {
@@ -1,26 +1,45 @@
 #ifndef w55002_h
 #define w55002_h
 
+#include "../EthernetPerf.h"
 #include "EthernetChip.h"
 #include "utility/socket.h"
+#include "utility/spi_transport.h"
 #include "utility/wiznet_registers.h"
 
-class W5500 : public EthernetChip {
+/**
+ * @brief WIZnet W5500 driver
+ *
+ * The class is final so that calls made through a W5500 pointer or reference
+ * (see socket_t.h and EthernetT.h) bind statically, and the inline SPI
+ * accessors below can be folded into the caller.
+ */
+class W5500 final : public EthernetChip {
    protected:
     SPISettings wiznet_SPI_settings;
 
-   public:
-    const uint16_t SSIZE = 2048;
-    const uint16_t RSIZE = 2048;
+    virtual void applyBufferSizes() override;
 
-    W5500(uint8_t cs_pin) : EthernetChip(cs_pin) {
-        wiznet_SPI_settings = SPISettings(8000000, MSBFIRST, SPI_MODE0);
+   public:
+    W5500(uint8_t cs_pin, SPIClass* spi = &SPI, uint32_t spi_clock = W5500_SPI_DEFAULT_CLOCK)
+        : EthernetChip(cs_pin, spi, spi_clock, W5500_SOCK_BUF_SIZE >> 10) {
+        wiznet_SPI_settings = SPISettings(_spi_clock, MSBFIRST, SPI_MODE0);
     }
 
+    /**
+     * @brief Initialize the chip
+     *
+     * Starts the SPI bus and reads VERSIONR back at the requested clock. If the
+     * chip does not answer, the clock is halved until it does or drops below
+     * W5500_SPI_MIN_CLOCK.
+     * @return true if the chip answered, false if no W5500 was found
+     */
     virtual bool init() override;
+    virtual void setSPIClock(uint32_t hz) override;
     virtual bool linkActive() override;
     virtual uint8_t getChipType() override;
     virtual void swReset() override;
+    virtual uint8_t bufferMemoryKB() override { return W5500_BUF_MEM_KB; }
 
     // ---------------------------------------------------------------------
     // Common network configuration accessors (must be implemented)
@@ -107,18 +126,79 @@ class W5500 : public EthernetChip {
     virtual uint16_t getTXFreeSize(SOCKET sock) override;
     virtual uint16_t getRXReceivedSize(SOCKET sock) override;
 
-    virtual uint8_t readSn(SOCKET _s, uint16_t _addr) override;
-    virtual uint8_t writeSn(SOCKET _s, uint16_t _addr, uint8_t _data) override;
-    virtual uint16_t readSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t len) override;
-    virtual uint16_t writeSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t len) override;
+    virtual void readSnBlock(SOCKET s, SnSnapshot& snap,
+                             uint8_t parts = SnSnapshot::ALL) override;
+    virtual void write_data(SOCKET s, uint16_t dst, const uint8_t* src, uint16_t len) override;
 
-    virtual uint8_t write(uint16_t _addr, uint8_t _cb, uint8_t _data) override;
-    virtual uint16_t write(uint16_t _addr, uint8_t _cb, const uint8_t* buf, uint16_t len) override;
-    virtual uint8_t read(uint16_t _addr, uint8_t _cb) override;
-    virtual uint16_t read(uint16_t _addr, uint8_t _cb, uint8_t* buf, uint16_t len) override;
+    // Socket register block select: read (s << 5) + 0x08, write (s << 5) + 0x0C
+    inline uint8_t readSn(SOCKET _s, uint16_t _addr) override {
+        return read(_addr, (_s << 5) + 0x08);
+    }
+    inline uint8_t writeSn(SOCKET _s, uint16_t _addr, uint8_t _data) override {
+        return write(_addr, (_s << 5) + 0x0C, _data);
+    }
+    inline uint16_t readSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t _len) override {
+        return read(_addr, (_s << 5) + 0x08, _buf, _len);
+    }
+    inline uint16_t writeSn(SOCKET _s, uint16_t _addr, uint8_t* _buf, uint16_t _len) override {
+        return write(_addr, (_s << 5) + 0x0C, _buf, _len);
+    }
+
+    inline uint8_t write(uint16_t _addr, uint8_t _cb, uint8_t _data) override {
+        uint8_t frame[4] = {(uint8_t)(_addr >> 8), (uint8_t)(_addr & 0xFF), _cb, _data};
+        _spi->beginTransaction(wiznet_SPI_settings);
+        setSS();
+        SPITransport::write(*_spi, frame, 4);
+        resetSS();
+        _spi->endTransaction();
+        ETHERNET_PERF_ADD(spiWrites, 1);
+        ETHERNET_PERF_ADD(spiBytesWritten, 1);
+        return 1;
+    }
+    inline uint16_t write(uint16_t _addr, uint8_t _cb, const uint8_t* _buf,
+                          uint16_t _len) override {
+        uint8_t header[3] = {(uint8_t)(_addr >> 8), (uint8_t)(_addr & 0xFF), _cb};
+        _spi->beginTransaction(wiznet_SPI_settings);
+        setSS();
+        SPITransport::write(*_spi, header, 3);
+        SPITransport::write(*_spi, _buf, _len);
+        resetSS();
+        _spi->endTransaction();
+        ETHERNET_PERF_ADD(spiWrites, 1);
+        ETHERNET_PERF_ADD(spiBytesWritten, _len);
+        return _len;
+    }
+    inline uint8_t read(uint16_t _addr, uint8_t _cb) override {
+        uint8_t header[3] = {(uint8_t)(_addr >> 8), (uint8_t)(_addr & 0xFF), _cb};
+        uint8_t _data;
+        _spi->beginTransaction(wiznet_SPI_settings);
+        setSS();
+        SPITransport::write(*_spi, header, 3);
+        SPITransport::read(*_spi, &_data, 1);
+        resetSS();
+        _spi->endTransaction();
+        ETHERNET_PERF_ADD(spiReads, 1);
+        ETHERNET_PERF_ADD(spiBytesRead, 1);
+        return _data;
+    }
+    inline uint16_t read(uint16_t _addr, uint8_t _cb, uint8_t* _buf, uint16_t _len) override {
+        uint8_t header[3] = {(uint8_t)(_addr >> 8), (uint8_t)(_addr & 0xFF), _cb};
+        _spi->beginTransaction(wiznet_SPI_settings);
+        setSS();
+        SPITransport::write(*_spi, header, 3);
+        SPITransport::read(*_spi, _buf, _len);
+        resetSS();
+        _spi->endTransaction();
+        ETHERNET_PERF_ADD(spiReads, 1);
+        ETHERNET_PERF_ADD(spiBytesRead, _len);
+        return _len;
+    }
 
     virtual void execCmdSn(SOCKET sock, SockCMD _cmd) override;
 
+    /** Read the chip version register (0x04 on a W5500) */
+    uint8_t readVERSIONR() { return read(W5500_VERSIONR, 0x00); }
+
     __SOCKET_REGISTER8(SnMR, 0x0000)        // Mode
     __SOCKET_REGISTER8(SnCR, 0x0001)        // Command
     __SOCKET_REGISTER8(SnIR, 0x0002)        // Interrupt
@@ -137,6 +217,7 @@ class W5500 : public EthernetChip {
     __SOCKET_REGISTER16(SnRX_RSR, 0x0026)   // RX Free Size
     __SOCKET_REGISTER16(SnRX_RD, 0x0028)    // RX Read Pointer
     __SOCKET_REGISTER16(SnRX_WR, 0x002A)    // RX Write Pointer (supported?)
+    __SOCKET_REGISTER8(SnIMR, 0x002C)       // Interrupt Mask
 
     __GP_REGISTER8(MR, 0x0000);        // Mode
     __GP_REGISTER_N(GAR, 0x0001, 4);   // Gateway IP address
@@ -150,6 +231,9 @@ class W5500 : public EthernetChip {
     __GP_REGISTER_N(UIPR, 0x0028, 4);  // Unreachable IP address in UDP mode
     __GP_REGISTER16(UPORT, 0x002C);    // Unreachable Port address in UDP mode
     __GP_REGISTER8(PHYCFGR, 0x002E);   // PHY Configuration register, default value: 0b 1011 1xxx
+    __GP_REGISTER16(INTLEVEL, 0x0013); // Interrupt Low Level Timer
+    __GP_REGISTER8(SIR, 0x0017);       // Socket Interrupt (one bit per socket)
+    __GP_REGISTER8(SIMR, 0x0018);      // Socket Interrupt Mask
 };
 
 #endif  // w55002_h
\ No newline at end of file
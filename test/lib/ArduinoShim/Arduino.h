@@ -0,0 +1,196 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for building Ethernet3 on the host
+ *
+ * Just enough of the Arduino API for the library and W5500Sim to compile and
+ * run natively (pio test -e native). There is no hardware behind it: pins and
+ * SPI do nothing, and delay() advances millis()/micros() without sleeping.
+ */
+
+#ifndef arduino_shim_h
+#define arduino_shim_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define MSBFIRST 1
+#define DEC 10
+#define HEX 16
+#define A0 14
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define IRAM_ATTR
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t irq);
+void noInterrupts();
+void interrupts();
+
+long random(long max);
+long random(long min, long max);
+
+inline uint16_t word(uint8_t h, uint8_t l) { return ((uint16_t)h << 8) | l; }
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+/** @brief Heap string with the subset of the Arduino String API the library uses */
+class String {
+   private:
+    char* _buf;
+    unsigned _len;
+
+    void assign(const char* s, unsigned n);
+    void append(const char* s, unsigned n);
+
+   public:
+    String(const char* s = "");
+    String(const String& other);
+    String(const __FlashStringHelper* s);
+    explicit String(char c);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator+=(const String& other);
+    String& operator+=(const char* s);
+    String& operator+=(char c);
+    friend String operator+(const String& a, const String& b);
+    friend String operator+(const String& a, const char* b);
+    friend String operator+(const char* a, const String& b);
+
+    bool operator==(const String& other) const { return strcmp(_buf, other._buf) == 0; }
+    bool operator==(const char* s) const { return strcmp(_buf, s) == 0; }
+    bool operator!=(const String& other) const { return !(*this == other); }
+    bool operator!=(const char* s) const { return !(*this == s); }
+    char operator[](unsigned i) const { return i < _len ? _buf[i] : 0; }
+
+    char charAt(unsigned i) const { return (*this)[i]; }
+    unsigned length() const { return _len; }
+    const char* c_str() const { return _buf; }
+    bool reserve(unsigned size);
+    void concat(const char* s, unsigned n) { append(s, n); }
+
+    int indexOf(char c, unsigned from = 0) const;
+    int indexOf(const String& s, unsigned from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned from, unsigned to) const;
+    String substring(unsigned from) const { return substring(from, _len); }
+    bool startsWith(const String& s) const { return strncmp(_buf, s._buf, s._len) == 0; }
+    bool endsWith(const String& s) const;
+    bool equalsIgnoreCase(const String& s) const;
+    void trim();
+    void toLowerCase();
+    long toInt() const { return atol(_buf); }
+};
+
+class Printable {};
+
+/** @brief Byte sink with Arduino's print()/println() overloads */
+class Print {
+   private:
+    int _writeError = 0;
+
+   public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t write(const char* buf, size_t size) { return write((const uint8_t*)buf, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    void setWriteError(int err = 1) { _writeError = err; }
+    int getWriteError() { return _writeError; }
+    void clearWriteError() { _writeError = 0; }
+
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) {
+        return print(value) + println();
+    }
+    template <typename T>
+    size_t println(const T& value, int format) {
+        return print(value, format) + println();
+    }
+};
+
+/** @brief Readable byte stream */
+class Stream : public Print {
+   protected:
+    unsigned long _timeout = 1000;
+
+   public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytes(char* buf, size_t size);
+    size_t readBytes(uint8_t* buf, size_t size) { return readBytes((char*)buf, size); }
+    String readStringUntil(char terminator);
+};
+
+/** @brief Serial port writing to stdout */
+class HardwareSerial : public Stream {
+   public:
+    void begin(unsigned long) {}
+    operator bool() { return true; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t b) override { return fputc(b, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#include "IPAddress.h"
+
+#endif
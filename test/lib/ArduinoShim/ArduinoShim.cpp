@@ -0,0 +1,226 @@
+/**
+ * @file ArduinoShim.cpp
+ * @brief Runtime of the host Arduino shim
+ */
+
+#include <ctype.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "SPI.h"
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+// ===== Time =====
+
+// Microseconds skipped by delay(), added to the real clock
+static unsigned long long skipped_us = 0;
+
+static unsigned long long now_us() {
+    static unsigned long long start = 0;
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    unsigned long long us = (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    if (start == 0) start = us;
+    return us - start + skipped_us;
+}
+
+unsigned long millis() { return (unsigned long)(now_us() / 1000); }
+unsigned long micros() { return (unsigned long)now_us(); }
+void delay(unsigned long ms) { skipped_us += (unsigned long long)ms * 1000; }
+void delayMicroseconds(unsigned int us) { skipped_us += us; }
+void yield() {}
+
+// ===== Pins and interrupts: nothing is wired =====
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+int analogRead(uint8_t) { return 0; }
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t, void (*)(void), int) {}
+void detachInterrupt(uint8_t) {}
+void noInterrupts() {}
+void interrupts() {}
+
+long random(long max) { return max > 0 ? rand() % max : 0; }
+long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+
+// ===== String =====
+
+void String::assign(const char* s, unsigned n) {
+    char* buf = (char*)malloc(n + 1);
+    memcpy(buf, s, n);
+    buf[n] = 0;
+    free(_buf);
+    _buf = buf;
+    _len = n;
+}
+
+void String::append(const char* s, unsigned n) {
+    char* buf = (char*)realloc(_buf, _len + n + 1);
+    memcpy(buf + _len, s, n);
+    _len += n;
+    buf[_len] = 0;
+    _buf = buf;
+}
+
+String::String(const char* s) : _buf(nullptr), _len(0) { assign(s ? s : "", s ? strlen(s) : 0); }
+String::String(const String& other) : _buf(nullptr), _len(0) { assign(other._buf, other._len); }
+String::String(const __FlashStringHelper* s) : String((const char*)s) {}
+String::String(char c) : _buf(nullptr), _len(0) { assign(&c, 1); }
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) : _buf(nullptr), _len(0) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", value);
+    assign(text, strlen(text));
+}
+
+String::String(unsigned long value, unsigned char base) : _buf(nullptr), _len(0) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", value);
+    assign(text, strlen(text));
+}
+
+String::~String() { free(_buf); }
+
+String& String::operator=(const String& other) {
+    if (this != &other) assign(other._buf, other._len);
+    return *this;
+}
+
+String& String::operator+=(const String& other) { return *this += other._buf; }
+
+String& String::operator+=(const char* s) {
+    append(s, strlen(s));
+    return *this;
+}
+
+String& String::operator+=(char c) {
+    append(&c, 1);
+    return *this;
+}
+
+String operator+(const String& a, const String& b) {
+    String r(a);
+    r += b;
+    return r;
+}
+
+String operator+(const String& a, const char* b) {
+    String r(a);
+    r += b;
+    return r;
+}
+
+String operator+(const char* a, const String& b) {
+    String r(a);
+    r += b;
+    return r;
+}
+
+bool String::reserve(unsigned size) {
+    if (size <= _len) return true;
+    char* buf = (char*)realloc(_buf, size + 1);
+    if (buf == nullptr) return false;
+    _buf = buf;
+    return true;
+}
+
+int String::indexOf(char c, unsigned from) const {
+    for (unsigned i = from; i < _len; i++) {
+        if (_buf[i] == c) return i;
+    }
+    return -1;
+}
+
+int String::indexOf(const String& s, unsigned from) const {
+    if (from > _len) return -1;
+    const char* found = strstr(_buf + from, s._buf);
+    return found ? (int)(found - _buf) : -1;
+}
+
+int String::lastIndexOf(char c) const {
+    for (int i = (int)_len - 1; i >= 0; i--) {
+        if (_buf[i] == c) return i;
+    }
+    return -1;
+}
+
+String String::substring(unsigned from, unsigned to) const {
+    if (to > _len) to = _len;
+    if (from > to) from = to;
+    String r;
+    r.assign(_buf + from, to - from);
+    return r;
+}
+
+bool String::endsWith(const String& s) const {
+    return s._len <= _len && strcmp(_buf + _len - s._len, s._buf) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& s) const {
+    if (s._len != _len) return false;
+    for (unsigned i = 0; i < _len; i++) {
+        if (tolower((unsigned char)_buf[i]) != tolower((unsigned char)s._buf[i])) return false;
+    }
+    return true;
+}
+
+void String::trim() {
+    unsigned start = 0, end = _len;
+    while (start < end && isspace((unsigned char)_buf[start])) start++;
+    while (end > start && isspace((unsigned char)_buf[end - 1])) end--;
+    String r = substring(start, end);
+    *this = r;
+}
+
+void String::toLowerCase() {
+    for (unsigned i = 0; i < _len; i++) _buf[i] = tolower((unsigned char)_buf[i]);
+}
+
+// ===== Print and Stream =====
+
+size_t Print::write(const uint8_t* buf, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buf[n])) n++;
+    return n;
+}
+
+size_t Print::print(long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+size_t Stream::readBytes(char* buf, size_t size) {
+    size_t n = 0;
+    while (n < size) {
+        int c = read();
+        if (c < 0) break;
+        buf[n++] = (char)c;
+    }
+    return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String r;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) r += (char)c;
+    return r;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file IPAddress.h
+ * @brief IPv4 address type of the host Arduino shim
+ */
+
+#ifndef ipaddress_shim_h
+#define ipaddress_shim_h
+
+#include <stdint.h>
+
+class IPAddress {
+   private:
+    union {
+        uint8_t bytes[4];
+        uint32_t dword;
+    } _address;
+
+   public:
+    IPAddress() { _address.dword = 0; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _address.bytes[0] = a;
+        _address.bytes[1] = b;
+        _address.bytes[2] = c;
+        _address.bytes[3] = d;
+    }
+    IPAddress(uint32_t address) { _address.dword = address; }
+    IPAddress(const uint8_t* address) { *this = address; }
+
+    operator uint32_t() const { return _address.dword; }
+    bool operator==(const IPAddress& other) const { return _address.dword == other._address.dword; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+    uint8_t operator[](int i) const { return _address.bytes[i]; }
+    uint8_t& operator[](int i) { return _address.bytes[i]; }
+
+    IPAddress& operator=(const uint8_t* address) {
+        for (int i = 0; i < 4; i++) _address.bytes[i] = address[i];
+        return *this;
+    }
+    IPAddress& operator=(uint32_t address) {
+        _address.dword = address;
+        return *this;
+    }
+
+    uint8_t* raw_address() { return _address.bytes; }
+};
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+#endif
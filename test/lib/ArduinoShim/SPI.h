@@ -0,0 +1,31 @@
+/**
+ * @file SPI.h
+ * @brief SPI bus of the host Arduino shim: transfers go nowhere and read 0
+ */
+
+#ifndef spi_shim_h
+#define spi_shim_h
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0
+
+class SPISettings {
+   public:
+    SPISettings() {}
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass {
+   public:
+    void begin() {}
+    void end() {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t) { return 0; }
+    void transfer(void* buf, size_t size) { memset(buf, 0, size); }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,16 @@
+/**
+ * @file Server.h
+ * @brief Arduino Server interface for the host shim
+ */
+
+#ifndef server_shim_h
+#define server_shim_h
+
+#include "Arduino.h"
+
+class Server : public Print {
+   public:
+    virtual void begin() = 0;
+};
+
+#endif
@@ -0,0 +1,426 @@
+/**
+ * @file test_main.cpp
+ * @brief Host tests: the library against W5500Sim
+ *
+ * Run with: pio test -e native
+ *
+ * Functional checks of TCP, UDP and HTTP, regression checks for socket
+ * ownership bugs, and SPI budgets: the SPI traffic of the hot paths is
+ * counted by the simulator and compared with fixed limits, so a change that
+ * adds a register access to one of them fails here. Lower a budget when an
+ * optimisation lands; raise one only with a reason.
+ */
+
+#include <unity.h>
+
+#include <Ethernet3.h>
+#include <EthernetGroup.h>
+#include <EthernetT.h>
+#include <EthernetUdp2.h>
+#include <HTTP.h>
+#include <chips/sim/w5500sim.h>
+
+static uint8_t mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
+static uint8_t peerIP[] = {192, 168, 1, 2};
+static const IPAddress localIP(192, 168, 1, 177);
+
+static W5500Sim chip;
+static EthernetClass eth(&chip);
+
+// Bytes the simulated chip put on the wire
+static char sent[2048];
+static uint16_t sentLen;
+
+static void captureTransmit(void* ctx, SOCKET s, const uint8_t* data, uint16_t len) {
+    uint16_t room = sizeof(sent) - 1 - sentLen;
+    if (len > room) len = room;
+    memcpy(sent + sentLen, data, len);
+    sentLen += len;
+    sent[sentLen] = 0;
+}
+
+static int findSocket(W5500Sim& sim, uint8_t status, uint16_t port = 0) {
+    for (int s = 0; s < MAX_SOCK_NUM; s++) {
+        if (sim.readSnSR(s) == status && (port == 0 || sim.readSnPORT(s) == port)) return s;
+    }
+    return -1;
+}
+
+static HTTPResponse handleRoot(const HTTPRequest& request) { return HTTPServer::sendPlain("hello"); }
+
+void setUp(void) {
+    chip.onTransmit(captureTransmit);
+    chip.setConnectRefused(false);
+    eth.begin(mac, localIP);
+    chip.resetStats();
+    sentLen = 0;
+    sent[0] = 0;
+}
+
+void tearDown(void) {}
+
+// ===== SPI budgets =====
+
+/** @brief Fail if the SPI transactions since the last resetStats() exceed a budget */
+static void checkBudget(const char* name, uint32_t transactions, int runs = 1) {
+    const W5500SimStats& st = chip.stats();
+    uint32_t used = (st.reads + st.writes) / runs;
+    char line[96];
+    snprintf(line, sizeof(line), "%-18s %4lu SPI transactions (budget %lu)", name,
+             (unsigned long)used, (unsigned long)transactions);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(transactions, used);
+    chip.resetStats();
+}
+
+// ===== Functional =====
+
+void test_tcp_server_roundtrip(void) {
+    EthernetServer server(&eth, &chip, 23);
+    server.begin();
+    int s = findSocket(chip, SnSR::LISTEN, 23);
+    TEST_ASSERT_TRUE(s >= 0);
+
+    TEST_ASSERT_TRUE(chip.peerConnect(s, peerIP, 40000));
+    TEST_ASSERT_EQUAL(5, chip.peerSend(s, (const uint8_t*)"hello", 5));
+    EthernetClient client = server.available();
+    TEST_ASSERT_TRUE((bool)client);
+
+    uint8_t buf[16];
+    TEST_ASSERT_EQUAL(5, client.read(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY("hello", buf, 5);
+
+    TEST_ASSERT_EQUAL(5, client.write((const uint8_t*)"world", 5));
+    client.flush();
+    TEST_ASSERT_EQUAL_STRING("world", sent);
+
+    chip.peerClose(s);
+    client.stop();
+    TEST_ASSERT_EQUAL(MAX_SOCK_NUM - 1, eth.freeSockets());  // the listener stays
+}
+
+void test_udp_roundtrip(void) {
+    EthernetUDP udp(&eth, &chip);
+    TEST_ASSERT_EQUAL(1, udp.begin(5000));
+    int s = findSocket(chip, SnSR::UDP, 5000);
+    TEST_ASSERT_TRUE(s >= 0);
+
+    TEST_ASSERT_TRUE(chip.peerSendUDP(s, peerIP, 6000, (const uint8_t*)"ping", 4));
+    TEST_ASSERT_EQUAL(4, udp.parsePacket());
+    TEST_ASSERT_EQUAL(6000, udp.remotePort());
+    uint8_t buf[8];
+    TEST_ASSERT_EQUAL(4, udp.read(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY("ping", buf, 4);
+
+    udp.beginPacket(IPAddress(peerIP), 6000);
+    udp.write((const uint8_t*)"pong", 4);
+    TEST_ASSERT_EQUAL(1, udp.endPacket());
+    TEST_ASSERT_EQUAL_STRING("pong", sent);
+    udp.stop();
+}
+
+void test_http_get(void) {
+    HTTPServer http(&eth, &chip, 80);
+    http.onGET("/", handleRoot);
+    http.begin();
+    http.handleClient();
+    int s = findSocket(chip, SnSR::LISTEN, 80);
+    TEST_ASSERT_TRUE(s >= 0);
+
+    const char* request = "GET / HTTP/1.1\r\nHost: test\r\n\r\n";
+    chip.peerConnect(s, peerIP, 40001);
+    chip.peerSend(s, (const uint8_t*)request, strlen(request));
+    for (int i = 0; i < 3; i++) http.handleClient();
+    TEST_ASSERT_NOT_NULL(strstr(sent, "200"));
+    TEST_ASSERT_NOT_NULL(strstr(sent, "hello"));
+}
+
+// ===== Regressions =====
+
+// A socket reclaimed from a client that left it CLOSED must not be freed
+// again by that client once someone else holds it
+void test_stale_handle_cannot_free_reused_socket(void) {
+    EthernetUDP udp(&eth, &chip);
+    TEST_ASSERT_EQUAL(1, udp.begin(5000));
+    int s = findSocket(chip, SnSR::UDP, 5000);
+    EthernetClient client(&eth, &chip);
+    TEST_ASSERT_EQUAL(1, client.connect(IPAddress(peerIP), 80));
+    int c = findSocket(chip, SnSR::ESTABLISHED);
+    TEST_ASSERT_TRUE(c >= 0);
+    close(&chip, s);
+    close(&chip, c);
+
+    // Fill the chip with open sockets: the closed ones are reclaimed to make room
+    uint8_t sock;
+    while ((sock = eth.allocSocket()) != MAX_SOCK_NUM) socket(&chip, sock, SnMR::UDP, 7000 + sock, 0);
+    TEST_ASSERT_EQUAL(2, eth.socketStats().reclaims);
+    TEST_ASSERT_EQUAL(SockOwner::USER, eth.socketOwner(s));
+    TEST_ASSERT_EQUAL(SockOwner::USER, eth.socketOwner(c));
+
+    udp.stop();
+    TEST_ASSERT_EQUAL(SockOwner::USER, eth.socketOwner(s));
+    TEST_ASSERT_EQUAL_HEX8(SnSR::UDP, chip.readSnSR(s));
+
+    // The client's old socket now carries someone else's connection
+    socket(&chip, c, SnMR::TCP, 8000, 0);
+    listen(&chip, c);
+    TEST_ASSERT_TRUE(chip.peerConnect(c, peerIP, 40002));
+    TEST_ASSERT_EQUAL(3, chip.peerSend(c, (const uint8_t*)"new", 3));
+
+    uint8_t buf[8];
+    TEST_ASSERT_EQUAL(0, client.available());
+    TEST_ASSERT_EQUAL(-1, client.read());
+    TEST_ASSERT_EQUAL(0, client.write((const uint8_t*)"old", 3));
+    TEST_ASSERT_EQUAL(-1, client.read(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(3, chip.getRXReceivedSize(c));
+    TEST_ASSERT_EQUAL(0, sentLen);
+    TEST_ASSERT_EQUAL(SockOwner::USER, eth.socketOwner(c));
+}
+
+// A failed asynchronous connect gives its socket back before its handler runs
+static int connectResult;
+static uint8_t freeInHandler;
+static void onConnect(void* ctx, uint8_t sock, int8_t result) {
+    connectResult = result;
+    freeInHandler = eth.freeSockets();
+}
+
+void test_failed_connect_frees_socket(void) {
+    chip.setConnectRefused(true);
+    connectResult = 0;
+    EthernetClient client(&eth, &chip);
+    TEST_ASSERT_EQUAL(1, client.connectAsync(IPAddress(peerIP), 80, onConnect));
+    for (int i = 0; i < 100 && connectResult == 0; i++) {
+        eth.maintain();
+        delay(10);
+    }
+    TEST_ASSERT_EQUAL(-1, connectResult);
+    TEST_ASSERT_EQUAL(MAX_SOCK_NUM, freeInHandler);
+    TEST_ASSERT_EQUAL(-1, client.connectStatus());
+    TEST_ASSERT_FALSE((bool)client);
+}
+
+// Every chip hands out its own ephemeral ports: connections on one chip do
+// not move the other's counter
+void test_ephemeral_ports_per_chip(void) {
+    W5500Sim other;
+    EthernetClass otherEth(&other);
+    otherEth.begin(mac, IPAddress(192, 168, 1, 178));
+
+    EthernetClient a(&eth, &chip), b(&otherEth, &other);
+    TEST_ASSERT_EQUAL(1, a.connect(IPAddress(peerIP), 80));
+    TEST_ASSERT_EQUAL(1, b.connect(IPAddress(peerIP), 80));
+    TEST_ASSERT_EQUAL(1025, other.readSnPORT(0));
+}
+
+// A client that closed while the server still held its socket does not stall accept
+void test_close_wait_does_not_block_server(void) {
+    EthernetServer server(&eth, &chip, 23);
+    server.begin();
+    int s = findSocket(chip, SnSR::LISTEN, 23);
+    chip.peerConnect(s, peerIP, 40000);
+    chip.peerClose(s);
+
+    unsigned long start = millis();
+    server.available();
+    TEST_ASSERT_LESS_OR_EQUAL(50, millis() - start);
+}
+
+// Coalesced writes left alone go out from maintain() once they age
+void test_maintain_flushes_idle_writes(void) {
+    uint8_t buf[64];
+    EthernetClient client(&eth, &chip);
+    TEST_ASSERT_EQUAL(1, client.connect(IPAddress(peerIP), 80));
+    client.setWriteBuffer(buf, sizeof(buf));
+    client.setWriteIdleTimeout(5);
+
+    client.write((const uint8_t*)"abc", 3);
+    eth.maintain();
+    TEST_ASSERT_EQUAL(0, sentLen);
+    delay(10);
+    eth.maintain();
+    eth.maintain();
+    TEST_ASSERT_EQUAL_STRING("abc", sent);
+}
+
+// An empty group hands out a client that fails to connect instead of crashing
+void test_empty_group_client(void) {
+    EthernetGroup group;
+    EthernetClient client = group.client();
+    TEST_ASSERT_EQUAL(0, client.connect(IPAddress(peerIP), 80));
+    TEST_ASSERT_EQUAL(0, client.connect("example.com", 80));
+    TEST_ASSERT_FALSE((bool)client);
+    TEST_ASSERT_EQUAL(0, client.available());
+    client.stop();
+}
+
+// Writes larger than the socket's TX memory go out in pieces, none dropped
+void test_write_larger_than_tx_memory(void) {
+    static uint8_t data[1500], wbuf[1200];
+    for (uint16_t i = 0; i < sizeof(data); i++) data[i] = 'a' + i % 26;
+    uint8_t kb[MAX_SOCK_NUM] = {1, 1, 1, 1, 1, 1, 1, 1};
+    W5500Sim small;
+    EthernetClass smallEth(&small);
+    small.setSocketBufferSizes(kb, kb);
+    smallEth.begin(mac, IPAddress(192, 168, 1, 178));
+    small.onTransmit(captureTransmit);
+
+    EthernetClient client(&smallEth, &small);
+    TEST_ASSERT_EQUAL(1, client.connect(IPAddress(peerIP), 80));
+    TEST_ASSERT_EQUAL(sizeof(data), client.write(data, sizeof(data)));
+    TEST_ASSERT_EQUAL(sizeof(data), sentLen);
+    TEST_ASSERT_EQUAL_MEMORY(data, sent, sizeof(data));
+
+    sentLen = 0;
+    client.setWriteBuffer(wbuf, sizeof(wbuf));
+    for (uint16_t i = 0; i < sizeof(data); i += 100) client.write(data + i, 100);
+    client.flush();
+    TEST_ASSERT_EQUAL(sizeof(data), sentLen);
+    TEST_ASSERT_EQUAL_MEMORY(data, sent, sizeof(data));
+}
+
+// The same, for the client bound to the concrete chip
+void test_write_larger_than_tx_memory_t(void) {
+    static uint8_t data[1500];
+    for (uint16_t i = 0; i < sizeof(data); i++) data[i] = 'a' + i % 26;
+    uint8_t kb[MAX_SOCK_NUM] = {1, 1, 1, 1, 1, 1, 1, 1};
+    W5500Sim small;
+    EthernetClass smallEth(&small);
+    small.setSocketBufferSizes(kb, kb);
+    smallEth.begin(mac, IPAddress(192, 168, 1, 178));
+    small.onTransmit(captureTransmit);
+
+    EthernetClientT<W5500Sim> client(&smallEth, &small);
+    TEST_ASSERT_EQUAL(1, client.connect(IPAddress(peerIP), 80));
+    TEST_ASSERT_EQUAL(sizeof(data), client.write(data, sizeof(data)));
+    TEST_ASSERT_EQUAL(sizeof(data), sentLen);
+    TEST_ASSERT_EQUAL_MEMORY(data, sent, sizeof(data));
+}
+
+// stopAsync() sends buffered data that does not fit in TX memory before the FIN
+static int8_t closeResult;
+static void onClosed(void* ctx, uint8_t sock, int8_t result) { closeResult = result; }
+
+void test_stop_async_sends_whole_buffer(void) {
+    static uint8_t data[1500], wbuf[2048];
+    for (uint16_t i = 0; i < sizeof(data); i++) data[i] = 'a' + i % 26;
+    uint8_t kb[MAX_SOCK_NUM] = {1, 1, 1, 1, 1, 1, 1, 1};
+    W5500Sim small;
+    EthernetClass smallEth(&small);
+    small.setSocketBufferSizes(kb, kb);
+    smallEth.begin(mac, IPAddress(192, 168, 1, 178));
+    small.onTransmit(captureTransmit);
+
+    EthernetClient client(&smallEth, &small);
+    TEST_ASSERT_EQUAL(1, client.connect(IPAddress(peerIP), 80));
+    client.setWriteBuffer(wbuf, sizeof(wbuf));
+    client.setWriteIdleTimeout(0);
+    for (uint16_t i = 0; i < sizeof(data); i += 100) client.write(data + i, 100);
+    TEST_ASSERT_EQUAL(0, sentLen);
+
+    closeResult = -1;
+    client.stopAsync(onClosed);
+    for (int i = 0; i < 100 && closeResult == -1; i++) smallEth.maintain();
+    TEST_ASSERT_EQUAL(1, closeResult);
+    TEST_ASSERT_EQUAL(sizeof(data), sentLen);
+    TEST_ASSERT_EQUAL_MEMORY(data, sent, sizeof(data));
+}
+
+// ===== SPI budgets of the hot paths =====
+
+void test_budget_tcp(void) {
+    const int runs = 8;
+    uint8_t buf[1024];
+    memset(buf, 'x', sizeof(buf));
+
+    EthernetServer server(&eth, &chip, 23);
+    server.begin();
+    int s = findSocket(chip, SnSR::LISTEN, 23);
+    chip.resetStats();
+
+    for (int i = 0; i < runs; i++) server.available();
+    checkBudget("server idle poll", 1, runs);
+
+    chip.peerConnect(s, peerIP, 40000);
+    chip.peerSend(s, buf, 1);
+    chip.resetStats();
+    EthernetClient client = server.available();
+    checkBudget("server accept", 12);
+    client.read();
+    chip.resetStats();
+
+    for (int i = 0; i < runs; i++) {
+        chip.peerSend(s, buf, sizeof(buf));
+        client.read(buf, sizeof(buf));
+    }
+    checkBudget("tcp recv 1 KB", 6, runs);
+
+    for (int i = 0; i < runs; i++) {
+        client.write(buf, sizeof(buf));
+        client.flush();
+    }
+    checkBudget("tcp send 1 KB", 8, runs);
+}
+
+void test_budget_udp(void) {
+    const int runs = 8;
+    uint8_t buf[64];
+    memset(buf, 'x', sizeof(buf));
+
+    EthernetUDP udp(&eth, &chip);
+    udp.begin(5000);
+    int s = findSocket(chip, SnSR::UDP, 5000);
+    chip.resetStats();
+
+    for (int i = 0; i < runs; i++) {
+        chip.peerSendUDP(s, peerIP, 6000, buf, sizeof(buf));
+        udp.parsePacket();
+        udp.read(buf, sizeof(buf));
+    }
+    checkBudget("udp recv 64 B", 6, runs);
+
+    for (int i = 0; i < runs; i++) {
+        udp.beginPacket(IPAddress(peerIP), 6000);
+        udp.write(buf, sizeof(buf));
+        udp.endPacket();
+    }
+    checkBudget("udp send 64 B", 8, runs);
+}
+
+void test_budget_http(void) {
+    const int runs = 8;
+    const char* request = "GET / HTTP/1.1\r\nHost: test\r\n\r\n";
+    HTTPServer http(&eth, &chip, 80);
+    http.onGET("/", handleRoot);
+    http.begin();
+    http.handleClient();
+    int s = findSocket(chip, SnSR::LISTEN, 80);
+
+    chip.peerConnect(s, peerIP, 40001);
+    chip.resetStats();
+    for (int i = 0; i < runs; i++) {
+        chip.peerSend(s, (const uint8_t*)request, strlen(request));
+        http.handleClient();
+    }
+    checkBudget("http GET /", 23, runs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tcp_server_roundtrip);
+    RUN_TEST(test_udp_roundtrip);
+    RUN_TEST(test_http_get);
+    RUN_TEST(test_stale_handle_cannot_free_reused_socket);
+    RUN_TEST(test_failed_connect_frees_socket);
+    RUN_TEST(test_ephemeral_ports_per_chip);
+    RUN_TEST(test_close_wait_does_not_block_server);
+    RUN_TEST(test_maintain_flushes_idle_writes);
+    RUN_TEST(test_empty_group_client);
+    RUN_TEST(test_write_larger_than_tx_memory);
+    RUN_TEST(test_write_larger_than_tx_memory_t);
+    RUN_TEST(test_stop_async_sends_whole_buffer);
+    RUN_TEST(test_budget_tcp);
+    RUN_TEST(test_budget_udp);
+    RUN_TEST(test_budget_http);
+    return UNITY_END();
+}